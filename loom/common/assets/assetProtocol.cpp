@@ -120,6 +120,35 @@ void NetworkBuffer::readCheckpoint(int _value)
 }
 
 
+// Log groups named by incoming LOG2 frames, so log rules and listeners see
+// the sender's group. Like groups made with lmDefineLogGroup they live for
+// the rest of the process, as queued log records may still point at them.
+static utHashTable<utHashedString, loom_logGroup_t *> gRemoteLogGroups;
+
+static loom_logGroup_t *assetProtocol_getRemoteLogGroup(const char *name)
+{
+    loom_logGroup_t **found = gRemoteLogGroups.get(utHashedString(name));
+
+    if (found)
+    {
+        return *found;
+    }
+
+    int  nameLength = (int)strlen(name);
+    char *nameCopy  = (char *)lmAlloc(NULL, nameLength + 1);
+    memcpy(nameCopy, name, nameLength + 1);
+
+    loom_logGroup_t *group = (loom_logGroup_t *)lmAlloc(NULL, sizeof(loom_logGroup_t));
+    group->name           = nameCopy;
+    group->enabled        = 1;
+    group->filterLevel    = LoomLogDebug;
+    group->ruleCacheToken = 0;    // Rules get applied on first use.
+
+    gRemoteLogGroups.insert(utHashedString(name), group);
+    return group;
+}
+
+
 class AssetProtocolPingAndLogMessageListener : public AssetProtocolMessageListener
 {
 public:
@@ -154,6 +183,39 @@ public:
             lmFree(NULL, logString);
 
             return true;
+
+        case LOOM_FOURCC('L', 'O', 'G', '2'):
+        {
+            // Level, group, then the same text LOG1 would carry.
+            int  level = buffer.readInt();
+            char *groupString, *logStringBinary;
+            int  groupStringLength, logStringBinaryLength;
+            buffer.readString(&groupString, &groupStringLength);
+            buffer.readString(&logStringBinary, &logStringBinaryLength);
+
+            if (logStringBinaryLength > 0 && logStringBinary[logStringBinaryLength - 1] == '\n')
+            {
+                logStringBinary[logStringBinaryLength - 1] = 0;
+            }
+
+            if (level < LoomLogDebug || level > LoomLogError)
+            {
+                level = LoomLogInfo;
+            }
+
+            // The text keeps whatever prefix the sender formatted into it, as
+            // with LOG1; the group decides whether it shows at all.
+            loom_logGroup_t *group = groupStringLength > 0 ? assetProtocol_getRemoteLogGroup(groupString) : &assetProtocolLogGroup;
+            if (loom_log_willGroupLog(group))
+            {
+                loom_log(group, (loom_logLevel_t)level, "%s", logStringBinary);
+            }
+
+            lmFree(NULL, groupString);
+            lmFree(NULL, logStringBinary);
+
+            return true;
+        }
         }
 
         return false;
@@ -430,6 +492,42 @@ void AssetProtocolHandler::sendLog(const char *log)
 }
 
 
+// Structured form of sendLog: carries the level and group name as fields
+// rather than baked into the text, so the receiver can filter without
+// parsing.
+void AssetProtocolHandler::sendLogBinary(const char *group, int level, const char *log)
+{
+    int groupLen = (int)strlen(group);
+    int len      = (int)strlen(log);
+
+    char          msgBuffer[4096];
+    NetworkBuffer sendBuffer;
+
+    // Clip rather than overrun the frame.
+    if (groupLen > 256)
+    {
+        groupLen = 256;
+    }
+
+    if (len > 4096 - 7 * 4 - groupLen)
+    {
+        len = 4096 - 7 * 4 - groupLen;
+    }
+
+    sendBuffer.setBuffer(msgBuffer, 4096);
+
+    sendBuffer.writeInt(6 * 4 + groupLen + len);
+    sendBuffer.writeCheckpoint(0xDEADBEEF);
+    sendBuffer.writeInt(LOOM_FOURCC('L', 'O', 'G', '2'));
+    sendBuffer.writeInt(level);
+    sendBuffer.writeString(group, groupLen);
+    sendBuffer.writeString(log, len);
+
+    // Send it.
+    loom_net_writeTCPSocket(socket, msgBuffer, sendBuffer.getCurrentPosition());
+}
+
+
 void AssetProtocolHandler::sendCustom(void* buffer, int length)
 {
     loom_net_writeTCPSocket(socket, buffer, length);
@@ -127,6 +127,7 @@ public:
     void sendPong();
     void sendFile(const char *filename, void *fileBits, int fileBitsLength, int pendingFiles);
     void sendLog(const char *log);
+    void sendLogBinary(const char *group, int level, const char *log);
     void sendCommand(const char *cmd);
     
     // Send an arbitrary custom buffer through the asset protocol
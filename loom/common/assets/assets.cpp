@@ -209,6 +209,7 @@ static int gShuttingDown = 0;
 // Asset server connection state.
 static MutexHandle          gAssetServerSocketLock    = NULL;
 static AssetProtocolHandler *gAssetProtocolHandler    = NULL;
+static int             gAssetBinaryLog                = 0;
 static int             gAssetServerConnectTryInterval = 3000;
 static int             gAssetServerPingInterval       = 1000;
 static int             gAssetServerLastPingTime       = 0;
@@ -359,12 +360,24 @@ void loom_asset_logListener(void *payload, loom_logGroup_t *group, loom_logLevel
 
     if (gAssetProtocolHandler)
     {
-        gAssetProtocolHandler->sendLog(msg);
+        if (gAssetBinaryLog)
+        {
+            gAssetProtocolHandler->sendLogBinary(group->name, level, msg);
+        }
+        else
+        {
+            gAssetProtocolHandler->sendLog(msg);
+        }
     }
 
     loom_mutex_unlock(gAssetServerSocketLock);
 }
 
+void loom_asset_setBinaryLog(int enabled)
+{
+    gAssetBinaryLog = enabled;
+}
+
 // Helper function to route Loom custom output over the network.
 void loom_asset_custom(void* buffer, int length)
 {
@@ -123,6 +123,10 @@ void loom_asset_setCommandCallback(LoomAssetCommandCallback callback);
 // Send an arbitrary custom buffer through the asset protocol
 void loom_asset_custom(void *buffer, int length);
 
+// Send log output to the asset agent as structured LOG2 frames (level,
+// group, text) instead of plain LOG1 text.
+void loom_asset_setBinaryLog(int enabled);
+
 void loom_asset_preload(const char *name);
 
 void loom_asset_flush(const char *name);
@@ -54,6 +54,11 @@ bool     LoomApplicationConfig::_displayMinimized = false;
 bool     LoomApplicationConfig::_displayResizable = true;
 bool     LoomApplicationConfig::_displayBorderless = false;
 utString LoomApplicationConfig::_displayMode = "windowed";
+bool     LoomApplicationConfig::_jitEnabled = false;
+utArray<utString> LoomApplicationConfig::_jitExclude;
+bool     LoomApplicationConfig::_logAsync = false;
+int      LoomApplicationConfig::_logQueueSize = 0;
+bool     LoomApplicationConfig::_logBinary = false;
 
 
 // little helpers that do conversion
@@ -243,6 +248,9 @@ static void parseLogBlock(json_t *logBlock, utString name)
     {
         if (strcmp(key, "enabled") == 0 || strcmp(key, "level") == 0) continue;
 
+        // Pipeline settings, read by parseApplicationConfig.
+        if (name == "" && (strcmp(key, "async") == 0 || strcmp(key, "queueSize") == 0 || strcmp(key, "binary") == 0)) continue;
+
         parseLogBlock(value, name == "" ? key : name + "." + key);
     }
 }
@@ -271,6 +279,10 @@ void LoomApplicationConfig::parseApplicationConfig(const utString& jsonString)
     if (json_t *logBlock = json_object_get(json, "log"))
     {
         parseLogBlock(logBlock, "");
+
+        _jsonReadBool(logBlock, "async", _logAsync);
+        _jsonReadInt(logBlock, "queueSize", _logQueueSize);
+        _jsonReadBool(logBlock, "binary", _logBinary);
     }
 
     _jsonReadBool(json, "_wants51Audio", _wants51Audio);
@@ -296,5 +308,23 @@ void LoomApplicationConfig::parseApplicationConfig(const utString& jsonString)
         _jsonReadStr(displayBlock, "mode", _displayMode);
     }
 
+    if (json_t *jitBlock = json_object_get(json, "jit"))
+    {
+        _jsonReadBool(jitBlock, "enabled", _jitEnabled);
+
+        _jitExclude.clear();
+        if (json_t *exclude = json_object_get(jitBlock, "exclude"))
+        {
+            for (size_t i = 0; i < json_array_size(exclude); i++)
+            {
+                const char *name = json_string_value(json_array_get(exclude, i));
+                if (name)
+                {
+                    _jitExclude.push_back(name);
+                }
+            }
+        }
+    }
+
     json_delete(json);
 }
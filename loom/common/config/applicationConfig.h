@@ -22,6 +22,7 @@
 #define _lmapplicationconfig_h
 
 #include "loom/common/utils/utString.h"
+#include "loom/common/utils/utTypes.h"
 
 /**
  * C++ access to assorted configuration parameters from the application assembly.
@@ -58,6 +59,13 @@ class LoomApplicationConfig
     static bool     _displayBorderless;
     static utString _displayMode;
 
+    static bool              _jitEnabled;
+    static utArray<utString> _jitExclude;
+
+    static bool _logAsync;
+    static int  _logQueueSize;
+    static bool _logBinary;
+
 public:
     static const int POSITION_INVALID;
     static const int POSITION_UNDEFINED;
@@ -158,5 +166,15 @@ public:
     static bool displayResizable() { return _displayResizable; }
     static bool displayBorderless() { return _displayBorderless; }
     static const utString& displayMode() { return _displayMode; }
+
+    // LuaJIT trace compiler, off unless enabled in the "jit" block
+    static bool jitEnabled() { return _jitEnabled; }
+    static const utArray<utString>& jitExclude() { return _jitExclude; }
+
+    // Log dispatch on a background thread and the binary asset agent log
+    // frame, both off unless set in the "log" block
+    static bool logAsync() { return _logAsync; }
+    static int logQueueSize() { return _logQueueSize; }
+    static bool logBinary() { return _logBinary; }
 };
 #endif
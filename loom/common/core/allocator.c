@@ -25,6 +25,7 @@
 #include <string.h>
 #include <assert.h>
 #include "loom/common/core/allocator.h"
+#include "loom/common/core/allocatorProfiler.h"
 #include "loom/common/core/assert.h"
 #include "loom/common/core/log.h"
 #include "loom/common/core/performance.h"
@@ -145,7 +146,14 @@ void *lmAlloc_inner(loom_allocator_t *allocator, size_t size, const char *file,
         allocator = loom_allocator_getGlobalHeap();
     }
 
-    obj = allocator->allocCall(allocator, size, file, line);
+    if (gLoomHeapProfilerEnabled)
+    {
+        obj = loom_heapProfiler_alloc(allocator, size, file, line);
+    }
+    else
+    {
+        obj = allocator->allocCall(allocator, size, file, line);
+    }
     tmAllocEx(gTelemetryContext, file, line, obj, size, "lmAlloc");
 
     return obj;
@@ -158,7 +166,14 @@ void * lmCalloc_inner( loom_allocator_t *allocator, size_t count, size_t size, c
 
    size *= count;
 
-   obj = allocator->allocCall(allocator, size, file, line);
+   if (gLoomHeapProfilerEnabled)
+   {
+       obj = loom_heapProfiler_alloc(allocator, size, file, line);
+   }
+   else
+   {
+       obj = allocator->allocCall(allocator, size, file, line);
+   }
    memset(obj, 0, size);
    tmAllocEx(gTelemetryContext, file, line, obj, size, "lmCalloc");
    
@@ -173,7 +188,14 @@ void lmFree_inner( loom_allocator_t *allocator, void *ptr, const char *file, int
     }
 
     tmFree(gTelemetryContext, ptr);
-    allocator->freeCall(allocator, ptr, file, line);
+    if (gLoomHeapProfilerEnabled)
+    {
+        loom_heapProfiler_free(allocator, ptr, file, line);
+    }
+    else
+    {
+        allocator->freeCall(allocator, ptr, file, line);
+    }
 }
 
 
@@ -182,7 +204,11 @@ void *lmRealloc_inner(loom_allocator_t *allocator, void *ptr, size_t size, const
    void *obj = NULL;
    if(!allocator) allocator = loom_allocator_getGlobalHeap();
 
-   if (ptr == NULL)
+   if (gLoomHeapProfilerEnabled)
+   {
+       obj = ptr == NULL ? loom_heapProfiler_alloc(allocator, size, file, line) : loom_heapProfiler_realloc(allocator, ptr, size, file, line);
+   }
+   else if (ptr == NULL)
    {
        obj = allocator->allocCall(allocator, size, file, line);
    }
@@ -269,12 +295,13 @@ static void *loom_poolAlloc_alloc(loom_allocator_t *thiz, size_t size, const cha
     assert(poolState->itemSize == size);
 
     // Unlink something from the lmFree list if we can.
+    loom_mutex_lock(poolState->lock);
     tmp = poolState->freeListHead;
-    if (tmp == NULL)
+    if (tmp != NULL)
     {
-        return NULL;
+        poolState->freeListHead = *(void **)tmp;
     }
-    poolState->freeListHead = *(void **)tmp;
+    loom_mutex_unlock(poolState->lock);
     return tmp;
 }
 
@@ -289,8 +316,10 @@ static void loom_poolAlloc_free(loom_allocator_t *thiz, void *ptr, const char *f
     assert(((unsigned char *)ptr - (unsigned char *)poolState->memory) % poolState->itemSize == 0);                  // On item boundary.
 
     // Re-attach to lmFree list.
+    loom_mutex_lock(poolState->lock);
     *(void **)ptr           = poolState->freeListHead;
     poolState->freeListHead = ptr;
+    loom_mutex_unlock(poolState->lock);
 }
 
 
@@ -129,7 +129,8 @@ void loom_allocator_initializeHeapAllocator(loom_allocator_t *a);
 loom_allocator_t *loom_allocator_getGlobalHeap();
 
 // Allocate a new fixed pool allocator, one that can allocate up to
-// itemCount items of itemSize size.
+// itemCount items of itemSize size. See allocatorPool.h for a pool that
+// grows instead of returning NULL when exhausted.
 loom_allocator_t *loom_allocator_initializeFixedPoolAllocator(loom_allocator_t *parent, size_t itemSize, size_t itemCount);
 
 // Allocate a new arena proxy allocator. This allocator keeps track of all
@@ -0,0 +1,270 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include "loom/common/platform/platform.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/core/allocatorFrame.h"
+
+// Every block is preceded by a header holding its size so realloc can copy
+// the old contents, the header also keeps the blocks 16 byte aligned.
+#define LOOM_FRAME_ALIGN          16
+#define LOOM_FRAME_HEADER_SIZE    16
+#define LOOM_FRAME_ROUND(size)    (((size) + LOOM_FRAME_ALIGN - 1) & ~((size_t)LOOM_FRAME_ALIGN - 1))
+
+// Byte written over a buffer when it is reset to catch use after flip
+#define LOOM_FRAME_DEBUG_FREED    0xDF
+
+typedef struct loom_frameAllocator
+{
+    unsigned char *buffers[2];
+    size_t        capacity;
+
+    int           current;
+    size_t        offset;    // next free byte in the current buffer
+    size_t        used[2];   // bytes used in each buffer when it was last flipped away from
+    void          *last;     // last block allocated from the current buffer
+
+    int           ownerThread;
+
+    size_t        highWater;
+    size_t        overflowBytes;
+    size_t        overflowCount;
+} loom_frameAllocator_t;
+
+static loom_allocator_t *gGlobalFrameAllocator = NULL;
+
+static int loom_frameAlloc_owns(loom_frameAllocator_t *state, void *ptr)
+{
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        if ((unsigned char *)ptr >= state->buffers[i] && (unsigned char *)ptr < state->buffers[i] + state->capacity)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static size_t loom_frameAlloc_blockSize(void *ptr)
+{
+    return *(size_t *)((unsigned char *)ptr - LOOM_FRAME_HEADER_SIZE);
+}
+
+static void *loom_frameAlloc_overflow(loom_allocator_t *thiz, size_t size, const char *file, int line)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+
+    state->overflowBytes += size;
+    state->overflowCount++;
+
+    return lmAlloc_inner(thiz->parent, size, file, line);
+}
+
+static void *loom_frameAlloc_alloc(loom_allocator_t *thiz, size_t size, const char *file, int line)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+    size_t                need   = LOOM_FRAME_HEADER_SIZE + LOOM_FRAME_ROUND(size);
+    unsigned char         *block;
+
+    if (platform_getCurrentThreadId() != state->ownerThread)
+    {
+        return lmAlloc_inner(thiz->parent, size, file, line);
+    }
+
+    if (need > state->capacity - state->offset)
+    {
+        return loom_frameAlloc_overflow(thiz, size, file, line);
+    }
+
+    block = state->buffers[state->current] + state->offset;
+    *(size_t *)block = size;
+    block += LOOM_FRAME_HEADER_SIZE;
+
+    state->offset += need;
+    state->last    = block;
+
+    if (state->offset > state->highWater)
+    {
+        state->highWater = state->offset;
+    }
+
+    return block;
+}
+
+static void loom_frameAlloc_free(loom_allocator_t *thiz, void *ptr, const char *file, int line)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    // Frame memory is released in bulk on flip, only overflow is returned.
+    if (loom_frameAlloc_owns(state, ptr))
+    {
+        return;
+    }
+
+    lmFree_inner(thiz->parent, ptr, file, line);
+}
+
+static void *loom_frameAlloc_realloc(loom_allocator_t *thiz, void *ptr, size_t size, const char *file, int line)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+    size_t                oldSize;
+    void                  *block;
+
+    if (ptr == NULL)
+    {
+        return loom_frameAlloc_alloc(thiz, size, file, line);
+    }
+
+    if (size == 0)
+    {
+        loom_frameAlloc_free(thiz, ptr, file, line);
+        return NULL;
+    }
+
+    if (!loom_frameAlloc_owns(state, ptr))
+    {
+        return lmRealloc_inner(thiz->parent, ptr, size, file, line);
+    }
+
+    oldSize = loom_frameAlloc_blockSize(ptr);
+
+    // The most recent block can grow or shrink in place.
+    if (ptr == state->last && platform_getCurrentThreadId() == state->ownerThread)
+    {
+        size_t start = (unsigned char *)ptr - state->buffers[state->current];
+
+        if (LOOM_FRAME_ROUND(size) <= state->capacity - start)
+        {
+            *(size_t *)((unsigned char *)ptr - LOOM_FRAME_HEADER_SIZE) = size;
+            state->offset = start + LOOM_FRAME_ROUND(size);
+
+            if (state->offset > state->highWater)
+            {
+                state->highWater = state->offset;
+            }
+
+            return ptr;
+        }
+    }
+
+    if (size <= oldSize)
+    {
+        *(size_t *)((unsigned char *)ptr - LOOM_FRAME_HEADER_SIZE) = size;
+        return ptr;
+    }
+
+    block = loom_frameAlloc_alloc(thiz, size, file, line);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(block, ptr, oldSize);
+    return block;
+}
+
+static void loom_frameAlloc_destroy(loom_allocator_t *thiz)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+
+    lmFree(thiz->parent, state->buffers[0]);
+    lmFree(thiz->parent, state->buffers[1]);
+    lmFree(thiz->parent, state);
+
+    if (thiz == gGlobalFrameAllocator)
+    {
+        gGlobalFrameAllocator = NULL;
+    }
+}
+
+loom_allocator_t *loom_allocator_initializeFrameAllocator(loom_allocator_t *parent, size_t frameSize)
+{
+    loom_allocator_t      *a;
+    loom_frameAllocator_t *state = lmAlloc(parent, sizeof(loom_frameAllocator_t));
+
+    memset(state, 0, sizeof(loom_frameAllocator_t));
+    state->capacity    = LOOM_FRAME_ROUND(frameSize);
+    state->buffers[0]  = lmAlloc(parent, state->capacity);
+    state->buffers[1]  = lmAlloc(parent, state->capacity);
+    state->ownerThread = platform_getCurrentThreadId();
+
+    a = lmAlloc(parent, sizeof(loom_allocator_t));
+    memset(a, 0, sizeof(loom_allocator_t));
+    a->name        = "frame";
+    a->parent      = parent;
+    a->userdata    = state;
+    a->allocCall   = loom_frameAlloc_alloc;
+    a->reallocCall = loom_frameAlloc_realloc;
+    a->freeCall    = loom_frameAlloc_free;
+    a->destroyCall = loom_frameAlloc_destroy;
+    return a;
+}
+
+void loom_frameAllocator_flip(loom_allocator_t *thiz)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+
+    state->used[state->current] = state->offset;
+
+    state->current       = !state->current;
+    state->offset        = 0;
+    state->last          = NULL;
+    state->overflowBytes = 0;
+    state->overflowCount = 0;
+    state->ownerThread   = platform_getCurrentThreadId();
+
+#if LOOM_DEBUG
+    memset(state->buffers[state->current], LOOM_FRAME_DEBUG_FREED, state->used[state->current]);
+#endif
+}
+
+void loom_frameAllocator_getStats(loom_allocator_t *thiz, loom_frameAllocatorStats_t *stats)
+{
+    loom_frameAllocator_t *state = (loom_frameAllocator_t *)thiz->userdata;
+
+    stats->capacity       = state->capacity;
+    stats->usedBytes      = state->offset;
+    stats->highWaterBytes = state->highWater;
+    stats->overflowBytes  = state->overflowBytes;
+    stats->overflowCount  = state->overflowCount;
+}
+
+loom_allocator_t *loom_frameAllocator_getGlobal()
+{
+    // The main loop requests this before anything else does, so it is
+    // created on, and owned by, the main thread.
+    if (!gGlobalFrameAllocator)
+    {
+        gGlobalFrameAllocator = loom_allocator_initializeFrameAllocator(NULL, LOOM_FRAMEALLOCATOR_DEFAULT_SIZE);
+    }
+
+    return gGlobalFrameAllocator;
+}
@@ -0,0 +1,72 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _CORE_ALLOCATORFRAME_H_
+#define _CORE_ALLOCATORFRAME_H_
+
+#include "loom/common/core/allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************************************
+* Frame Allocator
+*
+* A linear allocator for short lived temporaries. Allocations bump a
+* pointer into one of two buffers, and loom_frameAllocator_flip switches
+* to the other buffer and resets it, so memory allocated during a frame
+* stays valid until the end of the next frame.
+*
+* Allocations that do not fit in the current buffer, or that are made from
+* a thread other than the owner, are passed through to the parent. Callers
+* should always lmFree what they allocate: freeing frame memory is a no-op
+* while freeing overflow memory returns it to the parent.
+*
+* The owner is the thread that created the allocator or last flipped it.
+*************************************************************************/
+
+#define LOOM_FRAMEALLOCATOR_DEFAULT_SIZE    (1024 * 1024)
+
+typedef struct loom_frameAllocatorStats
+{
+    size_t capacity;        // size of each of the two buffers
+    size_t usedBytes;       // bytes used in the current buffer
+    size_t highWaterBytes;  // most bytes used in a single frame since creation
+    size_t overflowBytes;   // bytes passed to the parent in the current frame
+    size_t overflowCount;   // allocations passed to the parent in the current frame
+} loom_frameAllocatorStats_t;
+
+// Allocate a new frame allocator with two buffers of frameSize bytes each.
+loom_allocator_t *loom_allocator_initializeFrameAllocator(loom_allocator_t *parent, size_t frameSize);
+
+// Switch to the other buffer, invalidating the memory allocated in it
+// two frames ago, and reset the per frame stats.
+void loom_frameAllocator_flip(loom_allocator_t *thiz);
+
+void loom_frameAllocator_getStats(loom_allocator_t *thiz, loom_frameAllocatorStats_t *stats);
+
+// The engine wide frame allocator, flipped once per tick by the main loop.
+loom_allocator_t *loom_frameAllocator_getGlobal();
+
+#ifdef __cplusplus
+};
+#endif
+#endif
@@ -0,0 +1,526 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/core/assert.h"
+#include "loom/common/core/allocatorPool.h"
+
+// Items are aligned like the system heap and large enough for a link.
+#define LOOM_POOL_ALIGN              (2 * sizeof(void *))
+#define LOOM_POOL_ROUND(size)        (((size) + LOOM_POOL_ALIGN - 1) & ~((size_t)LOOM_POOL_ALIGN - 1))
+
+// Number of pools a thread can hold a cache for at once, past that it
+// goes through the shared list.
+#define LOOM_POOL_THREAD_SLOTS       16
+
+#define LOOM_POOL_DEBUG_FREED        0xDD
+#define LOOM_POOL_DEBUG_UNINITIALIZED 0xAD
+
+typedef struct loom_poolChunk
+{
+    struct loom_poolChunk *next;
+} loom_poolChunk_t;
+
+typedef struct loom_poolThreadCache
+{
+    void                        *head;
+    size_t                      count;
+    struct loom_poolThreadCache *next;
+} loom_poolThreadCache_t;
+
+typedef struct loom_poolAllocator
+{
+    loom_allocator_t          *parent;
+    MutexHandle               lock;
+    int                       serial;
+    int                       flags;
+
+    size_t                    itemSize;
+    size_t                    itemsPerChunk;
+
+    loom_poolChunk_t          *chunks;
+    size_t                    chunkCount;
+
+    void                      *sharedHead;
+    size_t                    sharedCount;
+
+    loom_poolThreadCache_t    *caches;
+    size_t                    cacheCount;
+
+    struct loom_poolAllocator *nextLive;
+} loom_poolAllocator_t;
+
+// Per thread map from pool serial to that thread's cache. Serials are
+// never reused so entries of destroyed pools can't be mistaken for live.
+typedef struct loom_poolThreadSlot
+{
+    int                    serial;
+    loom_poolThreadCache_t *cache;
+} loom_poolThreadSlot_t;
+
+static LOOM_THREADLOCAL loom_poolThreadSlot_t tPoolSlots[LOOM_POOL_THREAD_SLOTS];
+
+// Registry of live pools, used to reclaim thread slots of destroyed ones.
+static MutexHandle           gPoolRegistryLock  = NULL;
+static volatile atomic_int_t gPoolRegistryState = 0;
+static loom_poolAllocator_t  *gPoolLiveList      = NULL;
+static int                   gPoolSerial        = 0;
+
+static void loom_poolAlloc_threadExit()
+{
+    loom_poolAllocator_flushThreadCaches();
+}
+
+static void loom_poolAlloc_ensureRegistry()
+{
+    if (atomic_load32(&gPoolRegistryState) == 2)
+    {
+        return;
+    }
+
+    if (atomic_compareAndExchange(&gPoolRegistryState, 0, 1) == 0)
+    {
+        gPoolRegistryLock = loom_mutex_create();
+        loom_thread_addExitCallback(loom_poolAlloc_threadExit);
+        atomic_store32(&gPoolRegistryState, 2);
+        return;
+    }
+
+    while (atomic_load32(&gPoolRegistryState) != 2)
+    {
+        loom_thread_yield();
+    }
+}
+
+// Call with the registry lock held.
+static loom_poolAllocator_t *loom_poolAlloc_findLive(int serial)
+{
+    loom_poolAllocator_t *pool;
+
+    for (pool = gPoolLiveList; pool; pool = pool->nextLive)
+    {
+        if (pool->serial == serial)
+        {
+            return pool;
+        }
+    }
+
+    return NULL;
+}
+
+static void loom_poolAlloc_poison(loom_poolAllocator_t *pool, void *item)
+{
+    memset((unsigned char *)item + sizeof(void *), LOOM_POOL_DEBUG_FREED, pool->itemSize - sizeof(void *));
+}
+
+static void loom_poolAlloc_checkPoison(loom_poolAllocator_t *pool, void *item)
+{
+    size_t i;
+
+    for (i = sizeof(void *); i < pool->itemSize; i++)
+    {
+        lmAssert(((unsigned char *)item)[i] == LOOM_POOL_DEBUG_FREED, "Pool item %p was written to after being freed (offset %d)", item, (int)i);
+    }
+
+    memset(item, LOOM_POOL_DEBUG_UNINITIALIZED, pool->itemSize);
+}
+
+// Carve a new chunk into the shared free list, call with the lock held.
+static int loom_poolAlloc_grow(loom_allocator_t *thiz)
+{
+    loom_poolAllocator_t *pool      = (loom_poolAllocator_t *)thiz->userdata;
+    size_t               headerSize = LOOM_POOL_ROUND(sizeof(loom_poolChunk_t));
+    loom_poolChunk_t     *chunk     = lmAlloc(thiz->parent, headerSize + pool->itemSize * pool->itemsPerChunk);
+    unsigned char        *items;
+    size_t               i;
+
+    if (chunk == NULL)
+    {
+        return 0;
+    }
+
+    chunk->next  = pool->chunks;
+    pool->chunks = chunk;
+    pool->chunkCount++;
+
+    // Thread back to front so items are handed out in address order.
+    items = (unsigned char *)chunk + headerSize;
+    for (i = pool->itemsPerChunk; i > 0; i--)
+    {
+        void *item = items + (i - 1) * pool->itemSize;
+
+        if (pool->flags & LOOM_POOL_POISON)
+        {
+            loom_poolAlloc_poison(pool, item);
+        }
+
+        *(void **)item   = pool->sharedHead;
+        pool->sharedHead = item;
+    }
+    pool->sharedCount += pool->itemsPerChunk;
+
+    return 1;
+}
+
+// Returns the calling thread's cache for the pool, creating it on first
+// use, or NULL if the thread has no slot left.
+static loom_poolThreadCache_t *loom_poolAlloc_getCache(loom_allocator_t *thiz)
+{
+    loom_poolAllocator_t   *pool = (loom_poolAllocator_t *)thiz->userdata;
+    loom_poolThreadSlot_t  *slot = NULL;
+    loom_poolThreadCache_t *cache;
+    int                    i;
+
+    for (i = 0; i < LOOM_POOL_THREAD_SLOTS; i++)
+    {
+        if (tPoolSlots[i].serial == pool->serial)
+        {
+            return tPoolSlots[i].cache;
+        }
+
+        if ((slot == NULL) && (tPoolSlots[i].serial == 0))
+        {
+            slot = &tPoolSlots[i];
+        }
+    }
+
+    if (slot == NULL)
+    {
+        // Reclaim slots of pools destroyed since this thread last used them.
+        loom_mutex_lock(gPoolRegistryLock);
+        for (i = 0; i < LOOM_POOL_THREAD_SLOTS; i++)
+        {
+            if (loom_poolAlloc_findLive(tPoolSlots[i].serial) == NULL)
+            {
+                tPoolSlots[i].serial = 0;
+                tPoolSlots[i].cache  = NULL;
+                if (slot == NULL)
+                {
+                    slot = &tPoolSlots[i];
+                }
+            }
+        }
+        loom_mutex_unlock(gPoolRegistryLock);
+
+        if (slot == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    cache = lmAlloc(thiz->parent, sizeof(loom_poolThreadCache_t));
+    memset(cache, 0, sizeof(loom_poolThreadCache_t));
+
+    loom_mutex_lock(pool->lock);
+    cache->next  = pool->caches;
+    pool->caches = cache;
+    pool->cacheCount++;
+    loom_mutex_unlock(pool->lock);
+
+    slot->serial = pool->serial;
+    slot->cache  = cache;
+    return cache;
+}
+
+static void *loom_poolAlloc_alloc(loom_allocator_t *thiz, size_t size, const char *file, int line)
+{
+    loom_poolAllocator_t   *pool = (loom_poolAllocator_t *)thiz->userdata;
+    loom_poolThreadCache_t *cache;
+    void                   *item = NULL;
+
+    lmAssert(size <= pool->itemSize, "Pool allocator can only allocate up to its item size (%d > %d)", (int)size, (int)pool->itemSize);
+
+    cache = loom_poolAlloc_getCache(thiz);
+
+    if (cache && cache->head)
+    {
+        item        = cache->head;
+        cache->head = *(void **)item;
+        cache->count--;
+    }
+    else
+    {
+        loom_mutex_lock(pool->lock);
+
+        if ((pool->sharedHead != NULL) || loom_poolAlloc_grow(thiz))
+        {
+            item             = pool->sharedHead;
+            pool->sharedHead = *(void **)item;
+            pool->sharedCount--;
+
+            // Take a batch along so the next allocations don't lock.
+            while (cache && pool->sharedHead && cache->count < LOOM_POOL_BATCH)
+            {
+                void *next = pool->sharedHead;
+                pool->sharedHead = *(void **)next;
+                pool->sharedCount--;
+
+                *(void **)next = cache->head;
+                cache->head    = next;
+                cache->count++;
+            }
+        }
+
+        loom_mutex_unlock(pool->lock);
+    }
+
+    if (item && (pool->flags & LOOM_POOL_POISON))
+    {
+        loom_poolAlloc_checkPoison(pool, item);
+    }
+
+    return item;
+}
+
+static void loom_poolAlloc_free(loom_allocator_t *thiz, void *ptr, const char *file, int line)
+{
+    loom_poolAllocator_t   *pool = (loom_poolAllocator_t *)thiz->userdata;
+    loom_poolThreadCache_t *cache;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    if (pool->flags & LOOM_POOL_POISON)
+    {
+        loom_poolAlloc_poison(pool, ptr);
+    }
+
+    cache = loom_poolAlloc_getCache(thiz);
+
+    if (cache == NULL)
+    {
+        loom_mutex_lock(pool->lock);
+        *(void **)ptr    = pool->sharedHead;
+        pool->sharedHead = ptr;
+        pool->sharedCount++;
+        loom_mutex_unlock(pool->lock);
+        return;
+    }
+
+    *(void **)ptr = cache->head;
+    cache->head   = ptr;
+    cache->count++;
+
+    // Hand a batch back once the cache holds two, so a thread that only
+    // frees doesn't hoard items.
+    if (cache->count >= 2 * LOOM_POOL_BATCH)
+    {
+        void   *first = cache->head;
+        void   *last  = first;
+        size_t i;
+
+        for (i = 1; i < LOOM_POOL_BATCH; i++)
+        {
+            last = *(void **)last;
+        }
+
+        cache->head   = *(void **)last;
+        cache->count -= LOOM_POOL_BATCH;
+
+        loom_mutex_lock(pool->lock);
+        *(void **)last    = pool->sharedHead;
+        pool->sharedHead  = first;
+        pool->sharedCount += LOOM_POOL_BATCH;
+        loom_mutex_unlock(pool->lock);
+    }
+}
+
+static void *loom_poolAlloc_realloc(loom_allocator_t *thiz, void *ptr, size_t size, const char *file, int line)
+{
+    loom_poolAllocator_t *pool = (loom_poolAllocator_t *)thiz->userdata;
+
+    if (ptr == NULL)
+    {
+        return loom_poolAlloc_alloc(thiz, size, file, line);
+    }
+
+    if (size == 0)
+    {
+        loom_poolAlloc_free(thiz, ptr, file, line);
+        return NULL;
+    }
+
+    lmAssert(size <= pool->itemSize, "Pool allocator can only realloc up to its item size (%d > %d)", (int)size, (int)pool->itemSize);
+    return ptr;
+}
+
+static void loom_poolAlloc_destroy(loom_allocator_t *thiz)
+{
+    loom_poolAllocator_t   *pool = (loom_poolAllocator_t *)thiz->userdata;
+    loom_poolAllocator_t   **link;
+    loom_poolChunk_t       *chunk;
+    loom_poolThreadCache_t *cache;
+    int                    i;
+
+    loom_mutex_lock(gPoolRegistryLock);
+    for (link = &gPoolLiveList; *link; link = &(*link)->nextLive)
+    {
+        if (*link == pool)
+        {
+            *link = pool->nextLive;
+            break;
+        }
+    }
+    loom_mutex_unlock(gPoolRegistryLock);
+
+    // Other threads reclaim their slots lazily.
+    for (i = 0; i < LOOM_POOL_THREAD_SLOTS; i++)
+    {
+        if (tPoolSlots[i].serial == pool->serial)
+        {
+            tPoolSlots[i].serial = 0;
+            tPoolSlots[i].cache  = NULL;
+        }
+    }
+
+    while ((chunk = pool->chunks) != NULL)
+    {
+        pool->chunks = chunk->next;
+        lmFree(thiz->parent, chunk);
+    }
+
+    while ((cache = pool->caches) != NULL)
+    {
+        pool->caches = cache->next;
+        lmFree(thiz->parent, cache);
+    }
+
+    loom_mutex_destroy(pool->lock);
+    lmFree(thiz->parent, pool);
+}
+
+// Moves a thread's cached items to the shared free list and drops the
+// cache, call with the registry lock held so the pool can't be destroyed.
+static void loom_poolAlloc_releaseCache(loom_poolAllocator_t *pool, loom_poolThreadCache_t *cache)
+{
+    loom_poolThreadCache_t **link;
+
+    loom_mutex_lock(pool->lock);
+
+    while (cache->head)
+    {
+        void *item = cache->head;
+        cache->head = *(void **)item;
+
+        *(void **)item   = pool->sharedHead;
+        pool->sharedHead = item;
+        pool->sharedCount++;
+    }
+
+    for (link = &pool->caches; *link; link = &(*link)->next)
+    {
+        if (*link == cache)
+        {
+            *link = cache->next;
+            pool->cacheCount--;
+            break;
+        }
+    }
+
+    loom_mutex_unlock(pool->lock);
+
+    lmFree(pool->parent, cache);
+}
+
+void loom_poolAllocator_flushThreadCaches()
+{
+    int i;
+
+    if (atomic_load32(&gPoolRegistryState) != 2)
+    {
+        return;
+    }
+
+    loom_mutex_lock(gPoolRegistryLock);
+
+    for (i = 0; i < LOOM_POOL_THREAD_SLOTS; i++)
+    {
+        loom_poolAllocator_t *pool;
+
+        if (tPoolSlots[i].serial == 0)
+        {
+            continue;
+        }
+
+        pool = loom_poolAlloc_findLive(tPoolSlots[i].serial);
+        if (pool != NULL)
+        {
+            loom_poolAlloc_releaseCache(pool, tPoolSlots[i].cache);
+        }
+
+        tPoolSlots[i].serial = 0;
+        tPoolSlots[i].cache  = NULL;
+    }
+
+    loom_mutex_unlock(gPoolRegistryLock);
+}
+
+void loom_poolAllocator_getStats(loom_allocator_t *thiz, loom_poolAllocatorStats_t *stats)
+{
+    loom_poolAllocator_t *pool = (loom_poolAllocator_t *)thiz->userdata;
+
+    loom_mutex_lock(pool->lock);
+    stats->itemSize     = pool->itemSize;
+    stats->chunkCount   = pool->chunkCount;
+    stats->itemCount    = pool->chunkCount * pool->itemsPerChunk;
+    stats->sharedFree   = pool->sharedCount;
+    stats->threadCaches = pool->cacheCount;
+    loom_mutex_unlock(pool->lock);
+}
+
+loom_allocator_t *loom_allocator_initializePoolAllocator(loom_allocator_t *parent, size_t itemSize, size_t itemsPerChunk, int flags)
+{
+    loom_allocator_t     *a;
+    loom_poolAllocator_t *pool;
+
+    lmAssert(itemsPerChunk > 0, "Pool allocator needs at least one item per chunk");
+
+    loom_poolAlloc_ensureRegistry();
+
+    pool = lmAlloc(parent, sizeof(loom_poolAllocator_t));
+    memset(pool, 0, sizeof(loom_poolAllocator_t));
+    pool->parent        = parent;
+    pool->lock          = loom_mutex_create();
+    pool->flags         = flags;
+    pool->itemSize      = LOOM_POOL_ROUND(itemSize < sizeof(void *) ? sizeof(void *) : itemSize);
+    pool->itemsPerChunk = itemsPerChunk;
+
+    loom_mutex_lock(gPoolRegistryLock);
+    pool->serial   = ++gPoolSerial;
+    pool->nextLive = gPoolLiveList;
+    gPoolLiveList  = pool;
+    loom_mutex_unlock(gPoolRegistryLock);
+
+    a = lmAlloc(parent, sizeof(loom_allocator_t));
+    memset(a, 0, sizeof(loom_allocator_t));
+    a->name        = "pool";
+    a->parent      = parent;
+    a->userdata    = pool;
+    a->allocCall   = loom_poolAlloc_alloc;
+    a->reallocCall = loom_poolAlloc_realloc;
+    a->freeCall    = loom_poolAlloc_free;
+    a->destroyCall = loom_poolAlloc_destroy;
+    return a;
+}
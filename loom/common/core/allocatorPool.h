@@ -0,0 +1,78 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#ifndef _CORE_ALLOCATORPOOL_H_
+#define _CORE_ALLOCATORPOOL_H_
+
+#include "loom/common/core/allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************************************
+* Pool Allocator
+*
+* A thread safe allocator for items of a single size that grows in chunks
+* of itemsPerChunk items instead of failing when exhausted.
+*
+* Each thread allocates from and frees to its own cache of free items
+* without locking, trading batches of LOOM_POOL_BATCH items with the
+* shared free list when its cache runs dry or grows too large. Items freed
+* on another thread than the one they came from simply join that thread's
+* cache.
+*
+* Threads started with loom_thread_start hand their cached items back when
+* they exit. Other threads should call loom_poolAllocator_flushThreadCaches
+* before exiting, or their cached items stay out of reach until the pool is
+* destroyed.
+*
+* With LOOM_POOL_POISON freed items are filled with a pattern that is
+* checked when they are handed out again, catching writes after free.
+*
+* Memory is only returned to the parent when the pool is destroyed.
+*************************************************************************/
+
+#define LOOM_POOL_BATCH     32
+
+// Creation flags
+#define LOOM_POOL_POISON    1
+
+typedef struct loom_poolAllocatorStats
+{
+    size_t itemSize;     // item size after alignment
+    size_t chunkCount;   // chunks allocated from the parent
+    size_t itemCount;    // items in all the chunks
+    size_t sharedFree;   // items on the shared free list
+    size_t threadCaches; // threads that have a cache in this pool
+} loom_poolAllocatorStats_t;
+
+loom_allocator_t *loom_allocator_initializePoolAllocator(loom_allocator_t *parent, size_t itemSize, size_t itemsPerChunk, int flags);
+
+void loom_poolAllocator_getStats(loom_allocator_t *thiz, loom_poolAllocatorStats_t *stats);
+
+// Returns the calling thread's cached items to every pool's shared list.
+void loom_poolAllocator_flushThreadCaches();
+
+#ifdef __cplusplus
+};
+#endif
+#endif
@@ -0,0 +1,635 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "loom/common/platform/platform.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/core/log.h"
+#include "loom/common/core/allocatorProfiler.h"
+#include "loom/common/utils/fourcc.h"
+#include "loom/common/assets/assets.h"
+
+#if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
+#include <windows.h>
+#elif LOOM_PLATFORM == LOOM_PLATFORM_LINUX || LOOM_PLATFORM == LOOM_PLATFORM_OSX
+#include <execinfo.h>
+#define LOOM_HEAPPROFILER_EXECINFO    1
+#endif
+
+lmDefineLogGroup(gHeapProfilerLogGroup, "heapProfiler", 1, LoomLogInfo);
+
+// The profiler keeps its own tables in the system heap so sampling never
+// recurses into lmAlloc.
+#define LOOM_HEAPPROFILER_SITE_CAPACITY      4096
+#define LOOM_HEAPPROFILER_MIN_SAMPLES        1024
+
+// Bits set for every sampled address, tested without locking on free.
+// Bits are only cleared when sampling restarts, so a stale bit costs a
+// locked lookup and nothing more.
+#define LOOM_HEAPPROFILER_FILTER_BITS        (1 << 20)
+
+// Marks a sample slot whose block was freed
+#define LOOM_HEAPPROFILER_TOMBSTONE          ((void *)1)
+
+// Site that callsites are folded into once the site table is full
+static const char gHeapProfilerOtherSite[] = "(other)";
+
+typedef struct loom_heapProfilerSample
+{
+    void   *ptr;
+    size_t weight;
+    int    site;
+} loom_heapProfilerSample_t;
+
+int gLoomHeapProfilerEnabled = 0;
+
+static MutexHandle                gHeapProfilerLock        = NULL;
+static volatile atomic_int_t      gHeapProfilerLockState   = 0;
+static size_t                     gHeapProfilerSampleBytes = LOOM_HEAPPROFILER_DEFAULT_SAMPLE_BYTES;
+static int                        gHeapProfilerBacktrace   = 0;
+
+static loom_heapProfilerSite_t    *gHeapProfilerSites      = NULL;
+static int                        gHeapProfilerSiteCount   = 0;
+
+static loom_heapProfilerSample_t  *gHeapProfilerSamples    = NULL;
+static size_t                     gHeapProfilerSampleCap   = 0;
+static size_t                     gHeapProfilerSampleUsed  = 0;  // live and tombstone slots
+
+static unsigned char              gHeapProfilerFilter[LOOM_HEAPPROFILER_FILTER_BITS / 8];
+
+// Bytes left until the next sample and the generator for its distance
+static LOOM_THREADLOCAL long         tHeapProfilerCountdown = 0;
+static LOOM_THREADLOCAL unsigned int tHeapProfilerRandom    = 0;
+
+// Nesting depth of lmAlloc calls on this thread, only the outermost samples
+static LOOM_THREADLOCAL int          tHeapProfilerDepth     = 0;
+
+static void loom_heapProfiler_ensureLock()
+{
+    if (atomic_load32(&gHeapProfilerLockState) == 2)
+    {
+        return;
+    }
+
+    if (atomic_compareAndExchange(&gHeapProfilerLockState, 0, 1) == 0)
+    {
+        gHeapProfilerLock = loom_mutex_create();
+        atomic_store32(&gHeapProfilerLockState, 2);
+        return;
+    }
+
+    while (atomic_load32(&gHeapProfilerLockState) != 2)
+    {
+        loom_thread_yield();
+    }
+}
+
+static size_t loom_heapProfiler_hashPointer(void *ptr)
+{
+    uintptr_t h = (uintptr_t)ptr;
+
+    h ^= h >> 17;
+    h *= 0x9E3779B1u;
+    h ^= h >> 13;
+    return (size_t)h;
+}
+
+static int loom_heapProfiler_filterTest(void *ptr)
+{
+    size_t bit = loom_heapProfiler_hashPointer(ptr) & (LOOM_HEAPPROFILER_FILTER_BITS - 1);
+
+    return gHeapProfilerFilter[bit >> 3] & (1 << (bit & 7));
+}
+
+static void loom_heapProfiler_filterSet(void *ptr)
+{
+    size_t bit = loom_heapProfiler_hashPointer(ptr) & (LOOM_HEAPPROFILER_FILTER_BITS - 1);
+
+    gHeapProfilerFilter[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+}
+
+// Distance to the next sample, uniform around the sample interval so
+// periodic allocation patterns don't alias with it.
+static long loom_heapProfiler_nextCountdown()
+{
+    unsigned int x = tHeapProfilerRandom;
+
+    if (x == 0)
+    {
+        x = (unsigned int)(uintptr_t)&tHeapProfilerRandom ^ 0xA5A5A5A5u;
+    }
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    tHeapProfilerRandom = x;
+
+    return (long)(gHeapProfilerSampleBytes / 2 + x % (gHeapProfilerSampleBytes + 1));
+}
+
+static int loom_heapProfiler_findSite(const char *file, int line, void **backtrace, int depth)
+{
+    size_t h = (size_t)line * 31;
+    size_t i;
+    int    j;
+
+    for (j = 0; j < depth; j++)
+    {
+        h = h * 31 + loom_heapProfiler_hashPointer(backtrace[j]);
+    }
+
+    for (i = 0; i < LOOM_HEAPPROFILER_SITE_CAPACITY; i++)
+    {
+        loom_heapProfilerSite_t *site = &gHeapProfilerSites[(h + i) & (LOOM_HEAPPROFILER_SITE_CAPACITY - 1)];
+
+        if (site->file == NULL)
+        {
+            if ((gHeapProfilerSiteCount >= LOOM_HEAPPROFILER_SITE_CAPACITY / 2) && (file != gHeapProfilerOtherSite))
+            {
+                break;
+            }
+
+            site->file           = file;
+            site->line           = line;
+            site->backtraceDepth = depth;
+            memcpy(site->backtrace, backtrace, depth * sizeof(void *));
+            gHeapProfilerSiteCount++;
+            return (int)(site - gHeapProfilerSites);
+        }
+
+        if ((site->line == line) && (site->backtraceDepth == depth) &&
+            ((site->file == file) || (strcmp(site->file, file) == 0)) &&
+            (memcmp(site->backtrace, backtrace, depth * sizeof(void *)) == 0))
+        {
+            return (int)(site - gHeapProfilerSites);
+        }
+    }
+
+    // Table full, fold into a single overflow site.
+    return loom_heapProfiler_findSite(gHeapProfilerOtherSite, 0, NULL, 0);
+}
+
+static loom_heapProfilerSample_t *loom_heapProfiler_findSample(void *ptr)
+{
+    size_t mask = gHeapProfilerSampleCap - 1;
+    size_t h    = loom_heapProfiler_hashPointer(ptr);
+    size_t i;
+
+    for (i = 0; i < gHeapProfilerSampleCap; i++)
+    {
+        loom_heapProfilerSample_t *sample = &gHeapProfilerSamples[(h + i) & mask];
+
+        if (sample->ptr == ptr)
+        {
+            return sample;
+        }
+
+        if (sample->ptr == NULL)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void loom_heapProfiler_removeSample(loom_heapProfilerSample_t *sample)
+{
+    loom_heapProfilerSite_t *site = &gHeapProfilerSites[sample->site];
+
+    site->liveBytes -= sample->weight;
+    site->liveSamples--;
+    sample->ptr = LOOM_HEAPPROFILER_TOMBSTONE;
+}
+
+// Rebuild the sample table without tombstones, growing it if mostly live.
+static void loom_heapProfiler_rehash()
+{
+    loom_heapProfilerSample_t *old    = gHeapProfilerSamples;
+    size_t                    oldCap  = gHeapProfilerSampleCap;
+    size_t                    live    = 0;
+    size_t                    i;
+
+    for (i = 0; i < oldCap; i++)
+    {
+        if (old[i].ptr && (old[i].ptr != LOOM_HEAPPROFILER_TOMBSTONE))
+        {
+            live++;
+        }
+    }
+
+    gHeapProfilerSampleCap = oldCap ? oldCap : LOOM_HEAPPROFILER_MIN_SAMPLES;
+    while (live * 2 >= gHeapProfilerSampleCap)
+    {
+        gHeapProfilerSampleCap *= 2;
+    }
+
+    gHeapProfilerSamples    = (loom_heapProfilerSample_t *)calloc(gHeapProfilerSampleCap, sizeof(loom_heapProfilerSample_t));
+    gHeapProfilerSampleUsed = 0;
+
+    for (i = 0; i < oldCap; i++)
+    {
+        if (old[i].ptr && (old[i].ptr != LOOM_HEAPPROFILER_TOMBSTONE))
+        {
+            size_t h = loom_heapProfiler_hashPointer(old[i].ptr);
+
+            while (gHeapProfilerSamples[h & (gHeapProfilerSampleCap - 1)].ptr)
+            {
+                h++;
+            }
+
+            gHeapProfilerSamples[h & (gHeapProfilerSampleCap - 1)] = old[i];
+            gHeapProfilerSampleUsed++;
+        }
+    }
+
+    free(old);
+}
+
+static int loom_heapProfiler_captureBacktrace(void **trace)
+{
+    if (!gHeapProfilerBacktrace)
+    {
+        return 0;
+    }
+
+#if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
+    // Skip this function and the allocation hook
+    return CaptureStackBackTrace(2, LOOM_HEAPPROFILER_MAX_BACKTRACE, trace, NULL);
+#elif defined(LOOM_HEAPPROFILER_EXECINFO)
+    {
+        void *frames[LOOM_HEAPPROFILER_MAX_BACKTRACE + 2];
+        int  depth = backtrace(frames, LOOM_HEAPPROFILER_MAX_BACKTRACE + 2) - 2;
+
+        if (depth <= 0)
+        {
+            return 0;
+        }
+
+        memcpy(trace, frames + 2, depth * sizeof(void *));
+        return depth;
+    }
+#else
+    return 0;
+#endif
+}
+
+static void loom_heapProfiler_record(void *ptr, size_t size, const char *file, int line)
+{
+    void                      *backtrace[LOOM_HEAPPROFILER_MAX_BACKTRACE];
+    int                       depth;
+    size_t                    weight;
+    loom_heapProfilerSample_t *sample;
+    loom_heapProfilerSite_t   *site;
+
+    tHeapProfilerCountdown -= (long)size;
+    if (tHeapProfilerCountdown > 0)
+    {
+        return;
+    }
+
+    tHeapProfilerCountdown = loom_heapProfiler_nextCountdown();
+
+    // A sample stands for the bytes of the interval it was picked from
+    weight = size > gHeapProfilerSampleBytes ? size : gHeapProfilerSampleBytes;
+    depth  = loom_heapProfiler_captureBacktrace(backtrace);
+
+    loom_mutex_lock(gHeapProfilerLock);
+
+    if (!gLoomHeapProfilerEnabled)
+    {
+        loom_mutex_unlock(gHeapProfilerLock);
+        return;
+    }
+
+    // The address may still be recorded if it was freed outside of lmFree
+    sample = loom_heapProfiler_findSample(ptr);
+    if (sample)
+    {
+        loom_heapProfiler_removeSample(sample);
+    }
+
+    if ((gHeapProfilerSampleUsed + 1) * 4 >= gHeapProfilerSampleCap * 3)
+    {
+        loom_heapProfiler_rehash();
+    }
+
+    {
+        size_t h = loom_heapProfiler_hashPointer(ptr);
+
+        while (gHeapProfilerSamples[h & (gHeapProfilerSampleCap - 1)].ptr != NULL)
+        {
+            h++;
+        }
+
+        sample = &gHeapProfilerSamples[h & (gHeapProfilerSampleCap - 1)];
+    }
+
+    sample->ptr    = ptr;
+    sample->weight = weight;
+    sample->site   = loom_heapProfiler_findSite(file, line, backtrace, depth);
+    gHeapProfilerSampleUsed++;
+
+    site = &gHeapProfilerSites[sample->site];
+    site->liveBytes  += weight;
+    site->liveSamples++;
+    site->totalBytes += weight;
+    site->totalSamples++;
+
+    loom_heapProfiler_filterSet(ptr);
+
+    loom_mutex_unlock(gHeapProfilerLock);
+}
+
+static void loom_heapProfiler_forget(void *ptr)
+{
+    loom_heapProfilerSample_t *sample;
+
+    if ((ptr == NULL) || !loom_heapProfiler_filterTest(ptr))
+    {
+        return;
+    }
+
+    loom_mutex_lock(gHeapProfilerLock);
+
+    if (gHeapProfilerSamples && ((sample = loom_heapProfiler_findSample(ptr)) != NULL))
+    {
+        loom_heapProfiler_removeSample(sample);
+    }
+
+    loom_mutex_unlock(gHeapProfilerLock);
+}
+
+void *loom_heapProfiler_alloc(loom_allocator_t *allocator, size_t size, const char *file, int line)
+{
+    void *obj;
+
+    tHeapProfilerDepth++;
+    obj = allocator->allocCall(allocator, size, file, line);
+    tHeapProfilerDepth--;
+
+    if (obj && (tHeapProfilerDepth == 0))
+    {
+        loom_heapProfiler_record(obj, size, file, line);
+    }
+
+    return obj;
+}
+
+void loom_heapProfiler_free(loom_allocator_t *allocator, void *ptr, const char *file, int line)
+{
+    if (tHeapProfilerDepth == 0)
+    {
+        loom_heapProfiler_forget(ptr);
+    }
+
+    tHeapProfilerDepth++;
+    allocator->freeCall(allocator, ptr, file, line);
+    tHeapProfilerDepth--;
+}
+
+void *loom_heapProfiler_realloc(loom_allocator_t *allocator, void *ptr, size_t size, const char *file, int line)
+{
+    void *obj;
+
+    if (tHeapProfilerDepth == 0)
+    {
+        loom_heapProfiler_forget(ptr);
+    }
+
+    tHeapProfilerDepth++;
+    obj = allocator->reallocCall(allocator, ptr, size, file, line);
+    tHeapProfilerDepth--;
+
+    if (obj && (tHeapProfilerDepth == 0))
+    {
+        loom_heapProfiler_record(obj, size, file, line);
+    }
+
+    return obj;
+}
+
+static void loom_heapProfiler_reset()
+{
+    free(gHeapProfilerSamples);
+    gHeapProfilerSamples    = NULL;
+    gHeapProfilerSampleCap  = 0;
+    gHeapProfilerSampleUsed = 0;
+
+    free(gHeapProfilerSites);
+    gHeapProfilerSites     = NULL;
+    gHeapProfilerSiteCount = 0;
+
+    memset(gHeapProfilerFilter, 0, sizeof(gHeapProfilerFilter));
+}
+
+void loom_heapProfiler_enable(size_t sampleBytes, int captureBacktrace)
+{
+    loom_heapProfiler_ensureLock();
+    loom_mutex_lock(gHeapProfilerLock);
+
+    loom_heapProfiler_reset();
+
+    gHeapProfilerSampleBytes = sampleBytes > 0 ? sampleBytes : 1;
+    tHeapProfilerCountdown   = 0;
+    gHeapProfilerBacktrace   = captureBacktrace;
+    gHeapProfilerSites       = (loom_heapProfilerSite_t *)calloc(LOOM_HEAPPROFILER_SITE_CAPACITY, sizeof(loom_heapProfilerSite_t));
+    loom_heapProfiler_rehash();
+
+    gLoomHeapProfilerEnabled = 1;
+
+    loom_mutex_unlock(gHeapProfilerLock);
+
+    lmLogInfo(gHeapProfilerLogGroup, "Sampling every %d bytes allocated%s", (int)gHeapProfilerSampleBytes, captureBacktrace ? " with backtraces" : "");
+}
+
+void loom_heapProfiler_disable()
+{
+    if (!gLoomHeapProfilerEnabled)
+    {
+        return;
+    }
+
+    loom_mutex_lock(gHeapProfilerLock);
+    gLoomHeapProfilerEnabled = 0;
+    loom_heapProfiler_reset();
+    loom_mutex_unlock(gHeapProfilerLock);
+}
+
+int loom_heapProfiler_isEnabled()
+{
+    return gLoomHeapProfilerEnabled;
+}
+
+static int loom_heapProfiler_compareSites(const void *a, const void *b)
+{
+    size_t liveA = ((const loom_heapProfilerSite_t *)a)->liveBytes;
+    size_t liveB = ((const loom_heapProfilerSite_t *)b)->liveBytes;
+
+    return liveA < liveB ? 1 : (liveA > liveB ? -1 : 0);
+}
+
+int loom_heapProfiler_getSites(loom_heapProfilerSite_t *sites, int maxSites)
+{
+    loom_heapProfilerSite_t *all;
+    int                     count = 0;
+    int                     i;
+
+    if (!gLoomHeapProfilerEnabled)
+    {
+        return 0;
+    }
+
+    all = (loom_heapProfilerSite_t *)malloc(LOOM_HEAPPROFILER_SITE_CAPACITY * sizeof(loom_heapProfilerSite_t));
+
+    loom_mutex_lock(gHeapProfilerLock);
+    for (i = 0; gHeapProfilerSites && i < LOOM_HEAPPROFILER_SITE_CAPACITY; i++)
+    {
+        if (gHeapProfilerSites[i].file)
+        {
+            all[count++] = gHeapProfilerSites[i];
+        }
+    }
+    loom_mutex_unlock(gHeapProfilerLock);
+
+    qsort(all, count, sizeof(loom_heapProfilerSite_t), loom_heapProfiler_compareSites);
+
+    if (count > maxSites)
+    {
+        count = maxSites;
+    }
+    memcpy(sites, all, count * sizeof(loom_heapProfilerSite_t));
+
+    free(all);
+    return count;
+}
+
+// Format the report into a system heap buffer, one callsite per line:
+// live bytes, live samples, total bytes, total samples, file:line and
+// the backtrace addresses if any.
+static char *loom_heapProfiler_formatReport(int maxSites, size_t *length)
+{
+    loom_heapProfilerSite_t *sites = (loom_heapProfilerSite_t *)malloc(maxSites * sizeof(loom_heapProfilerSite_t));
+    int                     count  = loom_heapProfiler_getSites(sites, maxSites);
+    size_t                  cap    = 256 + count * (96 + LOOM_HEAPPROFILER_MAX_BACKTRACE * 20);
+    char                    *text  = (char *)malloc(cap);
+    size_t                  len;
+    int                     i, j;
+
+    len = snprintf(text, cap, "# heap profile, one sample per %d bytes\n# liveBytes liveSamples totalBytes totalSamples site [backtrace]\n",
+                   (int)gHeapProfilerSampleBytes);
+
+    for (i = 0; i < count && len < cap; i++)
+    {
+        loom_heapProfilerSite_t *site = &sites[i];
+
+        len += snprintf(text + len, cap - len, "%lu %lu %lu %lu %s:%d",
+                        (unsigned long)site->liveBytes, (unsigned long)site->liveSamples,
+                        (unsigned long)site->totalBytes, (unsigned long)site->totalSamples,
+                        site->file, site->line);
+
+        for (j = 0; j < site->backtraceDepth && len < cap; j++)
+        {
+            len += snprintf(text + len, cap - len, " %p", site->backtrace[j]);
+        }
+
+        if (len < cap)
+        {
+            len += snprintf(text + len, cap - len, "\n");
+        }
+    }
+
+    free(sites);
+
+    *length = len < cap ? len : cap - 1;
+    return text;
+}
+
+void loom_heapProfiler_dumpToLog(int maxSites)
+{
+    loom_heapProfilerSite_t *sites = (loom_heapProfilerSite_t *)malloc(maxSites * sizeof(loom_heapProfilerSite_t));
+    int                     count  = loom_heapProfiler_getSites(sites, maxSites);
+    int                     i;
+
+    lmLogInfo(gHeapProfilerLogGroup, "Top %d allocation sites by estimated live bytes:", count);
+    for (i = 0; i < count; i++)
+    {
+        lmLogInfo(gHeapProfilerLogGroup, "  %10lu bytes in %6lu samples  %s:%d",
+                  (unsigned long)sites[i].liveBytes, (unsigned long)sites[i].liveSamples, sites[i].file, sites[i].line);
+    }
+
+    free(sites);
+}
+
+int loom_heapProfiler_dumpToFile(const char *path, int maxSites)
+{
+    size_t length;
+    char   *text;
+    FILE   *file = fopen(path, "w");
+
+    if (file == NULL)
+    {
+        lmLogError(gHeapProfilerLogGroup, "Unable to open %s for the heap profile", path);
+        return 0;
+    }
+
+    text = loom_heapProfiler_formatReport(maxSites, &length);
+    fwrite(text, 1, length, file);
+    fclose(file);
+    free(text);
+
+    lmLogInfo(gHeapProfilerLogGroup, "Wrote heap profile to %s", path);
+    return 1;
+}
+
+// The asset protocol is little endian on the wire, like NetworkBuffer::writeInt
+static void loom_heapProfiler_writeInt(unsigned char *dst, unsigned int value)
+{
+    dst[0] = (unsigned char)(value & 0xFF);
+    dst[1] = (unsigned char)((value >> 8) & 0xFF);
+    dst[2] = (unsigned char)((value >> 16) & 0xFF);
+    dst[3] = (unsigned char)((value >> 24) & 0xFF);
+}
+
+void loom_heapProfiler_dumpToAssetAgent(int maxSites)
+{
+    const size_t  headerSize = 4 * 4;
+    size_t        length;
+    char          *text = loom_heapProfiler_formatReport(maxSites, &length);
+    unsigned char *message;
+
+    // Framed like the telemetry message: size, marker, fourcc, then the
+    // report text prefixed by its length.
+    message = (unsigned char *)malloc(headerSize + length);
+    loom_heapProfiler_writeInt(message, (unsigned int)(headerSize + length));
+    loom_heapProfiler_writeInt(message + 4, 0xDEADBEEF);
+    loom_heapProfiler_writeInt(message + 8, LOOM_FOURCC('H', 'E', 'A', 'P'));
+    loom_heapProfiler_writeInt(message + 12, (unsigned int)length);
+    memcpy(message + headerSize, text, length);
+
+    loom_asset_custom(message, (int)(headerSize + length));
+
+    free(message);
+    free(text);
+}
@@ -0,0 +1,93 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#ifndef _CORE_ALLOCATORPROFILER_H_
+#define _CORE_ALLOCATORPROFILER_H_
+
+#include "loom/common/core/allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************************************
+* Sampling Heap Profiler
+*
+* Records roughly one allocation every sampleBytes bytes allocated through
+* lmAlloc, attributing it to the file and line of the call and optionally
+* a backtrace. Each sample stands for sampleBytes of allocations, so the
+* per callsite tables estimate live and total bytes without tracking every
+* block. Unsampled frees cost a single bit test.
+*
+* Allocations made by allocators on behalf of an outer lmAlloc are not
+* sampled separately, they are attributed to the outer callsite.
+*
+* Reports list callsites by estimated live bytes and can be written to
+* the log, a file or the asset agent as a 'HEAP' custom message.
+*************************************************************************/
+
+#define LOOM_HEAPPROFILER_DEFAULT_SAMPLE_BYTES    (512 * 1024)
+#define LOOM_HEAPPROFILER_MAX_BACKTRACE           12
+
+typedef struct loom_heapProfilerSite
+{
+    const char *file;
+    int        line;
+
+    size_t     liveBytes;     // estimated bytes currently allocated
+    size_t     liveSamples;   // samples currently allocated
+    size_t     totalBytes;    // estimated bytes allocated since enabled
+    size_t     totalSamples;  // samples taken since enabled
+
+    int        backtraceDepth;
+    void       *backtrace[LOOM_HEAPPROFILER_MAX_BACKTRACE];
+} loom_heapProfilerSite_t;
+
+// Non zero while sampling, checked inline by lmAlloc and friends.
+extern int gLoomHeapProfilerEnabled;
+
+// Start sampling, discarding any previous samples. Backtraces are
+// captured where the platform supports it.
+void loom_heapProfiler_enable(size_t sampleBytes, int captureBacktrace);
+
+// Stop sampling and discard all samples.
+void loom_heapProfiler_disable();
+
+int loom_heapProfiler_isEnabled();
+
+// Copy up to maxSites callsites, by descending live bytes, into sites.
+// Returns the number of sites copied.
+int loom_heapProfiler_getSites(loom_heapProfilerSite_t *sites, int maxSites);
+
+// Write the report for the maxSites callsites with the most live bytes.
+void loom_heapProfiler_dumpToLog(int maxSites);
+int loom_heapProfiler_dumpToFile(const char *path, int maxSites);
+void loom_heapProfiler_dumpToAssetAgent(int maxSites);
+
+// Hooks used by lmAlloc and friends while the profiler is enabled.
+void *loom_heapProfiler_alloc(loom_allocator_t *allocator, size_t size, const char *file, int line);
+void loom_heapProfiler_free(loom_allocator_t *allocator, void *ptr, const char *file, int line);
+void *loom_heapProfiler_realloc(loom_allocator_t *allocator, void *ptr, size_t size, const char *file, int line);
+
+#ifdef __cplusplus
+};
+#endif
+#endif
@@ -0,0 +1,460 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include "loom/common/platform/platform.h"
+#include "loom/common/core/allocatorSlab.h"
+
+#if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+// Slabs are aligned to their size, so the slab owning an item is found by
+// masking the item address.
+#define LOOM_SLAB_SIZE    (64 * 1024)
+#define LOOM_SLAB_MASK    (~((uintptr_t)LOOM_SLAB_SIZE - 1))
+
+static const size_t gSlabClassSizes[LOOM_SLAB_CLASS_COUNT] =
+{
+    8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256
+};
+
+// Maps (size + 7) / 8 to a size class
+static unsigned char gSlabClassLookup[LOOM_SLAB_MAX_SIZE / 8 + 1];
+static int           gSlabClassLookupReady = 0;
+
+typedef struct loom_slab loom_slab_t;
+
+struct loom_slab
+{
+    // Links in the size class list of slabs with free items
+    loom_slab_t   *prev;
+    loom_slab_t   *next;
+
+    // Links in the list of all slabs
+    loom_slab_t   *allPrev;
+    loom_slab_t   *allNext;
+
+    void          *freeList;
+    unsigned char *bump;     // first item never handed out
+    size_t        used;
+    size_t        capacity;
+    int           classIndex;
+};
+
+#define LOOM_SLAB_HEADER_SIZE    ((sizeof(loom_slab_t) + 15) & ~(size_t)15)
+
+typedef struct loom_slabClass
+{
+    loom_slab_t *available;
+    size_t      slabCount;
+    size_t      emptyCount;
+    size_t      liveCount;
+    size_t      allocCount;
+} loom_slabClass_t;
+
+struct loom_slabAllocator
+{
+    loom_allocator_t *parent;
+    loom_slabClass_t classes[LOOM_SLAB_CLASS_COUNT];
+    loom_slab_t      *all;
+
+    size_t           largeBytes;
+    size_t           largeCount;
+    size_t           releasedSlabs;
+};
+
+static void *loom_slab_pageAlloc(void)
+{
+#if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
+    // The allocation granularity on Windows is 64KB, so this is already aligned
+    return VirtualAlloc(NULL, LOOM_SLAB_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    // Map twice the size and unmap around an aligned range
+    unsigned char *region = (unsigned char *)mmap(NULL, LOOM_SLAB_SIZE * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    uintptr_t     aligned;
+    size_t        head;
+
+    if (region == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    aligned = ((uintptr_t)region + LOOM_SLAB_SIZE - 1) & LOOM_SLAB_MASK;
+    head    = aligned - (uintptr_t)region;
+
+    if (head > 0)
+    {
+        munmap(region, head);
+    }
+    munmap((unsigned char *)aligned + LOOM_SLAB_SIZE, LOOM_SLAB_SIZE - head);
+
+    return (void *)aligned;
+#endif
+}
+
+static void loom_slab_pageFree(void *page)
+{
+#if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
+    VirtualFree(page, 0, MEM_RELEASE);
+#else
+    munmap(page, LOOM_SLAB_SIZE);
+#endif
+}
+
+static int loom_slab_classForSize(size_t size)
+{
+    return gSlabClassLookup[(size + 7) >> 3];
+}
+
+static void loom_slab_linkAvailable(loom_slabClass_t *cls, loom_slab_t *slab)
+{
+    slab->prev = NULL;
+    slab->next = cls->available;
+    if (cls->available)
+    {
+        cls->available->prev = slab;
+    }
+    cls->available = slab;
+}
+
+static void loom_slab_unlinkAvailable(loom_slabClass_t *cls, loom_slab_t *slab)
+{
+    if (slab->prev)
+    {
+        slab->prev->next = slab->next;
+    }
+    else
+    {
+        cls->available = slab->next;
+    }
+
+    if (slab->next)
+    {
+        slab->next->prev = slab->prev;
+    }
+
+    slab->prev = slab->next = NULL;
+}
+
+static loom_slab_t *loom_slab_create(loom_slabAllocator_t *thiz, int classIndex)
+{
+    loom_slabClass_t *cls = &thiz->classes[classIndex];
+    loom_slab_t      *slab = (loom_slab_t *)loom_slab_pageAlloc();
+
+    if (!slab)
+    {
+        return NULL;
+    }
+
+    memset(slab, 0, sizeof(loom_slab_t));
+    slab->classIndex = classIndex;
+    slab->capacity   = (LOOM_SLAB_SIZE - LOOM_SLAB_HEADER_SIZE) / gSlabClassSizes[classIndex];
+    slab->bump       = (unsigned char *)slab + LOOM_SLAB_HEADER_SIZE;
+
+    slab->allNext = thiz->all;
+    if (thiz->all)
+    {
+        thiz->all->allPrev = slab;
+    }
+    thiz->all = slab;
+
+    loom_slab_linkAvailable(cls, slab);
+    cls->slabCount++;
+    cls->emptyCount++;
+
+    return slab;
+}
+
+static void loom_slab_release(loom_slabAllocator_t *thiz, loom_slab_t *slab)
+{
+    loom_slabClass_t *cls = &thiz->classes[slab->classIndex];
+
+    loom_slab_unlinkAvailable(cls, slab);
+
+    if (slab->allPrev)
+    {
+        slab->allPrev->allNext = slab->allNext;
+    }
+    else
+    {
+        thiz->all = slab->allNext;
+    }
+
+    if (slab->allNext)
+    {
+        slab->allNext->allPrev = slab->allPrev;
+    }
+
+    cls->slabCount--;
+    cls->emptyCount--;
+    thiz->releasedSlabs++;
+
+    loom_slab_pageFree(slab);
+}
+
+loom_slabAllocator_t *loom_slabAllocator_create(loom_allocator_t *parent)
+{
+    loom_slabAllocator_t *thiz;
+
+    if (!gSlabClassLookupReady)
+    {
+        int i, classIndex = 0;
+        for (i = 0; i <= LOOM_SLAB_MAX_SIZE / 8; i++)
+        {
+            while (gSlabClassSizes[classIndex] < (size_t)i * 8)
+            {
+                classIndex++;
+            }
+            gSlabClassLookup[i] = (unsigned char)classIndex;
+        }
+        gSlabClassLookupReady = 1;
+    }
+
+    thiz = (loom_slabAllocator_t *)lmAlloc(parent, sizeof(loom_slabAllocator_t));
+    memset(thiz, 0, sizeof(loom_slabAllocator_t));
+    thiz->parent = parent;
+
+    return thiz;
+}
+
+void loom_slabAllocator_destroy(loom_slabAllocator_t *thiz)
+{
+    loom_slab_t *slab = thiz->all;
+
+    while (slab)
+    {
+        loom_slab_t *next = slab->allNext;
+        loom_slab_pageFree(slab);
+        slab = next;
+    }
+
+    lmFree(thiz->parent, thiz);
+}
+
+void *loom_slabAllocator_alloc(loom_slabAllocator_t *thiz, size_t size)
+{
+    loom_slabClass_t *cls;
+    loom_slab_t      *slab;
+    void             *item;
+    int              classIndex;
+
+    if (size > LOOM_SLAB_MAX_SIZE)
+    {
+        item = lmAlloc(thiz->parent, size);
+        if (item)
+        {
+            thiz->largeBytes += size;
+            thiz->largeCount++;
+        }
+        return item;
+    }
+
+    classIndex = loom_slab_classForSize(size);
+    cls        = &thiz->classes[classIndex];
+    slab       = cls->available;
+
+    if (!slab)
+    {
+        slab = loom_slab_create(thiz, classIndex);
+        if (!slab)
+        {
+            return NULL;
+        }
+    }
+
+    // Reuse freed items first so touched memory stays hot
+    if (slab->freeList)
+    {
+        item           = slab->freeList;
+        slab->freeList = *(void **)item;
+    }
+    else
+    {
+        item        = slab->bump;
+        slab->bump += gSlabClassSizes[classIndex];
+    }
+
+    if (slab->used == 0)
+    {
+        cls->emptyCount--;
+    }
+
+    slab->used++;
+    cls->liveCount++;
+    cls->allocCount++;
+
+    if (slab->used == slab->capacity)
+    {
+        loom_slab_unlinkAvailable(cls, slab);
+    }
+
+    return item;
+}
+
+void loom_slabAllocator_free(loom_slabAllocator_t *thiz, void *ptr, size_t size)
+{
+    loom_slabClass_t *cls;
+    loom_slab_t      *slab;
+
+    if (!ptr)
+    {
+        return;
+    }
+
+    if (size > LOOM_SLAB_MAX_SIZE)
+    {
+        lmFree(thiz->parent, ptr);
+        thiz->largeBytes -= size;
+        thiz->largeCount--;
+        return;
+    }
+
+    slab = (loom_slab_t *)((uintptr_t)ptr & LOOM_SLAB_MASK);
+    lmAssert(slab->classIndex == loom_slab_classForSize(size), "Slab allocator free with mismatched size %d", (int)size);
+
+    cls = &thiz->classes[slab->classIndex];
+
+    // Full slabs are off the available list until something is freed
+    if (slab->used == slab->capacity)
+    {
+        loom_slab_linkAvailable(cls, slab);
+    }
+
+    *(void **)ptr  = slab->freeList;
+    slab->freeList = ptr;
+
+    slab->used--;
+    cls->liveCount--;
+
+    if (slab->used == 0)
+    {
+        cls->emptyCount++;
+    }
+}
+
+void *loom_slabAllocator_realloc(loom_slabAllocator_t *thiz, void *ptr, size_t oldSize, size_t newSize)
+{
+    void *item;
+
+    if (!ptr)
+    {
+        return loom_slabAllocator_alloc(thiz, newSize);
+    }
+
+    if (oldSize <= LOOM_SLAB_MAX_SIZE && newSize <= LOOM_SLAB_MAX_SIZE)
+    {
+        if (loom_slab_classForSize(oldSize) == loom_slab_classForSize(newSize))
+        {
+            return ptr;
+        }
+    }
+    else if (oldSize > LOOM_SLAB_MAX_SIZE && newSize > LOOM_SLAB_MAX_SIZE)
+    {
+        item = lmRealloc(thiz->parent, ptr, newSize);
+        if (item)
+        {
+            thiz->largeBytes += newSize - oldSize;
+        }
+        return item;
+    }
+
+    // Moving between size classes or between a slab and the parent
+    item = loom_slabAllocator_alloc(thiz, newSize);
+    if (!item)
+    {
+        return NULL;
+    }
+
+    memcpy(item, ptr, oldSize < newSize ? oldSize : newSize);
+    loom_slabAllocator_free(thiz, ptr, oldSize);
+
+    return item;
+}
+
+size_t loom_slabAllocator_trim(loom_slabAllocator_t *thiz)
+{
+    size_t released = 0;
+    int    i;
+
+    for (i = 0; i < LOOM_SLAB_CLASS_COUNT; i++)
+    {
+        loom_slabClass_t *cls = &thiz->classes[i];
+        loom_slab_t      *slab;
+        int              kept = 0;
+
+        if (cls->emptyCount <= 1)
+        {
+            continue;
+        }
+
+        slab = cls->available;
+        while (slab)
+        {
+            loom_slab_t *next = slab->next;
+
+            if (slab->used == 0)
+            {
+                if (kept)
+                {
+                    loom_slab_release(thiz, slab);
+                    released += LOOM_SLAB_SIZE;
+                }
+                kept = 1;
+            }
+
+            slab = next;
+        }
+    }
+
+    return released;
+}
+
+void loom_slabAllocator_getStats(loom_slabAllocator_t *thiz, loom_slabAllocatorStats_t *stats)
+{
+    int i;
+
+    memset(stats, 0, sizeof(loom_slabAllocatorStats_t));
+
+    for (i = 0; i < LOOM_SLAB_CLASS_COUNT; i++)
+    {
+        loom_slabClass_t      *cls = &thiz->classes[i];
+        loom_slabClassStats_t *out = &stats->classes[i];
+
+        out->itemSize   = gSlabClassSizes[i];
+        out->liveCount  = cls->liveCount;
+        out->slabCount  = cls->slabCount;
+        out->allocCount = cls->allocCount;
+
+        stats->slabBytes += cls->slabCount * LOOM_SLAB_SIZE;
+        stats->liveBytes += cls->liveCount * gSlabClassSizes[i];
+    }
+
+    stats->largeBytes    = thiz->largeBytes;
+    stats->largeCount    = thiz->largeCount;
+    stats->releasedSlabs = thiz->releasedSlabs;
+}
@@ -0,0 +1,88 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _CORE_ALLOCATORSLAB_H_
+#define _CORE_ALLOCATORSLAB_H_
+
+#include "loom/common/core/allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************************************************
+* Slab Allocator
+*
+* A size class allocator for small objects whose size is known on free,
+* as with the Lua VM allocation callback. Blocks up to
+* LOOM_SLAB_MAX_SIZE bytes are carved from page backed slabs, one size
+* class per slab, and larger blocks are passed through to the parent.
+*
+* Slabs that become empty are kept until loom_slabAllocator_trim returns
+* them to the OS, typically after a GC cycle has swept them.
+*
+* The allocator is not thread safe, it is meant to be owned by a single VM.
+*************************************************************************/
+
+#define LOOM_SLAB_MAX_SIZE       256
+#define LOOM_SLAB_CLASS_COUNT    16
+
+typedef struct loom_slabAllocator loom_slabAllocator_t;
+
+typedef struct loom_slabClassStats
+{
+    size_t itemSize;     // size of every item in the class
+    size_t liveCount;    // items currently allocated
+    size_t slabCount;    // slabs currently held, including empty ones
+    size_t allocCount;   // allocations since creation
+} loom_slabClassStats_t;
+
+typedef struct loom_slabAllocatorStats
+{
+    loom_slabClassStats_t classes[LOOM_SLAB_CLASS_COUNT];
+
+    size_t slabBytes;      // bytes held in slabs
+    size_t liveBytes;      // bytes in use within slabs, rounded to class size
+    size_t largeBytes;     // bytes passed through to the parent
+    size_t largeCount;     // blocks passed through to the parent
+    size_t releasedSlabs;  // slabs returned to the OS since creation
+} loom_slabAllocatorStats_t;
+
+loom_slabAllocator_t *loom_slabAllocator_create(loom_allocator_t *parent);
+
+// Frees all the slabs, large blocks still allocated are leaked.
+void loom_slabAllocator_destroy(loom_slabAllocator_t *thiz);
+
+void *loom_slabAllocator_alloc(loom_slabAllocator_t *thiz, size_t size);
+void loom_slabAllocator_free(loom_slabAllocator_t *thiz, void *ptr, size_t size);
+
+// realloc() semantics, oldSize must be the size the block was allocated with.
+void *loom_slabAllocator_realloc(loom_slabAllocator_t *thiz, void *ptr, size_t oldSize, size_t newSize);
+
+// Return empty slabs to the OS, keeping one spare per size class.
+// Returns the number of bytes released.
+size_t loom_slabAllocator_trim(loom_slabAllocator_t *thiz);
+
+void loom_slabAllocator_getStats(loom_slabAllocator_t *thiz, loom_slabAllocatorStats_t *stats);
+
+#ifdef __cplusplus
+};
+#endif
+#endif
@@ -20,9 +20,18 @@
 
 
 #include "loom/common/core/allocator.h"
+#include "loom/common/core/allocatorFrame.h"
 #include "loom/common/core/allocatorJEMalloc.h"
+#include "loom/common/core/allocatorPool.h"
+#include "loom/common/core/allocatorProfiler.h"
+#include "loom/common/core/allocatorSlab.h"
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformTime.h"
 #include "seatest.h"
 
+lmDefineLogGroup(gAllocatorTestLogGroup, "allocatorTest", 1, LoomLogInfo);
+
 SEATEST_FIXTURE(allocatorSystem)
 {
     SEATEST_FIXTURE_ENTRY(allocator_basic);
@@ -32,6 +41,12 @@ SEATEST_FIXTURE(allocatorSystem)
     SEATEST_FIXTURE_ENTRY(allocator_cppNewDeleteComplex);
     SEATEST_FIXTURE_ENTRY(allocator_jemalloc);
     SEATEST_FIXTURE_ENTRY(allocator_arena);
+    SEATEST_FIXTURE_ENTRY(allocator_slab);
+    SEATEST_FIXTURE_ENTRY(allocator_frame);
+    SEATEST_FIXTURE_ENTRY(allocator_pool);
+    SEATEST_FIXTURE_ENTRY(allocator_poolThreadExit);
+    SEATEST_FIXTURE_ENTRY(allocator_poolThroughput);
+    SEATEST_FIXTURE_ENTRY(allocator_heapProfiler);
 }
 
 SEATEST_TEST(allocator_basic)
@@ -247,3 +262,430 @@ SEATEST_TEST(allocator_arena)
 
     loom_allocator_destroy(tracker);
 }
+
+SEATEST_TEST(allocator_slab)
+{
+    static const int count = 20000;
+    static void *allocs[count];
+    static size_t sizes[count];
+
+    loom_slabAllocator_t *slab = loom_slabAllocator_create(loom_allocator_getGlobalHeap());
+    loom_slabAllocatorStats_t stats;
+
+    // Mix of every size class and some large blocks
+    for (int i = 0; i < count; i++)
+    {
+        sizes[i] = 1 + (i * 7) % (LOOM_SLAB_MAX_SIZE + 64);
+        allocs[i] = loom_slabAllocator_alloc(slab, sizes[i]);
+        assert_true(allocs[i] != NULL);
+        memset(allocs[i], i & 0xFF, sizes[i]);
+    }
+
+    loom_slabAllocator_getStats(slab, &stats);
+    assert_true(stats.largeCount > 0);
+    assert_true(stats.liveBytes > 0);
+    assert_true(stats.slabBytes >= stats.liveBytes);
+
+    // Move every block to another size, contents must survive
+    for (int i = 0; i < count; i++)
+    {
+        size_t newSize = (i % 2) ? sizes[i] * 2 : sizes[i] / 2 + 1;
+        allocs[i] = loom_slabAllocator_realloc(slab, allocs[i], sizes[i], newSize);
+        assert_true(allocs[i] != NULL);
+
+        size_t kept = newSize < sizes[i] ? newSize : sizes[i];
+        for (size_t j = 0; j < kept; j++)
+        {
+            assert_int_equal(i & 0xFF, ((unsigned char *)allocs[i])[j]);
+        }
+        sizes[i] = newSize;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        loom_slabAllocator_free(slab, allocs[i], sizes[i]);
+    }
+
+    loom_slabAllocator_getStats(slab, &stats);
+    assert_int_equal(0, (int)stats.liveBytes);
+    assert_int_equal(0, (int)stats.largeBytes);
+    assert_int_equal(0, (int)stats.largeCount);
+
+    // Empty slabs are returned, keeping one per used size class
+    size_t heldBytes = stats.slabBytes;
+    assert_true(loom_slabAllocator_trim(slab) > 0);
+    loom_slabAllocator_getStats(slab, &stats);
+    assert_true(stats.slabBytes < heldBytes);
+    assert_true(stats.releasedSlabs > 0);
+    for (int i = 0; i < LOOM_SLAB_CLASS_COUNT; i++)
+    {
+        assert_true(stats.classes[i].slabCount <= 1);
+    }
+
+    loom_slabAllocator_destroy(slab);
+}
+
+SEATEST_TEST(allocator_frame)
+{
+    loom_allocator_t *frame = loom_allocator_initializeFrameAllocator(NULL, 4096);
+    loom_frameAllocatorStats_t stats;
+
+    // Blocks are aligned and laid out back to back
+    unsigned char *a = (unsigned char *)lmAlloc(frame, 100);
+    unsigned char *b = (unsigned char *)lmAlloc(frame, 100);
+    assert_true(((size_t)a & 15) == 0);
+    assert_true(((size_t)b & 15) == 0);
+    assert_true(b > a);
+    memset(a, 0xAA, 100);
+    memset(b, 0xBB, 100);
+
+    // The last block grows in place, others are copied
+    assert_true(lmRealloc(frame, b, 200) == b);
+    unsigned char *c = (unsigned char *)lmRealloc(frame, a, 300);
+    assert_true(c != a);
+    for (int i = 0; i < 100; i++)
+    {
+        assert_int_equal(0xAA, c[i]);
+        assert_int_equal(0xBB, b[i]);
+    }
+
+    lmFree(frame, a);
+    lmFree(frame, b);
+    lmFree(frame, c);
+
+    loom_frameAllocator_getStats(frame, &stats);
+    assert_int_equal(4096, (int)stats.capacity);
+    assert_true(stats.usedBytes >= 600);
+    assert_int_equal(0, (int)stats.overflowCount);
+
+    // Too large blocks are passed to the parent and must be freed
+    void *big = lmAlloc(frame, 8192);
+    memset(big, 0, 8192);
+    loom_frameAllocator_getStats(frame, &stats);
+    assert_int_equal(1, (int)stats.overflowCount);
+    assert_int_equal(8192, (int)stats.overflowBytes);
+    lmFree(frame, big);
+
+    // Memory from the previous frame stays valid for one flip
+    size_t used = stats.usedBytes;
+    unsigned char *prev = (unsigned char *)lmAlloc(frame, 64);
+    memset(prev, 0x55, 64);
+
+    loom_frameAllocator_flip(frame);
+    loom_frameAllocator_getStats(frame, &stats);
+    assert_int_equal(0, (int)stats.usedBytes);
+    assert_int_equal(0, (int)stats.overflowCount);
+    assert_true(stats.highWaterBytes >= used);
+
+    unsigned char *next = (unsigned char *)lmAlloc(frame, 64);
+    memset(next, 0x66, 64);
+    for (int i = 0; i < 64; i++)
+    {
+        assert_int_equal(0x55, prev[i]);
+    }
+
+    // The second flip reuses the first buffer
+    loom_frameAllocator_flip(frame);
+    assert_true(lmAlloc(frame, 16) == a);
+
+    // Realloc of NULL allocates from the frame, a zero size releases
+    loom_frameAllocator_getStats(frame, &stats);
+    used = stats.usedBytes;
+    void *d = frame->reallocCall(frame, NULL, 32, __FILE__, __LINE__);
+    assert_true(d != NULL);
+    loom_frameAllocator_getStats(frame, &stats);
+    assert_true(stats.usedBytes > used);
+    assert_int_equal(0, (int)stats.overflowCount);
+    assert_true(frame->reallocCall(frame, d, 0, __FILE__, __LINE__) == NULL);
+
+    loom_allocator_destroy(frame);
+}
+
+SEATEST_TEST(allocator_pool)
+{
+    loom_allocator_t *pool = loom_allocator_initializePoolAllocator(NULL, 40, 64, LOOM_POOL_POISON);
+    loom_poolAllocatorStats_t stats;
+    static void *items[1000];
+
+    // Grows past the first chunk instead of failing
+    for (int i = 0; i < 1000; i++)
+    {
+        items[i] = lmAlloc(pool, 40);
+        assert_true(items[i] != NULL);
+        assert_true(((size_t)items[i] & (sizeof(void *) - 1)) == 0);
+        memset(items[i], i & 0xFF, 40);
+    }
+
+    loom_poolAllocator_getStats(pool, &stats);
+    assert_int_equal(48, (int)stats.itemSize);
+    assert_true(stats.chunkCount >= 1000 / 64);
+    assert_true(stats.itemCount >= 1000);
+    assert_int_equal(1, (int)stats.threadCaches);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        for (int j = 0; j < 40; j++)
+        {
+            assert_int_equal(i & 0xFF, ((unsigned char *)items[i])[j]);
+        }
+        lmFree(pool, items[i]);
+    }
+
+    // Freed items are reused before growing again, with the poison intact
+    size_t chunks = stats.chunkCount;
+    for (int i = 0; i < 1000; i++)
+    {
+        items[i] = lmAlloc(pool, 40);
+    }
+    loom_poolAllocator_getStats(pool, &stats);
+    assert_int_equal((int)chunks, (int)stats.chunkCount);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        lmFree(pool, items[i]);
+    }
+
+    // Realloc follows the usual NULL and zero size rules
+    void *item = pool->reallocCall(pool, NULL, 40, __FILE__, __LINE__);
+    assert_true(item != NULL);
+    assert_true(pool->reallocCall(pool, item, 24, __FILE__, __LINE__) == item);
+    assert_true(pool->reallocCall(pool, item, 0, __FILE__, __LINE__) == NULL);
+
+    loom_allocator_destroy(pool);
+}
+
+static loom_allocator_t *gPoolExitAllocator = NULL;
+
+static int __stdcall poolExitThreadFunc(void *param)
+{
+    for (int i = 0; i < 10; i++)
+    {
+        lmFree(gPoolExitAllocator, lmAlloc(gPoolExitAllocator, 40));
+    }
+
+    return 0;
+}
+
+SEATEST_TEST(allocator_poolThreadExit)
+{
+    loom_allocator_t *pool = loom_allocator_initializePoolAllocator(NULL, 40, 64, 0);
+    loom_poolAllocatorStats_t stats;
+
+    gPoolExitAllocator = pool;
+    loom_thread_join(loom_thread_start(poolExitThreadFunc, NULL));
+
+    // The exiting thread handed its cache back
+    loom_poolAllocator_getStats(pool, &stats);
+    assert_int_equal(0, (int)stats.threadCaches);
+    assert_int_equal((int)stats.itemCount, (int)stats.sharedFree);
+
+    // And so does this thread when asked to
+    lmFree(pool, lmAlloc(pool, 40));
+    loom_poolAllocator_getStats(pool, &stats);
+    assert_int_equal(1, (int)stats.threadCaches);
+
+    loom_poolAllocator_flushThreadCaches();
+    loom_poolAllocator_getStats(pool, &stats);
+    assert_int_equal(0, (int)stats.threadCaches);
+    assert_int_equal((int)stats.itemCount, (int)stats.sharedFree);
+
+    loom_allocator_destroy(pool);
+}
+
+static const int POOL_BENCH_ITERATIONS = 2000;
+static const int POOL_BENCH_LIVE       = 64;
+static const int POOL_BENCH_SIZE       = 96;
+static const int POOL_BENCH_MAX_THREAD = 8;
+
+static loom_allocator_t *gPoolBenchAllocator = NULL;
+static volatile int     gPoolBenchErrors     = 0;
+
+// Allocates and frees items like an object pool under churn: each pass
+// replaces about a quarter of the thread's live items and keeps the rest.
+static int __stdcall poolBenchThreadFunc(void *param)
+{
+    void *live[POOL_BENCH_LIVE];
+    int  seed = (int)(size_t)param;
+
+    for (int i = 0; i < POOL_BENCH_LIVE; i++)
+    {
+        live[i] = NULL;
+    }
+
+    for (int iter = 0; iter < POOL_BENCH_ITERATIONS; iter++)
+    {
+        for (int i = 0; i < POOL_BENCH_LIVE; i++)
+        {
+            if (live[i] && ((i + iter + seed) & 3))
+            {
+                continue;
+            }
+
+            if (live[i])
+            {
+                lmFree(gPoolBenchAllocator, live[i]);
+            }
+            live[i] = lmAlloc(gPoolBenchAllocator, POOL_BENCH_SIZE);
+            ((int *)live[i])[0] = seed;
+            ((int *)live[i])[POOL_BENCH_SIZE / sizeof(int) - 1] = iter;
+        }
+
+        for (int i = 0; i < POOL_BENCH_LIVE; i++)
+        {
+            if (((int *)live[i])[0] != seed)
+            {
+                atomic_increment(&gPoolBenchErrors);
+            }
+        }
+    }
+
+    for (int i = 0; i < POOL_BENCH_LIVE; i++)
+    {
+        lmFree(gPoolBenchAllocator, live[i]);
+    }
+
+    return 0;
+}
+
+// Returns the average cost of one alloc/free pair in nanoseconds.
+static long long runPoolBench(loom_allocator_t *allocator, int threadCount)
+{
+    ThreadHandle threads[POOL_BENCH_MAX_THREAD];
+
+    gPoolBenchAllocator = allocator;
+
+    loom_precision_timer_t timer = loom_startTimer();
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        threads[i] = loom_thread_start(poolBenchThreadFunc, (void *)(size_t)(i + 1));
+    }
+
+    for (int i = 0; i < threadCount; i++)
+    {
+        loom_thread_join(threads[i]);
+    }
+
+    long long ns = loom_readTimerNano(timer);
+    loom_destroyTimer(timer);
+
+    // A quarter of the live items are replaced every iteration
+    return ns / ((long long)threadCount * POOL_BENCH_ITERATIONS * (POOL_BENCH_LIVE / 4));
+}
+
+SEATEST_TEST(allocator_poolThroughput)
+{
+    for (int threadCount = 1; threadCount <= POOL_BENCH_MAX_THREAD; threadCount *= 2)
+    {
+        loom_allocator_t *pool = loom_allocator_initializePoolAllocator(NULL, POOL_BENCH_SIZE, 256, 0);
+        loom_allocator_t *je   = loom_allocator_initializeJemallocAllocator(loom_allocator_getGlobalHeap());
+
+        gPoolBenchErrors = 0;
+        long long poolNs = runPoolBench(pool, threadCount);
+        long long jeNs   = runPoolBench(je, threadCount);
+        assert_int_equal(0, gPoolBenchErrors);
+
+        loom_poolAllocatorStats_t stats;
+        loom_poolAllocator_getStats(pool, &stats);
+        assert_true(stats.itemCount <= (size_t)(threadCount * POOL_BENCH_LIVE + (threadCount + 1) * 2 * LOOM_POOL_BATCH + 256));
+
+        // Every item came back once the threads exited
+        assert_int_equal(0, (int)stats.threadCaches);
+        assert_int_equal((int)stats.itemCount, (int)stats.sharedFree);
+
+        lmLogInfo(gAllocatorTestLogGroup, "%d thread(s): pool %lld ns, jemalloc %lld ns per alloc/free, pool grew to %d items",
+                  threadCount, poolNs, jeNs, (int)stats.itemCount);
+
+        loom_allocator_destroy(je);
+        loom_allocator_destroy(pool);
+    }
+}
+
+static const loom_heapProfilerSite_t *findHeapProfilerSite(const loom_heapProfilerSite_t *sites, int count, int line)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (sites[i].line == line && strstr(sites[i].file, "allocatorTests"))
+        {
+            return &sites[i];
+        }
+    }
+
+    return NULL;
+}
+
+SEATEST_TEST(allocator_heapProfiler)
+{
+    static loom_heapProfilerSite_t sites[64];
+    static void *allocs[4000];
+
+    // Sampling every byte records every allocation at its exact size
+    loom_heapProfiler_enable(1, 0);
+
+    int exactLine = __LINE__ + 3;
+    for (int i = 0; i < 10; i++)
+    {
+        allocs[i] = lmAlloc(NULL, 100);
+    }
+
+    int count = loom_heapProfiler_getSites(sites, 64);
+    const loom_heapProfilerSite_t *site = findHeapProfilerSite(sites, count, exactLine);
+    assert_true(site != NULL);
+    assert_int_equal(1000, (int)site->liveBytes);
+    assert_int_equal(10, (int)site->liveSamples);
+
+    for (int i = 0; i < 5; i++)
+    {
+        lmFree(NULL, allocs[i]);
+    }
+
+    count = loom_heapProfiler_getSites(sites, 64);
+    site  = findHeapProfilerSite(sites, count, exactLine);
+    assert_int_equal(500, (int)site->liveBytes);
+    assert_int_equal(1000, (int)site->totalBytes);
+
+    for (int i = 5; i < 10; i++)
+    {
+        lmFree(NULL, allocs[i]);
+    }
+
+    // Sparse sampling estimates the live bytes
+    loom_heapProfiler_enable(4096, 1);
+
+    int sampledLine = __LINE__ + 3;
+    for (int i = 0; i < 4000; i++)
+    {
+        allocs[i] = lmAlloc(NULL, 256);
+    }
+
+    count = loom_heapProfiler_getSites(sites, 64);
+    assert_true(count > 0);
+
+    size_t estimate = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (sites[i].line == sampledLine && strstr(sites[i].file, "allocatorTests"))
+        {
+            estimate += sites[i].liveBytes;
+        }
+    }
+    assert_true(estimate > 4000 * 256 / 2);
+    assert_true(estimate < 4000 * 256 * 2);
+
+    for (int i = 0; i < 4000; i++)
+    {
+        lmFree(NULL, allocs[i]);
+    }
+
+    count = loom_heapProfiler_getSites(sites, 64);
+    for (int i = 0; i < count; i++)
+    {
+        if (sites[i].line == sampledLine && strstr(sites[i].file, "allocatorTests"))
+        {
+            assert_int_equal(0, (int)sites[i].liveBytes);
+        }
+    }
+
+    loom_heapProfiler_disable();
+    assert_false(loom_heapProfiler_isEnabled());
+}
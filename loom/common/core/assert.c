@@ -19,6 +19,7 @@
  */
 
 #include "loom/common/core/assert.h"
+#include "loom/common/core/log.h"
 
 static loom_assertcallback gAssertCallback = NULL;
 
@@ -30,6 +31,9 @@ void loom_setAssertCallback(loom_assertcallback v)
 
 void loom_fireAssertCallback()
 {
+    // Get queued log output out before we go down.
+    loom_log_flush();
+
     if (gAssertCallback)
     {
         gAssertCallback();
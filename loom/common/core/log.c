@@ -19,7 +19,9 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "loom/common/platform/platform.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/common/core/log.h"
 #include "loom/common/core/assert.h"
 #include "loom/common/core/allocator.h"
@@ -35,6 +37,7 @@
  * 4. Multiple listeners.
  * 5. Absolute simplest API and good performance.
  * 6. No global registration steps.
+ * 7. Optionally, never block the logging thread on listener I/O.
  ***/
 
 lmDefineLogGroup(gLogLogGroup, "logger", 0, LoomLogInfo);
@@ -62,6 +65,47 @@ static int              gLoomLogInvalidationToken = 1;
 static loom_allocator_t *gLoggerAllocator         = NULL;
 static loom_logLevel_t globalLevel                = LoomLogInfo;
 
+/***
+ * Asynchronous dispatch
+ *
+ * Once loom_log_startAsync is called, loom_log formats the message and
+ * pushes it into a bounded ring; a dedicated thread pops records and calls
+ * the listeners. The ring is the usual sequence-numbered bounded queue:
+ * each record carries a sequence that tells producers when it is free and
+ * the consumer when it is filled, so producers only contend on a single
+ * compare-and-exchange of the head and never take a lock.
+ *
+ * When the ring is full, messages below LoomLogWarn are dropped and counted,
+ * while warnings and errors wait a little while for space first.
+ ***/
+
+typedef struct loom_log_record
+{
+    volatile atomic_int_t sequence;
+    loom_logGroup_t       *group;
+    loom_logLevel_t       level;
+    char                  *overflow; // Heap copy when the message doesn't fit in text.
+    char                  text[LOOM_LOG_RECORD_TEXT];
+} loom_log_record_t;
+
+static loom_log_record_t     *gLogRing        = NULL;
+static unsigned int          gLogRingMask     = 0;
+static volatile atomic_int_t gLogRingHead     = 0;
+static volatile atomic_int_t gLogRingTail     = 0;
+static volatile atomic_int_t gLogDropped      = 0;
+static volatile atomic_int_t gLogStalls       = 0;
+static volatile atomic_int_t gLogAsync        = 0;
+static volatile atomic_int_t gLogStopping     = 0;
+static volatile atomic_int_t gLogSleeping     = 0;
+static volatile atomic_int_t gLogProducers    = 0;
+static ThreadHandle          gLogThread       = NULL;
+static SemaphoreHandle       gLogWake;
+static MutexHandle           gLogListenerLock = NULL;
+
+static LOOM_THREADLOCAL int  tLogIsLogThread = 0;
+static LOOM_THREADLOCAL int  tLogDepth       = 0;
+static LOOM_THREADLOCAL char tLogFormatBuffer[LOOM_LOG_FORMAT_BUFFER];
+
 static void platformDebugListener(void *payload, loom_logGroup_t *group, loom_logLevel_t level, const char *msg)
 {
     // TODO: Don't need to reprint the msg. platform_debugOut has printf semantics
@@ -108,8 +152,18 @@ void loom_log_addListener(loom_logListener_t listener, void *payload)
     entry->payload  = payload;
 
     // Link it on the list.
+    if (gLogListenerLock)
+    {
+        loom_mutex_lock(gLogListenerLock);
+    }
+
     entry->next  = listenerHead;
     listenerHead = entry;
+
+    if (gLogListenerLock)
+    {
+        loom_mutex_unlock(gLogListenerLock);
+    }
 }
 
 
@@ -119,6 +173,13 @@ void loom_log_removeListener(loom_logListener_t listener, void *payload)
     loom_log_listenerEntry_t **entry = &listenerHead;
     loom_log_listenerEntry_t *cur    = NULL;
 
+    // Holding the lock means the log thread is not inside this listener
+    // and won't call it again once we return.
+    if (gLogListenerLock)
+    {
+        loom_mutex_lock(gLogListenerLock);
+    }
+
     do
     {
         cur = *entry;
@@ -137,6 +198,11 @@ void loom_log_removeListener(loom_logListener_t listener, void *payload)
         // Got it! Unlink and free.
         *entry = cur->next;
         lmFree(NULL, cur);
+
+        if (gLogListenerLock)
+        {
+            loom_mutex_unlock(gLogListenerLock);
+        }
         return;
     } while ((entry = &((*entry)->next)));
 
@@ -167,12 +233,337 @@ char* loom_log_getArgs(va_list args, const char **format) {
     return buff;
 }
 
-void loom_log(loom_logGroup_t *group, loom_logLevel_t level, const char *format, ...)
+static void loom_log_dispatch(loom_logGroup_t *group, loom_logLevel_t level, const char *msg)
 {
     loom_log_listenerEntry_t *listener = listenerHead;
-    char* buff;
+
+    // Walk the listeners and output.
+    while (listener)
+    {
+        listener->callback(listener->payload, group, level, msg);
+        listener = listener->next;
+    }
+}
+
+
+static void loom_log_wakeLogThread()
+{
+    if (atomic_compareAndExchange(&gLogSleeping, 1, 0) == 1)
+    {
+        loom_semaphore_post(gLogWake);
+    }
+}
+
+
+// Claims the next free record, or returns NULL if the ring is full. The
+// record must be handed back with loom_log_publish.
+static loom_log_record_t *loom_log_reserve(unsigned int *position)
+{
+    unsigned int      pos = (unsigned int)atomic_load32(&gLogRingHead);
+    loom_log_record_t *record;
+    int               diff;
+
+    for ( ; ; )
+    {
+        record = &gLogRing[pos & gLogRingMask];
+        diff   = (int)((unsigned int)atomic_load32(&record->sequence) - pos);
+
+        if (diff == 0)
+        {
+            unsigned int seen = (unsigned int)atomic_compareAndExchange(&gLogRingHead, (int)pos, (int)(pos + 1));
+            if (seen == pos)
+            {
+                *position = pos;
+                return record;
+            }
+
+            pos = seen;
+        }
+        else if (diff < 0)
+        {
+            return NULL;
+        }
+        else
+        {
+            pos = (unsigned int)atomic_load32(&gLogRingHead);
+        }
+    }
+}
+
+
+static void loom_log_publish(loom_log_record_t *record, unsigned int position)
+{
+    atomic_store32(&record->sequence, (int)(position + 1));
+    loom_log_wakeLogThread();
+}
+
+
+static void loom_log_enqueue(loom_logGroup_t *group, loom_logLevel_t level, const char *msg, int length)
+{
+    loom_log_record_t *record;
+    unsigned int      position;
+    int               waited = 0;
+
+    while ((record = loom_log_reserve(&position)) == NULL)
+    {
+        // The log thread is on its way out; don't wait on it.
+        if (!atomic_load32(&gLogAsync))
+        {
+            loom_log_dispatch(group, level, msg);
+            return;
+        }
+
+        // The wait is bounded because the caller may hold a lock a listener
+        // needs (the asset agent socket lock, say), and the log thread would
+        // then never make room.
+        if ((level < LoomLogWarn) || (waited >= LOOM_LOG_STALL_TIMEOUT_MS))
+        {
+            atomic_increment(&gLogDropped);
+            return;
+        }
+
+        if (waited == 0)
+        {
+            atomic_increment(&gLogStalls);
+        }
+
+        loom_log_wakeLogThread();
+        loom_thread_sleep(1);
+        waited++;
+    }
+
+    record->group = group;
+    record->level = level;
+
+    if (length < LOOM_LOG_RECORD_TEXT)
+    {
+        memcpy(record->text, msg, length + 1);
+        record->overflow = NULL;
+    }
+    else
+    {
+        record->overflow = (char *)lmAlloc(gLoggerAllocator, length + 1);
+        memcpy(record->overflow, msg, length + 1);
+    }
+
+    loom_log_publish(record, position);
+}
+
+
+// Pops and dispatches everything currently in the ring. Returns the number
+// of records handled.
+static int loom_log_drain()
+{
+    unsigned int      tail  = (unsigned int)atomic_load32(&gLogRingTail);
+    int               count = 0;
+    loom_log_record_t *record;
+
+    loom_mutex_lock(gLogListenerLock);
+
+    for ( ; ; )
+    {
+        record = &gLogRing[tail & gLogRingMask];
+        if ((int)((unsigned int)atomic_load32(&record->sequence) - (tail + 1)) < 0)
+        {
+            break;
+        }
+
+        loom_log_dispatch(record->group, record->level, record->overflow ? record->overflow : record->text);
+
+        if (record->overflow)
+        {
+            lmFree(gLoggerAllocator, record->overflow);
+            record->overflow = NULL;
+        }
+
+        // Free the record for the producer one lap ahead.
+        atomic_store32(&record->sequence, (int)(tail + gLogRingMask + 1));
+        tail++;
+        count++;
+        atomic_store32(&gLogRingTail, (int)tail);
+    }
+
+    loom_mutex_unlock(gLogListenerLock);
+
+    return count;
+}
+
+
+static int __stdcall loom_log_threadFunc(void *param)
+{
+    int reportedDrops = 0;
+    int dropped;
+
+    tLogIsLogThread = 1;
+    loom_thread_setDebugName("Loom Log");
+
+    for ( ; ; )
+    {
+        loom_log_drain();
+
+        // Let listeners know output went missing, from this side of the ring.
+        dropped = atomic_load32(&gLogDropped);
+        if (dropped != reportedDrops)
+        {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "%10s  Log ring full, dropped %d message(s)\n", gLogLogGroup.name, dropped - reportedDrops);
+            loom_mutex_lock(gLogListenerLock);
+            loom_log_dispatch(&gLogLogGroup, LoomLogWarn, msg);
+            loom_mutex_unlock(gLogListenerLock);
+            reportedDrops = dropped;
+        }
+
+        if (atomic_load32(&gLogStopping))
+        {
+            // Producers are done by now; one last pass picks up stragglers.
+            loom_log_drain();
+            break;
+        }
+
+        // Announce we're going to sleep, then check once more so a record
+        // published in between isn't left waiting for the next one.
+        atomic_store32(&gLogSleeping, 1);
+        if (loom_log_drain() > 0 || atomic_load32(&gLogStopping))
+        {
+            if (atomic_compareAndExchange(&gLogSleeping, 1, 0) == 1)
+            {
+                continue;
+            }
+        }
+
+        // Either nothing is pending or a producer already cleared the flag
+        // and posted; either way the wait returns when there is work.
+        loom_semaphore_wait(gLogWake);
+    }
+
+    return 0;
+}
+
+
+void loom_log_startAsync(int capacity)
+{
+    unsigned int count = 1, i;
+
+    if (atomic_load32(&gLogAsync))
+    {
+        return;
+    }
+
+    if (capacity <= 0)
+    {
+        capacity = LOOM_LOG_DEFAULT_CAPACITY;
+    }
+
+    while (count < (unsigned int)capacity)
+    {
+        count <<= 1;
+    }
+
+    if (gLoggerAllocator == NULL)
+    {
+        gLoggerAllocator = loom_allocator_getGlobalHeap();
+    }
+
+    gLogRing     = (loom_log_record_t *)lmAlloc(gLoggerAllocator, sizeof(loom_log_record_t) * count);
+    gLogRingMask = count - 1;
+    for (i = 0; i < count; i++)
+    {
+        gLogRing[i].sequence = (int)i;
+        gLogRing[i].overflow = NULL;
+    }
+
+    atomic_store32(&gLogRingHead, 0);
+    atomic_store32(&gLogRingTail, 0);
+    atomic_store32(&gLogStopping, 0);
+    atomic_store32(&gLogSleeping, 0);
+
+    if (gLogListenerLock == NULL)
+    {
+        gLogListenerLock = loom_mutex_create();
+    }
+
+    gLogWake   = loom_semaphore_create();
+    gLogThread = loom_thread_start(loom_log_threadFunc, NULL);
+
+    atomic_store32(&gLogAsync, 1);
+}
+
+
+void loom_log_stopAsync()
+{
+    if (!atomic_load32(&gLogAsync))
+    {
+        return;
+    }
+
+    // New messages go out synchronously from here on.
+    atomic_store32(&gLogAsync, 0);
+
+    // Producers that saw the flag still set may be writing into the ring;
+    // the log thread keeps draining until they are out of it.
+    while (atomic_load32(&gLogProducers) > 0)
+    {
+        loom_log_wakeLogThread();
+        loom_thread_sleep(1);
+    }
+
+    atomic_store32(&gLogStopping, 1);
+    loom_log_wakeLogThread();
+    loom_thread_join(gLogThread);
+    gLogThread = NULL;
+
+    loom_semaphore_destroy(gLogWake);
+    lmFree(gLoggerAllocator, gLogRing);
+    gLogRing = NULL;
+}
+
+
+int loom_log_isAsync()
+{
+    return atomic_load32(&gLogAsync);
+}
+
+
+void loom_log_flush()
+{
+    unsigned int target;
+    int          waited = 0;
+
+    if (!atomic_load32(&gLogAsync) || tLogIsLogThread)
+    {
+        return;
+    }
+
+    target = (unsigned int)atomic_load32(&gLogRingHead);
+
+    // Bounded, since this is also used on the way down after an assert and
+    // the log thread may be the one that's wedged.
+    while ((int)((unsigned int)atomic_load32(&gLogRingTail) - target) < 0 && waited < LOOM_LOG_FLUSH_TIMEOUT_MS)
+    {
+        loom_log_wakeLogThread();
+        loom_thread_sleep(1);
+        waited++;
+    }
+}
+
+
+void loom_log_getStats(loom_logStats_t *stats)
+{
+    stats->async      = atomic_load32(&gLogAsync);
+    stats->capacity   = gLogRing ? (int)(gLogRingMask + 1) : 0;
+    stats->queued     = (unsigned int)atomic_load32(&gLogRingHead);
+    stats->dispatched = (unsigned int)atomic_load32(&gLogRingTail);
+    stats->dropped    = (unsigned int)atomic_load32(&gLogDropped);
+    stats->stalls     = (unsigned int)atomic_load32(&gLogStalls);
+}
+
+
+void loom_log(loom_logGroup_t *group, loom_logLevel_t level, const char *format, ...)
+{
+    char    *buff;
+    int     length;
     va_list args;
-    
+
     // sometimes we're not using the lmLog macros, so enforce good behavior.
     if (!group->enabled)
     {
@@ -181,17 +572,56 @@ void loom_log(loom_logGroup_t *group, loom_logLevel_t level, const char *format,
 
     if (level < group->filterLevel) return;
 
-    lmLogArgs(args, buff, format);
+    if (tLogDepth > 0)
+    {
+        // Logged by a listener while this thread's buffer still holds the
+        // message being dispatched, so format onto the heap instead.
+        lmLogArgs(args, buff, format);
+        length = (int)strlen(buff);
+    }
+    else
+    {
+        // Format once into this thread's buffer; only very long messages
+        // need a second pass into a heap buffer.
+        va_start(args, format);
+        length = vsnprintf(tLogFormatBuffer, LOOM_LOG_FORMAT_BUFFER, format, args);
+        va_end(args);
 
-    // Walk the listeners and output.
-    while (listener)
+        if (length < 0)
+        {
+            return;
+        }
+
+        buff = tLogFormatBuffer;
+        if (length >= LOOM_LOG_FORMAT_BUFFER)
+        {
+            lmLogArgs(args, buff, format);
+        }
+    }
+
+    tLogDepth++;
+
+    // Counted before the flag is checked, so loom_log_stopAsync can wait for
+    // everyone it raced with before freeing the ring.
+    atomic_increment(&gLogProducers);
+
+    if (atomic_load32(&gLogAsync) && !tLogIsLogThread)
     {
-        listener->callback(listener->payload, group, level, buff);
-        listener = listener->next;
+        loom_log_enqueue(group, level, buff, length);
+        atomic_decrement(&gLogProducers);
+    }
+    else
+    {
+        atomic_decrement(&gLogProducers);
+        loom_log_dispatch(group, level, buff);
     }
 
-    lmFree(NULL, buff);
+    tLogDepth--;
 
+    if (buff != tLogFormatBuffer)
+    {
+        lmFree(NULL, buff);
+    }
 }
 
 
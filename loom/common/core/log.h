@@ -121,6 +121,46 @@ loom_logLevel_t loom_log_getGlobalLevel();
 
 void loom_log(loom_logGroup_t *group, loom_logLevel_t level, const char *format, ...);
 
+/**
+ * Asynchronous logging.
+ *
+ * By default listeners run on the thread that logs. After
+ * loom_log_startAsync, loom_log only formats the message and queues it,
+ * and a dedicated log thread calls the listeners, so slow listeners (the
+ * asset agent socket, platform debug output) no longer stall callers.
+ *
+ * capacity is the number of queued messages (rounded up to a power of two,
+ * 0 for the default). When the queue is full, debug and info messages are
+ * dropped and counted, while warnings and errors wait up to
+ * LOOM_LOG_STALL_TIMEOUT_MS for room before being dropped too. Messages
+ * logged from inside a listener are dispatched immediately.
+ *
+ * loom_log_stopAsync drains the queue, waits for callers still inside
+ * loom_log to leave, and returns to synchronous logging. loom_log_flush waits
+ * (for a bounded time) until everything queued so far has been dispatched.
+ */
+#define LOOM_LOG_DEFAULT_CAPACITY    1024
+#define LOOM_LOG_RECORD_TEXT         232
+#define LOOM_LOG_FORMAT_BUFFER       2048
+#define LOOM_LOG_STALL_TIMEOUT_MS    100
+#define LOOM_LOG_FLUSH_TIMEOUT_MS    2000
+
+typedef struct loom_logStats
+{
+    int          async;
+    int          capacity;
+    unsigned int queued;
+    unsigned int dispatched;
+    unsigned int dropped;
+    unsigned int stalls;     // Times a warning or error had to wait for room.
+} loom_logStats_t;
+
+void loom_log_startAsync(int capacity);
+void loom_log_stopAsync();
+int loom_log_isAsync();
+void loom_log_flush();
+void loom_log_getStats(loom_logStats_t *stats);
+
 // TODO: Make sure this inlines.
 int loom_log_willGroupLog(loom_logGroup_t *group);
 void loom_log_addRule(const char *prefix, int enabled, int filterLevel);
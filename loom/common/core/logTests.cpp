@@ -18,12 +18,20 @@
  * ===========================================================================
  */
 
+#include <string.h>
+
 #include "loom/common/core/log.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformTime.h"
 #include "seatest.h"
 
 SEATEST_FIXTURE(logging)
 {
     SEATEST_FIXTURE_ENTRY(logging_basic);
+    SEATEST_FIXTURE_ENTRY(logging_reentrant);
+    SEATEST_FIXTURE_ENTRY(logging_async);
+    SEATEST_FIXTURE_ENTRY(logging_stopWhileLogging);
+    SEATEST_FIXTURE_ENTRY(logging_asyncThroughput);
 }
 
 static int logCount;
@@ -55,3 +63,256 @@ SEATEST_TEST(logging_basic)
 
     loom_log_removeListener(test_listener, NULL);
 }
+
+lmDefineLogGroup(reentrantTestGroup, "logging_reentrant", 1, LoomLogInfo);
+
+static char reentrantOuter[64];
+static int  reentrantNested;
+
+// Added first, so it runs after the listener that logs from its callback.
+static void reentrant_recordListener(void *payload, loom_logGroup_t *group, loom_logLevel_t level, const char *msg)
+{
+    if (group != &reentrantTestGroup)
+    {
+        return;
+    }
+
+    const char *outer = strstr(msg, "outer");
+    if (outer)
+    {
+        strncpy(reentrantOuter, outer, sizeof(reentrantOuter) - 1);
+    }
+    else
+    {
+        reentrantNested++;
+    }
+}
+
+static void reentrant_loggingListener(void *payload, loom_logGroup_t *group, loom_logLevel_t level, const char *msg)
+{
+    if ((group == &reentrantTestGroup) && strstr(msg, "outer"))
+    {
+        lmLog(reentrantTestGroup, "nested message logged from a listener (%d)", 2);
+    }
+}
+
+SEATEST_TEST(logging_reentrant)
+{
+    memset(reentrantOuter, 0, sizeof(reentrantOuter));
+    reentrantNested = 0;
+
+    loom_log_addListener(reentrant_recordListener, NULL);
+    loom_log_addListener(reentrant_loggingListener, NULL);
+
+    // Later listeners must still see the outer message, not the nested one.
+    lmLog(reentrantTestGroup, "outer message (%d)", 1);
+    assert_string_equal("outer message (1)", reentrantOuter);
+    assert_int_equal(1, reentrantNested);
+
+    loom_log_removeListener(reentrant_loggingListener, NULL);
+    loom_log_removeListener(reentrant_recordListener, NULL);
+}
+
+static const int LOG_ASYNC_THREADS  = 4;
+static const int LOG_ASYNC_MESSAGES = 2000;
+
+lmDefineLogGroup(asyncTestGroup, "logging_async", 1, LoomLogInfo);
+
+static volatile int asyncLogCount;
+static volatile int asyncWarnCount;
+static volatile int asyncLongOk;
+static volatile int asyncWrongThread;
+static int          asyncMainThread;
+
+static void async_listener(void *payload, loom_logGroup_t *group, loom_logLevel_t level, const char *msg)
+{
+    if (group != &asyncTestGroup)
+    {
+        return;
+    }
+
+    if (platform_getCurrentThreadId() == asyncMainThread)
+    {
+        asyncWrongThread++;
+    }
+
+    asyncLogCount++;
+    if (level == LoomLogWarn)
+    {
+        asyncWarnCount++;
+    }
+
+    if (strstr(msg, "long:") && strlen(msg) > 1000 && msg[strlen(msg) - 1] == 'z')
+    {
+        asyncLongOk = 1;
+    }
+}
+
+static int __stdcall asyncLogThreadFunc(void *param)
+{
+    for (int i = 0; i < LOG_ASYNC_MESSAGES; i++)
+    {
+        lmLog(asyncTestGroup, "thread %d message %d", (int)(size_t)param, i);
+    }
+
+    // lmLogError logs at warning level, which waits for room rather than
+    // being dropped.
+    lmLogError(asyncTestGroup, "thread %d done", (int)(size_t)param);
+    return 0;
+}
+
+SEATEST_TEST(logging_async)
+{
+    ThreadHandle    threads[LOG_ASYNC_THREADS];
+    loom_logStats_t before, after;
+    char            longMessage[1200];
+
+    asyncLogCount    = 0;
+    asyncWarnCount   = 0;
+    asyncLongOk      = 0;
+    asyncWrongThread = 0;
+    asyncMainThread  = platform_getCurrentThreadId();
+
+    loom_log_addListener(async_listener, NULL);
+
+    // A small ring so producers overrun it.
+    loom_log_startAsync(64);
+    assert_true(loom_log_isAsync() != 0);
+    loom_log_getStats(&before);
+    assert_int_equal(64, before.capacity);
+
+    // Longer than a ring record holds.
+    memset(longMessage, 'z', sizeof(longMessage) - 1);
+    longMessage[sizeof(longMessage) - 1] = 0;
+    lmLogError(asyncTestGroup, "long:%s", longMessage);
+
+    for (int i = 0; i < LOG_ASYNC_THREADS; i++)
+    {
+        threads[i] = loom_thread_start(asyncLogThreadFunc, (void *)(size_t)i);
+    }
+
+    for (int i = 0; i < LOG_ASYNC_THREADS; i++)
+    {
+        loom_thread_join(threads[i]);
+    }
+
+    loom_log_flush();
+    loom_log_getStats(&after);
+
+    // Everything was either handed to listeners or counted as dropped.
+    unsigned int sent    = LOG_ASYNC_THREADS * (LOG_ASYNC_MESSAGES + 1) + 1;
+    unsigned int dropped = after.dropped - before.dropped;
+    assert_int_equal((int)after.queued, (int)after.dispatched);
+    assert_int_equal((int)sent, asyncLogCount + (int)dropped);
+    assert_int_equal(LOG_ASYNC_THREADS + 1, asyncWarnCount);
+    assert_int_equal(1, asyncLongOk);
+    assert_int_equal(0, asyncWrongThread);
+
+    lmLog(testGroup, "Async log: %d delivered, %d dropped, %d stalls",
+          asyncLogCount, (int)dropped, (int)(after.stalls - before.stalls));
+
+    loom_log_stopAsync();
+    assert_int_equal(0, loom_log_isAsync());
+
+    // Back to synchronous delivery.
+    asyncMainThread = -1;
+    int count = asyncLogCount;
+    lmLog(asyncTestGroup, "sync again");
+    assert_int_equal(count + 1, asyncLogCount);
+
+    loom_log_removeListener(async_listener, NULL);
+}
+
+static volatile int stopTestRunning;
+
+static int __stdcall stopLogThreadFunc(void *param)
+{
+    int i = 0;
+
+    while (stopTestRunning)
+    {
+        lmLog(asyncTestGroup, "stop test %d", i++);
+    }
+
+    return 0;
+}
+
+SEATEST_TEST(logging_stopWhileLogging)
+{
+    ThreadHandle threads[LOG_ASYNC_THREADS];
+
+    stopTestRunning = 1;
+    loom_log_startAsync(64);
+
+    for (int i = 0; i < LOG_ASYNC_THREADS; i++)
+    {
+        threads[i] = loom_thread_start(stopLogThreadFunc, NULL);
+    }
+
+    loom_thread_sleep(10);
+
+    // Producers are still inside loom_log while the ring goes away.
+    loom_log_stopAsync();
+    assert_int_equal(0, loom_log_isAsync());
+
+    stopTestRunning = 0;
+    for (int i = 0; i < LOG_ASYNC_THREADS; i++)
+    {
+        loom_thread_join(threads[i]);
+    }
+}
+
+// Stands in for a listener doing I/O, like the asset agent socket.
+static void slow_listener(void *payload, loom_logGroup_t *group, loom_logLevel_t level, const char *msg)
+{
+    if (group != &asyncTestGroup)
+    {
+        return;
+    }
+
+    loom_precision_timer_t timer = loom_startTimer();
+    while (loom_readTimerNano(timer) < 20000)
+    {
+    }
+    loom_destroyTimer(timer);
+}
+
+static long long timeLogCalls(int count)
+{
+    loom_precision_timer_t timer = loom_startTimer();
+
+    for (int i = 0; i < count; i++)
+    {
+        lmLog(asyncTestGroup, "throughput %d", i);
+    }
+
+    long long ns = loom_readTimerNano(timer);
+    loom_destroyTimer(timer);
+    return ns / count;
+}
+
+SEATEST_TEST(logging_asyncThroughput)
+{
+    loom_logStats_t before, after;
+
+    loom_log_addListener(slow_listener, NULL);
+
+    long long syncNs = timeLogCalls(200);
+    assert_true(syncNs >= 20000);
+
+    // The default ring holds all of them, so no caller waits on the listener.
+    loom_log_startAsync(0);
+    loom_log_getStats(&before);
+    long long asyncNs = timeLogCalls(200);
+    loom_log_flush();
+    loom_log_getStats(&after);
+    loom_log_stopAsync();
+
+    assert_int_equal(200, (int)(after.dispatched - before.dispatched));
+    assert_int_equal(0, (int)(after.dropped - before.dropped));
+    assert_int_equal(0, (int)(after.stalls - before.stalls));
+
+    loom_log_removeListener(slow_listener, NULL);
+
+    lmLog(testGroup, "Caller cost with a 20us listener: sync %lld ns, async %lld ns per message", syncNs, asyncNs);
+}
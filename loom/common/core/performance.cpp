@@ -90,6 +90,11 @@ void performance_tick()
     tmCheckDebugZoneLevel(gTelemetryContext, 1);
     tmTick(gTelemetryContext);
     tmSetDebugZoneLevel(gTelemetryContext, 1);
+
+    if (gLoomProfiler)
+    {
+        gLoomProfiler->tick();
+    }
 }
 
 
@@ -99,6 +104,16 @@ void performance_shutdown()
     tmShutdownContext(gTelemetryContext);
     tmShutdown();
 }
+
+#else
+
+void performance_tick()
+{
+    if (gLoomProfiler)
+    {
+        gLoomProfiler->tick();
+    }
+}
 #endif
 
 lmDefineLogGroup(gProfilerLogGroup, "profiler", 1, LoomLogInfo);
@@ -116,10 +131,12 @@ void finishProfilerBlock(profilerBlock_t *block)
 
 //-----------------------------------------------------------------------------
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "loom/common/core/assert.h"
 #include "loom/common/core/stringTable.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/common/utils/utTypes.h"
 
 typedef utHashTable<utHashedString, LoomProfilerRoot*> LookupType;
@@ -140,53 +157,184 @@ extern "C" {
     LUA_GC_PROFILE(step)
 }
 
-LoomProfiler::LoomProfiler()
+// Profiled blocks are recorded as begin/end events into a fixed size ring
+// owned by the thread that ran them. Only the owning thread writes mHead and
+// only the thread holding the profiler mutex writes mTail, so recording never
+// takes a lock. RingSize must be a power of two and comfortably larger than
+// twice MaxStackDepth so a drained ring always has room for a full stack.
+struct LoomProfilerEvent
 {
-   mMaxStackDepth = MaxStackDepth;
-   mCurrentHash = 0;
-
-   mCurrentLoomProfilerEntry = lmNew(gProfilerAllocator) LoomProfilerEntry();
-   mCurrentLoomProfilerEntry->mRoot = NULL;
-   mCurrentLoomProfilerEntry->mNextForRoot = NULL;
-   mCurrentLoomProfilerEntry->mNextLoomProfilerEntry = NULL;
-   mCurrentLoomProfilerEntry->mNextHash = NULL;
-   mCurrentLoomProfilerEntry->mParent = NULL;
-   mCurrentLoomProfilerEntry->mNextSibling = NULL;
-   mCurrentLoomProfilerEntry->mFirstChild = NULL;
-   mCurrentLoomProfilerEntry->mLastSeenProfiler = NULL;
-   mCurrentLoomProfilerEntry->mHash = 0;
-   mCurrentLoomProfilerEntry->mSubDepth = 0;
-   mCurrentLoomProfilerEntry->mInvokeCount = 0;
-   mCurrentLoomProfilerEntry->mTotalTime = 0;
-   mCurrentLoomProfilerEntry->mSubTime = 0;
-   mCurrentLoomProfilerEntry->mMaxTime = 0;
-   mCurrentLoomProfilerEntry->mMinTime = INFINITY;
-   mCurrentLoomProfilerEntry->mStartTime = 0.0;
-   mRootLoomProfilerEntry = mCurrentLoomProfilerEntry;
+    LoomProfilerRoot *mRoot;
+    long long        mTime;
+    bool             mBegin;
+};
 
-   for(U32 i = 0; i < LoomProfilerEntry::HashTableSize; i++)
-      mCurrentLoomProfilerEntry->mChildHash[i] = 0;
+struct LoomProfilerThread
+{
+    enum
+    {
+        RingSize = 4096,
+    };
+
+    LoomProfilerThread *mNext;
+    LoomProfilerThread *mNextFree;
+    int                mIndex;
+    int                mThreadId;
+    bool               mNamed;
+    char               mName[64];
+
+    // Owned by the recording thread.
+    LoomProfilerEvent     *mEvents;
+    volatile atomic_int_t mHead;
+    U32                   mCachedTail;
+    LoomProfilerRoot      **mStack;
+    S32                   mStackDepth;
+    S32                   mRecordedDepth;
+    S32                   mSkipDepth;
+    bool                  mAggregating;
+
+    // Owned by whoever holds the profiler mutex.
+    volatile atomic_int_t mTail;
+    LoomProfilerEntry     *mRootEntry;
+    LoomProfilerEntry     *mCurrentEntry;
+    S32                   mTraceDepth;
+    S32                   mTraceDropped;
+};
+
+struct LoomProfilerTraceEvent
+{
+    LoomProfilerRoot   *mRoot;
+    LoomProfilerThread *mThread;
+    long long          mTime;
+    char               mPhase;
+};
+
+struct LoomProfilerTrace
+{
+    utArray<LoomProfilerTraceEvent> mEvents;
+    UTsize                          mMaxEvents;
+    U32                             mDropped;
+};
+
+static LOOM_THREADLOCAL LoomProfilerThread *sCurrentThread = NULL;
 
+static void profilerThreadExit()
+{
+    if (gLoomProfiler)
+    {
+        gLoomProfiler->releaseThread();
+    }
+}
+
+static LoomProfilerEntry *createEntry(LoomProfilerRoot *root, LoomProfilerEntry *parent)
+{
+    LoomProfilerEntry *entry = lmNew(gProfilerAllocator) LoomProfilerEntry();
+
+    entry->mRoot = root;
+    entry->mNextForRoot = NULL;
+    entry->mNextLoomProfilerEntry = NULL;
+    entry->mNextHash = NULL;
+    entry->mParent = parent;
+    entry->mNextSibling = NULL;
+    entry->mFirstChild = NULL;
+    entry->mLastSeenProfiler = NULL;
+    entry->mHash = root ? root->mNameHash : 0;
+    entry->mSubDepth = 0;
+    entry->mInvokeCount = 0;
+    entry->mStartTime = 0.0;
+    entry->mTotalTime = 0;
+    entry->mSubTime = 0;
+    entry->mMaxTime = 0;
+    entry->mMinTime = INFINITY;
+
+    for(U32 i = 0; i < LoomProfilerEntry::HashTableSize; i++)
+        entry->mChildHash[i] = 0;
+
+    return entry;
+}
+
+static bool traceEvent(LoomProfilerTrace *trace, LoomProfilerThread *thread, LoomProfilerRoot *root, long long time, char phase)
+{
+    // Ends are always kept so every recorded begin stays balanced.
+    if (phase != 'E' && trace->mEvents.size() >= trace->mMaxEvents)
+    {
+        trace->mDropped++;
+        return false;
+    }
+
+    LoomProfilerTraceEvent event;
+    event.mRoot   = root;
+    event.mThread = thread;
+    event.mTime   = time;
+    event.mPhase  = phase;
+    trace->mEvents.push_back(event);
+    return true;
+}
+
+static void writeTraceString(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (const char *c = string; *c; c++)
+    {
+        if ((unsigned char)*c < 0x20)
+        {
+            continue;
+        }
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+LoomProfiler::LoomProfiler()
+{
    mProfileList = NULL;
+   mThreadList = NULL;
+   mFreeThreadList = NULL;
+   mTrace = NULL;
+   mMutex = loom_mutex_create();
 
    mEnabled = LOOM_PROFILE_AT_ENGINE_START_INTERNAL;   
 
    mNextEnable = LOOM_PROFILE_AT_ENGINE_START_INTERNAL;
 
-   mStackDepth = 0;
    gLoomProfiler = this;
    mDumpToConsole   = false;
 
    mTimer = loom_startTimer();
+
+   loom_thread_addExitCallback(profilerThreadExit);
 }
 
 
 LoomProfiler::~LoomProfiler()
 {
-   reset();
-   lmSafeDelete(gProfilerAllocator, mRootLoomProfilerEntry);
    gLoomProfiler = NULL;
 
+   while(mProfileList)
+   {
+      LoomProfilerEntry *next = mProfileList->mNextLoomProfilerEntry;
+      lmSafeDelete(gProfilerAllocator, mProfileList);
+      mProfileList = next;
+   }
+
+   while(mThreadList)
+   {
+      LoomProfilerThread *next = mThreadList->mNext;
+      lmSafeDelete(gProfilerAllocator, mThreadList->mRootEntry);
+      lmFree(gProfilerAllocator, mThreadList->mEvents);
+      lmFree(gProfilerAllocator, mThreadList->mStack);
+      lmSafeDelete(gProfilerAllocator, mThreadList);
+      mThreadList = next;
+   }
+   mFreeThreadList = NULL;
+
+   lmSafeDelete(gProfilerAllocator, mTrace);
+
+   loom_mutex_destroy(mMutex);
    loom_destroyTimer(mTimer);
 }
 
@@ -199,8 +347,14 @@ void LoomProfiler::dumpToConsole()
 
 void LoomProfiler::reset()
 {
+   LoomProfilerThread *thread = currentThread();
+
+   lock(thread);
+
    mEnabled = false; // in case we're in a profiler call.
 
+   drainAll();
+
    if (mDumpToConsole)
    {
       dump();
@@ -208,8 +362,9 @@ void LoomProfiler::reset()
 
    while(mProfileList)
    {
+      LoomProfilerEntry *next = mProfileList->mNextLoomProfilerEntry;
       lmSafeDelete(gProfilerAllocator, mProfileList);
-      mProfileList = NULL;
+      mProfileList = next;
    }
    for(LoomProfilerRoot *walk = LoomProfilerRoot::sRootList; walk; walk = walk->mNextRoot)
    {
@@ -220,20 +375,32 @@ void LoomProfiler::reset()
       walk->mMinTime = INFINITY;
       walk->mTotalInvokeCount = 0;
    }
-   mCurrentLoomProfilerEntry = mRootLoomProfilerEntry;
-   mCurrentLoomProfilerEntry->mNextForRoot = 0;
-   mCurrentLoomProfilerEntry->mFirstChild = 0;
-   for(U32 i = 0; i < LoomProfilerEntry::HashTableSize; i++)
-      mCurrentLoomProfilerEntry->mChildHash[i] = 0;
-   mCurrentLoomProfilerEntry->mInvokeCount = 0;
-   mCurrentLoomProfilerEntry->mTotalTime = 0;
-   mCurrentLoomProfilerEntry->mSubTime = 0;
-   mCurrentLoomProfilerEntry->mMaxTime = 0;
-   mCurrentLoomProfilerEntry->mMinTime = INFINITY;
-   mCurrentLoomProfilerEntry->mSubDepth = 0;
-   mCurrentLoomProfilerEntry->mLastSeenProfiler = 0;
+   for(LoomProfilerThread *walk = mThreadList; walk; walk = walk->mNext)
+   {
+      resetThread(walk);
+   }
+
+   unlock(thread);
+}
+
 
-   loom_resetTimer(mTimer);
+void LoomProfiler::resetThread(LoomProfilerThread *thread)
+{
+   // Blocks still open on this thread were just freed, their ends are
+   // ignored once they arrive at the root.
+   LoomProfilerEntry *root = thread->mRootEntry;
+   root->mNextForRoot = 0;
+   root->mFirstChild = 0;
+   for(U32 i = 0; i < LoomProfilerEntry::HashTableSize; i++)
+      root->mChildHash[i] = 0;
+   root->mInvokeCount = 0;
+   root->mTotalTime = 0;
+   root->mSubTime = 0;
+   root->mMaxTime = 0;
+   root->mMinTime = INFINITY;
+   root->mSubDepth = 0;
+   root->mLastSeenProfiler = 0;
+   thread->mCurrentEntry = root;
 }
 
 
@@ -310,33 +477,348 @@ void LoomProfiler::validate()
 }
 
 
+
+
+LoomProfilerThread *LoomProfiler::currentThread()
+{
+    LoomProfilerThread *thread = sCurrentThread;
+
+    if (thread == NULL)
+    {
+        thread = registerThread();
+        sCurrentThread = thread;
+    }
+
+    return thread;
+}
+
+
+LoomProfilerThread *LoomProfiler::registerThread()
+{
+    loom_mutex_lock(mMutex);
+    LoomProfilerThread *thread = mFreeThreadList;
+    if (thread)
+    {
+        mFreeThreadList = thread->mNextFree;
+    }
+    loom_mutex_unlock(mMutex);
+
+    if (thread)
+    {
+        // Left behind by an exited thread with its ring drained, the call
+        // tree carries on accumulating under the new thread.
+        thread->mThreadId = platform_getCurrentThreadId();
+        thread->mNamed = false;
+        sprintf(thread->mName, "Thread %d", thread->mThreadId);
+        thread->mCachedTail = (U32)atomic_load32(&thread->mTail);
+        thread->mStackDepth = 0;
+        thread->mRecordedDepth = 0;
+        thread->mSkipDepth = 0;
+        thread->mAggregating = false;
+        return thread;
+    }
+
+    thread = lmNew(gProfilerAllocator) LoomProfilerThread();
+
+    thread->mThreadId = platform_getCurrentThreadId();
+    thread->mNamed = false;
+    sprintf(thread->mName, "Thread %d", thread->mThreadId);
+
+    // The ring itself is allocated on the first recorded event so threads
+    // that only run while the profiler is off stay cheap.
+    thread->mEvents = NULL;
+    thread->mHead = 0;
+    thread->mCachedTail = 0;
+    thread->mStack = (LoomProfilerRoot **)lmAlloc(gProfilerAllocator, sizeof(LoomProfilerRoot *) * MaxStackDepth);
+    thread->mStackDepth = 0;
+    thread->mRecordedDepth = 0;
+    thread->mSkipDepth = 0;
+    thread->mAggregating = false;
+
+    thread->mTail = 0;
+    thread->mRootEntry = createEntry(NULL, NULL);
+    thread->mCurrentEntry = thread->mRootEntry;
+    thread->mTraceDepth = 0;
+    thread->mTraceDropped = 0;
+    thread->mNextFree = NULL;
+
+    loom_mutex_lock(mMutex);
+    thread->mIndex = mThreadList ? mThreadList->mIndex + 1 : 1;
+    thread->mNext = mThreadList;
+    mThreadList = thread;
+    loom_mutex_unlock(mMutex);
+
+    return thread;
+}
+
+
+void LoomProfiler::setThreadName(const char *name)
+{
+    LoomProfilerThread *thread = currentThread();
+
+    strncpy(thread->mName, name, sizeof(thread->mName) - 1);
+    thread->mName[sizeof(thread->mName) - 1] = 0;
+    thread->mNamed = true;
+}
+
+
+void LoomProfiler::releaseThread()
+{
+    LoomProfilerThread *thread = sCurrentThread;
+
+    if (thread == NULL)
+    {
+        return;
+    }
+
+    lock(thread);
+
+    drain(thread);
+
+    thread->mNextFree = mFreeThreadList;
+    mFreeThreadList = thread;
+
+    unlock(thread);
+
+    sCurrentThread = NULL;
+}
+
+
+void LoomProfiler::lock(LoomProfilerThread *thread)
+{
+    loom_mutex_lock(mMutex);
+
+    // Anything profiled while aggregating is skipped rather than recorded
+    // into a ring we may be draining.
+    thread->mAggregating = true;
+}
+
+
+void LoomProfiler::unlock(LoomProfilerThread *thread)
+{
+    thread->mAggregating = false;
+
+    loom_mutex_unlock(mMutex);
+}
+
+
+static inline void recordEvent(LoomProfilerThread *thread, LoomProfilerRoot *root, long long time, bool begin)
+{
+    U32 head = (U32)thread->mHead;
+    LoomProfilerEvent *event = &thread->mEvents[head & (LoomProfilerThread::RingSize - 1)];
+
+    event->mRoot  = root;
+    event->mTime  = time;
+    event->mBegin = begin;
+
+    // Publishes the event to the draining thread.
+    atomic_store32(&thread->mHead, (int)(head + 1));
+}
+
+
 void LoomProfiler::hashPush(LoomProfilerRoot *root)
 {
    Telemetry::beginTickTimer(root);
 
-   mStackDepth++;
-   lmAssert(mStackDepth <= (S32) mMaxStackDepth,
+   LoomProfilerThread *thread = currentThread();
+
+   lmAssert(thread->mStackDepth < (S32) MaxStackDepth,
                   "Stack overflow in profiler.  You may have mismatched PROFILE_START and PROFILE_ENDs");
-   if(!mEnabled)
+   thread->mStack[thread->mStackDepth++] = root;
+
+   // Once a block is skipped everything nested in it is skipped as well,
+   // which keeps enabling mid-frame from recording half a stack.
+   if(thread->mSkipDepth > 0 || thread->mAggregating || !mEnabled)
+   {
+      thread->mSkipDepth++;
       return;
+   }
+
+   if(!thread->mEvents)
+   {
+      thread->mEvents = (LoomProfilerEvent *)lmAlloc(gProfilerAllocator, sizeof(LoomProfilerEvent) * LoomProfilerThread::RingSize);
+   }
+
+   // Keep room for this begin, its end and the ends of every block already
+   // recorded, so hashPop never runs out of space.
+   U32 needed = (U32)thread->mRecordedDepth + 2;
+   if(LoomProfilerThread::RingSize - ((U32)thread->mHead - thread->mCachedTail) < needed)
+   {
+      thread->mCachedTail = (U32)atomic_load32(&thread->mTail);
+
+      if(LoomProfilerThread::RingSize - ((U32)thread->mHead - thread->mCachedTail) < needed)
+      {
+         // Full before the next tick, aggregate it ourselves.
+         lock(thread);
+         drain(thread);
+         unlock(thread);
+         thread->mCachedTail = (U32)atomic_load32(&thread->mTail);
+      }
+   }
+
+   recordEvent(thread, root, loom_readTimerNano(mTimer), true);
+   thread->mRecordedDepth++;
+}
+
+
+void LoomProfiler::enable(bool enabled)
+{
+    mNextEnable = enabled;
+}
+
+
+void LoomProfiler::hashPop(LoomProfilerRoot *expected)
+{
+    Telemetry::endTickTimer(expected);
+
+    LoomProfilerThread *thread = currentThread();
+
+    lmAssert(thread->mStackDepth > 0, "Stack underflow in profiler.  You may have mismatched PROFILE_START and PROFILE_ENDs");
+    LoomProfilerRoot *root = thread->mStack[--thread->mStackDepth];
+
+    if (thread->mSkipDepth > 0)
+    {
+        thread->mSkipDepth--;
+    }
+    else
+    {
+        if (expected)
+        {
+            lmAssert(expected == root, "LoomProfiler::hashPop - didn't get expected ProfilerRoot!");
+        }
 
+        recordEvent(thread, root, loom_readTimerNano(mTimer), false);
+        thread->mRecordedDepth--;
+    }
+
+    if (thread->mStackDepth == 0)
+    {
+        frameBoundary(thread);
+    }
+}
+
+
+void LoomProfiler::frameBoundary(LoomProfilerThread *thread)
+{
+    // apply the next enable...
+    mEnabled = mNextEnable;
+
+    if (mDumpToConsole && !thread->mAggregating)
+    {
+        lock(thread);
+        drainAll();
+        dump();
+        unlock(thread);
+    }
+}
+
+
+void LoomProfiler::hashZeroCheck()
+{
+    LoomProfilerThread *thread = currentThread();
+
+    if (thread->mStackDepth != 0)
+    {
+        // If you get this assert, it means you probably have mismatched LOOM_PROFILE_START
+        // and LOOM_PROFILE_END blocks. Enable LOOM_PROFILE_AT_ENGINE_START (see #define at top
+        // of file) to get a breakpoint on the exact mismatching LOOM_PROFILE_END.
+        lmAssert(false, "Profiler zero stack check failed on %s: %s",
+            thread->mName,
+            thread->mStack[thread->mStackDepth - 1]->mName
+        );
+    }
+    
+}
+
+
+void LoomProfiler::tick()
+{
+    LoomProfilerThread *thread = currentThread();
+
+    if (!thread->mNamed)
+    {
+        setThreadName("Main");
+    }
+
+    lock(thread);
+
+    drainAll();
+
+    if (mTrace)
+    {
+        traceEvent(mTrace, thread, NULL, loom_readTimerNano(mTimer), 'i');
+    }
+
+    unlock(thread);
+}
+
+
+void LoomProfiler::drainAll()
+{
+    for (LoomProfilerThread *walk = mThreadList; walk; walk = walk->mNext)
+    {
+        drain(walk);
+    }
+}
+
+
+void LoomProfiler::drain(LoomProfilerThread *thread)
+{
+    U32 head = (U32)atomic_load32(&thread->mHead);
+    U32 tail = (U32)thread->mTail;
+
+    if (head == tail)
+    {
+        return;
+    }
+
+    for (; tail != head; tail++)
+    {
+        LoomProfilerEvent *event = &thread->mEvents[tail & (LoomProfilerThread::RingSize - 1)];
+
+        if (event->mBegin)
+        {
+            replayPush(thread, event->mRoot, event->mTime);
+        }
+        else
+        {
+            replayPop(thread, event->mRoot, event->mTime);
+        }
+    }
+
+    // Hands the slots back to the recording thread.
+    atomic_store32(&thread->mTail, (int)tail);
+}
+
+
+void LoomProfiler::replayPush(LoomProfilerThread *thread, LoomProfilerRoot *root, long long time)
+{
+   if(mTrace)
+   {
+      if(traceEvent(mTrace, thread, root, time, 'B'))
+         thread->mTraceDepth++;
+      else
+         thread->mTraceDropped++;
+   }
+
+   LoomProfilerEntry *current = thread->mCurrentEntry;
    LoomProfilerEntry *nextProfiler = NULL;
-   if(!root->mEnabled || mCurrentLoomProfilerEntry->mRoot == root)
+   if(!root->mEnabled || current->mRoot == root)
    {
-      mCurrentLoomProfilerEntry->mSubDepth++;
+      current->mSubDepth++;
       return;
    }
 
-   if(mCurrentLoomProfilerEntry->mLastSeenProfiler &&
-            mCurrentLoomProfilerEntry->mLastSeenProfiler->mRoot == root)
-      nextProfiler = mCurrentLoomProfilerEntry->mLastSeenProfiler;
+   if(current->mLastSeenProfiler &&
+            current->mLastSeenProfiler->mRoot == root)
+      nextProfiler = current->mLastSeenProfiler;
 
    if(!nextProfiler)
    {
       // first see if it's in the hash table...
       U32 index = root->mNameHash & (LoomProfilerEntry::HashTableSize - 1);
       
-      nextProfiler = mCurrentLoomProfilerEntry->mChildHash[index];
+      nextProfiler = current->mChildHash[index];
       while(nextProfiler)
       {
          if(nextProfiler->mRoot == root)
@@ -346,122 +828,197 @@ void LoomProfiler::hashPush(LoomProfilerRoot *root)
 
       if(!nextProfiler)
       {
-         nextProfiler = lmNew(gProfilerAllocator) LoomProfilerEntry();
-         for(U32 i = 0; i < LoomProfilerEntry::HashTableSize; i++)
-            nextProfiler->mChildHash[i] = 0;
+         nextProfiler = createEntry(root, current);
 
-         nextProfiler->mRoot = root;
          nextProfiler->mNextForRoot = root->mFirstLoomProfilerEntry;
          root->mFirstLoomProfilerEntry = nextProfiler;
 
          nextProfiler->mNextLoomProfilerEntry = mProfileList;
          mProfileList = nextProfiler;
 
-         nextProfiler->mNextHash = mCurrentLoomProfilerEntry->mChildHash[index];
-         mCurrentLoomProfilerEntry->mChildHash[index] = nextProfiler;
-
-         nextProfiler->mParent = mCurrentLoomProfilerEntry;
-         nextProfiler->mNextSibling = mCurrentLoomProfilerEntry->mFirstChild;
-         mCurrentLoomProfilerEntry->mFirstChild = nextProfiler;
-         nextProfiler->mFirstChild = NULL;
-         nextProfiler->mLastSeenProfiler = NULL;
-         nextProfiler->mHash = root->mNameHash;
-         nextProfiler->mInvokeCount = 0;
-         nextProfiler->mTotalTime = 0;
-         nextProfiler->mSubTime = 0;
-         nextProfiler->mMaxTime = 0;
-         nextProfiler->mMinTime = INFINITY;
-         nextProfiler->mSubDepth = 0;
+         nextProfiler->mNextHash = current->mChildHash[index];
+         current->mChildHash[index] = nextProfiler;
+
+         nextProfiler->mNextSibling = current->mFirstChild;
+         current->mFirstChild = nextProfiler;
       }
    }
 
    root->mTotalInvokeCount++;
    nextProfiler->mInvokeCount++;
    
-   nextProfiler->mStartTime = loom_readTimerNano(mTimer);
+   nextProfiler->mStartTime = (F64)time;
 
-   mCurrentLoomProfilerEntry->mLastSeenProfiler = nextProfiler;
-   mCurrentLoomProfilerEntry = nextProfiler;
+   current->mLastSeenProfiler = nextProfiler;
+   thread->mCurrentEntry = nextProfiler;
 }
 
 
-void LoomProfiler::enable(bool enabled)
+void LoomProfiler::replayPop(LoomProfilerThread *thread, LoomProfilerRoot *root, long long time)
 {
-    mNextEnable = enabled;
+    // Once the trace is full every later begin is dropped, so the dropped
+    // blocks are always the innermost ones still open.
+    if (mTrace && thread->mTraceDropped > 0)
+    {
+        thread->mTraceDropped--;
+    }
+    else if (mTrace && thread->mTraceDepth > 0)
+    {
+        traceEvent(mTrace, thread, root, time, 'E');
+        thread->mTraceDepth--;
+    }
+
+    LoomProfilerEntry *current = thread->mCurrentEntry;
+
+    if (current->mSubDepth)
+    {
+        current->mSubDepth--;
+        return;
+    }
+
+    // The block was opened before the last reset.
+    if (current == thread->mRootEntry)
+    {
+        return;
+    }
+
+    F64 fElapsed = (F64)time - current->mStartTime;
+
+    lmAssert(fElapsed >= 0, "Elapsed time should be positive - is %f", fElapsed);
+
+    current->mTotalTime        += fElapsed;
+    current->mParent->mSubTime += fElapsed; // mark it in the parent as well...
+    current->mRoot->mTotalTime += fElapsed;
+    current->mMaxTime = fElapsed > current->mMaxTime ? fElapsed : current->mMaxTime;
+    current->mMinTime = fElapsed < current->mMinTime ? fElapsed : current->mMinTime;
+    current->mRoot->mMaxTime = fElapsed > current->mRoot->mMaxTime ? fElapsed : current->mRoot->mMaxTime;
+    current->mRoot->mMinTime = fElapsed < current->mRoot->mMinTime ? fElapsed : current->mRoot->mMinTime;
+    if (current->mParent->mRoot)
+    {
+        current->mParent->mRoot->mSubTime += fElapsed; // mark it in the parent as well...
+    }
+    thread->mCurrentEntry = current->mParent;
 }
 
 
-void LoomProfiler::hashPop(LoomProfilerRoot *expected)
+void LoomProfiler::beginTrace(int maxEvents)
 {
-    Telemetry::endTickTimer(expected);
+    LoomProfilerThread *thread = currentThread();
 
-    mStackDepth--;
+    lock(thread);
 
-    lmAssert(mStackDepth >= 0, "Stack underflow in profiler.  You may have mismatched PROFILE_START and PROFILE_ENDs");
-    if (mEnabled)
+    // Events recorded before this point are not part of the trace.
+    drainAll();
+
+    if (!mTrace)
     {
-        if (mCurrentLoomProfilerEntry->mSubDepth)
-        {
-            mCurrentLoomProfilerEntry->mSubDepth--;
-            return;
-        }
+        mTrace = lmNew(gProfilerAllocator) LoomProfilerTrace();
+    }
 
-        if (expected)
-        {
-            lmAssert(expected == mCurrentLoomProfilerEntry->mRoot, "LoomProfiler::hashPop - didn't get expected ProfilerRoot!");
-        }
+    mTrace->mEvents.clear();
+    mTrace->mMaxEvents = maxEvents > 0 ? (UTsize)maxEvents : 0;
+    mTrace->mDropped = 0;
+
+    for (LoomProfilerThread *walk = mThreadList; walk; walk = walk->mNext)
+    {
+        walk->mTraceDepth = 0;
+        walk->mTraceDropped = 0;
+    }
+
+    mNextEnable = true;
+
+    unlock(thread);
+}
 
-        F64 fElapsed = loom_readTimerNano(mTimer) - mCurrentLoomProfilerEntry->mStartTime;
 
-        lmAssert(fElapsed >= 0, "Elapsed time should be positive - is %f", fElapsed);
+bool LoomProfiler::endTrace(const char *path)
+{
+    LoomProfilerThread *thread = currentThread();
 
-        mCurrentLoomProfilerEntry->mTotalTime        += fElapsed;
-        mCurrentLoomProfilerEntry->mParent->mSubTime += fElapsed; // mark it in the parent as well...
-        mCurrentLoomProfilerEntry->mRoot->mTotalTime += fElapsed;
-        mCurrentLoomProfilerEntry->mMaxTime = fElapsed > mCurrentLoomProfilerEntry->mMaxTime ? fElapsed : mCurrentLoomProfilerEntry->mMaxTime;
-        mCurrentLoomProfilerEntry->mMinTime = fElapsed < mCurrentLoomProfilerEntry->mMinTime ? fElapsed : mCurrentLoomProfilerEntry->mMinTime;
-        mCurrentLoomProfilerEntry->mRoot->mMaxTime = fElapsed > mCurrentLoomProfilerEntry->mRoot->mMaxTime ? fElapsed : mCurrentLoomProfilerEntry->mRoot->mMaxTime;
-        mCurrentLoomProfilerEntry->mRoot->mMinTime = fElapsed < mCurrentLoomProfilerEntry->mRoot->mMinTime ? fElapsed : mCurrentLoomProfilerEntry->mRoot->mMinTime;
-        if (mCurrentLoomProfilerEntry->mParent->mRoot)
+    lock(thread);
+
+    if (!mTrace)
+    {
+        unlock(thread);
+        return false;
+    }
+
+    drainAll();
+
+    // Close the blocks that are still open so every begin has an end.
+    long long now = loom_readTimerNano(mTimer);
+    for (LoomProfilerThread *walk = mThreadList; walk; walk = walk->mNext)
+    {
+        for (; walk->mTraceDepth > 0; walk->mTraceDepth--)
         {
-            mCurrentLoomProfilerEntry->mParent->mRoot->mSubTime += fElapsed; // mark it in the parent as well...
+            traceEvent(mTrace, walk, NULL, now, 'E');
         }
-        mCurrentLoomProfilerEntry = mCurrentLoomProfilerEntry->mParent;
     }
 
-    if (mStackDepth == 0)
+    LoomProfilerTrace *trace = mTrace;
+    mTrace = NULL;
+
+    unlock(thread);
+
+    FILE *file = fopen(path, "wb");
+
+    if (!file)
+    {
+        lmLogError(gProfilerLogGroup, "Unable to write trace to %s", path);
+        lmSafeDelete(gProfilerAllocator, trace);
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Loom\"}}");
+
+    // Threads are only ever added to the head of the list, so it is safe to
+    // walk without the lock.
+    for (LoomProfilerThread *walk = mThreadList; walk; walk = walk->mNext)
+    {
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", walk->mIndex);
+        writeTraceString(file, walk->mName);
+        fprintf(file, "}}");
+    }
+
+    for (UTsize i = 0; i < trace->mEvents.size(); i++)
     {
-        // apply the next enable...
-        if (mDumpToConsole)
+        const LoomProfilerTraceEvent &event = trace->mEvents[i];
+        double ts = (double)event.mTime / 1000.0;
+
+        if (event.mPhase == 'B')
         {
-            dump();
-            mCurrentLoomProfilerEntry->mStartTime = loom_readTimerNano(mTimer);
+            fprintf(file, ",\n{\"name\":");
+            writeTraceString(file, event.mRoot->mName);
+            fprintf(file, ",\"ph\":\"B\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", event.mThread->mIndex, ts);
         }
-        if (!mEnabled && mNextEnable)
+        else if (event.mPhase == 'E')
         {
-            mCurrentLoomProfilerEntry->mStartTime = loom_readTimerNano(mTimer);
+            fprintf(file, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", event.mThread->mIndex, ts);
+        }
+        else
+        {
+            fprintf(file, ",\n{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", event.mThread->mIndex, ts);
         }
-
-        mEnabled = mNextEnable;
     }
-}
 
-void LoomProfiler::hashZeroCheck()
-{
-    if (mStackDepth != 0)
+    fprintf(file, "\n]}\n");
+
+    bool written = ferror(file) == 0;
+    fclose(file);
+
+    if (trace->mDropped > 0)
     {
-        // If you get this assert, it means you probably have mismatched LOOM_PROFILE_START
-        // and LOOM_PROFILE_END blocks. Enable LOOM_PROFILE_AT_ENGINE_START (see #define at top
-        // of file) to get a breakpoint on the exact mismatching LOOM_PROFILE_END.
-        lmAssert(false, "Profiler zero stack check failed: %s",
-            mCurrentLoomProfilerEntry == NULL ? "[entry NULL]" :
-            mCurrentLoomProfilerEntry->mRoot == NULL ? "[entry root NULL] (try compiling as a debug build or with LOOM_PROFILE_AT_ENGINE_START enabled for more info)" :
-            mCurrentLoomProfilerEntry->mRoot->mName
-        );
+        lmLogWarn(gProfilerLogGroup, "Trace was full, dropped %u blocks", trace->mDropped);
     }
-    
+    lmLogInfo(gProfilerLogGroup, "Wrote %u trace events to %s", (unsigned int)trace->mEvents.size(), path);
+
+    lmSafeDelete(gProfilerAllocator, trace);
+
+    return written;
 }
 
+
 static S32 rootDataCompare(const void *s1, const void *s2)
 {
     const LoomProfilerRoot *r1 = *((LoomProfilerRoot **)s1);
@@ -541,14 +1098,8 @@ static void LoomProfilerEntryDumpRecurse(LoomProfilerEntry *data, char *buffer,
 
 void LoomProfiler::dump()
 {
-    LOOM_PROFILE_ZERO_CHECK()
-
-    bool enableSave = mEnabled;
-
-    mEnabled = false;
-    mStackDepth++;
-
-    // may have some profiled calls... gotta turn em off.
+    // may have some profiled calls... the caller holds the lock, so
+    // anything profiled on this thread while dumping is skipped.
 
     utArray<LoomProfilerRoot *> rootVector;
     F64 totalTime = 0.0;
@@ -564,7 +1115,10 @@ void LoomProfiler::dump()
         rootVector.push_back(walk);
     }
 
-    qsort((void *)&rootVector[0], rootVector.size(), sizeof(LoomProfilerRoot *), rootDataCompare);
+    if (rootVector.size() > 0)
+    {
+        qsort((void *)&rootVector[0], rootVector.size(), sizeof(LoomProfilerRoot *), rootDataCompare);
+    }
 
     lmLogInfo(gProfilerLogGroup, "");
     lmLogInfo(gProfilerLogGroup, "Profiler Data Dump:");
@@ -603,20 +1157,25 @@ void LoomProfiler::dump()
         root->mMinTime = INFINITY;
     }
     lmLogInfo(gProfilerLogGroup, "Suppressed %i items with < %.1f%% of measured time.", suppressedEntries, threshold);
-    lmLogInfo(gProfilerLogGroup, "");
-    lmLogInfo(gProfilerLogGroup, "Ordered by stack trace total time -");
-    lmLogInfo(gProfilerLogGroup, "  %% Time %% NSTime  AvgTime  MaxTime  MinTime Invoke # Name");
-
-    mCurrentLoomProfilerEntry->mTotalTime = loom_readTimerNano(mTimer);
 
     char depthBuffer[MaxStackDepth * 2 + 1];
-    depthBuffer[0]    = 0;
-    suppressedEntries = 0;
-    LoomProfilerEntryDumpRecurse(mCurrentLoomProfilerEntry, depthBuffer, 0, totalTime, threshold);
-    lmLogInfo(gProfilerLogGroup, "Suppressed %i items with < %.1f%% of measured time.", suppressedEntries, threshold);
 
-    mEnabled = enableSave;
-    mStackDepth--;
+    for (LoomProfilerThread *thread = mThreadList; thread; thread = thread->mNext)
+    {
+        if (thread->mRootEntry->mFirstChild == NULL)
+        {
+            continue;
+        }
+
+        lmLogInfo(gProfilerLogGroup, "");
+        lmLogInfo(gProfilerLogGroup, "Ordered by stack trace total time (%s) -", thread->mName);
+        lmLogInfo(gProfilerLogGroup, "  %% Time %% NSTime  AvgTime  MaxTime  MinTime Invoke # Name");
+
+        depthBuffer[0]    = 0;
+        suppressedEntries = 0;
+        LoomProfilerEntryDumpRecurse(thread->mRootEntry, depthBuffer, 0, totalTime, threshold);
+        lmLogInfo(gProfilerLogGroup, "Suppressed %i items with < %.1f%% of measured time.", suppressedEntries, threshold);
+    }
 
     mDumpToConsole = false;
 }
@@ -77,7 +77,6 @@ extern "C" {
 
 extern HTELEMETRY gTelemetryContext;
 void performance_initialize();
-void performance_tick();
 void performance_shutdown();
 
 #else
@@ -100,10 +99,13 @@ void performance_shutdown();
 #define tmFree(...)
 
 #define performance_initialize()
-#define performance_tick()
 #define performance_shutdown()
 #endif
 
+// Called once per frame from the main loop. Ticks Telemetry when it is
+// available and aggregates the per-thread profiler event buffers.
+void performance_tick();
+
 void profilerEnter(const char *name);
 void profilerLeave(const char *name);
 
@@ -121,6 +123,8 @@ void finishProfilerBlock(profilerBlock_t *block);
 
 struct LoomProfilerEntry;
 struct LoomProfilerRoot;
+struct LoomProfilerThread;
+struct LoomProfilerTrace;
 
 typedef unsigned int   U32;
 typedef int            S32;
@@ -128,28 +132,50 @@ typedef float          F32;
 typedef double         F64;
 
 
-
+/**
+ * Every thread that enters a profiled block gets its own LoomProfilerThread
+ * context. Begin and end events are written into a per-thread ring buffer
+ * without taking any locks; the rings are drained into per-thread call trees
+ * once per frame from performance_tick (or earlier, if a ring fills up).
+ * Contexts of threads started with loom_thread_start are reused once those
+ * threads exit, so short-lived workers don't pile up.
+ *
+ * While a trace is being captured (see beginTrace) the drained events are
+ * also kept in order and can be written out as Chrome Trace Event JSON,
+ * which loads in chrome://tracing and Perfetto.
+ */
 class LoomProfiler
 {
     enum
     {
         MaxStackDepth = 256,
     };
-    U32 mCurrentHash;
 
-    LoomProfilerEntry *mCurrentLoomProfilerEntry;
     LoomProfilerEntry *mProfileList;
-    LoomProfilerEntry *mRootLoomProfilerEntry;
+    LoomProfilerThread *mThreadList;
+    LoomProfilerThread *mFreeThreadList;
+    LoomProfilerTrace  *mTrace;
+    void *mMutex;
     loom_precision_timer_t mTimer;
 
-    bool mEnabled;
-    S32  mStackDepth;
+    volatile bool mEnabled;
     bool mNextEnable;
-    U32  mMaxStackDepth;
     bool mDumpToConsole;
     void dump();
     void validate();
 
+    LoomProfilerThread *currentThread();
+    LoomProfilerThread *registerThread();
+    void lock(LoomProfilerThread *thread);
+    void unlock(LoomProfilerThread *thread);
+    void frameBoundary(LoomProfilerThread *thread);
+
+    void drain(LoomProfilerThread *thread);
+    void drainAll();
+    void replayPush(LoomProfilerThread *thread, LoomProfilerRoot *root, long long time);
+    void replayPop(LoomProfilerThread *thread, LoomProfilerRoot *root, long long time);
+    void resetThread(LoomProfilerThread *thread);
+
 public:
     LoomProfiler();
     ~LoomProfiler();
@@ -172,6 +198,28 @@ public:
     void hashPop(LoomProfilerRoot *expected);
 
     void hashZeroCheck();
+
+    /// Aggregates the events recorded by all threads since the last tick,
+    /// called from performance_tick on the main loop thread.
+    void tick();
+
+    /// Name the calling thread in dumps and exported traces.
+    void setThreadName(const char *name);
+
+    /// Hands the calling thread's context back for reuse by the next thread
+    /// that gets profiled, called when a loom_thread_start thread exits.
+    void releaseThread();
+
+    /// Start capturing a timeline of all profiled blocks on all threads;
+    /// this also enables the profiler. At most maxEvents are kept.
+    void beginTrace(int maxEvents);
+
+    /// Stop capturing and write the timeline to path as Chrome Trace Event
+    /// JSON. Returns false if no trace was active or the file could not be
+    /// written.
+    bool endTrace(const char *path);
+
+    inline bool isTracing() { return mTrace != 0; }
 };
 
 extern LoomProfiler *gLoomProfiler;
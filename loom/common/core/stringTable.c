@@ -19,6 +19,7 @@
  */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <assert.h>
 
@@ -27,115 +28,270 @@
 #include "loom/common/platform/platformThread.h"
 #include "loom/common/platform/platform.h"
 
+/*
+ * Interned strings live in an open-addressed table of entry pointers.
+ *
+ * Lookups never lock: they load the current bucket array and probe it.
+ * A slot goes from NULL to a fully written entry exactly once, so a reader
+ * either sees the entry or an empty slot, in which case it falls back to
+ * the locked insert path, which probes again before adding anything.
+ *
+ * Growing copies every entry into a bucket array twice the size and then
+ * publishes it. The old array is chained off the new one and never freed,
+ * since a reader may still be walking it; the chain totals less than the
+ * live array. Strings are never removed.
+ *
+ * String data is carved out of arena chunks so a new entry costs one bump
+ * rather than two lmAlloc calls.
+ */
+
 typedef struct stringTableEntry
 {
-    const char              *string;
-    struct stringTableEntry *next;
+    unsigned int hash;
+    unsigned int length;
+    char         string[1];
 } stringTableEntry_t;
 
-#define csmTableSize    4027 // Biggest prime smaller than 4k.
-static stringTableEntry_t *gTable[csmTableSize];
-static MutexHandle        gTableMutex = NULL;
+typedef struct stringTableBuckets
+{
+    struct stringTableBuckets   *retired;
+    unsigned int                mask;
+    stringTableEntry_t *volatile slots[1];
+} stringTableBuckets_t;
+
+typedef struct stringTableChunk
+{
+    struct stringTableChunk *next;
+    size_t                  used;
+    size_t                  size;
+} stringTableChunk_t;
+
+#define STRINGTABLE_INITIAL_BUCKETS    4096
+#define STRINGTABLE_CHUNK_SIZE         (32 * 1024)
+
+static stringTableBuckets_t *volatile gTable      = NULL;
+static unsigned int                   gTableCount = 0;
+static stringTableChunk_t             *gChunks    = NULL;
+static MutexHandle                    gTableMutex = NULL;
+static volatile atomic_int_t          gTableState = 0;
+
+static stringTableBuckets_t *allocBuckets(unsigned int count)
+{
+    size_t               size    = sizeof(stringTableBuckets_t) + (count - 1) * sizeof(stringTableEntry_t *);
+    stringTableBuckets_t *result = (stringTableBuckets_t *)lmAlloc(NULL, size);
+
+    memset(result, 0, size);
+    result->mask = count - 1;
+    return result;
+}
+
 
 void stringtable_initialize()
 {
-    // Clear out the hash table.
-    memset(gTable, 0, sizeof(stringTableEntry_t *) * csmTableSize);
-    gTableMutex = loom_mutex_create();
+    // Safe to call more than once and from any thread; only the first call
+    // sets up the table.
+    if (atomic_load32(&gTableState) == 2)
+    {
+        return;
+    }
+
+    if (atomic_compareAndExchange(&gTableState, 0, 1) == 0)
+    {
+        gTableMutex = loom_mutex_create();
+        atomic_storePtr((void *volatile *)&gTable, allocBuckets(STRINGTABLE_INITIAL_BUCKETS));
+        atomic_store32(&gTableState, 2);
+        return;
+    }
+
+    while (atomic_load32(&gTableState) != 2)
+    {
+        loom_thread_yield();
+    }
 }
 
 
-static unsigned long hash(const char *str)
+static unsigned int hash(const char *str, size_t length)
 {
     // Courtesy of http://www.cse.yorku.ca/~oz/hash.html
-    unsigned long hash_result = 5381;
-    int           c;
+    unsigned int hash_result = 5381;
+    size_t       i;
 
-    while ((c = *str++))
+    for (i = 0; i < length; i++)
     {
-        hash_result = ((hash_result << 5) + hash_result) + c; /* hash * 33 + c */
+        hash_result = ((hash_result << 5) + hash_result) + (unsigned char)str[i]; /* hash * 33 + c */
     }
+
+    // Names like "foo.1", "foo.2" hash to neighbouring values, which would
+    // pile up into long linear probe runs; scramble the bits before masking.
+    hash_result ^= hash_result >> 16;
+    hash_result *= 0x85ebca6b;
+    hash_result ^= hash_result >> 13;
+    hash_result *= 0xc2b2ae35;
+    hash_result ^= hash_result >> 16;
+
     return hash_result;
 }
 
 
-static stringTableEntry_t *allocEntry(const char *str)
+static stringTableEntry_t *findEntry(stringTableBuckets_t *table, const char *str, size_t length, unsigned int hash_result)
+{
+    unsigned int       i = hash_result & table->mask;
+    stringTableEntry_t *walk;
+
+    for ( ; ; )
+    {
+        walk = (stringTableEntry_t *)atomic_loadPtr((void *volatile *)&table->slots[i]);
+
+        if (walk == NULL)
+        {
+            return NULL;
+        }
+
+        if ((walk->hash == hash_result) && (walk->length == length) && (memcmp(walk->string, str, length) == 0))
+        {
+            return walk;
+        }
+
+        i = (i + 1) & table->mask;
+    }
+}
+
+
+// Called with gTableMutex held.
+static stringTableEntry_t *allocEntry(const char *str, size_t length, unsigned int hash_result)
 {
-    size_t len;
-    stringTableEntry_t *entry = (stringTableEntry_t *)lmAlloc(NULL, sizeof(stringTableEntry_t));
+    // Keep entries aligned for the header fields.
+    size_t             size  = (offsetof(stringTableEntry_t, string) + length + 1 + sizeof(unsigned int) - 1) & ~(sizeof(unsigned int) - 1);
+    stringTableChunk_t *chunk = gChunks;
+    stringTableEntry_t *entry;
+
+    if ((chunk == NULL) || (chunk->used + size > chunk->size))
+    {
+        size_t chunkSize = size > STRINGTABLE_CHUNK_SIZE / 4 ? size : STRINGTABLE_CHUNK_SIZE;
+
+        chunk       = (stringTableChunk_t *)lmAlloc(NULL, sizeof(stringTableChunk_t) + chunkSize);
+        chunk->used = 0;
+        chunk->size = chunkSize;
+
+        // Oversized strings get their own chunk; keep filling the current one.
+        if ((gChunks != NULL) && (chunkSize != STRINGTABLE_CHUNK_SIZE))
+        {
+            chunk->next   = gChunks->next;
+            gChunks->next = chunk;
+        }
+        else
+        {
+            chunk->next = gChunks;
+            gChunks     = chunk;
+        }
+    }
+
+    entry = (stringTableEntry_t *)((char *)(chunk + 1) + chunk->used);
+    chunk->used += size;
 
-    entry->next = NULL;
-    len = strlen(str);
-    entry->string = (const char*)lmAlloc(NULL, len + 1);
-    memcpy((char*)entry->string, str, len);
-    ((char*)entry->string)[len] = '\0';
+    entry->hash   = hash_result;
+    entry->length = (unsigned int)length;
+    memcpy(entry->string, str, length);
+    entry->string[length] = '\0';
 
     return entry;
 }
 
 
-StringTableEntry stringtable_insert(const char *str)
+// Called with gTableMutex held.
+static stringTableBuckets_t *growTable(stringTableBuckets_t *table)
 {
-    unsigned long      hash_result;
-    stringTableEntry_t *walk  = NULL;
-    StringTableEntry   result = NULL;
-    int                bucket;
+    stringTableBuckets_t *grown = allocBuckets((table->mask + 1) * 2);
+    stringTableEntry_t   *walk;
+    unsigned int         i, j;
+
+    for (i = 0; i <= table->mask; i++)
+    {
+        walk = table->slots[i];
+        if (walk == NULL)
+        {
+            continue;
+        }
 
+        j = walk->hash & grown->mask;
+        while (grown->slots[j] != NULL)
+        {
+            j = (j + 1) & grown->mask;
+        }
+        grown->slots[j] = walk;
+    }
+
+    grown->retired = table;
+    atomic_storePtr((void *volatile *)&gTable, grown);
+
+    return grown;
+}
+
+
+StringTableEntry stringtable_insert(const char *str)
+{
     // A NULL would cause a crash eventually
     if (str == NULL)
         str = "";
 
-    // Hash the string.
-    hash_result = hash(str);
-
-    // Determine the hash table bucket.
-    bucket = hash_result % csmTableSize;
+    return stringtable_insertWithLength(str, strlen(str));
+}
 
-    // TODO: Make this a readwrite lock, since most of the time we are just
-    // traversing the stringtable to find existing data, not inserting.
-    loom_mutex_lock(gTableMutex);
 
-    // Walk the chain, if any.
-    walk = gTable[bucket];
+StringTableEntry stringtable_insertWithLength(const char *str, size_t length)
+{
+    unsigned int         hash_result;
+    stringTableBuckets_t *table;
+    stringTableEntry_t   *entry;
+    unsigned int         i;
 
-    // Empty bucket, easy case!
-    if (!walk)
+    if (str == NULL)
     {
-        gTable[bucket] = allocEntry(str);
-        assert(gTable[bucket]->string);
-        result = gTable[bucket]->string;
-        loom_mutex_unlock(gTableMutex);
+        str    = "";
+        length = 0;
+    }
 
-        return result;
+    stringtable_initialize();
+
+    hash_result = hash(str, length);
+
+    // Fast path, no lock: most calls intern a string we already have.
+    table = (stringTableBuckets_t *)atomic_loadPtr((void *volatile *)&gTable);
+    entry = findEntry(table, str, length, hash_result);
+    if (entry != NULL)
+    {
+        return entry->string;
     }
 
-    while (walk)
+    loom_mutex_lock(gTableMutex);
+
+    // Another thread may have added it, or grown the table, since we looked.
+    table = gTable;
+    entry = findEntry(table, str, length, hash_result);
+    if (entry != NULL)
     {
-        // Is it a match?
-        if (strcmp(walk->string, str) == 0)
-        {
-            assert(walk->string);
-            result = (StringTableEntry)walk->string;
-            loom_mutex_unlock(gTableMutex);
+        loom_mutex_unlock(gTableMutex);
+        return entry->string;
+    }
 
-            return result;
-        }
+    // Stay under 3/4 full so probe chains stay short.
+    if ((gTableCount + 1) * 4 > (table->mask + 1) * 3)
+    {
+        table = growTable(table);
+    }
 
-        // Another one to check?
-        if (walk->next != NULL)
-        {
-            walk = walk->next;
-            continue;
-        }
+    entry = allocEntry(str, length, hash_result);
 
-        break;
+    i = hash_result & table->mask;
+    while (table->slots[i] != NULL)
+    {
+        i = (i + 1) & table->mask;
     }
+    atomic_storePtr((void *volatile *)&table->slots[i], entry);
+    gTableCount++;
 
-    // No match. Chain 'er on.
-    walk->next = allocEntry(str);
-    assert(walk->next->string);
-    result = walk->next->string;
+    assert(entry->string);
     loom_mutex_unlock(gTableMutex);
 
-    return result;
+    return entry->string;
 }
@@ -21,6 +21,8 @@
 #ifndef _CORE_STRINGTABLE_H_
 #define _CORE_STRINGTABLE_H_
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,15 +30,21 @@ extern "C" {
 // Typedef to identify inserted strings.
 typedef const char * StringTableEntry;
 
-// Called to initialize the string table! Call before using insert.
+// Called to initialize the string table! Safe to call more than once; insert
+// also initializes on first use.
 void stringtable_initialize();
 
 // Takes strings and returns a single copy, so we can save on memory/string
 // overhead and simplify compares - one global copy means we can do pointer
-// compares rather than strcmp. This is thread-safe. This action is also
+// compares rather than strcmp. This is thread-safe, and looking up a string
+// that is already in the table never takes a lock. This action is also
 // known as interning the string in some realms.
 StringTableEntry stringtable_insert(const char *str);
 
+// As stringtable_insert, for callers that already know the length. str need
+// not be NUL terminated; the returned copy always is.
+StringTableEntry stringtable_insertWithLength(const char *str, size_t length);
+
 #ifdef __cplusplus
 };
 #endif
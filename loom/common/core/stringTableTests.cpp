@@ -18,12 +18,23 @@
  * ===========================================================================
  */
 
+#include <stdio.h>
+#include <string.h>
+
 #include "seatest.h"
+#include "loom/common/core/log.h"
 #include "loom/common/core/stringTable.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/common/platform/platformTime.h"
+
+lmDefineLogGroup(gStringTableTestLogGroup, "stringTableTest", 1, LoomLogInfo);
 
 SEATEST_FIXTURE(stringTable)
 {
     SEATEST_FIXTURE_ENTRY(stringTable_basic);
+    SEATEST_FIXTURE_ENTRY(stringTable_withLength);
+    SEATEST_FIXTURE_ENTRY(stringTable_grow);
+    SEATEST_FIXTURE_ENTRY(stringTable_threaded);
 }
 
 SEATEST_TEST(stringTable_basic)
@@ -40,3 +51,131 @@ SEATEST_TEST(stringTable_basic)
     assert_string_equal((char *)ste1, "Hey!");
     assert_true(ste2 != ste3);
 }
+
+SEATEST_TEST(stringTable_withLength)
+{
+    stringtable_initialize();
+    StringTableEntry ste1 = stringtable_insertWithLength("Hey!Whoa!", 4);
+    StringTableEntry ste2 = stringtable_insert("Hey!");
+    StringTableEntry ste3 = stringtable_insertWithLength("Whoa!Hey!", 5);
+    StringTableEntry ste4 = stringtable_insertWithLength(NULL, 0);
+
+    assert_true(ste1 == ste2);
+    assert_string_equal((char *)ste3, "Whoa!");
+    assert_true(ste3 == stringtable_insert("Whoa!"));
+    assert_true(ste4 == stringtable_insert(""));
+    assert_true(ste4 == stringtable_insert(NULL));
+}
+
+SEATEST_TEST(stringTable_grow)
+{
+    static const int count = 20000;
+    StringTableEntry *entries = new StringTableEntry[count];
+    char             name[64];
+
+    // Enough distinct strings to force the table to grow a few times.
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "stringTable_grow.%d", i);
+        entries[i] = stringtable_insert(name);
+        assert_string_equal((char *)entries[i], name);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "stringTable_grow.%d", i);
+        assert_true(entries[i] == stringtable_insert(name));
+    }
+
+    delete[] entries;
+}
+
+static const int STRINGTABLE_BENCH_NAMES      = 4096;
+static const int STRINGTABLE_BENCH_PASSES     = 64;
+static const int STRINGTABLE_BENCH_MAX_THREAD = 8;
+
+static char             gStringTableBenchNames[STRINGTABLE_BENCH_NAMES][32];
+static StringTableEntry gStringTableBenchResults[STRINGTABLE_BENCH_MAX_THREAD][STRINGTABLE_BENCH_NAMES];
+static int              gStringTableBenchChanged[STRINGTABLE_BENCH_MAX_THREAD];
+static volatile int     gStringTableBenchRound = 0;
+
+// Interns the shared name list in a thread-specific order, so threads race to
+// add the same new strings on the first pass and only look them up afterwards.
+// Later passes count lookups that don't return the entry of the first pass.
+static int __stdcall stringTableBenchThreadFunc(void *param)
+{
+    int              thread  = (int)(size_t)param;
+    StringTableEntry *result = gStringTableBenchResults[thread];
+    int              changed = 0;
+
+    for (int pass = 0; pass < STRINGTABLE_BENCH_PASSES; pass++)
+    {
+        for (int i = 0; i < STRINGTABLE_BENCH_NAMES; i++)
+        {
+            int              idx   = (i * 7 + thread * 131) & (STRINGTABLE_BENCH_NAMES - 1);
+            StringTableEntry entry = stringtable_insert(gStringTableBenchNames[idx]);
+            if (pass == 0)
+            {
+                result[idx] = entry;
+            }
+            else if (entry != result[idx])
+            {
+                changed++;
+            }
+        }
+    }
+
+    gStringTableBenchChanged[thread] = changed;
+
+    return 0;
+}
+
+SEATEST_TEST(stringTable_threaded)
+{
+    ThreadHandle threads[STRINGTABLE_BENCH_MAX_THREAD];
+
+    for (int threadCount = 1; threadCount <= STRINGTABLE_BENCH_MAX_THREAD; threadCount *= 2)
+    {
+        // Fresh names each round so the first pass really inserts.
+        int round = gStringTableBenchRound++;
+        for (int i = 0; i < STRINGTABLE_BENCH_NAMES; i++)
+        {
+            snprintf(gStringTableBenchNames[i], sizeof(gStringTableBenchNames[i]), "bench.%d.%d", round, i);
+        }
+
+        loom_precision_timer_t timer = loom_startTimer();
+
+        for (int i = 0; i < threadCount; i++)
+        {
+            threads[i] = loom_thread_start(stringTableBenchThreadFunc, (void *)(size_t)i);
+        }
+
+        for (int i = 0; i < threadCount; i++)
+        {
+            loom_thread_join(threads[i]);
+        }
+
+        long long ns = loom_readTimerNano(timer);
+        loom_destroyTimer(timer);
+
+        // Entries must stay put while the table grows under other threads
+        for (int t = 0; t < threadCount; t++)
+        {
+            assert_int_equal(0, gStringTableBenchChanged[t]);
+        }
+
+        // Every thread must have been handed the same copy of each string.
+        for (int i = 0; i < STRINGTABLE_BENCH_NAMES; i++)
+        {
+            assert_string_equal((char *)gStringTableBenchResults[0][i], gStringTableBenchNames[i]);
+            assert_true(stringtable_insert(gStringTableBenchNames[i]) == gStringTableBenchResults[0][i]);
+            for (int t = 1; t < threadCount; t++)
+            {
+                assert_true(gStringTableBenchResults[t][i] == gStringTableBenchResults[0][i]);
+            }
+        }
+
+        lmLogInfo(gStringTableTestLogGroup, "%d thread(s): %lld ns per insert",
+                  threadCount, ns / ((long long)threadCount * STRINGTABLE_BENCH_PASSES * STRINGTABLE_BENCH_NAMES));
+    }
+}
@@ -15,7 +15,22 @@ utByteArray Telemetry::sendBuffer;
 
 int Telemetry::tickId = 0;
 
-TableValues<TickMetricValue> Telemetry::tickValues;
+const char *Telemetry::tickMetricNames[TICK_METRICS_MAX];
+int Telemetry::tickMetricCount = 0;
+int Telemetry::tickMetricsDropped = 0;
+utHashTable<utHashedString, TickMetricID> *Telemetry::tickMetricLookup = NULL;
+
+TickMetricValue Telemetry::tickMetrics[TICK_METRICS_MAX];
+bool Telemetry::tickMetricIsSet[TICK_METRICS_MAX];
+TickMetricID Telemetry::tickMetricsSet[TICK_METRICS_MAX];
+int Telemetry::tickMetricsSetCount = 0;
+size_t Telemetry::tickValuesSize = 0;
+
+UTuint64 *Telemetry::tickEvents = NULL;
+int Telemetry::tickEventCount = 0;
+int Telemetry::tickEventsOpen = 0;
+int Telemetry::tickEventsSkipDepth = 0;
+int Telemetry::tickEventsDropped = 0;
 
 loom_precision_timer_t Telemetry::tickTimer = loom_startTimer();
 
@@ -30,7 +45,10 @@ template<> const TableType TableValues<TickMetricValue>::type = 1;
 template<> const int TableValues<TickMetricValue>::packedItemSize = 4 + 8;
 
 static const int EVENT_BYTE_SIZE = 16;
-static const size_t EVENTS_MIN_SIZE = EVENT_BYTE_SIZE*128;
+
+static TickMetricID tickIdMetric = Telemetry::registerTickValue("tick.id");
+static TickMetricID eventsDroppedMetric = Telemetry::registerTickValue("telemetry.events.dropped");
+static TickMetricID valuesDroppedMetric = Telemetry::registerTickValue("telemetry.values.dropped");
 
 void Telemetry::enable()
 {
@@ -46,12 +64,22 @@ void Telemetry::beginTick()
 {
     if (enabled != pendingEnabled) {
         if (pendingEnabled) tickThreadId = platform_getCurrentThreadId();
+        if (pendingEnabled && !tickEvents) tickEvents = (UTuint64*)lmAlloc(NULL, TICK_EVENTS_MAX*EVENT_BYTE_SIZE);
         enabled = pendingEnabled;
         lmLog(gTelemetryLogGroup, "Telemetry %s", enabled ? "enabled" : "disabled");
     }
     if (!enabled) return;
 
-    tickValues.reset();
+    // Only clear the values that were actually set last tick
+    for (int i = 0; i < tickMetricsSetCount; i++) tickMetricIsSet[tickMetricsSet[i]] = false;
+    tickMetricsSetCount = 0;
+    tickValuesSize = TableValues<TickMetricValue>::HEADER_SIZE;
+
+    tickEventCount = 0;
+    tickEventsOpen = 0;
+    tickEventsSkipDepth = 0;
+    tickEventsDropped = 0;
+
     tickProfilerRootsVisited = 0;
 
     loom_resetTimer(tickTimer);
@@ -74,7 +102,7 @@ void Telemetry::beginTick()
     eventsStartPos = sendBuffer.getPosition();
 
     // Add the tick id as a default tick value
-    setTickValue("tick.id", tickId);
+    setTickValue(tickIdMetric, tickId);
 
     tickProfilerActive = true;
 }
@@ -226,6 +254,18 @@ void Telemetry::endTick()
 
     tickProfilerActive = false;
 
+    if (tickEventsDropped > 0) setTickValue(eventsDroppedMetric, tickEventsDropped);
+    if (tickMetricsDropped > 0) setTickValue(valuesDroppedMetric, tickMetricsDropped);
+
+    // Copy the whole event buffer over at once, it's already in the wire format
+    size_t eventsBytes = tickEventCount*EVENT_BYTE_SIZE;
+    if (sendBuffer.getPosition() + eventsBytes > sendBuffer.getSize())
+    {
+        sendBuffer.resize(sendBuffer.getPosition() + eventsBytes);
+    }
+    memcpy(static_cast<unsigned char*>(sendBuffer.getDataPtr()) + sendBuffer.getPosition(), tickEvents, eventsBytes);
+    sendBuffer.setPosition(sendBuffer.getPosition() + eventsBytes);
+
     // End events with a zero int64
     sendBuffer.writeUnsignedInt64(0);
 
@@ -270,7 +310,7 @@ void Telemetry::endTick()
     sendBuffer.writeUnsignedInt64(rootWalkTime);
 
     // Write out the values table
-    tickValues.write(&sendBuffer);
+    writeTickValues(&sendBuffer);
 
     // Fix message size to be the actual written size
     size_t sendSize = sendBuffer.getPosition();
@@ -284,17 +324,6 @@ void Telemetry::endTick()
     tickId++;
 }
 
-// Ensure that the message buffer contains enough space for at least
-// one more event.
-static void ensureEventBuffer(utByteArray &buffer, size_t startPos)
-{
-    size_t size = buffer.getSize();
-    if (buffer.getPosition() + EVENT_BYTE_SIZE > size) {
-        size_t newEventsSize = utMax((size - startPos)*2, EVENTS_MIN_SIZE);
-        buffer.resize(size + newEventsSize);
-    }
-}
-
 // Begins the profiling range of the provided root.
 void Telemetry::beginTickTimer(LoomProfilerRoot* root)
 {
@@ -307,18 +336,26 @@ void Telemetry::beginTickTimer(LoomProfilerRoot* root)
     //lmAssert(tickProfilerActive, "Began tick timer while inactive at %s", root->mName);
     if (!tickProfilerActive) return;
 
+    // Keep room for the end of this and every other open range, once a range
+    // is dropped everything nested in it is dropped as well
+    if (tickEventsSkipDepth > 0 || tickEventCount + tickEventsOpen + 2 > TICK_EVENTS_MAX)
+    {
+        tickEventsSkipDepth++;
+        tickEventsDropped++;
+        return;
+    }
+
     if (!root->mTelemetryVisited) {
         ++tickProfilerRootsVisited;
         root->mTelemetryVisited = true;
     }
 
-    ensureEventBuffer(sendBuffer, eventsStartPos);
-
     // Write out the event message directly in system endianness
-    UTuint64* buf = reinterpret_cast<UTuint64*>(static_cast<unsigned char*>(sendBuffer.getDataPtr()) + sendBuffer.getPosition());
+    UTuint64* buf = tickEvents + tickEventCount*2;
     buf[0] = reinterpret_cast<UTuint64>(root) | TICK_EVENT_BEGIN;
     buf[1] = loom_readTimerNano(tickTimer);
-    sendBuffer.setPosition(sendBuffer.getPosition() + EVENT_BYTE_SIZE);
+    tickEventCount++;
+    tickEventsOpen++;
 }
 
 // Ends the timing range of the provided root. See `beginTickTimer`.
@@ -328,41 +365,90 @@ void Telemetry::endTickTimer(LoomProfilerRoot* root)
     if (platform_getCurrentThreadId() != tickThreadId) return;
     if (!tickProfilerActive) return;
 
-    ensureEventBuffer(sendBuffer, eventsStartPos);
+    if (tickEventsSkipDepth > 0)
+    {
+        tickEventsSkipDepth--;
+        return;
+    }
 
-    UTuint64* buf = reinterpret_cast<UTuint64*>(static_cast<unsigned char*>(sendBuffer.getDataPtr()) + sendBuffer.getPosition());
+    UTuint64* buf = tickEvents + tickEventCount*2;
     buf[0] = reinterpret_cast<UTuint64>(root) | TICK_EVENT_END;
     buf[1] = loom_readTimerNano(tickTimer);
-    sendBuffer.setPosition(sendBuffer.getPosition() + EVENT_BYTE_SIZE);
+    tickEventCount++;
+    tickEventsOpen--;
 }
 
-TickMetricValue* Telemetry::setTickValue(const char *name, double value)
+TickMetricID Telemetry::registerTickValue(const char *name)
 {
-    if (!enabled) return NULL;
+    if (!tickMetricLookup) tickMetricLookup = lmNew(NULL) utHashTable<utHashedString, TickMetricID>();
 
     utHashedString key = utHashedString(name);
-    TickMetricValue *stored = tickValues.table.get(key);
-    TickMetricValue metric;
+    TickMetricID *existing = tickMetricLookup->get(key);
+    if (existing) return *existing;
+
+    // The table is full, drop the name and remember it so it's only counted once
+    if (tickMetricCount >= TICK_METRICS_MAX)
+    {
+        tickMetricLookup->insert(key, TICK_METRIC_INVALID);
+        tickMetricsDropped++;
+        return TICK_METRIC_INVALID;
+    }
 
-    // This is a new value, insert it and update the table size
-    if (stored == NULL) {
-        metric.id = tickValues.sequence++;
-        metric.value = value;
+    TickMetricID id = tickMetricCount++;
+    tickMetricLookup->insert(key, id);
 
-        bool inserted = tickValues.table.insert(key, metric);
-        lmAssert(inserted, "Tick metric should be able to be inserted or retrieved");
+    // Keep our own copy, the name may not outlive registration
+    size_t nameLength = strlen(name);
+    char *nameCopy = (char*)lmAlloc(NULL, nameLength + 1);
+    memcpy(nameCopy, name, nameLength + 1);
+    tickMetricNames[id] = nameCopy;
 
-        stored = &tickValues.table.at(tickValues.table.size() - 1);
+    return id;
+}
+
+TickMetricValue* Telemetry::setTickValue(TickMetricID id, double value)
+{
+    if (!enabled) return NULL;
+
+    if (id == TICK_METRIC_INVALID) return NULL;
+
+    lmAssert(id >= 0 && id < tickMetricCount, "Invalid telemetry tick value ID %d", id);
 
-        size_t strSize = 2 + strlen(name);
-        tickValues.size += strSize + TableValues<TickMetricValue>::packedItemSize;
+    TickMetricValue *stored = &tickMetrics[id];
+
+    // First time this tick, add it to the table and update the table size
+    if (!tickMetricIsSet[id]) {
+        tickMetricIsSet[id] = true;
+        tickMetricsSet[tickMetricsSetCount++] = id;
+        stored->id = id;
+        tickValuesSize += 2 + strlen(tickMetricNames[id]) + TableValues<TickMetricValue>::packedItemSize;
     }
-    else
+
+    stored->value = value;
+
+    return stored;
+}
+
+TickMetricValue* Telemetry::setTickValue(const char *name, double value)
+{
+    if (!enabled) return NULL;
+
+    return setTickValue(registerTickValue(name), value);
+}
+
+void Telemetry::writeTickValues(utByteArray *buffer)
+{
+    size_t startPos = buffer->getPosition();
+
+    buffer->writeUnsignedByte(TableValues<TickMetricValue>::type);
+    buffer->writeUnsignedInt((unsigned int)tickValuesSize);
+
+    for (int i = 0; i < tickMetricsSetCount; i++)
     {
-        // It was inserted before, just update the value
-        metric = *stored;
-        metric.value = value;
+        TickMetricID id = tickMetricsSet[i];
+        buffer->writeUTF(tickMetricNames[id]);
+        tickMetrics[id].write(buffer);
     }
 
-    return stored;
+    lmAssert(tickValuesSize == buffer->getPosition() - startPos, "Internal tick value size inconsistency: %d != %d", buffer->getPosition() - startPos, tickValuesSize);
 }
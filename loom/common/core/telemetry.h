@@ -20,6 +20,16 @@ static const int TICK_EVENT_END   = 2;
 
 static const unsigned char TICK_PROFILER_TYPE = 3;
 
+// Maximum number of distinct tick values that can be registered
+static const int TICK_METRICS_MAX = 256;
+
+// Returned when registering past TICK_METRICS_MAX, setting it is a no-op
+static const TickMetricID TICK_METRIC_INVALID = -1;
+
+// Capacity of the preallocated tick profiler event buffer, events past
+// this are dropped for the rest of the tick
+static const int TICK_EVENTS_MAX = 65536;
+
 // Base struct for different kinds of metrics
 struct TickMetricBase
 {
@@ -224,8 +234,42 @@ protected:
     // Temporary buffer used while sending the tick
     static utByteArray sendBuffer;
 
-    // Stored values of the current tick
-    static TableValues<TickMetricValue> tickValues;
+    // Registered tick value names indexed by TickMetricID. These are plain
+    // arrays so registration works during static initialization.
+    static const char *tickMetricNames[TICK_METRICS_MAX];
+    static int tickMetricCount;
+
+    // Number of distinct names not registered because the table was full
+    static int tickMetricsDropped;
+
+    // Name to TickMetricID lookup, created on first registration
+    static utHashTable<utHashedString, TickMetricID> *tickMetricLookup;
+
+    // Values of the current tick indexed by TickMetricID
+    static TickMetricValue tickMetrics[TICK_METRICS_MAX];
+    static bool tickMetricIsSet[TICK_METRICS_MAX];
+
+    // IDs of the values set in the current tick, in the order they were set
+    static TickMetricID tickMetricsSet[TICK_METRICS_MAX];
+    static int tickMetricsSetCount;
+
+    // Packed size of the values table for the current tick
+    static size_t tickValuesSize;
+
+    // Preallocated profiler events of the current tick, each a root address
+    // tagged with the event type followed by a nanosecond timestamp
+    static UTuint64 *tickEvents;
+    static int tickEventCount;
+
+    // Begin events without a matching end yet, their ends always have room
+    static int tickEventsOpen;
+
+    // Nesting depth of begin events dropped because the buffer was full
+    static int tickEventsSkipDepth;
+    static int tickEventsDropped;
+
+    // Write the values set this tick in the TableValues<TickMetricValue> format
+    static void writeTickValues(utByteArray *buffer);
 
     // Timer used for timing tick ranges
     static loom_precision_timer_t tickTimer;
@@ -275,9 +319,28 @@ public:
     // End the timer range previously began with the specified profiler root
     static void endTickTimer(LoomProfilerRoot* root);
 
-    // Set an arbitrary floating point value associated with the current tick and name
-    // Previously set values of the same name get overwritten
+    // Register a named tick value once and get a handle for setTickValue.
+    // Registering the same name again returns the same ID. Can be used
+    // during static initialization, e.g.
+    //     static TickMetricID gcMemoryID = Telemetry::registerTickValue("gc.memory");
     // To avoid name conflicts it is suggested to use namespaced names (e.g. gc.cycle.update.count)
+    // Once TICK_METRICS_MAX names are registered, new names are dropped and
+    // counted, and TICK_METRIC_INVALID is returned.
+    static TickMetricID registerTickValue(const char *name);
+
+    // Returns the number of distinct names dropped by registerTickValue
+    inline static int getTickValuesDropped()
+    {
+        return tickMetricsDropped;
+    }
+
+    // Set a floating point value for the current tick by its registered ID
+    // Previously set values of the same ID get overwritten
+    // Returns NULL if telemetry is disabled or the ID is TICK_METRIC_INVALID
+    static TickMetricValue* setTickValue(TickMetricID id, double value);
+
+    // Set an arbitrary floating point value associated with the current tick and name
+    // This looks up the name every call, prefer registering the name once
     static TickMetricValue* setTickValue(const char *name, double value);
 
     // Read and process tick events from the provided buffer and save them as JSON
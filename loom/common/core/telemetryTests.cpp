@@ -0,0 +1,173 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+
+#include "seatest.h"
+#include "loom/common/core/log.h"
+#include "loom/common/core/performance.h"
+#include "loom/common/core/telemetry.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/assets/assets.h"
+
+lmDefineLogGroup(gTelemetryTestLogGroup, "telemetryTest", 1, LoomLogInfo);
+
+SEATEST_FIXTURE(telemetry)
+{
+    SEATEST_FIXTURE_ENTRY(telemetry_registerTickValue);
+    SEATEST_FIXTURE_ENTRY(telemetry_tickOverhead);
+    // Fills the tick value table, keep it last
+    SEATEST_FIXTURE_ENTRY(telemetry_registerOverflow);
+}
+
+static TickMetricID gTestMetricID = Telemetry::registerTickValue("test.telemetry.static");
+
+SEATEST_TEST(telemetry_registerTickValue)
+{
+    // Registration is idempotent, so names may be registered from several places
+    assert_int_equal(gTestMetricID, Telemetry::registerTickValue("test.telemetry.static"));
+    assert_true(Telemetry::registerTickValue("test.telemetry.other") != gTestMetricID);
+}
+
+static const int BENCH_TICKS     = 500;
+static const int BENCH_TIMERS    = 200;
+static const int BENCH_VALUES    = 12;
+
+static LoomProfilerRoot gBenchOuterRoot("telemetryBenchOuter");
+static LoomProfilerRoot gBenchInnerRoot("telemetryBenchInner");
+
+// Runs BENCH_TICKS ticks of a representative frame: a few hundred timer
+// events and a dozen tick values. Returns the average cost in nanoseconds.
+static long long runBenchTicks(TickMetricID *ids)
+{
+    loom_precision_timer_t timer = loom_startTimer();
+
+    for (int tick = 0; tick < BENCH_TICKS; tick++)
+    {
+        Telemetry::beginTick();
+
+        for (int i = 0; i < BENCH_TIMERS; i++)
+        {
+            Telemetry::beginTickTimer(&gBenchOuterRoot);
+            Telemetry::beginTickTimer(&gBenchInnerRoot);
+            Telemetry::endTickTimer(&gBenchInnerRoot);
+            Telemetry::endTickTimer(&gBenchOuterRoot);
+        }
+
+        for (int i = 0; i < BENCH_VALUES; i++)
+        {
+            Telemetry::setTickValue(ids[i], tick + i);
+        }
+
+        Telemetry::endTick();
+    }
+
+    long long ns = loom_readTimerNano(timer);
+    loom_destroyTimer(timer);
+
+    return ns / BENCH_TICKS;
+}
+
+SEATEST_TEST(telemetry_tickOverhead)
+{
+    // endTick publishes through the asset protocol
+    loom_asset_initialize(".");
+
+    TickMetricID ids[BENCH_VALUES];
+    char name[64];
+    for (int i = 0; i < BENCH_VALUES; i++)
+    {
+        sprintf(name, "test.telemetry.bench.%d", i);
+        ids[i] = Telemetry::registerTickValue(name);
+        assert_true(ids[i] >= 0);
+    }
+
+    long long disabledNs = runBenchTicks(ids);
+
+    // Values are ignored while disabled
+    Telemetry::beginTick();
+    assert_true(Telemetry::setTickValue(ids[0], 1) == NULL);
+    Telemetry::endTick();
+
+    // Enabling takes effect on the next beginTick
+    Telemetry::enable();
+    long long enabledNs = runBenchTicks(ids);
+    assert_true(Telemetry::isEnabled());
+
+    // Setting a value again in the same tick overwrites it in place
+    Telemetry::beginTick();
+    TickMetricValue *stored = Telemetry::setTickValue(ids[0], 1);
+    assert_true(stored != NULL);
+    assert_int_equal(ids[0], stored->id);
+    assert_true(Telemetry::setTickValue(ids[0], 2) == stored);
+    assert_double_equal(2, stored->value, 0);
+    assert_true(Telemetry::setTickValue("test.telemetry.bench.0", 3) == stored);
+    Telemetry::endTick();
+
+    Telemetry::disable();
+    Telemetry::beginTick();
+    Telemetry::endTick();
+    assert_false(Telemetry::isEnabled());
+
+    lmLogInfo(gTelemetryTestLogGroup, "Tick overhead with %d timers and %d values: %lld ns disabled, %lld ns enabled",
+              BENCH_TIMERS * 2, BENCH_VALUES, disabledNs, enabledNs);
+
+    loom_asset_shutdown();
+}
+
+SEATEST_TEST(telemetry_registerOverflow)
+{
+    loom_asset_initialize(".");
+
+    int droppedBefore = Telemetry::getTickValuesDropped();
+
+    // Register past the table size, the extra names are dropped
+    char name[64];
+    int registered = 0;
+    for (int i = 0; i < TICK_METRICS_MAX + 10; i++)
+    {
+        sprintf(name, "test.telemetry.overflow.%d", i);
+        if (Telemetry::registerTickValue(name) != TICK_METRIC_INVALID) registered++;
+    }
+
+    int dropped = Telemetry::getTickValuesDropped() - droppedBefore;
+    assert_true(registered < TICK_METRICS_MAX);
+    assert_int_equal(TICK_METRICS_MAX + 10 - registered, dropped);
+
+    // Names already seen don't get counted twice
+    sprintf(name, "test.telemetry.overflow.%d", TICK_METRICS_MAX + 9);
+    assert_int_equal(TICK_METRIC_INVALID, Telemetry::registerTickValue(name));
+    assert_int_equal(droppedBefore + dropped, Telemetry::getTickValuesDropped());
+
+    // Registered IDs keep working, dropped ones are ignored
+    Telemetry::enable();
+    Telemetry::beginTick();
+    assert_true(Telemetry::setTickValue(gTestMetricID, 1) != NULL);
+    assert_true(Telemetry::setTickValue(TICK_METRIC_INVALID, 1) == NULL);
+    assert_true(Telemetry::setTickValue(name, 1) == NULL);
+    assert_true(Telemetry::setTickValue("test.telemetry.overflow.unseen", 1) == NULL);
+    Telemetry::endTick();
+
+    Telemetry::disable();
+    Telemetry::beginTick();
+    Telemetry::endTick();
+
+    loom_asset_shutdown();
+}
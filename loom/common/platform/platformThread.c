@@ -27,6 +27,55 @@
 
 loom_allocator_t *gThreadAllocator = NULL;
 
+#define LOOM_THREAD_MAX_EXIT_CALLBACKS    4
+
+static ThreadExitCallback   gThreadExitCallbacks[LOOM_THREAD_MAX_EXIT_CALLBACKS];
+static volatile atomic_int_t gThreadExitCallbackCount = 0;
+
+typedef struct loom_threadStart
+{
+    ThreadFunction func;
+    void           *param;
+} loom_threadStart_t;
+
+void loom_thread_addExitCallback(ThreadExitCallback callback)
+{
+    int count = atomic_load32(&gThreadExitCallbackCount);
+
+    lmAssert(count < LOOM_THREAD_MAX_EXIT_CALLBACKS, "Too many thread exit callbacks");
+
+    gThreadExitCallbacks[count] = callback;
+    atomic_store32(&gThreadExitCallbackCount, count + 1);
+}
+
+// Entry point of every thread started by loom_thread_start, runs the thread
+// function and then the exit callbacks.
+static int __stdcall loom_thread_main(void *param)
+{
+    loom_threadStart_t start = *(loom_threadStart_t *)param;
+    int result, i;
+
+    lmFree(gThreadAllocator, param);
+
+    result = start.func(start.param);
+
+    for (i = atomic_load32(&gThreadExitCallbackCount) - 1; i >= 0; i--)
+    {
+        gThreadExitCallbacks[i]();
+    }
+
+    return result;
+}
+
+static loom_threadStart_t *loom_thread_createStart(ThreadFunction func, void *param)
+{
+    loom_threadStart_t *start = (loom_threadStart_t *)lmAlloc(gThreadAllocator, sizeof(loom_threadStart_t));
+
+    start->func  = func;
+    start->param = param;
+    return start;
+}
+
 #if LOOM_PLATFORM == LOOM_PLATFORM_WIN32
 
 #define WIN32_LEAN_AND_MEAN
@@ -155,7 +204,7 @@ ThreadHandle loom_thread_start(ThreadFunction func, void *param)
     // _beginthreadex is reported to properly initialize the CRT, while
     // CreateThread does not, so we use it.
     assert(sizeof(uintptr_t) == sizeof(ThreadHandle));
-    return (ThreadHandle)_beginthreadex(NULL, 0, func, param, 0, NULL);
+    return (ThreadHandle)_beginthreadex(NULL, 0, loom_thread_main, loom_thread_createStart(func, param), 0, NULL);
 }
 
 
@@ -306,6 +355,24 @@ void atomic_store32(volatile int *variable, int newValue)
 }
 
 
+void *atomic_loadPtr(void *volatile *variable)
+{
+    MEMORY_RW_BARRIER();
+
+    return *variable;
+}
+
+
+void atomic_storePtr(void *volatile *variable, void *newValue)
+{
+    MEMORY_RW_BARRIER();
+
+    *variable = newValue;
+
+    MEMORY_RW_BARRIER();
+}
+
+
 //
 // Usage: SetThreadName (-1, "MainThread");
 // From: http://msdn.microsoft.com/en-us/library/xcb2z8hs%28v=VS.71%29.aspx
@@ -482,7 +549,7 @@ ThreadHandle loom_thread_start(ThreadFunction func, void *param)
 {
     assert(sizeof(ThreadHandle) >= sizeof(pthread_t *));
     pthread_t *t = (pthread_t *)lmAlloc(NULL, sizeof(pthread_t));
-    pthread_create(t, NULL, (pthread_thread_func)func, param);
+    pthread_create(t, NULL, (pthread_thread_func)loom_thread_main, loom_thread_createStart(func, param));
     return t;
 }
 
@@ -582,16 +649,27 @@ void loom_thread_yield()
 
 int atomic_load32(volatile int *variable)
 {
-    __sync_synchronize();
-    return *variable;
+    return __atomic_load_n(variable, __ATOMIC_SEQ_CST);
 }
 
 
 void atomic_store32(volatile int *variable, int newValue)
 {
-    __sync_synchronize();
-    *variable = newValue;
-    __sync_synchronize();
+    __atomic_store_n(variable, newValue, __ATOMIC_SEQ_CST);
+}
+
+
+// Acquire/release is all publishing a pointer needs, and is cheaper than a
+// full barrier on every read.
+void *atomic_loadPtr(void *volatile *variable)
+{
+    return __atomic_load_n(variable, __ATOMIC_ACQUIRE);
+}
+
+
+void atomic_storePtr(void *volatile *variable, void *newValue)
+{
+    __atomic_store_n(variable, newValue, __ATOMIC_RELEASE);
 }
 
 
@@ -741,7 +819,7 @@ ThreadHandle loom_thread_start(ThreadFunction func, void *param)
 {
    assert(sizeof(ThreadHandle) >= sizeof(pthread_t*));
    pthread_t *t = lmAlloc(gThreadAllocator, sizeof(pthread_t));
-   pthread_create(t, NULL, (pthread_thread_func)func, param);
+   pthread_create(t, NULL, (pthread_thread_func)loom_thread_main, loom_thread_createStart(func, param));
    return t;
 }
 
@@ -878,16 +956,25 @@ int atomic_decrement(volatile int *value)
 
 int atomic_load32(volatile int *variable)
 {
-    __sync_synchronize();
-    return *variable;
+    return __atomic_load_n(variable, __ATOMIC_SEQ_CST);
 }
 
 
 void atomic_store32(volatile int *variable, int newValue)
 {
-    __sync_synchronize();
-    *variable = newValue;
-    __sync_synchronize();
+    __atomic_store_n(variable, newValue, __ATOMIC_SEQ_CST);
+}
+
+
+void *atomic_loadPtr(void *volatile *variable)
+{
+    return __atomic_load_n(variable, __ATOMIC_ACQUIRE);
+}
+
+
+void atomic_storePtr(void *volatile *variable, void *newValue)
+{
+    __atomic_store_n(variable, newValue, __ATOMIC_RELEASE);
 }
 
 
@@ -71,6 +71,12 @@ void loom_thread_setDebugName(const char *name);
 int loom_thread_getIdFromHandle(ThreadHandle th);
 void loom_thread_join(ThreadHandle th);
 
+// Callbacks run on every thread started with loom_thread_start right before
+// it exits, most recently added first. Add them during startup, before any
+// thread that should see them is started.
+typedef void (*ThreadExitCallback)(void);
+void loom_thread_addExitCallback(ThreadExitCallback callback);
+
 // Our own simple semaphore abstraction:
 #if LOOM_PLATFORM_IS_APPLE
 typedef size_t   SemaphoreHandle;
@@ -95,6 +101,15 @@ int atomic_increment(volatile atomic_int_t *value);
 int atomic_decrement(volatile atomic_int_t *value);
 int atomic_load32(volatile atomic_int_t *variable);
 void atomic_store32(volatile atomic_int_t *variable, int newValue);
+void *atomic_loadPtr(void *volatile *variable);
+void atomic_storePtr(void *volatile *variable, void *newValue);
+
+// Storage class for variables with one instance per thread.
+#if LOOM_COMPILER == LOOM_COMPILER_MSVC
+#define LOOM_THREADLOCAL    __declspec(thread)
+#else
+#define LOOM_THREADLOCAL    __thread
+#endif
 
 // Sleeping and yielding.
 void loom_thread_sleep(long ms);
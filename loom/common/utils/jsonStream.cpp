@@ -0,0 +1,969 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "loom/common/utils/jsonStream.h"
+
+// Reader states, what the next token may be
+enum
+{
+    READ_VALUE,         // any value
+    READ_ARRAY_FIRST,   // a value or ']'
+    READ_KEY,           // a key
+    READ_OBJECT_FIRST,  // a key or '}'
+    READ_AFTER_VALUE,   // ',' or the end of the current container
+    READ_DONE
+};
+
+JSONReader::JSONReader() :
+    _data(NULL), _length(0), _position(0), _state(READ_DONE), _token(JSON_TOKEN_NONE), _number(0), _stringLength(0)
+{
+}
+
+void JSONReader::load(const char *data, UTsize length)
+{
+    _data     = data;
+    _length   = data ? length : 0;
+    _position = 0;
+    _containers.clear();
+    _state        = READ_VALUE;
+    _token        = JSON_TOKEN_NONE;
+    _number       = 0;
+    _stringLength = 0;
+    _errorMsg     = "";
+}
+
+bool JSONReader::loadString(const char *json)
+{
+    load(json, json ? (UTsize)strlen(json) : 0);
+    return json != NULL;
+}
+
+bool JSONReader::loadBytes(utByteArray *bytes)
+{
+    if (!bytes)
+    {
+        load(NULL, 0);
+        return false;
+    }
+
+    load((const char *)bytes->getDataPtr(), bytes->getSize());
+    return true;
+}
+
+int JSONReader::fail(const char *message)
+{
+    // Only work out the line and column when something went wrong
+    int    line   = 1;
+    UTsize column = 1;
+    for (UTsize i = 0; i < _position && i < _length; i++)
+    {
+        if (_data[i] == '\n')
+        {
+            line++;
+            column = 1;
+        }
+        else
+        {
+            column++;
+        }
+    }
+
+    char error[1024];
+    snprintf(error, sizeof(error), "JSON Error: Line %i Column %i Position %i, %s",
+             line, (int)column, (int)_position, message);
+    _errorMsg = error;
+
+    _state = READ_DONE;
+    return _token = JSON_TOKEN_ERROR;
+}
+
+void JSONReader::skipWhitespace()
+{
+    while (_position < _length)
+    {
+        char c = _data[_position];
+        if ((c != ' ') && (c != '\n') && (c != '\r') && (c != '\t'))
+        {
+            break;
+        }
+        _position++;
+    }
+}
+
+static inline void reserveScratch(utArray<char>& scratch, UTsize needed)
+{
+    if (scratch.size() < needed)
+    {
+        UTsize grown = scratch.size() * 2;
+        scratch.resize(grown > needed ? grown : (needed < 64 ? 64 : needed));
+    }
+}
+
+bool JSONReader::appendUTF8(unsigned int codepoint)
+{
+    reserveScratch(_string, _stringLength + 5);
+
+    char *out = _string.ptr() + _stringLength;
+
+    if (codepoint < 0x80)
+    {
+        out[0]         = (char)codepoint;
+        _stringLength += 1;
+    }
+    else if (codepoint < 0x800)
+    {
+        out[0]         = (char)(0xC0 | (codepoint >> 6));
+        out[1]         = (char)(0x80 | (codepoint & 0x3F));
+        _stringLength += 2;
+    }
+    else if (codepoint < 0x10000)
+    {
+        out[0]         = (char)(0xE0 | (codepoint >> 12));
+        out[1]         = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2]         = (char)(0x80 | (codepoint & 0x3F));
+        _stringLength += 3;
+    }
+    else
+    {
+        out[0]         = (char)(0xF0 | (codepoint >> 18));
+        out[1]         = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+        out[2]         = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[3]         = (char)(0x80 | (codepoint & 0x3F));
+        _stringLength += 4;
+    }
+
+    return true;
+}
+
+static int readHex4(const char *p)
+{
+    int value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        char c = p[i];
+        value <<= 4;
+        if ((c >= '0') && (c <= '9'))
+        {
+            value |= c - '0';
+        }
+        else if ((c >= 'a') && (c <= 'f'))
+        {
+            value |= c - 'a' + 10;
+        }
+        else if ((c >= 'A') && (c <= 'F'))
+        {
+            value |= c - 'A' + 10;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+    return value;
+}
+
+int JSONReader::scanString(int token)
+{
+    // skip the opening quote
+    _position++;
+    _stringLength = 0;
+
+    for ( ; ; )
+    {
+        // Copy runs of plain characters in one go
+        UTsize start = _position;
+        while (_position < _length)
+        {
+            unsigned char c = (unsigned char)_data[_position];
+            if ((c == '"') || (c == '\\') || (c < 0x20))
+            {
+                break;
+            }
+            _position++;
+        }
+
+        UTsize run = _position - start;
+        if (run)
+        {
+            reserveScratch(_string, _stringLength + run + 1);
+            memcpy(_string.ptr() + _stringLength, _data + start, run);
+            _stringLength += run;
+        }
+
+        if (_position >= _length)
+        {
+            return fail("Unterminated string");
+        }
+
+        char c = _data[_position];
+
+        if (c == '"')
+        {
+            _position++;
+            break;
+        }
+
+        if (c != '\\')
+        {
+            return fail("Control character in string");
+        }
+
+        if (_position + 1 >= _length)
+        {
+            return fail("Unterminated string");
+        }
+
+        char escaped = _data[_position + 1];
+        _position += 2;
+
+        char unescaped = 0;
+        switch (escaped)
+        {
+        case '"': unescaped = '"'; break;
+        case '\\': unescaped = '\\'; break;
+        case '/': unescaped = '/'; break;
+        case 'b': unescaped = '\b'; break;
+        case 'f': unescaped = '\f'; break;
+        case 'n': unescaped = '\n'; break;
+        case 'r': unescaped = '\r'; break;
+        case 't': unescaped = '\t'; break;
+
+        case 'u':
+        {
+            if (_position + 4 > _length)
+            {
+                return fail("Invalid \\u escape");
+            }
+
+            int codepoint = readHex4(_data + _position);
+            if (codepoint < 0)
+            {
+                return fail("Invalid \\u escape");
+            }
+            _position += 4;
+
+            if ((codepoint >= 0xDC00) && (codepoint <= 0xDFFF))
+            {
+                return fail("Invalid Unicode surrogate pair");
+            }
+
+            if ((codepoint >= 0xD800) && (codepoint <= 0xDBFF))
+            {
+                // a high surrogate must be followed by a low one
+                int low = -1;
+                if ((_position + 6 <= _length) && (_data[_position] == '\\') && (_data[_position + 1] == 'u'))
+                {
+                    low = readHex4(_data + _position + 2);
+                }
+
+                if ((low < 0xDC00) || (low > 0xDFFF))
+                {
+                    return fail("Invalid Unicode surrogate pair");
+                }
+
+                _position += 6;
+                codepoint  = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+            }
+
+            appendUTF8((unsigned int)codepoint);
+            continue;
+        }
+
+        default:
+            _position -= 1;
+            return fail("Invalid escape in string");
+        }
+
+        reserveScratch(_string, _stringLength + 2);
+        _string[_stringLength++] = unescaped;
+    }
+
+    reserveScratch(_string, _stringLength + 1);
+    _string[_stringLength] = 0;
+
+    return _token = token;
+}
+
+int JSONReader::scanNumber()
+{
+    UTsize start = _position;
+
+    if (_data[_position] == '-')
+    {
+        _position++;
+    }
+
+    // Plain integers of up to 15 digits are exact in a double and are
+    // accumulated directly; everything else goes through strtod.
+    bool   simple = true;
+    double value  = 0;
+    UTsize digits = 0;
+
+    if ((_position < _length) && (_data[_position] == '0'))
+    {
+        _position++;
+        digits = 1;
+    }
+    else
+    {
+        while ((_position < _length) && (_data[_position] >= '0') && (_data[_position] <= '9'))
+        {
+            value = value * 10 + (_data[_position] - '0');
+            _position++;
+            digits++;
+        }
+    }
+
+    if (!digits)
+    {
+        return fail("Invalid number");
+    }
+
+    if (digits > 15)
+    {
+        simple = false;
+    }
+
+    if ((_position < _length) && (_data[_position] == '.'))
+    {
+        simple = false;
+        _position++;
+
+        UTsize fraction = _position;
+        while ((_position < _length) && (_data[_position] >= '0') && (_data[_position] <= '9'))
+        {
+            _position++;
+        }
+
+        if (_position == fraction)
+        {
+            return fail("Invalid number");
+        }
+    }
+
+    if ((_position < _length) && ((_data[_position] == 'e') || (_data[_position] == 'E')))
+    {
+        simple = false;
+        _position++;
+
+        if ((_position < _length) && ((_data[_position] == '+') || (_data[_position] == '-')))
+        {
+            _position++;
+        }
+
+        UTsize exponent = _position;
+        while ((_position < _length) && (_data[_position] >= '0') && (_data[_position] <= '9'))
+        {
+            _position++;
+        }
+
+        if (_position == exponent)
+        {
+            return fail("Invalid number");
+        }
+    }
+
+    // Keep the text around, getString on a number gives values that don't
+    // fit a double (e.g. 64 bit ids) exactly
+    _stringLength = _position - start;
+    reserveScratch(_string, _stringLength + 1);
+    memcpy(_string.ptr(), _data + start, _stringLength);
+    _string[_stringLength] = 0;
+
+    if (simple)
+    {
+        _number = (_data[start] == '-') ? -value : value;
+    }
+    else
+    {
+        _number = strtod(_string.ptr(), NULL);
+    }
+
+    return _token = JSON_TOKEN_NUMBER;
+}
+
+int JSONReader::scanLiteral(const char *literal, UTsize length, int token)
+{
+    if ((_position + length > _length) || memcmp(_data + _position, literal, length))
+    {
+        return fail("Invalid literal");
+    }
+
+    _position += length;
+    return _token = token;
+}
+
+int JSONReader::next()
+{
+    if ((_token == JSON_TOKEN_ERROR) || (_state == READ_DONE))
+    {
+        return _token == JSON_TOKEN_ERROR ? _token : (_token = JSON_TOKEN_END);
+    }
+
+    skipWhitespace();
+
+    if (_state == READ_AFTER_VALUE)
+    {
+        if (!_containers.size())
+        {
+            if (_position < _length)
+            {
+                return fail("Unexpected data after the end of the document");
+            }
+
+            _state = READ_DONE;
+            return _token = JSON_TOKEN_END;
+        }
+
+        if (_position >= _length)
+        {
+            return fail("Unexpected end of input");
+        }
+
+        char c         = _data[_position];
+        char container = _containers.back();
+
+        if (c == ',')
+        {
+            _position++;
+            skipWhitespace();
+            _state = container == '{' ? READ_KEY : READ_VALUE;
+        }
+        else if ((c == '}') && (container == '{'))
+        {
+            _position++;
+            _containers.pop_back();
+            return _token = JSON_TOKEN_OBJECT_END;
+        }
+        else if ((c == ']') && (container == '['))
+        {
+            _position++;
+            _containers.pop_back();
+            return _token = JSON_TOKEN_ARRAY_END;
+        }
+        else
+        {
+            return fail("Expected ',' or the end of the object or array");
+        }
+    }
+
+    if (_position >= _length)
+    {
+        return fail("Unexpected end of input");
+    }
+
+    char c = _data[_position];
+
+    if ((_state == READ_KEY) || (_state == READ_OBJECT_FIRST))
+    {
+        if ((c == '}') && (_state == READ_OBJECT_FIRST))
+        {
+            _position++;
+            _containers.pop_back();
+            _state = READ_AFTER_VALUE;
+            return _token = JSON_TOKEN_OBJECT_END;
+        }
+
+        if (c != '"')
+        {
+            return fail("Expected a string key");
+        }
+
+        if (scanString(JSON_TOKEN_KEY) == JSON_TOKEN_ERROR)
+        {
+            return _token;
+        }
+
+        skipWhitespace();
+
+        if ((_position >= _length) || (_data[_position] != ':'))
+        {
+            return fail("Expected ':' after key");
+        }
+
+        _position++;
+        _state = READ_VALUE;
+        return _token;
+    }
+
+    if ((c == ']') && (_state == READ_ARRAY_FIRST))
+    {
+        _position++;
+        _containers.pop_back();
+        _state = READ_AFTER_VALUE;
+        return _token = JSON_TOKEN_ARRAY_END;
+    }
+
+    _state = READ_AFTER_VALUE;
+
+    switch (c)
+    {
+    case '{':
+        _position++;
+        _containers.push_back('{');
+        _state = READ_OBJECT_FIRST;
+        return _token = JSON_TOKEN_OBJECT_START;
+
+    case '[':
+        _position++;
+        _containers.push_back('[');
+        _state = READ_ARRAY_FIRST;
+        return _token = JSON_TOKEN_ARRAY_START;
+
+    case '"':
+        return scanString(JSON_TOKEN_STRING);
+
+    case 't':
+        return scanLiteral("true", 4, JSON_TOKEN_TRUE);
+
+    case 'f':
+        return scanLiteral("false", 5, JSON_TOKEN_FALSE);
+
+    case 'n':
+        return scanLiteral("null", 4, JSON_TOKEN_NULL);
+
+    default:
+        if ((c == '-') || ((c >= '0') && (c <= '9')))
+        {
+            return scanNumber();
+        }
+    }
+
+    return fail("Unexpected character");
+}
+
+bool JSONReader::skip()
+{
+    if (_token == JSON_TOKEN_KEY)
+    {
+        next();
+    }
+
+    if ((_token == JSON_TOKEN_OBJECT_START) || (_token == JSON_TOKEN_ARRAY_START))
+    {
+        int depth = getDepth();
+        while (getDepth() >= depth)
+        {
+            if (next() == JSON_TOKEN_ERROR)
+            {
+                return false;
+            }
+        }
+    }
+
+    return _token != JSON_TOKEN_ERROR;
+}
+
+JSONWriter::JSONWriter() :
+    _afterKey(false), _indent(0), _complete(false), _flushThreshold(64 * 1024)
+{
+}
+
+JSONWriter::~JSONWriter()
+{
+    closeFile();
+}
+
+void JSONWriter::clear()
+{
+    _bytes.resize(0);
+    _containers.clear();
+    _hasElements.clear();
+    _afterKey = false;
+    _complete = false;
+    _errorMsg = "";
+}
+
+bool JSONWriter::fail(const char *message)
+{
+    _errorMsg = message;
+    return false;
+}
+
+void JSONWriter::writeNewline()
+{
+    if (!_indent)
+    {
+        return;
+    }
+
+    static const char spaces[] = "                                ";
+
+    writeRaw("\n", 1);
+
+    int count = _indent * (int)_containers.size();
+    while (count > 0)
+    {
+        int n = count < (int)sizeof(spaces) - 1 ? count : (int)sizeof(spaces) - 1;
+        writeRaw(spaces, n);
+        count -= n;
+    }
+}
+
+bool JSONWriter::beginValue()
+{
+    if (_complete)
+    {
+        return fail("The document is already complete");
+    }
+
+    if (!_containers.size())
+    {
+        return true;
+    }
+
+    if (_containers.back() == '{')
+    {
+        if (!_afterKey)
+        {
+            return fail("Expected a key before the value");
+        }
+
+        _afterKey = false;
+        return true;
+    }
+
+    if (_hasElements.back())
+    {
+        writeRaw(",", 1);
+    }
+
+    _hasElements.back() = true;
+    writeNewline();
+
+    return true;
+}
+
+void JSONWriter::flushIfNeeded()
+{
+    if (!_containers.size())
+    {
+        _complete = true;
+    }
+
+    if (_file.isOpen() && (_bytes.getSize() >= _flushThreshold))
+    {
+        _file.write(_bytes.getDataPtr(), _bytes.getSize());
+        _bytes.resize(0);
+    }
+}
+
+void JSONWriter::writeEscaped(const char *value)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    writeRaw("\"", 1);
+
+    const char *run = value;
+    for (const char *p = value; ; p++)
+    {
+        unsigned char c = (unsigned char)*p;
+
+        if (c && (c >= 0x20) && (c != '"') && (c != '\\'))
+        {
+            continue;
+        }
+
+        if (p > run)
+        {
+            writeRaw(run, (UTsize)(p - run));
+        }
+
+        if (!c)
+        {
+            break;
+        }
+
+        run = p + 1;
+
+        switch (c)
+        {
+        case '"': writeRaw("\\\"", 2); break;
+        case '\\': writeRaw("\\\\", 2); break;
+        case '\b': writeRaw("\\b", 2); break;
+        case '\f': writeRaw("\\f", 2); break;
+        case '\n': writeRaw("\\n", 2); break;
+        case '\r': writeRaw("\\r", 2); break;
+        case '\t': writeRaw("\\t", 2); break;
+
+        default:
+        {
+            char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            writeRaw(escaped, 6);
+        }
+        }
+    }
+
+    writeRaw("\"", 1);
+}
+
+bool JSONWriter::beginObject()
+{
+    if (!beginValue())
+    {
+        return false;
+    }
+
+    writeRaw("{", 1);
+    _containers.push_back('{');
+    _hasElements.push_back(false);
+    return true;
+}
+
+bool JSONWriter::endObject()
+{
+    if (!_containers.size() || (_containers.back() != '{') || _afterKey)
+    {
+        return fail("endObject without a matching beginObject");
+    }
+
+    bool hadElements = _hasElements.back();
+    _containers.pop_back();
+    _hasElements.pop_back();
+
+    if (hadElements)
+    {
+        writeNewline();
+    }
+
+    writeRaw("}", 1);
+    flushIfNeeded();
+    return true;
+}
+
+bool JSONWriter::beginArray()
+{
+    if (!beginValue())
+    {
+        return false;
+    }
+
+    writeRaw("[", 1);
+    _containers.push_back('[');
+    _hasElements.push_back(false);
+    return true;
+}
+
+bool JSONWriter::endArray()
+{
+    if (!_containers.size() || (_containers.back() != '['))
+    {
+        return fail("endArray without a matching beginArray");
+    }
+
+    bool hadElements = _hasElements.back();
+    _containers.pop_back();
+    _hasElements.pop_back();
+
+    if (hadElements)
+    {
+        writeNewline();
+    }
+
+    writeRaw("]", 1);
+    flushIfNeeded();
+    return true;
+}
+
+bool JSONWriter::writeKey(const char *key)
+{
+    if (!_containers.size() || (_containers.back() != '{') || _afterKey)
+    {
+        return fail("Keys can only be written inside an object");
+    }
+
+    if (_hasElements.back())
+    {
+        writeRaw(",", 1);
+    }
+
+    _hasElements.back() = true;
+    writeNewline();
+
+    writeEscaped(key ? key : "");
+
+    if (_indent)
+    {
+        writeRaw(": ", 2);
+    }
+    else
+    {
+        writeRaw(":", 1);
+    }
+
+    _afterKey = true;
+    return true;
+}
+
+bool JSONWriter::writeString(const char *value)
+{
+    if (!value)
+    {
+        return writeNull();
+    }
+
+    if (!beginValue())
+    {
+        return false;
+    }
+
+    writeEscaped(value);
+    flushIfNeeded();
+    return true;
+}
+
+bool JSONWriter::writeNumber(double value)
+{
+    if ((value != value) || (value - value != 0))
+    {
+        return fail("NaN and infinity can't be written to JSON");
+    }
+
+    if (!beginValue())
+    {
+        return false;
+    }
+
+    char text[32];
+    int  length;
+
+    if ((fabs(value) < 1e15) && (value == floor(value)))
+    {
+        length = snprintf(text, sizeof(text), "%.0f", value);
+    }
+    else
+    {
+        // Shortest of the two precisions that reads back exactly
+        length = snprintf(text, sizeof(text), "%.15g", value);
+        if (strtod(text, NULL) != value)
+        {
+            length = snprintf(text, sizeof(text), "%.17g", value);
+        }
+    }
+
+    writeRaw(text, (UTsize)length);
+    flushIfNeeded();
+    return true;
+}
+
+bool JSONWriter::writeInteger(int value)
+{
+    return writeNumber((double)value);
+}
+
+bool JSONWriter::writeBoolean(bool value)
+{
+    if (!beginValue())
+    {
+        return false;
+    }
+
+    if (value)
+    {
+        writeRaw("true", 4);
+    }
+    else
+    {
+        writeRaw("false", 5);
+    }
+
+    flushIfNeeded();
+    return true;
+}
+
+bool JSONWriter::writeNull()
+{
+    if (!beginValue())
+    {
+        return false;
+    }
+
+    writeRaw("null", 4);
+    flushIfNeeded();
+    return true;
+}
+
+bool JSONWriter::openFile(const char *path)
+{
+    closeFile();
+
+    _file.open(path, utStream::SM_WRITE);
+    if (!_file.isOpen())
+    {
+        return fail("Unable to open file for writing");
+    }
+
+    if (_bytes.getSize())
+    {
+        _file.write(_bytes.getDataPtr(), _bytes.getSize());
+        _bytes.resize(0);
+    }
+
+    return true;
+}
+
+bool JSONWriter::closeFile()
+{
+    if (!_file.isOpen())
+    {
+        return false;
+    }
+
+    if (_bytes.getSize())
+    {
+        _file.write(_bytes.getDataPtr(), _bytes.getSize());
+        _bytes.resize(0);
+    }
+
+    _file.close();
+    return true;
+}
+
+const char *JSONWriter::serialize()
+{
+    if (_file.isOpen())
+    {
+        fail("Output is being streamed to a file");
+        return NULL;
+    }
+
+    // Terminate past the end so the contents stay appendable
+    UTsize size = _bytes.getSize();
+    _bytes.writeUnsignedByte(0);
+    _bytes.resize(size);
+
+    return (const char *)_bytes.getDataPtr();
+}
+
+bool JSONWriter::serializeToBuffer(utByteArray *bytes)
+{
+    if (!bytes || _file.isOpen())
+    {
+        return false;
+    }
+
+    bytes->writeRaw(_bytes.getDataPtr(), _bytes.getSize());
+    return true;
+}
@@ -0,0 +1,215 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#ifndef _UTILS_JSONSTREAM_H
+#define _UTILS_JSONSTREAM_H
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/utils/utString.h"
+#include "loom/common/utils/utByteArray.h"
+#include "loom/common/utils/utStreams.h"
+
+struct lua_State;
+
+/*
+ * Tokens returned by JSONReader::next, mirrored by system.JSONToken in script.
+ */
+enum JSONToken
+{
+    JSON_TOKEN_NONE,
+    JSON_TOKEN_OBJECT_START,
+    JSON_TOKEN_OBJECT_END,
+    JSON_TOKEN_ARRAY_START,
+    JSON_TOKEN_ARRAY_END,
+    JSON_TOKEN_KEY,
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_NUMBER,
+    JSON_TOKEN_TRUE,
+    JSON_TOKEN_FALSE,
+    JSON_TOKEN_NULL,
+    JSON_TOKEN_END,
+    JSON_TOKEN_ERROR
+};
+
+/*
+ * Pull parser for JSON text. Unlike JSON, no document tree is built: each
+ * call to next() scans one token out of the source and the caller decides
+ * what to keep, so memory use is bounded by the longest string rather than
+ * the size of the document.
+ *
+ * The source is not copied and must stay alive and unmodified while it is
+ * being read. Keys and strings are unescaped into a scratch buffer that is
+ * reused by the following token.
+ */
+class JSONReader {
+    const char *_data;
+    UTsize     _length;
+    UTsize     _position;
+
+    // Open containers, '{' or '['
+    utArray<char> _containers;
+    int           _state;
+
+    int    _token;
+    double _number;
+
+    // Unescaped key or string of the current token, null terminated
+    utArray<char> _string;
+    UTsize        _stringLength;
+
+    utString _errorMsg;
+
+    int fail(const char *message);
+    int scanString(int token);
+    int scanNumber();
+    int scanLiteral(const char *literal, UTsize length, int token);
+    bool appendUTF8(unsigned int codepoint);
+    void skipWhitespace();
+
+public:
+
+    JSONReader();
+
+    /*
+     * Start reading the given memory from the beginning. The memory is not
+     * copied.
+     */
+    void load(const char *data, UTsize length);
+
+    bool loadString(const char *json);
+    bool loadBytes(utByteArray *bytes);
+
+    /*
+     * Advance to and return the next token. Returns JSON_TOKEN_END once the
+     * top level value has been read, or JSON_TOKEN_ERROR (sticky) on
+     * malformed input.
+     */
+    int next();
+
+    int getToken() const { return _token; }
+
+    // Valid for JSON_TOKEN_KEY and JSON_TOKEN_STRING, the buffer is reused by
+    // the next string or number, so copy a key before reading its value
+    const char *getString() const { return _string.ptr(); }
+    UTsize getStringLength() const { return _stringLength; }
+
+    // Valid for JSON_TOKEN_NUMBER
+    double getNumber() const { return _number; }
+
+    // Valid for JSON_TOKEN_TRUE and JSON_TOKEN_FALSE
+    bool getBoolean() const { return _token == JSON_TOKEN_TRUE; }
+
+    // Number of containers currently open
+    int getDepth() const { return (int)_containers.size(); }
+
+    /*
+     * Skip the value of the current token. For an object or array start
+     * this reads up to and including the matching end, for a key it skips
+     * the value that follows. Returns false on malformed input.
+     */
+    bool skip();
+
+    const char *getError() const { return _errorMsg.c_str(); }
+
+    /*
+     * Decode the next value directly into LoomScript objects, using the
+     * reflection info of the given type; implemented in lmJSONStream.cpp.
+     */
+    int decode(lua_State *L);
+};
+
+/*
+ * Streaming JSON writer. Output is appended to an internal buffer which can
+ * be retrieved as a string or copied into a utByteArray, or when a file is
+ * open, flushed to it whenever the buffer passes a threshold so documents
+ * of any size can be written with a small, fixed amount of memory.
+ */
+class JSONWriter {
+    utByteArray _bytes;
+
+    // Per open container: '{' or '[' and whether it has an element yet
+    utArray<char> _containers;
+    utArray<bool> _hasElements;
+    bool          _afterKey;
+
+    int      _indent;
+    bool     _complete;
+    utString _errorMsg;
+
+    utFileStream _file;
+    UTsize       _flushThreshold;
+
+    bool beginValue();
+    void writeNewline();
+    void writeEscaped(const char *value);
+    void writeRaw(const char *text, UTsize length) { _bytes.writeRaw(text, length); }
+    bool fail(const char *message);
+    void flushIfNeeded();
+
+public:
+
+    JSONWriter();
+    ~JSONWriter();
+
+    /*
+     * Discard any output and start a new document.
+     */
+    void clear();
+
+    /*
+     * Spaces per level of indentation, 0 (the default) writes compact
+     * output.
+     */
+    void setIndent(int spaces) { _indent = spaces < 0 ? 0 : spaces; }
+    int getIndent() const { return _indent; }
+
+    bool beginObject();
+    bool endObject();
+    bool beginArray();
+    bool endArray();
+    bool writeKey(const char *key);
+    bool writeString(const char *value);
+    bool writeNumber(double value);
+    bool writeInteger(int value);
+    bool writeBoolean(bool value);
+    bool writeNull();
+
+    /*
+     * True once a complete top level value has been written.
+     */
+    bool isComplete() const { return _complete; }
+
+    /*
+     * Stream output into the file at path as it is written. Anything
+     * already written is flushed to it first.
+     */
+    bool openFile(const char *path);
+    bool closeFile();
+
+    /*
+     * The output written so far. Not available while streaming to a file.
+     */
+    const char *serialize();
+    bool serializeToBuffer(utByteArray *bytes);
+
+    const char *getError() const { return _errorMsg.c_str(); }
+};
+
+#endif
@@ -0,0 +1,366 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/utils/json.h"
+#include "loom/common/utils/jsonStream.h"
+#include "seatest.h"
+
+lmDefineLogGroup(gJSONStreamTestLogGroup, "jsonStreamTest", 1, LoomLogInfo);
+
+SEATEST_FIXTURE(jsonStream)
+{
+    SEATEST_FIXTURE_ENTRY(jsonStream_readTokens);
+    SEATEST_FIXTURE_ENTRY(jsonStream_readErrors);
+    SEATEST_FIXTURE_ENTRY(jsonStream_skip);
+    SEATEST_FIXTURE_ENTRY(jsonStream_readDictionary);
+    SEATEST_FIXTURE_ENTRY(jsonStream_write);
+    SEATEST_FIXTURE_ENTRY(jsonStream_parseBenchmark);
+}
+
+SEATEST_TEST(jsonStream_readTokens)
+{
+    const char *json =
+        "{ \"name\": \"a\\\"b\\\\c\\n\\u00e9\\ud83d\\ude00\",\n"
+        "  \"values\": [1, -2.5, 1e3, 9007199254740993, true, false, null],\n"
+        "  \"empty\": {}, \"none\": [] }";
+
+    JSONReader reader;
+    reader.loadString(json);
+
+    assert_int_equal(JSON_TOKEN_OBJECT_START, reader.next());
+    assert_int_equal(1, reader.getDepth());
+
+    assert_int_equal(JSON_TOKEN_KEY, reader.next());
+    assert_string_equal("name", reader.getString());
+    assert_int_equal(JSON_TOKEN_STRING, reader.next());
+    assert_string_equal("a\"b\\c\n\xC3\xA9\xF0\x9F\x98\x80", reader.getString());
+    assert_int_equal(12, (int)reader.getStringLength());
+
+    assert_int_equal(JSON_TOKEN_KEY, reader.next());
+    assert_string_equal("values", reader.getString());
+    assert_int_equal(JSON_TOKEN_ARRAY_START, reader.next());
+    assert_int_equal(2, reader.getDepth());
+    assert_int_equal(JSON_TOKEN_NUMBER, reader.next());
+    assert_true(reader.getNumber() == 1);
+    assert_int_equal(JSON_TOKEN_NUMBER, reader.next());
+    assert_true(reader.getNumber() == -2.5);
+    assert_int_equal(JSON_TOKEN_NUMBER, reader.next());
+    assert_true(reader.getNumber() == 1000);
+    assert_int_equal(JSON_TOKEN_NUMBER, reader.next());
+    // Too large for a double, the text is still exact
+    assert_string_equal("9007199254740993", reader.getString());
+    assert_int_equal(JSON_TOKEN_TRUE, reader.next());
+    assert_true(reader.getBoolean());
+    assert_int_equal(JSON_TOKEN_FALSE, reader.next());
+    assert_false(reader.getBoolean());
+    assert_int_equal(JSON_TOKEN_NULL, reader.next());
+    assert_int_equal(JSON_TOKEN_ARRAY_END, reader.next());
+    assert_int_equal(1, reader.getDepth());
+
+    assert_int_equal(JSON_TOKEN_KEY, reader.next());
+    assert_int_equal(JSON_TOKEN_OBJECT_START, reader.next());
+    assert_int_equal(JSON_TOKEN_OBJECT_END, reader.next());
+    assert_int_equal(JSON_TOKEN_KEY, reader.next());
+    assert_int_equal(JSON_TOKEN_ARRAY_START, reader.next());
+    assert_int_equal(JSON_TOKEN_ARRAY_END, reader.next());
+
+    assert_int_equal(JSON_TOKEN_OBJECT_END, reader.next());
+    assert_int_equal(0, reader.getDepth());
+    assert_int_equal(JSON_TOKEN_END, reader.next());
+    assert_int_equal(JSON_TOKEN_END, reader.next());
+
+    // Reading from a view over a buffer that isn't null terminated
+    utByteArray bytes;
+    bytes.attach("[42]xyz", 4);
+    reader.loadBytes(&bytes);
+    assert_int_equal(JSON_TOKEN_ARRAY_START, reader.next());
+    assert_int_equal(JSON_TOKEN_NUMBER, reader.next());
+    assert_true(reader.getNumber() == 42);
+    assert_int_equal(JSON_TOKEN_ARRAY_END, reader.next());
+    assert_int_equal(JSON_TOKEN_END, reader.next());
+}
+
+static bool readFails(const char *json)
+{
+    JSONReader reader;
+    reader.loadString(json);
+
+    int token;
+    do
+    {
+        token = reader.next();
+    } while ((token != JSON_TOKEN_END) && (token != JSON_TOKEN_ERROR));
+
+    return token == JSON_TOKEN_ERROR && reader.getError()[0];
+}
+
+SEATEST_TEST(jsonStream_readErrors)
+{
+    assert_false(readFails("{\"a\": [1, 2, {\"b\": null}]}"));
+    assert_false(readFails(" 12 "));
+
+    assert_true(readFails(""));
+    assert_true(readFails("[1, 2,]"));
+    assert_true(readFails("{\"a\" 1}"));
+    assert_true(readFails("{\"a\": 1,}"));
+    assert_true(readFails("{a: 1}"));
+    assert_true(readFails("[1 2]"));
+    assert_true(readFails("[1}"));
+    assert_true(readFails("[\"abc"));
+    assert_true(readFails("[\"a\tb\"]"));
+    assert_true(readFails("[\"\\x\"]"));
+    assert_true(readFails("[\"\\ud800\"]"));
+    assert_true(readFails("[01]"));
+    assert_true(readFails("[1.]"));
+    assert_true(readFails("[-]"));
+    assert_true(readFails("[tru]"));
+    assert_true(readFails("[1] 2"));
+    assert_true(readFails("{\"a\": 1"));
+
+    JSONReader reader;
+    reader.loadString("{\n  \"a\": ?}");
+    reader.next();
+    reader.next();
+    assert_int_equal(JSON_TOKEN_ERROR, reader.next());
+    assert_true(strstr(reader.getError(), "Line 2 Column 8") != NULL);
+    // errors are sticky
+    assert_int_equal(JSON_TOKEN_ERROR, reader.next());
+}
+
+SEATEST_TEST(jsonStream_skip)
+{
+    JSONReader reader;
+    reader.loadString("{\"skip\": {\"a\": [1, {\"b\": []}], \"c\": \"}\"}, \"keep\": 5, \"also\": [[]], \"last\": true}");
+
+    assert_int_equal(JSON_TOKEN_OBJECT_START, reader.next());
+    assert_int_equal(JSON_TOKEN_KEY, reader.next());
+    assert_true(reader.skip());
+    assert_int_equal(JSON_TOKEN_KEY, reader.next());
+    assert_string_equal("keep", reader.getString());
+    assert_int_equal(JSON_TOKEN_NUMBER, reader.next());
+    assert_true(reader.getNumber() == 5);
+    assert_int_equal(JSON_TOKEN_KEY, reader.next());
+    assert_int_equal(JSON_TOKEN_ARRAY_START, reader.next());
+    assert_true(reader.skip());
+    assert_int_equal(JSON_TOKEN_ARRAY_END, reader.getToken());
+    assert_int_equal(JSON_TOKEN_KEY, reader.next());
+    assert_string_equal("last", reader.getString());
+    assert_int_equal(JSON_TOKEN_TRUE, reader.next());
+    assert_int_equal(JSON_TOKEN_OBJECT_END, reader.next());
+    assert_int_equal(JSON_TOKEN_END, reader.next());
+}
+
+SEATEST_TEST(jsonStream_readDictionary)
+{
+    // Reads keys and values the way the script Dictionary decoder does,
+    // every key is copied before the value is scanned over it
+    JSONReader reader;
+    reader.loadString("{\"name\": \"box\", \"gravity\": 9.8, \"count\": 3, \"tag\": \"a longer string value\"}");
+
+    utArray<utString> keys;
+    utArray<utString> values;
+
+    assert_int_equal(JSON_TOKEN_OBJECT_START, reader.next());
+
+    for ( ; ; )
+    {
+        int token = reader.next();
+
+        if (token == JSON_TOKEN_OBJECT_END)
+        {
+            break;
+        }
+
+        assert_int_equal(JSON_TOKEN_KEY, token);
+        keys.push_back(utString(reader.getString()));
+
+        token = reader.next();
+
+        if (token == JSON_TOKEN_NUMBER)
+        {
+            char number[32];
+            sprintf(number, "%g", reader.getNumber());
+            values.push_back(utString(number));
+        }
+        else
+        {
+            assert_int_equal(JSON_TOKEN_STRING, token);
+            values.push_back(utString(reader.getString()));
+        }
+    }
+
+    assert_int_equal(JSON_TOKEN_END, reader.next());
+
+    assert_int_equal(4, (int)keys.size());
+    assert_int_equal(4, (int)values.size());
+
+    assert_string_equal("name", keys[0].c_str());
+    assert_string_equal("box", values[0].c_str());
+    assert_string_equal("gravity", keys[1].c_str());
+    assert_string_equal("9.8", values[1].c_str());
+    assert_string_equal("count", keys[2].c_str());
+    assert_string_equal("3", values[2].c_str());
+    assert_string_equal("tag", keys[3].c_str());
+    assert_string_equal("a longer string value", values[3].c_str());
+
+    // the key text does not survive reading its value
+    reader.loadString("{\"key\": \"value\"}");
+    reader.next();
+    reader.next();
+    reader.next();
+    assert_string_equal("value", reader.getString());
+}
+
+SEATEST_TEST(jsonStream_write)
+{
+    JSONWriter writer;
+
+    writer.beginObject();
+    writer.writeKey("name");
+    writer.writeString("a\"b\\c\n\x01\xC3\xA9");
+    writer.writeKey("values");
+    writer.beginArray();
+    writer.writeInteger(1);
+    writer.writeNumber(-2.5);
+    writer.writeNumber(0.1);
+    writer.writeNumber(1e300);
+    writer.writeBoolean(true);
+    writer.writeBoolean(false);
+    writer.writeNull();
+    writer.endArray();
+    writer.writeKey("empty");
+    writer.beginObject();
+    writer.endObject();
+    assert_false(writer.isComplete());
+    writer.endObject();
+    assert_true(writer.isComplete());
+
+    assert_string_equal("{\"name\":\"a\\\"b\\\\c\\n\\u0001\xC3\xA9\",\"values\":[1,-2.5,0.1,1e+300,true,false,null],\"empty\":{}}",
+                        writer.serialize());
+
+    // Misuse is reported rather than producing broken output
+    assert_false(writer.writeNull());
+    writer.clear();
+    writer.beginObject();
+    assert_false(writer.writeInteger(1));
+    assert_false(writer.endArray());
+    writer.writeKey("a");
+    assert_false(writer.writeKey("b"));
+    assert_false(writer.endObject());
+    assert_false(writer.writeNumber(0.0 / 0.0));
+
+    writer.clear();
+    writer.setIndent(2);
+    writer.beginObject();
+    writer.writeKey("a");
+    writer.beginArray();
+    writer.writeInteger(1);
+    writer.writeInteger(2);
+    writer.endArray();
+    writer.writeKey("b");
+    writer.beginArray();
+    writer.endArray();
+    writer.endObject();
+    assert_string_equal("{\n  \"a\": [\n    1,\n    2\n  ],\n  \"b\": []\n}", writer.serialize());
+
+    // What is written reads back the same
+    JSONReader reader;
+    reader.loadString(writer.serialize());
+    assert_int_equal(JSON_TOKEN_OBJECT_START, reader.next());
+    assert_int_equal(JSON_TOKEN_KEY, reader.next());
+    assert_int_equal(JSON_TOKEN_ARRAY_START, reader.next());
+    assert_int_equal(JSON_TOKEN_NUMBER, reader.next());
+    assert_int_equal(JSON_TOKEN_NUMBER, reader.next());
+    assert_true(reader.getNumber() == 2);
+
+    utByteArray bytes;
+    bytes.writeUnsignedByte('>');
+    assert_true(writer.serializeToBuffer(&bytes));
+    assert_int_equal(1 + (int)strlen(writer.serialize()), (int)bytes.getSize());
+}
+
+SEATEST_TEST(jsonStream_parseBenchmark)
+{
+    static const int entities = 20000;
+
+    // Something shaped like a level file
+    JSONWriter writer;
+    writer.beginObject();
+    writer.writeKey("entities");
+    writer.beginArray();
+    for (int i = 0; i < entities; i++)
+    {
+        writer.beginObject();
+        writer.writeKey("name");
+        writer.writeString("entity");
+        writer.writeKey("x");
+        writer.writeNumber(i * 1.5);
+        writer.writeKey("y");
+        writer.writeInteger(-i);
+        writer.writeKey("visible");
+        writer.writeBoolean((i & 1) != 0);
+        writer.writeKey("tags");
+        writer.beginArray();
+        writer.writeString("static");
+        writer.writeString("solid");
+        writer.endArray();
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+
+    const char *json   = writer.serialize();
+    int         length = (int)strlen(json);
+
+    loom_precision_timer_t timer = loom_startTimer();
+
+    JSON document;
+    assert_true(document.loadString(json));
+    long long domNs = loom_readTimerNano(timer);
+
+    loom_resetTimer(timer);
+
+    JSONReader reader;
+    reader.loadString(json);
+    int    tokens = 0;
+    double sum    = 0;
+    int    token;
+    while ((token = reader.next()) > JSON_TOKEN_NONE && token < JSON_TOKEN_END)
+    {
+        if (token == JSON_TOKEN_NUMBER)
+        {
+            sum += reader.getNumber();
+        }
+        tokens++;
+    }
+    long long streamNs = loom_readTimerNano(timer);
+    loom_destroyTimer(timer);
+
+    assert_int_equal(JSON_TOKEN_END, token);
+    assert_int_equal(5 + entities * 15, tokens);
+
+    lmLogInfo(gJSONStreamTestLogGroup, "%d bytes: JSON DOM %lld ns, JSONReader %lld ns (%d tokens)",
+              length, domNs, streamNs, tokens);
+}
@@ -53,6 +53,8 @@ bool utByteArray::tryReadToArray(const utString& path, utByteArray& bytes, bool
         sz += 1;
     }
 
+    // The file replaces the contents, don't read it into a view.
+    bytes._data.detach();
     bytes._data.resize(sz);
 
     fstream.read(bytes._data.ptr(), addNullTerminator ? sz - 1 : sz);
@@ -24,8 +24,11 @@
 //#include "core/assert.h"
 #include "utTypes.h"
 #include "utString.h"
+#include "utEndian.h"
 #include "loom/common/core/assert.h"
 
+struct lua_State;
+
 class utByteArray {
 protected:
     // stored as little endian
@@ -34,26 +37,52 @@ protected:
 
     void memcpyUnaligned(void *destination, const void *source, size_t num)
     {
-        // TODO smarter
-        // Loop copying byte by byte to avoid unaligned access
-        for (size_t i = 0; i < num; i++)
+        // memcpy makes no alignment assumptions, and for the fixed sizes
+        // used by readValue/writeValue compilers turn it into a single
+        // unaligned-safe load or store.
+        memcpy(destination, source, num);
+    }
+
+    // Makes room to write length bytes at the current position. Capacity
+    // grows geometrically so a run of small writes doesn't reallocate each
+    // time. Views are copied into owned storage before the first write.
+    void ensureWritable(UTsize length)
+    {
+        UTsize needed = _position + length;
+
+        if (_data.isAttached() || (_data.capacity() < needed))
         {
-            ((char*)destination)[i] = ((char*)source)[i];
+            UTsize grown = _data.capacity() + _data.capacity() / 2;
+
+            if (grown < needed)
+            {
+                grown = needed;
+            }
+
+            if (grown < 16)
+            {
+                grown = 16;
+            }
+
+            _data.reserve(grown);
+        }
+
+        if (_data.size() < needed)
+        {
+            _data.resize(needed);
         }
     }
 
     template<typename T>
     T readValue()
     {
-        lmAssert(_position <= _data.size() - sizeof(T), "ByteArray out of data on read of size %u", sizeof(T));
+        lmAssert(_position + sizeof(T) <= _data.size(), "ByteArray out of data on read of size %u", sizeof(T));
         
-        T *ptr  = (T *)&_data[_position];
         T value;
 
         // memcpy is necessary for some platforms as we can get
         // an unaligned read exception (e.g. SIGBUS on Android/ARM) otherwise
-        // TODO: benchmark vs. assignment
-        memcpyUnaligned(&value, ptr, sizeof(T));
+        memcpyUnaligned(&value, _data.ptr() + _position, sizeof(T));
 
         _position += sizeof(T);
 
@@ -65,21 +94,69 @@ protected:
     template<typename T>
     void writeValue(T value)
     {
-        if (_data.size() < _position + sizeof(T))
-        {
-            _data.resize(_position + sizeof(T));
-        }
+        ensureWritable(sizeof(T));
 
         value = convertHostToLEndian(value);
 
-        T *ptr = (T *)&_data[_position];
-        
         // Needed for unaligned writes, see readValue for more info
-        memcpyUnaligned(ptr, &value, sizeof(T));
+        memcpyUnaligned(_data.ptr() + _position, &value, sizeof(T));
 
         _position += sizeof(T);
     }
 
+public:
+
+    template<typename T>
+    void readArray(T *values, UTsize count)
+    {
+        UTsize length = count * sizeof(T);
+
+        lmAssert(_position + length <= _data.size(), "ByteArray out of data on read of %u values of size %u", count, sizeof(T));
+
+        if (!length)
+        {
+            return;
+        }
+
+        memcpyUnaligned(values, _data.ptr() + _position, length);
+
+        _position += length;
+
+#if UT_ENDIAN != UT_ENDIAN_LITTLE
+        for (UTsize i = 0; i < count; i++)
+        {
+            values[i] = convertLEndianToHost(values[i]);
+        }
+#endif
+    }
+
+    template<typename T>
+    void writeArray(const T *values, UTsize count)
+    {
+        UTsize length = count * sizeof(T);
+
+        if (!length)
+        {
+            return;
+        }
+
+        ensureWritable(length);
+
+#if UT_ENDIAN == UT_ENDIAN_LITTLE
+        memcpyUnaligned(_data.ptr() + _position, values, length);
+#else
+        for (UTsize i = 0; i < count; i++)
+        {
+            T value = convertHostToLEndian(values[i]);
+            memcpyUnaligned(_data.ptr() + _position + i * sizeof(T), &value, sizeof(T));
+        }
+#endif
+
+        _position += length;
+    }
+
+protected:
+
     static int copyBytesInternal(utByteArray *dstByteArray, utByteArray *srcByteArray, int offset = 0, int length = 0, bool dstOffset = true)
     {
         if (!srcByteArray || !dstByteArray)
@@ -87,6 +164,12 @@ protected:
             return 0;
         }
 
+        // Never write through to the memory behind a view
+        if (dstByteArray->_data.isAttached())
+        {
+            dstByteArray->_data.reserve(dstByteArray->_data.size());
+        }
+
         unsigned char *dst = dstByteArray->_data.ptr();
         unsigned char *src = srcByteArray->_data.ptr();
 
@@ -275,13 +358,9 @@ public:
 
         writeValue<int>(length);
 
-        if ((int)_data.size() < _position + length)
-        {
-            _data.resize(_position + length);
-        }
+        ensureWritable(length);
 
-        char *ptr = (char *)&_data[_position];
-        memcpyUnaligned(ptr, value, length);
+        memcpyUnaligned(_data.ptr() + _position, value, length);
 
         _position += length;
     }
@@ -301,7 +380,7 @@ public:
         lmAssert(_position + length <= _data.size(), "Insufficient data available for length of %d (use readStringBytes if you don't have a 32-bit integer length header)", length);
 
         svalue.alloc(length);
-        memcpyUnaligned((void*)svalue.c_str(), &_data[_position], length);
+        memcpyUnaligned((void*)svalue.c_str(), _data.ptr() + _position, length);
         
         _position += length;
 
@@ -362,18 +441,40 @@ public:
     {
         if (!length) return;
 
-        if ((UTsize)_data.size() < _position + length)
-        {
-            _data.resize(_position + length);
-        }
+        ensureWritable(length);
 
-        char *ptr = (char *)&_data[_position];
-        memcpyUnaligned(ptr, value, length);
+        memcpyUnaligned(_data.ptr() + _position, value, length);
 
         _position += length;
     }
 
 
+    /*
+     * Bulk reads and writes of count values at the current position. These
+     * do one bounds check and one copy rather than one per value, and take
+     * care of unaligned data and byte order the same way the single value
+     * calls do.
+     */
+    void readRaw(void *bytes, UTsize length) { readArray<unsigned char>((unsigned char *)bytes, length); }
+    void writeRaw(const void *bytes, UTsize length) { writeArray<unsigned char>((const unsigned char *)bytes, length); }
+    void readInts(int *values, UTsize count) { readArray<int>(values, count); }
+    void writeInts(const int *values, UTsize count) { writeArray<int>(values, count); }
+    void readUnsignedShorts(unsigned short *values, UTsize count) { readArray<unsigned short>(values, count); }
+    void writeUnsignedShorts(const unsigned short *values, UTsize count) { writeArray<unsigned short>(values, count); }
+    void readFloats(float *values, UTsize count) { readArray<float>(values, count); }
+    void writeFloats(const float *values, UTsize count) { writeArray<float>(values, count); }
+    void readDoubles(double *values, UTsize count) { readArray<double>(values, count); }
+    void writeDoubles(const double *values, UTsize count) { writeArray<double>(values, count); }
+
+    /*
+     * Script bindings for the bulk calls, filling or draining a
+     * Vector.<Number>; implemented in lmByteArray.cpp.
+     */
+    int readFloatsLua(lua_State *L);
+    int writeFloatsLua(lua_State *L);
+    int readIntsLua(lua_State *L);
+    int writeIntsLua(lua_State *L);
+
     void writeBytes(utByteArray *byteArray, int offset = 0, int length = 0)
     {
         copyBytesInternal(this, byteArray, offset, length, false);
@@ -411,15 +512,29 @@ public:
      */
     void allocateAndCopy(void *src, int size)
     {
+        // A view is dropped rather than written through.
+        _data.detach();
         _data.resize(size);
         memcpy(_data.ptr(), src, size);
         _position = 0;
     }
 
-    void attach(void *memory, UTsize size)
+    /*
+     * Make the utByteArray a view over external memory, e.g. a mapped file,
+     * without copying it. The memory must outlive the view (or until
+     * clear). Reads come straight from the memory; the first write copies
+     * the contents into storage the utByteArray owns, so the external
+     * memory is never modified and may be read-only.
+     */
+    void attach(const void *memory, UTsize size)
     {
         _position = 0;
-        _data.attach(memory, size);
+        _data.attach((void *)memory, size);
+    }
+
+    bool isView() const
+    {
+        return _data.isAttached();
     }
 
     /*
@@ -430,6 +545,11 @@ public:
         return _data.ptr();
     }
 
+    const void *getDataPtr() const
+    {
+        return _data.ptr();
+    }
+
     /*
      * Direct access to the utByteArray's size
      */
@@ -450,12 +570,19 @@ public:
     }
 
     /*
-     * Set the utByteArray's size directly
+     * Set the utByteArray's size directly, a view is copied into owned
+     * storage first
      */
     void resize(UTsize size)
     {
         _position = _position > size ? size : _position;
-        return _data.resize(size);
+        _data.resize(size);
+
+        // Growing already copied the view, shrinking copies what is left.
+        if (_data.isAttached())
+        {
+            _data.reserve(size);
+        }
     }
 
     /*
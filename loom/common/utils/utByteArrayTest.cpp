@@ -0,0 +1,166 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include <string.h>
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/utils/utByteArray.h"
+#include "seatest.h"
+
+lmDefineLogGroup(gByteArrayTestLogGroup, "byteArrayTest", 1, LoomLogInfo);
+
+SEATEST_FIXTURE(utByteArray)
+{
+    SEATEST_FIXTURE_ENTRY(utByteArray_view);
+    SEATEST_FIXTURE_ENTRY(utByteArray_bulk);
+    SEATEST_FIXTURE_ENTRY(utByteArray_writeBenchmark);
+}
+
+SEATEST_TEST(utByteArray_view)
+{
+    const unsigned char source[] = { 1, 0, 0, 0, 2, 0, 0, 0, 0xAB };
+
+    utByteArray bytes;
+    bytes.attach(source, sizeof(source));
+
+    assert_true(bytes.isView());
+    assert_true(bytes.getDataPtr() == source);
+    assert_int_equal(1, bytes.readInt());
+    assert_int_equal(2, bytes.readInt());
+    assert_int_equal(0xAB, bytes.readUnsignedByte());
+
+    // Writing copies into owned storage and leaves the source alone
+    bytes.setPosition(0);
+    bytes.writeInt(7);
+    assert_false(bytes.isView());
+    assert_true(bytes.getDataPtr() != source);
+    assert_int_equal(1, source[0]);
+    assert_int_equal(sizeof(source), bytes.getSize());
+
+    bytes.setPosition(0);
+    assert_int_equal(7, bytes.readInt());
+    assert_int_equal(2, bytes.readInt());
+    assert_int_equal(0xAB, bytes.readUnsignedByte());
+
+    // Same for a view written to through writeBytes
+    utByteArray other;
+    other.writeInt(9);
+    bytes.attach(source, sizeof(source));
+    bytes.writeBytes(&other);
+    assert_false(bytes.isView());
+    assert_int_equal(1, source[0]);
+    bytes.setPosition(0);
+    assert_int_equal(9, bytes.readInt());
+    assert_int_equal(2, bytes.readInt());
+
+    // Resizing a view, even down, leaves it with owned storage
+    bytes.attach(source, sizeof(source));
+    bytes.resize(4);
+    assert_false(bytes.isView());
+    assert_true(bytes.getDataPtr() != source);
+    assert_int_equal(4, bytes.getSize());
+    assert_int_equal(1, bytes.readInt());
+
+    // Replacing the contents of a view doesn't write into the source
+    const unsigned char replacement[] = { 5, 0, 0, 0 };
+    bytes.attach(source, sizeof(source));
+    bytes.allocateAndCopy((void *)replacement, sizeof(replacement));
+    assert_false(bytes.isView());
+    assert_int_equal(1, source[0]);
+    assert_int_equal(sizeof(replacement), bytes.getSize());
+    assert_int_equal(5, bytes.readInt());
+}
+
+SEATEST_TEST(utByteArray_bulk)
+{
+    float  floats[300];
+    int    ints[5] = { 0, -1, 2147483647, -2147483647 - 1, 12345 };
+    double doubles[3] = { 0.5, -1e300, 3.25 };
+
+    for (int i = 0; i < 300; i++)
+    {
+        floats[i] = i * 0.25f - 10.0f;
+    }
+
+    utByteArray bytes;
+    bytes.writeUnsignedByte(0xFF); // so the bulk data is unaligned
+    bytes.writeFloats(floats, 300);
+    bytes.writeInts(ints, 5);
+    bytes.writeDoubles(doubles, 3);
+    bytes.writeRaw("abc", 3);
+    assert_int_equal(1 + 300 * 4 + 5 * 4 + 3 * 8 + 3, bytes.getSize());
+
+    // Bulk writes produce the same bytes as single value writes
+    utByteArray single;
+    single.writeUnsignedByte(0xFF);
+    for (int i = 0; i < 300; i++)
+    {
+        single.writeFloat(floats[i]);
+    }
+    assert_int_equal(0, memcmp(bytes.getDataPtr(), single.getDataPtr(), single.getSize()));
+
+    float  floatsOut[300];
+    int    intsOut[5];
+    double doublesOut[3];
+    char   raw[4] = { 0 };
+
+    bytes.setPosition(1);
+    bytes.readFloats(floatsOut, 300);
+    bytes.readInts(intsOut, 5);
+    bytes.readDoubles(doublesOut, 3);
+    bytes.readRaw(raw, 3);
+    assert_int_equal(0, bytes.bytesAvailable());
+
+    assert_int_equal(0, memcmp(floats, floatsOut, sizeof(floats)));
+    assert_int_equal(0, memcmp(ints, intsOut, sizeof(ints)));
+    assert_int_equal(0, memcmp(doubles, doublesOut, sizeof(doubles)));
+    assert_string_equal("abc", raw);
+}
+
+SEATEST_TEST(utByteArray_writeBenchmark)
+{
+    static const int count = 100000;
+
+    static float values[count];
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = (float)i;
+    }
+
+    utByteArray bytes;
+    loom_precision_timer_t timer = loom_startTimer();
+    for (int i = 0; i < count; i++)
+    {
+        bytes.writeFloat(values[i]);
+    }
+    long long singleNs = loom_readTimerNano(timer);
+
+    bytes.clear();
+    loom_resetTimer(timer);
+    bytes.writeFloats(values, count);
+    long long bulkNs = loom_readTimerNano(timer);
+    loom_destroyTimer(timer);
+
+    assert_int_equal(count * 4, bytes.getSize());
+
+    lmLogInfo(gByteArrayTestLogGroup, "%d floats: writeFloat %lld ns, writeFloats %lld ns",
+              count, singleNs, bulkNs);
+}
@@ -0,0 +1,332 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#ifndef _UTILS_UTFLATSTRINGMAP_H_
+#define _UTILS_UTFLATSTRINGMAP_H_
+
+#include <string.h>
+#include "loom/common/core/allocator.h"
+#include "loom/common/utils/utString.h"
+
+// FNV-1a over the bytes of the key.
+inline UThash utFlatStringHash(const char *key, UTsize length)
+{
+    UThash h = 2166136261u;
+
+    for (UTsize i = 0; i < length; i++)
+    {
+        h = (h ^ (unsigned char)key[i]) * 16777619u;
+    }
+    return h;
+}
+
+/*
+ * A string key with its length and hash computed once, for lookups that
+ * are repeated or whose key is not null terminated. The characters are
+ * not copied, so the key must outlive it.
+ */
+struct utFlatStringKey
+{
+    const char *str;
+    UTsize     length;
+    UThash     hash;
+
+    utFlatStringKey(const char *s) : str(s), length((UTsize)strlen(s)) { hash = utFlatStringHash(s, length); }
+    utFlatStringKey(const char *s, UTsize len) : str(s), length(len), hash(utFlatStringHash(s, len)) {}
+};
+
+/*
+ * Hash map from strings to values using open addressing.
+ *
+ * Entries are stored densely in insertion order, with removal moving the
+ * last entry into the hole like utHashTable, so they can be walked with
+ * at()/keyAt() by index. A separate power of two slot array holds each
+ * entry's hash and index and is probed linearly, so a miss usually touches
+ * a single cache line and a hit compares one string.
+ *
+ * Lookups take a const char *, an optional length or a utFlatStringKey and
+ * never allocate. Keys are copied into the map on insert. Lookups don't
+ * modify the map, so any number of threads may read it concurrently as
+ * long as no thread is writing.
+ */
+template<typename Value>
+class utFlatStringMap
+{
+public:
+
+    struct Entry
+    {
+        UThash hash;
+        UTsize length;
+        char   *key;
+        Value  value;
+    };
+
+    utFlatStringMap() : m_slots(NULL), m_capacity(0) {}
+    ~utFlatStringMap() { clear(); }
+
+    UTsize find(const utFlatStringKey& key) const
+    {
+        UTsize slot = findSlot(key.str, key.length, key.hash);
+
+        return slot == UT_NPOS ? UT_NPOS : m_slots[slot].index;
+    }
+
+    UT_INLINE UTsize find(const char *key, UTsize length) const { return find(utFlatStringKey(key, length)); }
+    UT_INLINE UTsize find(const char *key) const { return find(utFlatStringKey(key)); }
+    UT_INLINE UTsize find(const utString& key) const { return find(utFlatStringKey(key.c_str())); }
+
+    Value *get(const utFlatStringKey& key)
+    {
+        UTsize i = find(key);
+
+        return i == UT_NPOS ? NULL : &m_entries[i].value;
+    }
+
+    const Value *get(const utFlatStringKey& key) const
+    {
+        UTsize i = find(key);
+
+        return i == UT_NPOS ? NULL : &m_entries[i].value;
+    }
+
+    UT_INLINE Value *get(const char *key) { return get(utFlatStringKey(key)); }
+    UT_INLINE const Value *get(const char *key) const { return get(utFlatStringKey(key)); }
+    UT_INLINE Value *get(const char *key, UTsize length) { return get(utFlatStringKey(key, length)); }
+    UT_INLINE const Value *get(const char *key, UTsize length) const { return get(utFlatStringKey(key, length)); }
+    UT_INLINE Value *get(const utString& key) { return get(utFlatStringKey(key.c_str())); }
+    UT_INLINE const Value *get(const utString& key) const { return get(utFlatStringKey(key.c_str())); }
+
+    // Insert the key-value pair if the key is missing, returns false and
+    // leaves the map unchanged otherwise.
+    bool insert(const utFlatStringKey& key, const Value& value)
+    {
+        if (findSlot(key.str, key.length, key.hash) != UT_NPOS)
+        {
+            return false;
+        }
+
+        if ((m_entries.size() + 1) * 4 > m_capacity * 3)
+        {
+            rehash(m_capacity == 0 ? 16 : m_capacity * 2);
+        }
+
+        Entry entry;
+        entry.hash   = key.hash;
+        entry.length = key.length;
+        entry.key    = (char *)lmAlloc(NULL, key.length + 1);
+        entry.value  = value;
+        memcpy(entry.key, key.str, key.length);
+        entry.key[key.length] = 0;
+
+        m_entries.push_back(entry);
+        placeSlot(key.hash, m_entries.size() - 1);
+        return true;
+    }
+
+    UT_INLINE bool insert(const char *key, const Value& value) { return insert(utFlatStringKey(key), value); }
+    UT_INLINE bool insert(const utString& key, const Value& value) { return insert(utFlatStringKey(key.c_str()), value); }
+
+    // Insert the key-value pair, or replace the value if the key exists.
+    void set(const utFlatStringKey& key, const Value& value)
+    {
+        Value *existing = get(key);
+
+        if (existing)
+        {
+            *existing = value;
+        }
+        else
+        {
+            insert(key, value);
+        }
+    }
+
+    UT_INLINE void set(const char *key, const Value& value) { set(utFlatStringKey(key), value); }
+
+    // Remove the key if present, the last entry takes its index.
+    bool remove(const utFlatStringKey& key)
+    {
+        UTsize slot = findSlot(key.str, key.length, key.hash);
+
+        if (slot == UT_NPOS)
+        {
+            return false;
+        }
+
+        UTsize index = m_slots[slot].index;
+        UTsize last  = m_entries.size() - 1;
+
+        eraseSlot(slot);
+        lmFree(NULL, m_entries[index].key);
+
+        if (index != last)
+        {
+            // Repoint the slot of the last entry at its new index
+            UTsize mask = m_capacity - 1;
+            UTsize s    = m_entries[last].hash & mask;
+            while (m_slots[s].index != last)
+            {
+                s = (s + 1) & mask;
+            }
+            m_slots[s].index = index;
+
+            m_entries[index] = m_entries[last];
+        }
+
+        m_entries.pop_back();
+        return true;
+    }
+
+    UT_INLINE bool remove(const char *key) { return remove(utFlatStringKey(key)); }
+    UT_INLINE bool remove(const utString& key) { return remove(utFlatStringKey(key.c_str())); }
+    UT_INLINE void erase(const char *key) { remove(utFlatStringKey(key)); }
+    UT_INLINE void erase(const utString& key) { remove(utFlatStringKey(key.c_str())); }
+
+    void clear()
+    {
+        for (UTsize i = 0; i < m_entries.size(); i++)
+        {
+            lmFree(NULL, m_entries[i].key);
+        }
+        m_entries.clear();
+
+        lmSafeFree(NULL, m_slots);
+        m_capacity = 0;
+    }
+
+    void reserve(UTsize nr)
+    {
+        UTsize capacity = 16;
+
+        while (nr * 4 > capacity * 3)
+        {
+            capacity *= 2;
+        }
+
+        if (capacity > m_capacity)
+        {
+            rehash(capacity);
+        }
+        m_entries.reserve(nr);
+    }
+
+    UT_INLINE UTsize size() const { return m_entries.size(); }
+    UT_INLINE bool empty() const { return m_entries.size() == 0; }
+
+    UT_INLINE Value& at(UTsize i) { return m_entries[i].value; }
+    UT_INLINE const Value& at(UTsize i) const { return m_entries[i].value; }
+    UT_INLINE const char *keyAt(UTsize i) const { return m_entries[i].key; }
+    UT_INLINE UTsize keyLengthAt(UTsize i) const { return m_entries[i].length; }
+
+private:
+
+    struct Slot
+    {
+        UThash hash;
+        UTsize index;   // UT_NPOS when empty
+    };
+
+    // Keys are owned, so copies would double free them.
+    utFlatStringMap(const utFlatStringMap&);
+    utFlatStringMap& operator=(const utFlatStringMap&);
+
+    UTsize findSlot(const char *key, UTsize length, UThash h) const
+    {
+        if (m_capacity == 0)
+        {
+            return UT_NPOS;
+        }
+
+        UTsize mask = m_capacity - 1;
+
+        for (UTsize s = h & mask; m_slots[s].index != UT_NPOS; s = (s + 1) & mask)
+        {
+            if (m_slots[s].hash == h)
+            {
+                const Entry& entry = m_entries[m_slots[s].index];
+                if ((entry.length == length) && (memcmp(entry.key, key, length) == 0))
+                {
+                    return s;
+                }
+            }
+        }
+
+        return UT_NPOS;
+    }
+
+    void placeSlot(UThash h, UTsize index)
+    {
+        UTsize mask = m_capacity - 1;
+        UTsize s    = h & mask;
+
+        while (m_slots[s].index != UT_NPOS)
+        {
+            s = (s + 1) & mask;
+        }
+
+        m_slots[s].hash  = h;
+        m_slots[s].index = index;
+    }
+
+    // Backward shift deletion, keeps probe sequences intact without tombstones.
+    void eraseSlot(UTsize hole)
+    {
+        UTsize mask = m_capacity - 1;
+
+        for (UTsize s = (hole + 1) & mask; m_slots[s].index != UT_NPOS; s = (s + 1) & mask)
+        {
+            UTsize home = m_slots[s].hash & mask;
+
+            // Move the slot back if the hole lies between its home and it
+            if (((s - home) & mask) >= ((s - hole) & mask))
+            {
+                m_slots[hole] = m_slots[s];
+                hole          = s;
+            }
+        }
+
+        m_slots[hole].index = UT_NPOS;
+    }
+
+    void rehash(UTsize capacity)
+    {
+        lmSafeFree(NULL, m_slots);
+
+        m_capacity = capacity;
+        m_slots    = (Slot *)lmAlloc(NULL, capacity * sizeof(Slot));
+        for (UTsize s = 0; s < capacity; s++)
+        {
+            m_slots[s].index = UT_NPOS;
+        }
+
+        for (UTsize i = 0; i < m_entries.size(); i++)
+        {
+            placeSlot(m_entries[i].hash, i);
+        }
+    }
+
+    utArray<Entry> m_entries;
+    Slot           *m_slots;
+    UTsize         m_capacity;
+};
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include "loom/common/core/log.h"
+#include "loom/common/platform/platformTime.h"
+#include "loom/common/utils/utFlatStringMap.h"
+#include "seatest.h"
+
+lmDefineLogGroup(gFlatStringMapTestLogGroup, "flatStringMapTest", 1, LoomLogInfo);
+
+SEATEST_FIXTURE(utFlatStringMap)
+{
+    SEATEST_FIXTURE_ENTRY(utFlatStringMap_insertGet);
+    SEATEST_FIXTURE_ENTRY(utFlatStringMap_remove);
+    SEATEST_FIXTURE_ENTRY(utFlatStringMap_lookupBenchmark);
+}
+
+SEATEST_TEST(utFlatStringMap_insertGet)
+{
+    utFlatStringMap<int> map;
+
+    assert_true(map.get("missing") == NULL);
+
+    assert_true(map.insert("alpha", 1));
+    assert_true(map.insert("beta", 2));
+    assert_false(map.insert("alpha", 3));
+    assert_int_equal(2, (int)map.size());
+
+    assert_int_equal(1, *map.get("alpha"));
+    assert_int_equal(2, *map.get(utString("beta")));
+
+    // Lookups by length don't need a terminated key
+    const char *text = "beta.gamma";
+    assert_int_equal(2, *map.get(text, 4));
+    assert_true(map.get(text, 3) == NULL);
+
+    utFlatStringKey key("alpha");
+    assert_int_equal(0, (int)map.find(key));
+
+    map.set("alpha", 10);
+    map.set("delta", 4);
+    assert_int_equal(10, *map.get("alpha"));
+    assert_int_equal(4, *map.get("delta"));
+
+    // Grows past the initial slots
+    char name[32];
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(name, "key%d", i);
+        assert_true(map.insert(name, i));
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(name, "key%d", i);
+        assert_int_equal(i, *map.get(name));
+    }
+    assert_int_equal(1003, (int)map.size());
+}
+
+SEATEST_TEST(utFlatStringMap_remove)
+{
+    utFlatStringMap<int> map;
+    char                 name[32];
+
+    for (int i = 0; i < 500; i++)
+    {
+        sprintf(name, "key%d", i);
+        map.insert(name, i);
+    }
+
+    // Remove every other key, the rest must survive the shifting
+    for (int i = 0; i < 500; i += 2)
+    {
+        sprintf(name, "key%d", i);
+        assert_true(map.remove(name));
+        assert_false(map.remove(name));
+    }
+
+    assert_int_equal(250, (int)map.size());
+    for (int i = 0; i < 500; i++)
+    {
+        sprintf(name, "key%d", i);
+        if (i % 2)
+        {
+            assert_int_equal(i, *map.get(name));
+        }
+        else
+        {
+            assert_true(map.get(name) == NULL);
+        }
+    }
+
+    // Entries stay dense and match their keys
+    for (UTsize i = 0; i < map.size(); i++)
+    {
+        int value = map.at(i);
+        sprintf(name, "key%d", value);
+        assert_string_equal(name, map.keyAt(i));
+    }
+
+    map.clear();
+    assert_true(map.empty());
+    assert_true(map.get("key1") == NULL);
+}
+
+static const int BENCH_KEYS    = 512;
+static const int BENCH_LOOKUPS = 200000;
+
+SEATEST_TEST(utFlatStringMap_lookupBenchmark)
+{
+    utFlatStringMap<int>             flat;
+    utHashTable<utHashedString, int> table;
+
+    static char names[BENCH_KEYS][48];
+    for (int i = 0; i < BENCH_KEYS; i++)
+    {
+        sprintf(names[i], "assets/textures/atlas%d/frame%d.png", i % 17, i);
+        assert_true(flat.insert(names[i], i));
+        table.insert(utHashedString(names[i]), i);
+    }
+    assert_int_equal(BENCH_KEYS, (int)flat.size());
+
+    // Alternate keys so the utHashTable last lookup cache doesn't hit
+    int tableMisses = 0;
+    loom_precision_timer_t timer = loom_startTimer();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        int key = (i * 7) % BENCH_KEYS;
+        int *value = table.get(utHashedString(names[key]));
+        if (!value || *value != key) tableMisses++;
+    }
+    long long tableNs = loom_readTimerNano(timer);
+
+    // Every lookup must find its own key, none may resolve to a neighbour
+    int flatMisses = 0;
+    loom_resetTimer(timer);
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        int key = (i * 7) % BENCH_KEYS;
+        int *value = flat.get(names[key]);
+        if (!value || *value != key) flatMisses++;
+    }
+    long long flatNs = loom_readTimerNano(timer);
+    loom_destroyTimer(timer);
+
+    assert_int_equal(0, tableMisses);
+    assert_int_equal(0, flatMisses);
+
+    // Keys sharing a prefix with stored ones, or cut short, must not match
+    char probe[64];
+    for (int i = 0; i < BENCH_KEYS; i++)
+    {
+        snprintf(probe, sizeof(probe), "%s.bak", names[i]);
+        assert_true(flat.get(probe) == NULL);
+        assert_true(flat.get(names[i], (UTsize)strlen(names[i]) - 1) == NULL);
+        assert_int_equal(i, *flat.get(probe, (UTsize)strlen(names[i])));
+    }
+
+    lmLogInfo(gFlatStringMapTestLogGroup, "%d string lookups: utHashTable %lld ns, utFlatStringMap %lld ns",
+              BENCH_LOOKUPS, tableNs, flatNs);
+}
@@ -809,17 +809,27 @@ public:
         m_size = nr;
     }
 
+    // Attached (non-owning) storage is copied into owned storage here,
+    // leaving the external memory untouched.
     void reserve(UTsize nr)
     {
-        if (m_capacity < nr)
+        if (m_capacity < nr || m_attached)
         {
+            if (nr < m_size)
+            {
+                nr = m_size;
+            }
+
             T *p = loom_newArray<T>(NULL, nr);
-            detach();
             if (m_data != 0)
             {
                 copy(p, m_data, m_size);
-                loom_deleteArray(NULL, m_data);
+                if (!m_attached)
+                {
+                    loom_deleteArray(NULL, m_data);
+                }
             }
+            m_attached = false;
             m_data     = p;
             m_capacity = nr;
         }
@@ -867,6 +877,7 @@ public:
     UT_INLINE UTsize capacity(void) const { return m_capacity; }
     UT_INLINE UTsize size(void) const { return m_size; }
     UT_INLINE bool empty(void) const { return m_size == 0; }
+    UT_INLINE bool isAttached(void) const { return m_attached; }
 
 
     UT_INLINE Iterator iterator(void)       { return m_data && m_size > 0 ? Iterator(m_data, m_size) : Iterator(); }
@@ -35,5 +35,14 @@ SEATEST_SUITE(allTests)
     //SEATEST_SUITE_ENTRY(matrix);
     SEATEST_SUITE_ENTRY(logging);
     SEATEST_SUITE_ENTRY(assets);
+    SEATEST_SUITE_ENTRY(telemetry);
     SEATEST_SUITE_ENTRY(lmAutoPtr);
+    SEATEST_SUITE_ENTRY(utFlatStringMap);
+    SEATEST_SUITE_ENTRY(utByteArray);
+    SEATEST_SUITE_ENTRY(jsonStream);
+    SEATEST_SUITE_ENTRY(bitmapFontLayout);
+    SEATEST_SUITE_ENTRY(tweenEngine);
+    SEATEST_SUITE_ENTRY(vectorCapture);
+    SEATEST_SUITE_ENTRY(box2dWorldQuery);
+    SEATEST_SUITE_ENTRY(box2dStepper);
 }
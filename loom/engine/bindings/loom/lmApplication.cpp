@@ -25,6 +25,7 @@
 using namespace LS;
 
 #include "loom/common/core/log.h"
+#include "loom/common/core/allocatorProfiler.h"
 #include "loom/common/assets/assetsScript.h"
 #include "loom/common/platform/platformNetwork.h"
 #include "loom/common/platform/platformWebView.h"
@@ -218,6 +219,19 @@ void LoomApplication::initMainAssembly()
     rootVM->readExecutableAssemblyBinaryHeader(initBytes);
     Assembly *assembly = BinReader::loadMainAssemblyHeader();
     LoomApplicationConfig::parseApplicationConfig(assembly->getLoomConfig());
+
+    if (LoomApplicationConfig::logAsync())
+    {
+        loom_log_startAsync(LoomApplicationConfig::logQueueSize());
+    }
+    loom_asset_setBinaryLog(LoomApplicationConfig::logBinary());
+
+    // The trace compiler is applied when the VM opens
+    LSLuaState::setJITCompilerDefault(LoomApplicationConfig::jitEnabled());
+    for (UTsize i = 0; i < LoomApplicationConfig::jitExclude().size(); i++)
+    {
+        LSLuaState::addJITExclusion(LoomApplicationConfig::jitExclude()[i]);
+    }
     
     Loom2D::Stage::initFromConfig();
 }
@@ -326,8 +340,69 @@ void LoomApplication::_reloadMainAssembly()
 }
 
 
+// Handles the heap profiler commands sent by the asset agent:
+//   heapProfile start [sampleBytes] [backtrace]
+//   heapProfile stop
+//   heapProfile dump [path]
+// Dumps go back to the agent and the log unless a path is given.
+static bool dispatchHeapProfilerCommand(const char *cmd)
+{
+    char action[16];
+    char arg[1024];
+    int  backtrace = 0;
+
+    if (strncmp(cmd, "heapProfile ", 12) != 0)
+    {
+        return false;
+    }
+
+    arg[0] = 0;
+    if (sscanf(cmd + 12, "%15s %1023s %d", action, arg, &backtrace) < 1)
+    {
+        return false;
+    }
+
+    if (strcmp(action, "start") == 0)
+    {
+        int sampleBytes = atoi(arg);
+        loom_heapProfiler_enable(sampleBytes > 0 ? sampleBytes : LOOM_HEAPPROFILER_DEFAULT_SAMPLE_BYTES, backtrace);
+    }
+    else if (strcmp(action, "stop") == 0)
+    {
+        loom_heapProfiler_disable();
+    }
+    else if (strcmp(action, "dump") == 0)
+    {
+        if (!loom_heapProfiler_isEnabled())
+        {
+            lmLogWarn(applicationLogGroup, "Heap profiler is not running, use 'heapProfile start' first");
+        }
+        else if (arg[0])
+        {
+            loom_heapProfiler_dumpToFile(arg, 256);
+        }
+        else
+        {
+            loom_heapProfiler_dumpToLog(20);
+            loom_heapProfiler_dumpToAssetAgent(256);
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
 static void dispatchCommand(const char *cmd)
 {
+    if (dispatchHeapProfilerCommand(cmd))
+    {
+        return;
+    }
+
     NativeDelegate *nd = &LoomApplication::assetCommandDelegate;
 
     nd->pushArgument(cmd);
@@ -464,8 +539,14 @@ void LoomApplication::shutdown()
 
     platform_HTTPCleanup();
 
+    // Deliver queued log output while the asset agent can still receive it.
+    loom_log_flush();
+
     // Shut down application subsystems.
     loom_asset_shutdown();
+
+    // Only once the asset threads are done logging.
+    loom_log_stopAsync();
 } 
 
 
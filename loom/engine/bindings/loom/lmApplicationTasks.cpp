@@ -23,15 +23,43 @@
 #include "loom/common/platform/platformThread.h"
 #include "loom/common/platform/platformNetwork.h"
 #include "loom/common/core/performance.h"
+#include "loom/common/core/allocatorFrame.h"
+#include "loom/common/core/telemetry.h"
 #include "loom/common/assets/assets.h"
 #include "loom/script/native/lsNativeDelegate.h"
 #include "lmApplication.h"
 #include "loom/common/config/applicationConfig.h"
 #include "loom/engine/loom2d/l2dStage.h"
 #include "loom/graphics/gfxTexture.h"
+#include "loom/graphics/gfxVectorSVGCache.h"
 
 lmDefineLogGroup(gTickLogGroup, "tick", true, LoomLogInfo)
 
+static TickMetricID frameAllocUsedID          = Telemetry::registerTickValue("frame.alloc.used");
+static TickMetricID frameAllocHighWaterID     = Telemetry::registerTickValue("frame.alloc.highwater");
+static TickMetricID frameAllocOverflowBytesID = Telemetry::registerTickValue("frame.alloc.overflow.bytes");
+static TickMetricID frameAllocOverflowCountID = Telemetry::registerTickValue("frame.alloc.overflow.count");
+
+// Report what the previous tick used of the frame allocator and flip it,
+// temporaries from the previous tick stay valid through this one.
+static void loom_flipFrameAllocator()
+{
+    loom_allocator_t *frame = loom_frameAllocator_getGlobal();
+
+    if (Telemetry::isEnabled())
+    {
+        loom_frameAllocatorStats_t stats;
+        loom_frameAllocator_getStats(frame, &stats);
+
+        Telemetry::setTickValue(frameAllocUsedID, (double)stats.usedBytes);
+        Telemetry::setTickValue(frameAllocHighWaterID, (double)stats.highWaterBytes);
+        Telemetry::setTickValue(frameAllocOverflowBytesID, (double)stats.overflowBytes);
+        Telemetry::setTickValue(frameAllocOverflowCountID, (double)stats.overflowCount);
+    }
+
+    loom_frameAllocator_flip(frame);
+}
+
 extern "C"
 {
 
@@ -68,6 +96,7 @@ void loom_tick()
     // Mark the main thread for NativeDelegates. On some platforms this
     // may change so we remark every frame.
     NativeDelegate::markMainThread();
+    loom_flipFrameAllocator();
     if (vm) NativeDelegate::executeDeferredCalls(vm->VM());
 
     performance_tick();
@@ -100,6 +129,7 @@ void loom_tick()
     platform_HTTPUpdate();
     
     GFX::Texture::tick();
+    GFX::VectorSVGCache::tick();
     
     if (Loom2D::Stage::smMainStage) Loom2D::Stage::smMainStage->invokeRenderStage();
     
@@ -57,8 +57,13 @@
 //
 
 #include "loom/common/core/log.h"
+#include "loom/common/core/performance.h"
+#include "loom/common/platform/platformThread.h"
 #include "loom/script/loomscript.h"
 #include "loom/script/native/lsNativeDelegate.h"
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/engine/bindings/loom/lmBox2D.h"
+#include "loom/engine/bindings/loom/lmBox2DStepper.h"
 #include "loom/vendor/box2d/Box2D.h"
 #include <map>
 
@@ -287,6 +292,648 @@ void b2ShapeCache::addShapesWithFile(const std::string &plist, b2Vec2 vertexScal
 
 #endif
 
+static utArray<BodySync *>   sBodySyncs;
+static utArray<WorldQuery *> sWorldQueries;
+
+// contact events arrive on the WorldStepper worker while queries for other
+// worlds may be created or destroyed on the main thread
+static MutexHandle sWorldQueriesMutex = NULL;
+
+// Worlds only take a single listener of each kind, these forward the
+// callbacks to every WorldQuery of the calling world.
+class Box2DDestructionListener : public b2DestructionListener
+{
+public:
+
+    void SayGoodbye(b2Joint *joint) { B2_NOT_USED(joint); }
+    void SayGoodbye(b2Fixture *fixture);
+};
+
+class Box2DContactListener : public b2ContactListener
+{
+public:
+
+    void BeginContact(b2Contact *contact);
+    void EndContact(b2Contact *contact);
+};
+
+static Box2DDestructionListener sDestructionListener;
+static Box2DContactListener     sContactListener;
+
+BodySync::BodySync()
+{
+    construct();
+}
+
+BodySync::BodySync(b2World *_world)
+{
+    construct();
+    initialize(_world);
+}
+
+void BodySync::construct()
+{
+    world          = NULL;
+    pixelsPerMeter = 32.0f;
+    offsetX        = 0.0f;
+    offsetY        = 0.0f;
+    numSynced      = 0;
+
+    sBodySyncs.push_back(this);
+}
+
+BodySync::~BodySync()
+{
+    sBodySyncs.erase(this);
+}
+
+void BodySync::initialize(b2World *_world)
+{
+    lmAssert(_world, "BodySync needs a World");
+    lmAssert(!world, "BodySync already has a World");
+
+    world = _world;
+}
+
+void BodySync::link(b2Body *body, Loom2D::DisplayObject *target)
+{
+    lmAssert(body && target, "BodySync.link needs a body and a target");
+    lmAssert(body->GetWorld() == world, "BodySync.link given a body of another World");
+
+    const b2Vec2& position = body->GetPosition();
+
+    Link l;
+    l.body      = body;
+    l.target    = target;
+    l.prevX     = position.x;
+    l.prevY     = position.y;
+    l.prevAngle = body->GetAngle();
+    l.lastX     = l.lastY = l.lastAngle = 0.0f;
+    l.written   = false;
+
+    int *index = linkIndex.get(utPointerHashKey(body));
+
+    if (index)
+    {
+        links[*index] = l;
+        return;
+    }
+
+    linkIndex.insert(utPointerHashKey(body), (int)links.size());
+    links.push_back(l);
+}
+
+void BodySync::unlink(b2Body *body)
+{
+    int *found = linkIndex.get(utPointerHashKey(body));
+
+    if (!found)
+    {
+        return;
+    }
+
+    // move the last link into the gap
+    int index = *found;
+    int last  = (int)links.size() - 1;
+
+    linkIndex.remove(utPointerHashKey(body));
+
+    if (index != last)
+    {
+        links[index] = links[last];
+        *linkIndex.get(utPointerHashKey(links[index].body)) = index;
+    }
+
+    links.pop_back();
+}
+
+bool BodySync::isLinked(b2Body *body)
+{
+    return linkIndex.get(utPointerHashKey(body)) != NULL;
+}
+
+void BodySync::clear()
+{
+    links.clear();
+    linkIndex.clear();
+}
+
+void BodySync::snapshot()
+{
+    for (UTsize i = 0; i < links.size(); i++)
+    {
+        Link& l = links[i];
+
+        const b2Vec2& position = l.body->GetPosition();
+
+        l.prevX     = position.x;
+        l.prevY     = position.y;
+        l.prevAngle = l.body->GetAngle();
+    }
+}
+
+void BodySync::sync(float alpha)
+{
+    LOOM_PROFILE_SCOPE(box2dBodySync);
+
+    numSynced = 0;
+
+    bool interpolate = alpha < 1.0f;
+
+    for (UTsize i = 0; i < links.size(); i++)
+    {
+        Link& l = links[i];
+
+        const b2Vec2& position = l.body->GetPosition();
+
+        float x     = position.x;
+        float y     = position.y;
+        float angle = l.body->GetAngle();
+
+        if (interpolate)
+        {
+            x     = l.prevX + (x - l.prevX) * alpha;
+            y     = l.prevY + (y - l.prevY) * alpha;
+            angle = l.prevAngle + (angle - l.prevAngle) * alpha;
+        }
+
+        if (l.written && !l.body->IsAwake() && (x == l.lastX) && (y == l.lastY) && (angle == l.lastAngle))
+        {
+            continue;
+        }
+
+        write(l, x, y, angle);
+    }
+}
+
+void BodySync::syncStepper(WorldStepper *stepper)
+{
+    LOOM_PROFILE_SCOPE(box2dBodySync);
+
+    lmAssert(stepper && stepper->getWorld() == world, "BodySync.syncStepper needs a WorldStepper of the same World");
+
+    numSynced = 0;
+
+    float alpha = stepper->getAlpha();
+
+    for (UTsize i = 0; i < links.size(); i++)
+    {
+        Link& l = links[i];
+
+        const WorldStepper::Pose *pose = stepper->getPose(l.body);
+
+        if (!pose)
+        {
+            continue;
+        }
+
+        float x     = pose->prevX + (pose->x - pose->prevX) * alpha;
+        float y     = pose->prevY + (pose->y - pose->prevY) * alpha;
+        float angle = pose->prevAngle + (pose->angle - pose->prevAngle) * alpha;
+
+        if (l.written && (x == l.lastX) && (y == l.lastY) && (angle == l.lastAngle))
+        {
+            continue;
+        }
+
+        write(l, x, y, angle);
+    }
+}
+
+void BodySync::bodyDestroyed(b2Body *body)
+{
+    for (UTsize i = 0; i < sBodySyncs.size(); i++)
+    {
+        if (sBodySyncs[i]->world == body->GetWorld())
+        {
+            sBodySyncs[i]->unlink(body);
+        }
+    }
+}
+
+void BodySync::write(Link& l, float x, float y, float angle)
+{
+    l.target->setX(x * pixelsPerMeter + offsetX);
+    l.target->setY(y * pixelsPerMeter + offsetY);
+    l.target->setRotation(angle);
+
+    l.lastX     = x;
+    l.lastY     = y;
+    l.lastAngle = angle;
+    l.written   = true;
+
+    numSynced++;
+}
+
+class WorldQueryAABBCollector : public b2QueryCallback
+{
+public:
+
+    utArray<b2Fixture *> fixtures;
+
+    bool ReportFixture(b2Fixture *fixture)
+    {
+        fixtures.push_back(fixture);
+        return true;
+    }
+};
+
+class WorldQueryRayCollector : public b2RayCastCallback
+{
+public:
+
+    utArray<WorldQuery::RayHit> hits;
+
+    float32 ReportFixture(b2Fixture *fixture, const b2Vec2& point, const b2Vec2& normal, float32 fraction)
+    {
+        WorldQuery::RayHit hit = { fixture, point.x, point.y, normal.x, normal.y, fraction };
+        hits.push_back(hit);
+
+        // keep going to collect every hit along the ray
+        return 1.0f;
+    }
+};
+
+static int compareRayHits(const void *a, const void *b)
+{
+    float fa = ((const WorldQuery::RayHit *)a)->fraction;
+    float fb = ((const WorldQuery::RayHit *)b)->fraction;
+
+    return fa < fb ? -1 : (fa > fb ? 1 : 0);
+}
+
+WorldQuery::WorldQuery(b2World *_world)
+{
+    lmAssert(_world, "WorldQuery needs a World");
+
+    world = _world;
+
+    world->SetContactListener(&sContactListener);
+    world->SetDestructionListener(&sDestructionListener);
+
+    if (!sWorldQueriesMutex)
+    {
+        sWorldQueriesMutex = loom_mutex_create();
+    }
+
+    loom_mutex_lock(sWorldQueriesMutex);
+    sWorldQueries.push_back(this);
+    loom_mutex_unlock(sWorldQueriesMutex);
+}
+
+WorldQuery::~WorldQuery()
+{
+    loom_mutex_lock(sWorldQueriesMutex);
+    sWorldQueries.erase(this);
+    loom_mutex_unlock(sWorldQueriesMutex);
+}
+
+void WorldQuery::step(float32 timeStep, int32 velocityIterations, int32 positionIterations)
+{
+    clearContacts();
+    world->Step(timeStep, velocityIterations, positionIterations);
+}
+
+int WorldQuery::getBeginContacts(lua_State *L)
+{
+    lua_pushnumber(L, writeContacts(L, beginContacts, "getBeginContacts"));
+    return 1;
+}
+
+int WorldQuery::getEndContacts(lua_State *L)
+{
+    lua_pushnumber(L, writeContacts(L, endContacts, "getEndContacts"));
+    return 1;
+}
+
+int WorldQuery::queryAABB(lua_State *L)
+{
+    if (!lua_istable(L, 6))
+    {
+        return luaL_error(L, "WorldQuery.queryAABB: result Vector is null");
+    }
+
+    b2AABB aabb;
+
+    aabb.lowerBound.Set((float32)lua_tonumber(L, 2), (float32)lua_tonumber(L, 3));
+    aabb.upperBound.Set((float32)lua_tonumber(L, 4), (float32)lua_tonumber(L, 5));
+
+    WorldQueryAABBCollector collector;
+    world->QueryAABB(&collector, aabb);
+
+    int count = (int)collector.fixtures.size();
+
+    lua_rawgeti(L, 6, LSINDEXVECTOR);
+    int vectorTable = lua_gettop(L);
+
+    for (int i = 0; i < count; i++)
+    {
+        lualoom_pushnative<b2Fixture>(L, collector.fixtures[i]);
+        lua_rawseti(L, vectorTable, i);
+    }
+
+    lua_pop(L, 1);
+    lsr_vector_set_length(L, 6, count);
+
+    lua_pushnumber(L, count);
+    return 1;
+}
+
+int WorldQuery::rayCastAll(lua_State *L)
+{
+    if (!lua_istable(L, 6))
+    {
+        return luaL_error(L, "WorldQuery.rayCastAll: fixtures Vector is null");
+    }
+
+    b2Vec2 point1((float32)lua_tonumber(L, 2), (float32)lua_tonumber(L, 3));
+    b2Vec2 point2((float32)lua_tonumber(L, 4), (float32)lua_tonumber(L, 5));
+
+    WorldQueryRayCollector collector;
+
+    if ((point2 - point1).LengthSquared() > 0.0f)
+    {
+        world->RayCast(&collector, point1, point2);
+    }
+
+    // Box2D reports hits in no particular order
+    int count = (int)collector.hits.size();
+
+    if (count > 1)
+    {
+        qsort(collector.hits.ptr(), count, sizeof(RayHit), compareRayHits);
+    }
+
+    lua_rawgeti(L, 6, LSINDEXVECTOR);
+    int fixturesTable = lua_gettop(L);
+
+    for (int i = 0; i < count; i++)
+    {
+        lualoom_pushnative<b2Fixture>(L, collector.hits[i].fixture);
+        lua_rawseti(L, fixturesTable, i);
+    }
+
+    lua_pop(L, 1);
+    lsr_vector_set_length(L, 6, count);
+
+    if (!lua_isnoneornil(L, 7))
+    {
+        // x, y, normalX, normalY, fraction per hit
+        lua_rawgeti(L, 7, LSINDEXVECTOR);
+        int hitsTable = lua_gettop(L);
+
+        for (int i = 0; i < count; i++)
+        {
+            const RayHit& hit = collector.hits[i];
+
+            lua_pushnumber(L, hit.x);
+            lua_rawseti(L, hitsTable, i * 5);
+            lua_pushnumber(L, hit.y);
+            lua_rawseti(L, hitsTable, i * 5 + 1);
+            lua_pushnumber(L, hit.normalX);
+            lua_rawseti(L, hitsTable, i * 5 + 2);
+            lua_pushnumber(L, hit.normalY);
+            lua_rawseti(L, hitsTable, i * 5 + 3);
+            lua_pushnumber(L, hit.fraction);
+            lua_rawseti(L, hitsTable, i * 5 + 4);
+        }
+
+        lua_pop(L, 1);
+        lsr_vector_set_length(L, 7, count * 5);
+    }
+
+    lua_pushnumber(L, count);
+    return 1;
+}
+
+int WorldQuery::getBodies(lua_State *L)
+{
+    if (!lua_istable(L, 2))
+    {
+        return luaL_error(L, "WorldQuery.getBodies: fixtures Vector is null");
+    }
+
+    if (!lua_istable(L, 3))
+    {
+        return luaL_error(L, "WorldQuery.getBodies: result Vector is null");
+    }
+
+    int count = lsr_vector_get_length(L, 2);
+
+    lua_rawgeti(L, 2, LSINDEXVECTOR);
+    int fixturesTable = lua_gettop(L);
+
+    lua_rawgeti(L, 3, LSINDEXVECTOR);
+    int bodiesTable = lua_gettop(L);
+
+    for (int i = 0; i < count; i++)
+    {
+        lua_rawgeti(L, fixturesTable, i);
+        b2Fixture *fixture = lua_isnil(L, -1) ? NULL : (b2Fixture *)lualoom_getnativepointer(L, -1);
+        lua_pop(L, 1);
+
+        if (fixture)
+        {
+            lualoom_pushnative<b2Body>(L, fixture->GetBody());
+        }
+        else
+        {
+            lua_pushnil(L);
+        }
+
+        lua_rawseti(L, bodiesTable, i);
+    }
+
+    lua_pop(L, 2);
+    lsr_vector_set_length(L, 3, count);
+
+    lua_pushnumber(L, count);
+    return 1;
+}
+
+void WorldQuery::contactEvent(b2Contact *contact, bool begin)
+{
+    b2World *contactWorld = contact->GetFixtureA()->GetBody()->GetWorld();
+
+    loom_mutex_lock(sWorldQueriesMutex);
+
+    for (UTsize i = 0; i < sWorldQueries.size(); i++)
+    {
+        WorldQuery *query = sWorldQueries[i];
+
+        if (query->world != contactWorld)
+        {
+            continue;
+        }
+
+        ContactEvent e;
+        e.fixtureA = contact->GetFixtureA();
+        e.fixtureB = contact->GetFixtureB();
+        e.x        = e.y = 0.0f;
+        e.normalX  = e.normalY = 0.0f;
+
+        if (begin)
+        {
+            int pointCount = contact->GetManifold()->pointCount;
+
+            if (pointCount > 0)
+            {
+                b2WorldManifold manifold;
+                contact->GetWorldManifold(&manifold);
+
+                // average of the manifold points
+                b2Vec2 point = manifold.points[0];
+
+                if (pointCount > 1)
+                {
+                    point = 0.5f * (manifold.points[0] + manifold.points[1]);
+                }
+
+                e.x       = point.x;
+                e.y       = point.y;
+                e.normalX = manifold.normal.x;
+                e.normalY = manifold.normal.y;
+            }
+
+            query->beginContacts.push_back(e);
+        }
+        else
+        {
+            query->endContacts.push_back(e);
+        }
+    }
+
+    loom_mutex_unlock(sWorldQueriesMutex);
+}
+
+void WorldQuery::fixtureDestroyed(b2Fixture *fixture)
+{
+    purgeFixture(fixture->GetBody()->GetWorld(), fixture);
+}
+
+void WorldQuery::purgeFixture(b2World *fixtureWorld, b2Fixture *fixture)
+{
+    if (!sWorldQueriesMutex)
+    {
+        return;
+    }
+
+    loom_mutex_lock(sWorldQueriesMutex);
+
+    for (UTsize i = 0; i < sWorldQueries.size(); i++)
+    {
+        WorldQuery *query = sWorldQueries[i];
+
+        if (query->world == fixtureWorld)
+        {
+            purge(query->beginContacts, fixture);
+            purge(query->endContacts, fixture);
+        }
+    }
+
+    loom_mutex_unlock(sWorldQueriesMutex);
+}
+
+void WorldQuery::purge(utArray<ContactEvent>& events, b2Fixture *fixture)
+{
+    UTsize alive = 0;
+
+    for (UTsize i = 0; i < events.size(); i++)
+    {
+        if ((events[i].fixtureA == fixture) || (events[i].fixtureB == fixture))
+        {
+            continue;
+        }
+
+        events[alive++] = events[i];
+    }
+
+    events.resize(alive);
+}
+
+int WorldQuery::writeContacts(lua_State *L, utArray<ContactEvent>& events, const char *method)
+{
+    if (!lua_istable(L, 2))
+    {
+        return luaL_error(L, "WorldQuery.%s: fixtures Vector is null", method);
+    }
+
+    int count = (int)events.size();
+
+    lua_rawgeti(L, 2, LSINDEXVECTOR);
+    int fixturesTable = lua_gettop(L);
+
+    for (int i = 0; i < count; i++)
+    {
+        lualoom_pushnative<b2Fixture>(L, events[i].fixtureA);
+        lua_rawseti(L, fixturesTable, i * 2);
+        lualoom_pushnative<b2Fixture>(L, events[i].fixtureB);
+        lua_rawseti(L, fixturesTable, i * 2 + 1);
+    }
+
+    lua_pop(L, 1);
+    lsr_vector_set_length(L, 2, count * 2);
+
+    if (!lua_isnoneornil(L, 3))
+    {
+        lua_rawgeti(L, 3, LSINDEXVECTOR);
+        int pointsTable = lua_gettop(L);
+
+        for (int i = 0; i < count; i++)
+        {
+            const ContactEvent& e = events[i];
+
+            lua_pushnumber(L, e.x);
+            lua_rawseti(L, pointsTable, i * 4);
+            lua_pushnumber(L, e.y);
+            lua_rawseti(L, pointsTable, i * 4 + 1);
+            lua_pushnumber(L, e.normalX);
+            lua_rawseti(L, pointsTable, i * 4 + 2);
+            lua_pushnumber(L, e.normalY);
+            lua_rawseti(L, pointsTable, i * 4 + 3);
+        }
+
+        lua_pop(L, 1);
+        lsr_vector_set_length(L, 3, count * 4);
+    }
+
+    return count;
+}
+
+void WorldQuery::destroyFixture(b2Body *body, b2Fixture *fixture)
+{
+    b2World *fixtureWorld = body->GetWorld();
+
+    // DestroyFixture buffers end events for the fixture's contacts, so purge
+    // afterwards, matching on the pointer only as the fixture is freed by then
+    body->DestroyFixture(fixture);
+
+    purgeFixture(fixtureWorld, fixture);
+}
+
+void Box2DDestructionListener::SayGoodbye(b2Fixture *fixture)
+{
+    WorldQuery::fixtureDestroyed(fixture);
+}
+
+void BodySync::destroyWorldBody(b2World *world, b2Body *body)
+{
+    bodyDestroyed(body);
+    WorldStepper::bodyDestroyed(body);
+
+    world->DestroyBody(body);
+}
+
+void Box2DContactListener::BeginContact(b2Contact *contact)
+{
+    WorldQuery::contactEvent(contact, true);
+}
+
+void Box2DContactListener::EndContact(b2Contact *contact)
+{
+    WorldQuery::contactEvent(contact, false);
+}
+
 static int registerLoomBox2D(lua_State *L)
 {
     beginPackage(L, "loom.box2d")
@@ -460,7 +1107,7 @@ static int registerLoomBox2D(lua_State *L)
         .beginClass<b2Body>("Body")
 
             .addMethod("createFixture", (b2Fixture* (b2Body::*)(const b2FixtureDef*))&b2Body::CreateFixture)
-            .addMethod("destroyFixture", (void (b2Body::*)(b2Fixture*))&b2Body::DestroyFixture)
+            .addStaticMethod("_destroyFixture", &WorldQuery::destroyFixture)
             .addMethod("setTransform", &b2Body::SetTransform)
             //.addMethod("getTransform", &b2Body::GetTransform)
             .addMethod("getPosition", &b2Body::GetPosition)
@@ -554,7 +1201,7 @@ static int registerLoomBox2D(lua_State *L)
             .addConstructor<void (*)(b2Vec2&)>()
 
             .addMethod("createBody", &b2World::CreateBody)
-            .addMethod("destroyBody", &b2World::DestroyBody)
+            .addStaticMethod("_destroyBody", &BodySync::destroyWorldBody)
             .addMethod("getBodyCount", &b2World::GetBodyCount)
             .addMethod("getBodyList", (b2Body* (b2World::*)())&b2World::GetBodyList)
             .addMethod("createJoint", &b2World::CreateJoint)
@@ -579,6 +1226,80 @@ static int registerLoomBox2D(lua_State *L)
             .addMethod("dump", &b2World::Dump)
 
         .endClass()
+
+        .beginClass<BodySync>("BodySync")
+
+            .addConstructor<void (*)(void)>()
+
+            .addVar("pixelsPerMeter", &BodySync::pixelsPerMeter)
+            .addVar("offsetX", &BodySync::offsetX)
+            .addVar("offsetY", &BodySync::offsetY)
+
+            .addMethod("_initialize", &BodySync::initialize)
+            .addMethod("_link", &BodySync::link)
+            .addMethod("_unlink", &BodySync::unlink)
+            .addMethod("isLinked", &BodySync::isLinked)
+            .addMethod("_clear", &BodySync::clear)
+            .addMethod("getNumLinks", &BodySync::getNumLinks)
+            .addMethod("getNumSynced", &BodySync::getNumSynced)
+            .addMethod("snapshot", &BodySync::snapshot)
+            .addMethod("sync", &BodySync::sync)
+            .addMethod("syncStepper", &BodySync::syncStepper)
+
+        .endClass()
+
+        .beginClass<WorldQuery>("WorldQuery")
+
+            .addConstructor<void (*)(b2World *)>()
+
+            .addMethod("step", &WorldQuery::step)
+            .addMethod("clearContacts", &WorldQuery::clearContacts)
+            .addMethod("getNumBeginContacts", &WorldQuery::getNumBeginContacts)
+            .addMethod("getNumEndContacts", &WorldQuery::getNumEndContacts)
+            .addLuaFunction("getBeginContacts", &WorldQuery::getBeginContacts)
+            .addLuaFunction("getEndContacts", &WorldQuery::getEndContacts)
+            .addLuaFunction("queryAABB", &WorldQuery::queryAABB)
+            .addLuaFunction("rayCastAll", &WorldQuery::rayCastAll)
+            .addLuaFunction("getBodies", &WorldQuery::getBodies)
+
+        .endClass()
+
+        .beginClass<WorldStepper>("WorldStepper")
+
+            .addConstructor<void (*)(void)>()
+
+            .addVar("timeStep", &WorldStepper::timeStep)
+            .addVar("velocityIterations", &WorldStepper::velocityIterations)
+            .addVar("positionIterations", &WorldStepper::positionIterations)
+            .addVar("maxSteps", &WorldStepper::maxSteps)
+
+            .addProperty("threaded", &WorldStepper::getThreaded, &WorldStepper::setThreaded)
+            .addProperty("alpha", &WorldStepper::getAlpha)
+            .addProperty("stepCount", &WorldStepper::getStepCount)
+
+            .addMethod("_initialize", &WorldStepper::initialize)
+            .addMethod("_dispose", &WorldStepper::dispose)
+            .addMethod("_advance", &WorldStepper::advance)
+            .addMethod("finish", &WorldStepper::finish)
+            .addMethod("isBusy", &WorldStepper::isBusy)
+            .addMethod("getWorld", &WorldStepper::getWorld)
+            .addMethod("getNumCommands", &WorldStepper::getNumCommands)
+            .addMethod("getNumPoses", &WorldStepper::getNumPoses)
+
+            .addMethod("applyForce", &WorldStepper::applyForce)
+            .addMethod("applyForceToCenter", &WorldStepper::applyForceToCenter)
+            .addMethod("applyTorque", &WorldStepper::applyTorque)
+            .addMethod("applyLinearImpulse", &WorldStepper::applyLinearImpulse)
+            .addMethod("applyAngularImpulse", &WorldStepper::applyAngularImpulse)
+            .addMethod("setLinearVelocity", &WorldStepper::setLinearVelocity)
+            .addMethod("setAngularVelocity", &WorldStepper::setAngularVelocity)
+            .addMethod("setTransform", &WorldStepper::setTransform)
+            .addMethod("setAwake", &WorldStepper::setAwake)
+            .addMethod("_destroyBody", &WorldStepper::destroyBody)
+
+            .addVarAccessor("onBoundary", &WorldStepper::getBoundaryDelegate)
+
+        .endClass()
     
 /*        .beginClass<b2ShapeCache>("ShapeCache")
 
@@ -613,5 +1334,10 @@ void installLoomBox2D()
     LOOM_DECLARE_MANAGEDNATIVETYPE(b2Body, registerLoomBox2D);
     LOOM_DECLARE_MANAGEDNATIVETYPE(b2Joint, registerLoomBox2D);
     LOOM_DECLARE_MANAGEDNATIVETYPE(b2World, registerLoomBox2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(BodySync, registerLoomBox2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(WorldQuery, registerLoomBox2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(WorldStepper, registerLoomBox2D);
+
+    WorldStepper::destroyBodyFunction = &BodySync::destroyWorldBody;
     //LOOM_DECLARE_MANAGEDNATIVETYPE(b2ShapeCache, registerLoomBox2D);
 }
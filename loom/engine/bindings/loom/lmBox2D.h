@@ -0,0 +1,229 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/vendor/box2d/Box2D.h"
+
+struct lua_State;
+
+class WorldStepper;
+
+namespace Loom2D
+{
+class DisplayObject;
+}
+
+/**
+ * Links bodies to Loom2D display objects and copies the body transforms to
+ * them in a single native pass, so per frame syncing costs no script calls.
+ *
+ * Positions are scaled by pixelsPerMeter and offset, the angle maps to
+ * rotation. When snapshot() is called before stepping, sync() can
+ * interpolate between the previous and the current transforms. Worlds
+ * driven by a WorldStepper use syncStepper(), which reads its pose buffer
+ * instead of the bodies so it is safe while the world steps on a thread.
+ */
+class BodySync
+{
+public:
+
+    struct Link
+    {
+        b2Body                *body;
+        Loom2D::DisplayObject *target;
+
+        // transform recorded by snapshot(), in world units
+        float prevX, prevY, prevAngle;
+
+        // last values written to the target, sleeping bodies are skipped while they match
+        float lastX, lastY, lastAngle;
+        bool  written;
+    };
+
+    float pixelsPerMeter;
+    float offsetX;
+    float offsetY;
+
+    BodySync();
+    BodySync(b2World *_world);
+    ~BodySync();
+
+    void initialize(b2World *_world);
+
+    // replaces any previous link of the body
+    void link(b2Body *body, Loom2D::DisplayObject *target);
+
+    // moves the last link into the gap, so links change order
+    void unlink(b2Body *body);
+
+    bool isLinked(b2Body *body);
+
+    void clear();
+
+    int getNumLinks() const
+    {
+        return (int)links.size();
+    }
+
+    const Link& getLink(int index) const
+    {
+        return links[index];
+    }
+
+    int getNumSynced() const
+    {
+        return numSynced;
+    }
+
+    // records the current transforms as the start of the next interpolation
+    void snapshot();
+
+    // writes the transforms, alpha blends from the snapshot (0) to the current state (1)
+    void sync(float alpha);
+
+    // writes the poses of the stepper's last batch blended by its alpha, bodies
+    // created since that batch keep their previous values
+    void syncStepper(WorldStepper *stepper);
+
+    // unlinks a body that is about to be destroyed from every sync of its world
+    static void bodyDestroyed(b2Body *body);
+
+    // bound as World.destroyBody, Box2D has no destruction callback for bodies
+    // so everything that keeps body pointers forgets the body here first
+    static void destroyWorldBody(b2World *world, b2Body *body);
+
+private:
+
+    void construct();
+
+    void write(Link& l, float x, float y, float angle);
+
+    b2World *world;
+
+    utArray<Link> links;
+    utHashTable<utPointerHashKey, int> linkIndex;
+
+    int numSynced;
+};
+
+/**
+ * Answers AABB and ray queries and buffers contact events, handing the
+ * results to script in one call each instead of one call per element.
+ *
+ * Contacts that begin or end during World.step are recorded by a contact
+ * listener and kept until clearContacts (step clears them first).
+ */
+class WorldQuery
+{
+public:
+
+    struct ContactEvent
+    {
+        b2Fixture *fixtureA;
+        b2Fixture *fixtureB;
+
+        // world space contact point and normal (from A to B), begin events only
+        float x, y;
+        float normalX, normalY;
+    };
+
+    struct RayHit
+    {
+        b2Fixture *fixture;
+        float     x, y;
+        float     normalX, normalY;
+        float     fraction;
+    };
+
+    WorldQuery(b2World *_world);
+    ~WorldQuery();
+
+    // clears the contact buffers and steps the world
+    void step(float32 timeStep, int32 velocityIterations, int32 positionIterations);
+
+    void clearContacts()
+    {
+        beginContacts.clear(true);
+        endContacts.clear(true);
+    }
+
+    int getNumBeginContacts() const
+    {
+        return (int)beginContacts.size();
+    }
+
+    int getNumEndContacts() const
+    {
+        return (int)endContacts.size();
+    }
+
+    const ContactEvent& getBeginContact(int index) const
+    {
+        return beginContacts[index];
+    }
+
+    const ContactEvent& getEndContact(int index) const
+    {
+        return endContacts[index];
+    }
+
+    // (fixtures:Vector.<Fixture>, points:Vector.<Number> = null):int
+    int getBeginContacts(lua_State *L);
+
+    // (fixtures:Vector.<Fixture>):int
+    int getEndContacts(lua_State *L);
+
+    // (lowerX, lowerY, upperX, upperY, result:Vector.<Fixture>):int
+    int queryAABB(lua_State *L);
+
+    // (x1, y1, x2, y2, fixtures:Vector.<Fixture>, hits:Vector.<Number> = null):int
+    int rayCastAll(lua_State *L);
+
+    // (fixtures:Vector.<Fixture>, result:Vector.<Body>):int
+    int getBodies(lua_State *L);
+
+    static void contactEvent(b2Contact *contact, bool begin);
+
+    // drops the buffered events of a fixture that is being destroyed
+    static void fixtureDestroyed(b2Fixture *fixture);
+
+    // bound as Body.destroyFixture, b2Body::DestroyFixture ends the fixture's
+    // contacts but does not tell the destruction listener about the fixture
+    static void destroyFixture(b2Body *body, b2Fixture *fixture);
+
+private:
+
+    // drops a fixture's events from every query of a world, only compares the pointer
+    static void purgeFixture(b2World *fixtureWorld, b2Fixture *fixture);
+
+    // drops the events of a fixture that is being destroyed, keeping the order
+    static void purge(utArray<ContactEvent>& events, b2Fixture *fixture);
+
+    // fills the fixtures vector at 2 with A/B pairs and, if given, the
+    // vector at 3 with x, y, normalX, normalY per event
+    int writeContacts(lua_State *L, utArray<ContactEvent>& events, const char *method);
+
+    b2World *world;
+
+    utArray<ContactEvent> beginContacts;
+    utArray<ContactEvent> endContacts;
+};
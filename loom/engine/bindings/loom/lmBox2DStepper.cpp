@@ -0,0 +1,572 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/bindings/loom/lmBox2DStepper.h"
+#include "loom/common/core/assert.h"
+#include "loom/common/core/performance.h"
+
+utArray<WorldStepper *> WorldStepper::steppers;
+WorldStepper::DestroyBodyFunction WorldStepper::destroyBodyFunction = NULL;
+
+WorldStepper::WorldStepper()
+{
+    construct();
+}
+
+
+WorldStepper::WorldStepper(b2World *_world, float _timeStep)
+{
+    construct();
+    initialize(_world, _timeStep);
+}
+
+
+void WorldStepper::construct()
+{
+    world              = NULL;
+    timeStep           = 1.0f / 60.0f;
+    velocityIterations = 8;
+    positionIterations = 3;
+    maxSteps           = 8;
+
+    accumulator = 0.0f;
+    alpha       = 1.0f;
+    stepCount   = 0;
+    batchSteps  = 0;
+    batchAlpha  = 1.0f;
+    pending     = false;
+    running     = false;
+    threaded    = false;
+    quit        = false;
+    tearingDown = false;
+    inBoundary  = false;
+
+    boundaryCallback = NULL;
+    boundaryPayload  = NULL;
+
+    front = &buffers[0];
+    back  = &buffers[1];
+
+    worker         = NULL;
+    startSemaphore = NULL;
+    doneSemaphore  = NULL;
+
+    steppers.push_back(this);
+}
+
+
+WorldStepper::~WorldStepper()
+{
+    // collected by the GC, script must not be called back from here
+    tearingDown = true;
+
+    stopWorker();
+
+    steppers.erase(this);
+}
+
+
+void WorldStepper::initialize(b2World *_world, float _timeStep)
+{
+    lmAssert(_world, "WorldStepper needs a World");
+    lmAssert(!world, "WorldStepper already has a World");
+    lmAssert(_timeStep > 0.0f, "WorldStepper needs a positive time step");
+
+    world    = _world;
+    timeStep = _timeStep;
+}
+
+
+void WorldStepper::dispose()
+{
+    stopWorker();
+    finish();
+
+    boundaryCommands.clear(true);
+    commands.clear(true);
+
+    for (int i = 0; i < 2; i++)
+    {
+        buffers[i].poses.clear(true);
+        buffers[i].index.clear(true);
+    }
+
+    world = NULL;
+}
+
+
+void WorldStepper::setThreaded(bool value)
+{
+    if (value == threaded)
+    {
+        return;
+    }
+
+    finish();
+
+    if (!value)
+    {
+        stopWorker();
+    }
+
+    threaded = value;
+}
+
+
+int WorldStepper::advance(float dt)
+{
+    LOOM_PROFILE_SCOPE(box2dWorldStepper);
+
+    lmAssert(world, "WorldStepper has no World, it was disposed or never initialized");
+
+    // the boundary, the world is idle from here until the next batch starts
+    if (pending)
+    {
+        completeBatch();
+    }
+
+    applyCommands();
+
+    accumulator += dt;
+
+    int steps = 0;
+
+    while (accumulator >= timeStep && steps < maxSteps)
+    {
+        accumulator -= timeStep;
+        steps++;
+    }
+
+    // too far behind, drop whole steps rather than spiral
+    if (accumulator >= timeStep)
+    {
+        accumulator -= timeStep * floorf(accumulator / timeStep);
+    }
+
+    batchSteps = steps;
+    batchAlpha = accumulator / timeStep;
+    pending    = true;
+
+    if (!threaded)
+    {
+        runBatch();
+        completeBatch();
+        return steps;
+    }
+
+    // a batch without steps has nothing to run, it completes at the next boundary
+    if (steps > 0)
+    {
+        startWorker();
+
+        running = true;
+        loom_semaphore_post(startSemaphore);
+    }
+
+    return steps;
+}
+
+
+void WorldStepper::finish()
+{
+    if (pending)
+    {
+        completeBatch();
+    }
+}
+
+
+void WorldStepper::queue(int type, b2Body *body, float x, float y, float z, float w)
+{
+    lmAssert(body, "WorldStepper command needs a body");
+    lmAssert(body->GetWorld() == world, "WorldStepper command given a body of another World");
+
+    Command c;
+    c.type = type;
+    c.body = body;
+    c.x    = x;
+    c.y    = y;
+    c.z    = z;
+    c.w    = w;
+
+    if (inBoundary)
+    {
+        boundaryCommands.push_back(c);
+    }
+    else
+    {
+        commands.push_back(c);
+    }
+}
+
+
+void WorldStepper::applyForce(b2Body *body, float forceX, float forceY, float pointX, float pointY)
+{
+    queue(COMMAND_APPLY_FORCE, body, forceX, forceY, pointX, pointY);
+}
+
+
+void WorldStepper::applyForceToCenter(b2Body *body, float forceX, float forceY)
+{
+    queue(COMMAND_APPLY_FORCE_TO_CENTER, body, forceX, forceY, 0.0f, 0.0f);
+}
+
+
+void WorldStepper::applyTorque(b2Body *body, float torque)
+{
+    queue(COMMAND_APPLY_TORQUE, body, torque, 0.0f, 0.0f, 0.0f);
+}
+
+
+void WorldStepper::applyLinearImpulse(b2Body *body, float impulseX, float impulseY, float pointX, float pointY)
+{
+    queue(COMMAND_APPLY_LINEAR_IMPULSE, body, impulseX, impulseY, pointX, pointY);
+}
+
+
+void WorldStepper::applyAngularImpulse(b2Body *body, float impulse)
+{
+    queue(COMMAND_APPLY_ANGULAR_IMPULSE, body, impulse, 0.0f, 0.0f, 0.0f);
+}
+
+
+void WorldStepper::setLinearVelocity(b2Body *body, float x, float y)
+{
+    queue(COMMAND_SET_LINEAR_VELOCITY, body, x, y, 0.0f, 0.0f);
+}
+
+
+void WorldStepper::setAngularVelocity(b2Body *body, float omega)
+{
+    queue(COMMAND_SET_ANGULAR_VELOCITY, body, omega, 0.0f, 0.0f, 0.0f);
+}
+
+
+void WorldStepper::setTransform(b2Body *body, float x, float y, float angle)
+{
+    queue(COMMAND_SET_TRANSFORM, body, x, y, angle, 0.0f);
+}
+
+
+void WorldStepper::setAwake(b2Body *body, bool awake)
+{
+    queue(COMMAND_SET_AWAKE, body, awake ? 1.0f : 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+
+void WorldStepper::destroyBody(b2Body *body)
+{
+    queue(COMMAND_DESTROY_BODY, body, 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+
+void WorldStepper::applyCommands()
+{
+    lmAssert(!running, "WorldStepper applying commands while the world is stepping");
+
+    // when threaded, the boundary that queued boundaryCommands fired after the
+    // frame queued commands, apply them in the order an unthreaded world sees
+    applyCommands(boundaryCommands);
+    applyCommands(commands);
+}
+
+
+void WorldStepper::applyCommands(utArray<Command>& queued)
+{
+    for (UTsize i = 0; i < queued.size(); i++)
+    {
+        const Command& c = queued[i];
+
+        b2Body *body = c.body;
+
+        if (!body)
+        {
+            continue;
+        }
+
+        switch (c.type)
+        {
+        case COMMAND_APPLY_FORCE:
+            body->ApplyForce(b2Vec2(c.x, c.y), b2Vec2(c.z, c.w), true);
+            break;
+
+        case COMMAND_APPLY_FORCE_TO_CENTER:
+            body->ApplyForceToCenter(b2Vec2(c.x, c.y), true);
+            break;
+
+        case COMMAND_APPLY_TORQUE:
+            body->ApplyTorque(c.x, true);
+            break;
+
+        case COMMAND_APPLY_LINEAR_IMPULSE:
+            body->ApplyLinearImpulse(b2Vec2(c.x, c.y), b2Vec2(c.z, c.w), true);
+            break;
+
+        case COMMAND_APPLY_ANGULAR_IMPULSE:
+            body->ApplyAngularImpulse(c.x, true);
+            break;
+
+        case COMMAND_SET_LINEAR_VELOCITY:
+            body->SetLinearVelocity(b2Vec2(c.x, c.y));
+            break;
+
+        case COMMAND_SET_ANGULAR_VELOCITY:
+            body->SetAngularVelocity(c.x);
+            break;
+
+        case COMMAND_SET_TRANSFORM:
+            body->SetTransform(b2Vec2(c.x, c.y), c.z);
+            break;
+
+        case COMMAND_SET_AWAKE:
+            body->SetAwake(c.x != 0.0f);
+            break;
+
+        case COMMAND_DESTROY_BODY:
+            forgetBody(body);
+
+            if (destroyBodyFunction)
+            {
+                destroyBodyFunction(world, body);
+            }
+            else
+            {
+                world->DestroyBody(body);
+            }
+            break;
+        }
+    }
+
+    queued.clear(true);
+}
+
+
+void WorldStepper::runBatch()
+{
+    for (int i = 0; i < batchSteps; i++)
+    {
+        if (i == batchSteps - 1)
+        {
+            recordPoses(true);
+        }
+
+        world->Step(timeStep, velocityIterations, positionIterations);
+    }
+
+    if (batchSteps > 0)
+    {
+        recordPoses(false);
+    }
+}
+
+
+void WorldStepper::recordPoses(bool previous)
+{
+    // bodies are only created and destroyed at boundaries, so the list
+    // keeps its order between the two passes of a batch
+    if (previous)
+    {
+        back->poses.clear(true);
+        back->index.clear(true);
+
+        for (b2Body *body = world->GetBodyList(); body; body = body->GetNext())
+        {
+            const b2Vec2& position = body->GetPosition();
+
+            Pose p;
+            p.body      = body;
+            p.prevX     = p.x = position.x;
+            p.prevY     = p.y = position.y;
+            p.prevAngle = p.angle = body->GetAngle();
+
+            back->index.insert(utPointerHashKey(body), (int)back->poses.size());
+            back->poses.push_back(p);
+        }
+
+        return;
+    }
+
+    UTsize i = 0;
+
+    for (b2Body *body = world->GetBodyList(); body; body = body->GetNext(), i++)
+    {
+        lmAssert(i < back->poses.size() && back->poses[i].body == body, "WorldStepper body list changed during a batch");
+
+        Pose& p = back->poses[i];
+
+        const b2Vec2& position = body->GetPosition();
+
+        p.x     = position.x;
+        p.y     = position.y;
+        p.angle = body->GetAngle();
+    }
+}
+
+
+void WorldStepper::completeBatch()
+{
+    if (running)
+    {
+        loom_semaphore_wait(doneSemaphore);
+        running = false;
+    }
+
+    pending = false;
+    alpha   = batchAlpha;
+
+    if (batchSteps == 0)
+    {
+        return;
+    }
+
+    PoseBuffer *swap = front;
+    front = back;
+    back  = swap;
+
+    stepCount += batchSteps;
+
+    if (tearingDown)
+    {
+        return;
+    }
+
+    inBoundary = true;
+
+    if (boundaryCallback)
+    {
+        boundaryCallback(this, batchSteps, boundaryPayload);
+    }
+
+    if (_BoundaryDelegate.getCount() > 0)
+    {
+        _BoundaryDelegate.pushArgument(batchSteps);
+        _BoundaryDelegate.invoke();
+    }
+
+    inBoundary = false;
+}
+
+
+const WorldStepper::Pose *WorldStepper::getPose(b2Body *body)
+{
+    int *index = front->index.get(utPointerHashKey(body));
+
+    return index ? &front->poses[*index] : NULL;
+}
+
+
+void WorldStepper::forgetBody(b2Body *body)
+{
+    forgetBody(boundaryCommands, body);
+    forgetBody(commands, body);
+
+    // the address may be reused by a body created before the next batch
+    int *index = front->index.get(utPointerHashKey(body));
+
+    if (index)
+    {
+        front->poses[*index].body = NULL;
+        front->index.remove(utPointerHashKey(body));
+    }
+}
+
+
+void WorldStepper::forgetBody(utArray<Command>& queued, b2Body *body)
+{
+    for (UTsize i = 0; i < queued.size(); i++)
+    {
+        if (queued[i].body == body)
+        {
+            queued[i].body = NULL;
+        }
+    }
+}
+
+
+void WorldStepper::bodyDestroyed(b2Body *body)
+{
+    for (UTsize i = 0; i < steppers.size(); i++)
+    {
+        if (steppers[i]->world == body->GetWorld())
+        {
+            steppers[i]->forgetBody(body);
+        }
+    }
+}
+
+
+void WorldStepper::startWorker()
+{
+    if (worker)
+    {
+        return;
+    }
+
+    quit           = false;
+    startSemaphore = loom_semaphore_create();
+    doneSemaphore  = loom_semaphore_create();
+    worker         = loom_thread_start(workerMain, this);
+}
+
+
+void WorldStepper::stopWorker()
+{
+    if (!worker)
+    {
+        return;
+    }
+
+    finish();
+
+    quit = true;
+    loom_semaphore_post(startSemaphore);
+    loom_thread_join(worker);
+
+    loom_semaphore_destroy(startSemaphore);
+    loom_semaphore_destroy(doneSemaphore);
+
+    worker         = NULL;
+    startSemaphore = NULL;
+    doneSemaphore  = NULL;
+}
+
+
+int __stdcall WorldStepper::workerMain(void *param)
+{
+    WorldStepper *stepper = (WorldStepper *)param;
+
+    loom_thread_setDebugName("WorldStepper");
+
+    for ( ; ; )
+    {
+        loom_semaphore_wait(stepper->startSemaphore);
+
+        if (stepper->quit)
+        {
+            break;
+        }
+
+        stepper->runBatch();
+
+        loom_semaphore_post(stepper->doneSemaphore);
+    }
+
+    return 0;
+}
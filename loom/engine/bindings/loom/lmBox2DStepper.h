@@ -0,0 +1,254 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/script/native/lsNativeDelegate.h"
+#include "loom/vendor/box2d/Box2D.h"
+
+/**
+ * Steps a b2World at a fixed timestep, optionally on a worker thread.
+ *
+ * advance() accumulates frame time and runs as many fixed steps as fit in
+ * it as one batch. Between batches (the step boundary) the world is idle on
+ * the main thread: queued commands are applied, bodies may be created and
+ * destroyed and the Boundary delegate fires. Every batch records the body
+ * transforms before and after its last step into a pose buffer, renderers
+ * read the front buffer and blend the two with getAlpha().
+ *
+ * When threaded, a batch runs on the worker while the main thread renders
+ * the previous one, so the displayed state lags one frame behind. Batches,
+ * command order and step boundaries are the same in both modes, so a world
+ * follows the same trajectory whether it is threaded or not. Commands queued
+ * while Boundary fires are applied before those queued by the frame after it,
+ * even though the threaded boundary only fires at the next advance().
+ */
+class WorldStepper
+{
+public:
+
+    enum CommandType
+    {
+        COMMAND_APPLY_FORCE,
+        COMMAND_APPLY_FORCE_TO_CENTER,
+        COMMAND_APPLY_TORQUE,
+        COMMAND_APPLY_LINEAR_IMPULSE,
+        COMMAND_APPLY_ANGULAR_IMPULSE,
+        COMMAND_SET_LINEAR_VELOCITY,
+        COMMAND_SET_ANGULAR_VELOCITY,
+        COMMAND_SET_TRANSFORM,
+        COMMAND_SET_AWAKE,
+        COMMAND_DESTROY_BODY
+    };
+
+    struct Command
+    {
+        int    type;
+
+        // NULL once the body was destroyed, skipped when applied
+        b2Body *body;
+
+        float  x, y, z, w;
+    };
+
+    struct Pose
+    {
+        b2Body *body;
+
+        // transform before and after the last step of the batch
+        float  prevX, prevY, prevAngle;
+        float  x, y, angle;
+    };
+
+    float timeStep;
+    int   velocityIterations;
+    int   positionIterations;
+
+    // the most steps a single advance runs, the rest of the time is dropped
+    int   maxSteps;
+
+    // script constructs with no World and calls initialize
+    WorldStepper();
+    WorldStepper(b2World *_world, float _timeStep);
+    ~WorldStepper();
+
+    void initialize(b2World *_world, float _timeStep);
+
+    // stops the worker and lets go of the World, the stepper can't be used after
+    void dispose();
+
+    bool getThreaded() const
+    {
+        return threaded;
+    }
+
+    // switching modes waits for a running batch first
+    void setThreaded(bool value);
+
+    // runs the steps that fit in the accumulated time, returns how many were started
+    int advance(float dt);
+
+    // waits for the running batch, the world is then safe to touch until the next advance
+    void finish();
+
+    bool isBusy() const
+    {
+        return running;
+    }
+
+    // interpolation fraction between the poses of the front buffer
+    float getAlpha() const
+    {
+        return alpha;
+    }
+
+    int getStepCount() const
+    {
+        return stepCount;
+    }
+
+    b2World *getWorld() const
+    {
+        return world;
+    }
+
+    // commands are queued and applied to the world at the next step boundary
+    void applyForce(b2Body *body, float forceX, float forceY, float pointX, float pointY);
+    void applyForceToCenter(b2Body *body, float forceX, float forceY);
+    void applyTorque(b2Body *body, float torque);
+    void applyLinearImpulse(b2Body *body, float impulseX, float impulseY, float pointX, float pointY);
+    void applyAngularImpulse(b2Body *body, float impulse);
+    void setLinearVelocity(b2Body *body, float x, float y);
+    void setAngularVelocity(b2Body *body, float omega);
+    void setTransform(b2Body *body, float x, float y, float angle);
+    void setAwake(b2Body *body, bool awake);
+    void destroyBody(b2Body *body);
+
+    int getNumCommands() const
+    {
+        return (int)(boundaryCommands.size() + commands.size());
+    }
+
+    // the front buffer, NULL for bodies that did not exist when the last batch ran
+    const Pose *getPose(b2Body *body);
+
+    int getNumPoses() const
+    {
+        return (int)front->poses.size();
+    }
+
+    // poses in body list order, the body is NULL once destroyed
+    const Pose *getPoseAt(int index) const
+    {
+        return &front->poses[index];
+    }
+
+    // called on the main thread with the number of steps of each finished batch,
+    // the world is idle while it runs
+    LOOM_DELEGATE(Boundary);
+
+    // called right before Boundary, for native users of the stepper
+    typedef void (*BoundaryCallback)(WorldStepper *stepper, int steps, void *payload);
+
+    void setBoundaryCallback(BoundaryCallback callback, void *payload)
+    {
+        boundaryCallback = callback;
+        boundaryPayload  = payload;
+    }
+
+    // forgets a body that is about to be destroyed, called by World.destroyBody
+    static void bodyDestroyed(b2Body *body);
+
+    // destroys the body of a queued destroyBody command, set by the Box2D
+    // bindings so their helpers forget the body too
+    typedef void (*DestroyBodyFunction)(b2World *world, b2Body *body);
+    static DestroyBodyFunction destroyBodyFunction;
+
+private:
+
+    struct PoseBuffer
+    {
+        utArray<Pose> poses;
+        utHashTable<utPointerHashKey, int> index;
+    };
+
+    void construct();
+
+    void queue(int type, b2Body *body, float x, float y, float z, float w);
+
+    void applyCommands();
+    void applyCommands(utArray<Command>& queued);
+
+    // drops queued commands and the front pose of a body being destroyed
+    void forgetBody(b2Body *body);
+    static void forgetBody(utArray<Command>& queued, b2Body *body);
+
+    // runs a batch, on the worker when threaded
+    void runBatch();
+
+    void recordPoses(bool previous);
+
+    // swaps the pose buffers of the finished batch and fires Boundary
+    void completeBatch();
+
+    void startWorker();
+    void stopWorker();
+
+    static int __stdcall workerMain(void *param);
+
+    b2World *world;
+
+    float accumulator;
+    float alpha;
+    int   stepCount;
+
+    // the batch handed to runBatch and the alpha it will be displayed with
+    int   batchSteps;
+    float batchAlpha;
+    bool  pending;
+    bool  running;
+
+    bool threaded;
+    bool quit;
+
+    // set while destroyed, Boundary is not fired then
+    bool tearingDown;
+
+    // set while Boundary fires, commands queued then go to boundaryCommands
+    bool inBoundary;
+
+    BoundaryCallback boundaryCallback;
+    void             *boundaryPayload;
+
+    utArray<Command> boundaryCommands;
+    utArray<Command> commands;
+
+    PoseBuffer buffers[2];
+    PoseBuffer *front;
+    PoseBuffer *back;
+
+    ThreadHandle    worker;
+    SemaphoreHandle startSemaphore;
+    SemaphoreHandle doneSemaphore;
+
+    static utArray<WorldStepper *> steppers;
+};
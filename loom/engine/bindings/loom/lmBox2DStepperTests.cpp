@@ -0,0 +1,334 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include "loom/engine/bindings/loom/lmBox2DStepper.h"
+#include "loom/common/utils/utRandom.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(box2dStepper)
+{
+    SEATEST_FIXTURE_ENTRY(box2dStepper_fixedSteps);
+    SEATEST_FIXTURE_ENTRY(box2dStepper_commands);
+    SEATEST_FIXTURE_ENTRY(box2dStepper_boundaryCommands);
+    SEATEST_FIXTURE_ENTRY(box2dStepper_threadedMatchesSync);
+    SEATEST_FIXTURE_ENTRY(box2dStepper_dispose);
+}
+
+static b2Body *createBox(b2World *world, float x, float y, float halfWidth, float halfHeight, bool dynamic)
+{
+    b2BodyDef bodyDef;
+    bodyDef.type = dynamic ? b2_dynamicBody : b2_staticBody;
+    bodyDef.position.Set(x, y);
+
+    b2PolygonShape shape;
+    shape.SetAsBox(halfWidth, halfHeight);
+
+    b2Body *body = world->CreateBody(&bodyDef);
+    body->CreateFixture(&shape, 1.0f);
+
+    return body;
+}
+
+static b2Body *createBall(b2World *world, float x, float y, float radius)
+{
+    b2BodyDef bodyDef;
+    bodyDef.type = b2_dynamicBody;
+    bodyDef.position.Set(x, y);
+
+    b2CircleShape shape;
+    shape.m_radius = radius;
+
+    b2FixtureDef fixtureDef;
+    fixtureDef.shape       = &shape;
+    fixtureDef.density     = 1.0f;
+    fixtureDef.restitution = 0.5f;
+
+    b2Body *body = world->CreateBody(&bodyDef);
+    body->CreateFixture(&fixtureDef);
+
+    return body;
+}
+
+// ground, a stack of boxes and a few balls
+static void createScene(b2World *world, utArray<b2Body *>& bodies)
+{
+    createBox(world, 0.0f, 0.0f, 20.0f, 0.5f, false);
+
+    for (int i = 0; i < 12; i++)
+    {
+        bodies.push_back(createBox(world, (i % 3) * 1.1f - 1.1f, 1.0f + (i / 3) * 1.05f, 0.5f, 0.5f, true));
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        bodies.push_back(createBall(world, -6.0f + i * 2.0f, 8.0f + i * 0.5f, 0.4f));
+    }
+}
+
+// kicks the first body at every boundary, the frames push the same body so
+// the result depends on boundary commands being applied first
+static void kickAtBoundary(WorldStepper *stepper, int steps, void *payload)
+{
+    utArray<b2Body *> *bodies = (utArray<b2Body *> *)payload;
+
+    stepper->setLinearVelocity((*bodies)[0], steps * 0.5f - 1.0f, 4.0f);
+}
+
+// drives a scene with seeded frame times and commands, recording the front
+// poses every time a batch completes (a frame later when threaded)
+static void runScene(bool threaded, UTuint32 seed, int frames, utArray<float>& trajectory)
+{
+    b2World      world(b2Vec2(0.0f, -10.0f));
+    WorldStepper stepper(&world, 1.0f / 60.0f);
+
+    stepper.setThreaded(threaded);
+
+    utArray<b2Body *> bodies;
+    createScene(&world, bodies);
+
+    stepper.setBoundaryCallback(kickAtBoundary, &bodies);
+
+    utRandomNumberGenerator random(seed);
+
+    int lastStepCount = 0;
+
+    for (int frame = 0; frame <= frames; frame++)
+    {
+        if (frame == frames)
+        {
+            stepper.finish();
+        }
+        else
+        {
+            stepper.advance(random.randRange(0.008f, 0.04f));
+        }
+
+        if (stepper.getStepCount() != lastStepCount)
+        {
+            lastStepCount = stepper.getStepCount();
+
+            trajectory.push_back((float)lastStepCount);
+            trajectory.push_back(stepper.getAlpha());
+
+            for (int i = 0; i < stepper.getNumPoses(); i++)
+            {
+                const WorldStepper::Pose *pose = stepper.getPoseAt(i);
+
+                trajectory.push_back(pose->prevX);
+                trajectory.push_back(pose->prevY);
+                trajectory.push_back(pose->prevAngle);
+                trajectory.push_back(pose->x);
+                trajectory.push_back(pose->y);
+                trajectory.push_back(pose->angle);
+            }
+        }
+
+        if (frame == frames)
+        {
+            break;
+        }
+
+        // the world may be stepping, so nothing here reads it
+        stepper.applyForceToCenter(bodies[random.randRangeInt(0, (int)bodies.size() - 1)],
+                                   random.randRange(-100.0f, 100.0f), random.randRange(0.0f, 300.0f));
+        stepper.applyLinearImpulse(bodies[0], random.randRange(-2.0f, 2.0f), 0.0f, 0.0f, 0.0f);
+
+        if (frame % 25 == 24)
+        {
+            stepper.applyTorque(bodies[random.randRangeInt(0, (int)bodies.size() - 1)], random.randRange(-20.0f, 20.0f));
+        }
+
+        if ((frame % 40 == 39) && (bodies.size() > 4))
+        {
+            // the first body is kicked at every boundary, keep it
+            int index = random.randRangeInt(1, (int)bodies.size() - 1);
+
+            stepper.destroyBody(bodies[index]);
+            bodies.erase(bodies[index]);
+        }
+
+        // bodies are created at a boundary, once the running batch finished
+        if (frame % 50 == 49)
+        {
+            stepper.finish();
+            bodies.push_back(createBall(&world, random.randRange(-4.0f, 4.0f), 12.0f, 0.3f));
+        }
+    }
+
+    // the final state, read straight from the bodies
+    for (UTsize i = 0; i < bodies.size(); i++)
+    {
+        trajectory.push_back(bodies[i]->GetPosition().x);
+        trajectory.push_back(bodies[i]->GetPosition().y);
+        trajectory.push_back(bodies[i]->GetAngle());
+    }
+}
+
+SEATEST_TEST(box2dStepper_fixedSteps)
+{
+    b2World      world(b2Vec2(0.0f, -10.0f));
+    WorldStepper stepper(&world, 0.01f);
+
+    b2Body *ball = createBall(&world, 0.0f, 10.0f, 0.5f);
+
+    assert_int_equal(0, stepper.advance(0.005f));
+    assert_int_equal(0, stepper.getStepCount());
+    assert_true(stepper.getPose(ball) == NULL);
+
+    assert_int_equal(1, stepper.advance(0.0075f));
+    assert_int_equal(1, stepper.getStepCount());
+    assert_float_equal(0.25f, stepper.getAlpha(), 0.001f);
+
+    const WorldStepper::Pose *pose = stepper.getPose(ball);
+    assert_true(pose != NULL);
+    assert_float_equal(10.0f, pose->prevY, 0.0f);
+    assert_float_equal(ball->GetPosition().y, pose->y, 0.0f);
+    assert_true(pose->y < pose->prevY);
+
+    // a long frame is capped at maxSteps
+    stepper.maxSteps = 4;
+    assert_int_equal(4, stepper.advance(1.0f));
+    assert_int_equal(5, stepper.getStepCount());
+    assert_true(stepper.getAlpha() < 1.0f);
+}
+
+SEATEST_TEST(box2dStepper_commands)
+{
+    b2World      world(b2Vec2(0.0f, 0.0f));
+    WorldStepper stepper(&world, 0.01f);
+
+    b2Body *ball  = createBall(&world, 0.0f, 0.0f, 0.5f);
+    b2Body *other = createBall(&world, 5.0f, 0.0f, 0.5f);
+
+    // queued, not applied until the next boundary
+    stepper.setLinearVelocity(ball, 1.0f, 0.0f);
+    stepper.setTransform(other, 5.0f, 3.0f, 0.0f);
+    assert_int_equal(2, stepper.getNumCommands());
+    assert_float_equal(0.0f, ball->GetLinearVelocity().x, 0.0f);
+
+    stepper.advance(0.01f);
+    assert_int_equal(0, stepper.getNumCommands());
+    assert_float_equal(1.0f, ball->GetLinearVelocity().x, 0.0f);
+    assert_float_equal(3.0f, other->GetPosition().y, 0.0f);
+    assert_float_equal(0.01f, ball->GetPosition().x, 0.0001f);
+
+    // commands queued after a destroy of the same body are dropped
+    stepper.destroyBody(other);
+    stepper.applyForceToCenter(other, 1.0f, 1.0f);
+    stepper.advance(0.01f);
+    assert_int_equal(1, world.GetBodyCount());
+    assert_true(stepper.getPose(other) == NULL);
+    assert_true(stepper.getPose(ball) != NULL);
+}
+
+static void slowAtBoundary(WorldStepper *stepper, int steps, void *payload)
+{
+    stepper->setLinearVelocity((b2Body *)payload, 1.0f, 0.0f);
+}
+
+SEATEST_TEST(box2dStepper_boundaryCommands)
+{
+    for (int threaded = 0; threaded < 2; threaded++)
+    {
+        b2World      world(b2Vec2(0.0f, 0.0f));
+        WorldStepper stepper(&world, 0.01f);
+
+        b2Body *ball = createBall(&world, 0.0f, 0.0f, 0.5f);
+
+        stepper.setThreaded(threaded != 0);
+        stepper.setBoundaryCallback(slowAtBoundary, ball);
+
+        // the frame's command comes after the boundary's, even though the
+        // threaded boundary only fires in the next advance
+        stepper.advance(0.01f);
+        stepper.setLinearVelocity(ball, 2.0f, 0.0f);
+        stepper.advance(0.01f);
+        stepper.finish();
+
+        assert_float_equal(2.0f, ball->GetLinearVelocity().x, 0.0f);
+    }
+}
+
+SEATEST_TEST(box2dStepper_threadedMatchesSync)
+{
+    utArray<float> syncTrajectory;
+    utArray<float> threadedTrajectory;
+
+    runScene(false, 1234, 300, syncTrajectory);
+    runScene(true, 1234, 300, threadedTrajectory);
+
+    assert_true(syncTrajectory.size() > 0);
+    assert_int_equal((int)syncTrajectory.size(), (int)threadedTrajectory.size());
+
+    int mismatches = 0;
+
+    for (UTsize i = 0; i < syncTrajectory.size() && i < threadedTrajectory.size(); i++)
+    {
+        if (syncTrajectory[i] != threadedTrajectory[i])
+        {
+            mismatches++;
+        }
+    }
+
+    assert_int_equal(0, mismatches);
+
+    // and a different seed takes a different path
+    utArray<float> otherTrajectory;
+    runScene(false, 4321, 300, otherTrajectory);
+
+    bool differs = otherTrajectory.size() != syncTrajectory.size();
+
+    for (UTsize i = 0; !differs && i < syncTrajectory.size(); i++)
+    {
+        differs = syncTrajectory[i] != otherTrajectory[i];
+    }
+
+    assert_true(differs);
+}
+
+SEATEST_TEST(box2dStepper_dispose)
+{
+    b2World world(b2Vec2(0.0f, -10.0f));
+
+    utArray<b2Body *> bodies;
+    createScene(&world, bodies);
+
+    // disposing waits for the running batch before letting go of the world
+    WorldStepper stepper(&world, 1.0f / 60.0f);
+    stepper.setThreaded(true);
+    stepper.applyForceToCenter(bodies[0], 0.0f, 100.0f);
+    assert_int_equal(2, stepper.advance(0.04f));
+    stepper.applyForceToCenter(bodies[0], 0.0f, 100.0f);
+
+    stepper.dispose();
+    assert_false(stepper.isBusy());
+    assert_int_equal(0, stepper.getNumCommands());
+    assert_int_equal(0, stepper.getNumPoses());
+    assert_true(stepper.getWorld() == NULL);
+
+    // destroying a stepper mid batch stops the worker first
+    WorldStepper *other = new WorldStepper(&world, 1.0f / 60.0f);
+    other->setThreaded(true);
+    other->advance(0.1f);
+    delete other;
+
+    world.Step(1.0f / 60.0f, 8, 3);
+}
@@ -0,0 +1,257 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/engine/bindings/loom/lmBox2D.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(box2dWorldQuery)
+{
+    SEATEST_FIXTURE_ENTRY(box2dWorldQuery_bufferContacts);
+    SEATEST_FIXTURE_ENTRY(box2dWorldQuery_destroyFixture);
+    SEATEST_FIXTURE_ENTRY(box2dWorldQuery_destroyBody);
+    SEATEST_FIXTURE_ENTRY(box2dWorldQuery_bodySyncUnlink);
+    SEATEST_FIXTURE_ENTRY(box2dWorldQuery_bodySyncDestroyBody);
+    SEATEST_FIXTURE_ENTRY(box2dWorldQuery_bodySyncSleeping);
+}
+
+static b2Fixture *createDisc(b2World *world, float x, float y)
+{
+    b2BodyDef bodyDef;
+    bodyDef.type = b2_dynamicBody;
+    bodyDef.position.Set(x, y);
+
+    b2CircleShape shape;
+    shape.m_radius = 1.0f;
+
+    return world->CreateBody(&bodyDef)->CreateFixture(&shape, 1.0f);
+}
+
+static bool eventsReference(const WorldQuery& query, b2Fixture *fixture)
+{
+    for (int i = 0; i < query.getNumBeginContacts(); i++)
+    {
+        const WorldQuery::ContactEvent& e = query.getBeginContact(i);
+
+        if ((e.fixtureA == fixture) || (e.fixtureB == fixture))
+        {
+            return true;
+        }
+    }
+
+    for (int i = 0; i < query.getNumEndContacts(); i++)
+    {
+        const WorldQuery::ContactEvent& e = query.getEndContact(i);
+
+        if ((e.fixtureA == fixture) || (e.fixtureB == fixture))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+SEATEST_TEST(box2dWorldQuery_bufferContacts)
+{
+    b2World    world(b2Vec2(0.0f, 0.0f));
+    WorldQuery query(&world);
+
+    b2Fixture *a = createDisc(&world, 0.0f, 0.0f);
+    b2Fixture *b = createDisc(&world, 1.5f, 0.0f);
+
+    createDisc(&world, 10.0f, 0.0f);
+
+    query.step(1.0f / 60.0f, 8, 3);
+
+    assert_int_equal(1, query.getNumBeginContacts());
+    assert_int_equal(0, query.getNumEndContacts());
+    assert_true(eventsReference(query, a));
+    assert_true(eventsReference(query, b));
+
+    // the next step starts with empty buffers
+    query.step(1.0f / 60.0f, 8, 3);
+    assert_int_equal(0, query.getNumBeginContacts());
+}
+
+SEATEST_TEST(box2dWorldQuery_destroyFixture)
+{
+    b2World    world(b2Vec2(0.0f, 0.0f));
+    WorldQuery query(&world);
+
+    b2Fixture *a = createDisc(&world, 0.0f, 0.0f);
+    b2Fixture *b = createDisc(&world, 1.5f, 0.0f);
+    b2Fixture *c = createDisc(&world, 20.0f, 0.0f);
+    b2Fixture *d = createDisc(&world, 21.5f, 0.0f);
+
+    query.step(1.0f / 60.0f, 8, 3);
+    assert_int_equal(2, query.getNumBeginContacts());
+
+    // destroying a touching fixture ends its contact, neither the buffered
+    // begin event nor the new end event may keep pointing at it
+    WorldQuery::destroyFixture(a->GetBody(), a);
+
+    assert_false(eventsReference(query, a));
+    assert_int_equal(1, query.getNumBeginContacts());
+    assert_int_equal(0, query.getNumEndContacts());
+    assert_true(eventsReference(query, c));
+    assert_true(eventsReference(query, d));
+    assert_true(b->GetBody()->GetFixtureList() == b);
+}
+
+SEATEST_TEST(box2dWorldQuery_destroyBody)
+{
+    b2World    world(b2Vec2(0.0f, 0.0f));
+    WorldQuery query(&world);
+
+    b2Fixture *a = createDisc(&world, 0.0f, 0.0f);
+    createDisc(&world, 1.5f, 0.0f);
+
+    query.step(1.0f / 60.0f, 8, 3);
+    assert_int_equal(1, query.getNumBeginContacts());
+
+    // destroying the body reports its fixtures to the destruction listener
+    world.DestroyBody(a->GetBody());
+
+    assert_false(eventsReference(query, a));
+    assert_int_equal(0, query.getNumBeginContacts());
+    assert_int_equal(0, query.getNumEndContacts());
+}
+
+// every link's target shows its own body
+static bool linksMatchTargets(BodySync& sync)
+{
+    for (int i = 0; i < sync.getNumLinks(); i++)
+    {
+        const BodySync::Link& l = sync.getLink(i);
+
+        if (l.target->getX() != l.body->GetPosition().x * sync.pixelsPerMeter)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+SEATEST_TEST(box2dWorldQuery_bodySyncUnlink)
+{
+    b2World  world(b2Vec2(0.0f, 0.0f));
+    BodySync sync(&world);
+
+    b2Body                *bodies[4];
+    Loom2D::DisplayObject targets[4];
+
+    for (int i = 0; i < 4; i++)
+    {
+        bodies[i] = createDisc(&world, i * 10.0f, 0.0f)->GetBody();
+        sync.link(bodies[i], &targets[i]);
+    }
+
+    // unlinking from the middle moves the last link into the gap
+    sync.unlink(bodies[1]);
+    assert_int_equal(3, sync.getNumLinks());
+    assert_false(sync.isLinked(bodies[1]));
+    assert_true(sync.getLink(1).body == bodies[3]);
+
+    // the moved link is still found by its body
+    sync.unlink(bodies[3]);
+    assert_int_equal(2, sync.getNumLinks());
+    assert_false(sync.isLinked(bodies[3]));
+    assert_true(sync.isLinked(bodies[0]));
+    assert_true(sync.isLinked(bodies[2]));
+
+    // relinking replaces the link in place
+    Loom2D::DisplayObject other;
+    sync.link(bodies[2], &other);
+    assert_int_equal(2, sync.getNumLinks());
+
+    targets[1].setX(-1.0f);
+    targets[2].setX(-1.0f);
+    targets[3].setX(-1.0f);
+
+    sync.sync(1.0f);
+    assert_int_equal(2, sync.getNumSynced());
+    assert_true(linksMatchTargets(sync));
+    assert_float_equal(20.0f * sync.pixelsPerMeter, other.getX(), 0.0f);
+    assert_float_equal(-1.0f, targets[1].getX(), 0.0f);
+    assert_float_equal(-1.0f, targets[2].getX(), 0.0f);
+    assert_float_equal(-1.0f, targets[3].getX(), 0.0f);
+}
+
+SEATEST_TEST(box2dWorldQuery_bodySyncDestroyBody)
+{
+    b2World  world(b2Vec2(0.0f, 0.0f));
+    BodySync sync(&world);
+
+    b2Body                *bodies[3];
+    Loom2D::DisplayObject targets[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        bodies[i] = createDisc(&world, i * 10.0f, 0.0f)->GetBody();
+        sync.link(bodies[i], &targets[i]);
+    }
+
+    // World.destroyBody drops the link before the body is freed
+    BodySync::destroyWorldBody(&world, bodies[0]);
+    assert_int_equal(2, world.GetBodyCount());
+    assert_int_equal(2, sync.getNumLinks());
+    assert_false(sync.isLinked(bodies[0]));
+
+    sync.sync(1.0f);
+    assert_int_equal(2, sync.getNumSynced());
+    assert_true(linksMatchTargets(sync));
+}
+
+SEATEST_TEST(box2dWorldQuery_bodySyncSleeping)
+{
+    b2World  world(b2Vec2(0.0f, 0.0f));
+    BodySync sync(&world);
+
+    b2Body                *body = createDisc(&world, 1.0f, 2.0f)->GetBody();
+    Loom2D::DisplayObject target;
+
+    sync.link(body, &target);
+
+    sync.sync(1.0f);
+    assert_int_equal(1, sync.getNumSynced());
+
+    // awake bodies are written every time
+    sync.sync(1.0f);
+    assert_int_equal(1, sync.getNumSynced());
+
+    // asleep and unchanged, the target is left alone
+    body->SetAwake(false);
+    target.setX(123.0f);
+
+    sync.sync(1.0f);
+    assert_int_equal(0, sync.getNumSynced());
+    assert_float_equal(123.0f, target.getX(), 0.0f);
+
+    // moved while asleep, written again
+    body->SetTransform(b2Vec2(3.0f, 2.0f), 0.0f);
+    assert_false(body->IsAwake());
+
+    sync.sync(1.0f);
+    assert_int_equal(1, sync.getNumSynced());
+    assert_float_equal(3.0f * sync.pixelsPerMeter, target.getX(), 0.0f);
+}
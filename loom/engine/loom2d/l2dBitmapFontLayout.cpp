@@ -0,0 +1,689 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/engine/loom2d/l2dBitmapFontLayout.h"
+#include "loom/engine/loom2d/l2dQuadBatch.h"
+#include "loom/graphics/gfxTexture.h"
+#include "loom/common/core/log.h"
+#include "loom/common/core/performance.h"
+
+lmDefineLogGroup(gBitmapFontLogGroup, "loom2d.bitmapfont", 1, LoomLogInfo);
+
+namespace Loom2D
+{
+static const int CHAR_SPACE           = 32;
+static const int CHAR_TAB             = 9;
+static const int CHAR_NEWLINE         = 10;
+static const int CHAR_CARRIAGE_RETURN = 13;
+
+utArray<BitmapFontLayout::CharLocation> BitmapFontLayout::sLineChars;
+utArray<int> BitmapFontLayout::sLineStarts;
+
+// alignment offsets are whole units like the script implementation, clamp
+// before truncating so unbounded boxes (Number.MAX_VALUE) stay well defined
+static int truncateOffset(float value)
+{
+    if (value != value)
+    {
+        return 0;
+    }
+
+    if (value > 1e9f)
+    {
+        return 1000000000;
+    }
+
+    if (value < -1e9f)
+    {
+        return -1000000000;
+    }
+
+    return (int)value;
+}
+
+static UThash hashBytes(UThash hash, const void *data, int length)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    for (int i = 0; i < length; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+BitmapFontLayout::BitmapFontLayout()
+{
+    size       = 14.0f;
+    lineHeight = 14.0f;
+    textureID  = -1;
+    useCounter = 0;
+    current    = NULL;
+
+    measuredWidth  = 0.0f;
+    measuredHeight = 0.0f;
+
+    for (int i = 0; i < 256; i++)
+    {
+        asciiGlyphs[i] = -1;
+    }
+}
+
+BitmapFontLayout::~BitmapFontLayout()
+{
+    invalidate();
+}
+
+void BitmapFontLayout::setSize(float value)
+{
+    if (size == value)
+    {
+        return;
+    }
+
+    size = value;
+    invalidate();
+}
+
+void BitmapFontLayout::setLineHeight(float value)
+{
+    if (lineHeight == value)
+    {
+        return;
+    }
+
+    lineHeight = value;
+    invalidate();
+}
+
+void BitmapFontLayout::addGlyph(int id, float x, float y, float width, float height, float xOffset, float yOffset, float xAdvance)
+{
+    Glyph glyph;
+
+    glyph.id       = id;
+    glyph.x        = x;
+    glyph.y        = y;
+    glyph.width    = width;
+    glyph.height   = height;
+    glyph.xOffset  = xOffset;
+    glyph.yOffset  = yOffset;
+    glyph.xAdvance = xAdvance;
+
+    const Glyph *existing = getGlyph(id);
+
+    if (existing)
+    {
+        glyphs[(UTsize)(existing - glyphs.ptr())] = glyph;
+    }
+    else
+    {
+        int index = (int)glyphs.size();
+        glyphs.push_back(glyph);
+
+        if ((id >= 0) && (id < 256))
+        {
+            asciiGlyphs[id] = index;
+        }
+        else
+        {
+            glyphLookup.insert(utIntHashKey(id), index);
+        }
+    }
+
+    invalidate();
+}
+
+void BitmapFontLayout::addKerning(int first, int second, float amount)
+{
+    // pairs are packed into one key, which covers the basic multilingual plane
+    if ((first < 0) || (first > 0xFFFF) || (second < 0) || (second > 0xFFFF))
+    {
+        return;
+    }
+
+    utIntHashKey key((first << 16) | second);
+
+    if (kernings.get(key))
+    {
+        kernings.set(key, amount);
+    }
+    else
+    {
+        kernings.insert(key, amount);
+    }
+
+    invalidate();
+}
+
+float BitmapFontLayout::getKerning(int first, int second) const
+{
+    if ((first < 0) || (first > 0xFFFF) || (second < 0) || (second > 0xFFFF) || kernings.empty())
+    {
+        return 0.0f;
+    }
+
+    UTsize index = kernings.find(utIntHashKey((first << 16) | second));
+
+    return index == UT_NPOS ? 0.0f : kernings.at(index);
+}
+
+const BitmapFontLayout::Glyph *BitmapFontLayout::getGlyph(int id) const
+{
+    int index = -1;
+
+    if ((id >= 0) && (id < 256))
+    {
+        index = asciiGlyphs[id];
+    }
+    else
+    {
+        UTsize found = glyphLookup.find(utIntHashKey(id));
+
+        if (found != UT_NPOS)
+        {
+            index = glyphLookup.at(found);
+        }
+    }
+
+    return index == -1 ? NULL : &glyphs[index];
+}
+
+int BitmapFontLayout::parseHAlign(const char *align)
+{
+    if (align && !strcmp(align, "left"))
+    {
+        return HALIGN_LEFT;
+    }
+
+    if (align && !strcmp(align, "right"))
+    {
+        return HALIGN_RIGHT;
+    }
+
+    return HALIGN_CENTER;
+}
+
+int BitmapFontLayout::parseVAlign(const char *align)
+{
+    if (align && !strcmp(align, "top"))
+    {
+        return VALIGN_TOP;
+    }
+
+    if (align && !strcmp(align, "bottom"))
+    {
+        return VALIGN_BOTTOM;
+    }
+
+    return VALIGN_CENTER;
+}
+
+void BitmapFontLayout::invalidate()
+{
+    for (UTsize i = 0; i < arrangements.size(); i++)
+    {
+        lmDelete(NULL, arrangements.at(i));
+    }
+
+    arrangements.clear();
+    current = NULL;
+}
+
+BitmapFontLayout::Arrangement *BitmapFontLayout::arrange(float width, float height, const char *text, float fontSize,
+                                                         int hAlign, int vAlign, bool autoScale, bool kerning)
+{
+    if (!text || !text[0])
+    {
+        return NULL;
+    }
+
+    int length = (int)strlen(text);
+
+    UThash hash = hashBytes(2166136261u, text, length);
+    hash = hashBytes(hash, &width, sizeof(width));
+    hash = hashBytes(hash, &height, sizeof(height));
+    hash = hashBytes(hash, &fontSize, sizeof(fontSize));
+
+    int flags = hAlign | (vAlign << 2) | (autoScale ? 16 : 0) | (kerning ? 32 : 0);
+    hash = hashBytes(hash, &flags, sizeof(flags));
+
+    utIntHashKey key((UTint32)hash);
+    Arrangement **found = arrangements.get(key);
+    Arrangement *a = found ? *found : NULL;
+
+    if (a && (a->width == width) && (a->height == height) && (a->fontSize == fontSize) &&
+        (a->hAlign == hAlign) && (a->vAlign == vAlign) && (a->autoScale == autoScale) &&
+        (a->kerning == kerning) && (a->text.size() == (utString::size_type)length) &&
+        !memcmp(a->text.c_str(), text, length))
+    {
+        a->lastUsed = ++useCounter;
+        return a;
+    }
+
+    if (!a)
+    {
+        if ((int)arrangements.size() >= MAX_CACHED_LAYOUTS)
+        {
+            // evict the least recently used arrangement
+            UTsize oldest = 0;
+
+            for (UTsize i = 1; i < arrangements.size(); i++)
+            {
+                if (arrangements.at(i)->lastUsed < arrangements.at(oldest)->lastUsed)
+                {
+                    oldest = i;
+                }
+            }
+
+            Arrangement *evicted = arrangements.at(oldest);
+
+            if (evicted == current)
+            {
+                current = NULL;
+            }
+
+            arrangements.erase(utIntHashKey((UTint32)evicted->hash));
+            lmDelete(NULL, evicted);
+        }
+
+        a = lmNew(NULL) Arrangement;
+        arrangements.insert(key, a);
+    }
+
+    // a hash collision reuses the entry in place
+    a->text      = text;
+    a->hash      = hash;
+    a->width     = width;
+    a->height    = height;
+    a->fontSize  = fontSize;
+    a->hAlign    = hAlign;
+    a->vAlign    = vAlign;
+    a->autoScale = autoScale;
+    a->kerning   = kerning;
+    a->lastUsed  = ++useCounter;
+
+    arrangeChars(a);
+
+    return a;
+}
+
+void BitmapFontLayout::arrangeChars(Arrangement *a)
+{
+    LOOM_PROFILE_SCOPE(bitmapFontArrange);
+
+    const char *text = a->text.c_str();
+    int numChars = (int)a->text.size();
+
+    // lines are stored back to back in sLineChars, each as a start/end pair
+    utArray<CharLocation>& lineChars = sLineChars;
+    utArray<int>& lines = sLineStarts;
+
+    lineChars.clear(true);
+    lines.clear(true);
+
+    a->chars.clear(true);
+
+    float fontSize = a->fontSize;
+
+    // enforce sanity of font size
+    if (fontSize < 0)
+    {
+        fontSize *= -size;
+    }
+
+    bool finished = false;
+    float containerWidth = 0.0f;
+    float containerHeight = 0.0f;
+    float scale = 1.0f;
+
+    float currentX = 0.0f;
+    float currentY = 0.0f;
+
+    int sanity = 60;
+
+    while (!finished)
+    {
+        scale = fontSize / size;
+        containerWidth  = a->width / scale;
+        containerHeight = a->height / scale;
+
+        lineChars.clear(true);
+        lines.clear(true);
+
+        if ((lineHeight * scale <= containerHeight) || !a->autoScale)
+        {
+            int lastWhiteSpace = -1;
+            int lastWhiteSpaceChar = -1;
+            int lastCharID = -1;
+            int lineStart = 0;
+
+            currentX = 0.0f;
+            currentY = 0.0f;
+
+            for (int i = 0; i < numChars; i++)
+            {
+                bool lineFull = false;
+                int charStart = i;
+                int charID = (unsigned char)text[i];
+
+                // two byte UTF8 sequences cover Latin-1, other alphabets are not supported
+                if ((i < numChars - 1) && ((charID == 0xC2) || (charID == 0xC3)))
+                {
+                    int nextChar = (unsigned char)text[++i];
+
+                    // C2 means the next byte is used as-is, C3 needs an additional bit set
+                    charID = (charID == 0xC3) ? (nextChar | 0x40) : nextChar;
+                }
+
+                const Glyph *glyph = getGlyph(charID);
+
+                if ((charID == CHAR_NEWLINE) || (charID == CHAR_CARRIAGE_RETURN))
+                {
+                    lineFull = true;
+                }
+                else if (!glyph)
+                {
+                    lmLogWarn(gBitmapFontLogGroup, "Missing character: %d", charID);
+                }
+                else
+                {
+                    if ((charID == CHAR_SPACE) || (charID == CHAR_TAB))
+                    {
+                        lastWhiteSpace = i;
+                        lastWhiteSpaceChar = (int)lineChars.size();
+                    }
+
+                    if (a->kerning)
+                    {
+                        currentX += getKerning(lastCharID, charID);
+                    }
+
+                    CharLocation location;
+                    location.glyph = (int)(glyph - glyphs.ptr());
+                    location.x     = currentX + glyph->xOffset;
+                    location.y     = currentY + glyph->yOffset;
+                    lineChars.push_back(location);
+
+                    currentX  += glyph->xAdvance;
+                    lastCharID = charID;
+
+                    if (location.x + glyph->width > containerWidth)
+                    {
+                        // remove the overflowing word and add it again on the next line,
+                        // or just this char if the line has no whitespace to break at
+                        if (lastWhiteSpace == -1)
+                        {
+                            lineChars.pop_back();
+                            i = charStart - 1;
+                        }
+                        else
+                        {
+                            lineChars.resize(lastWhiteSpaceChar + 1);
+                            i = lastWhiteSpace;
+                        }
+
+                        if ((int)lineChars.size() == lineStart)
+                        {
+                            break;
+                        }
+
+                        lineFull = true;
+                    }
+                }
+
+                if (i == numChars - 1)
+                {
+                    lines.push_back(lineStart);
+                    lines.push_back((int)lineChars.size());
+                    finished = true;
+                }
+                else if (lineFull)
+                {
+                    // autosized text always goes on one line for now
+                    if (a->autoScale)
+                    {
+                        break;
+                    }
+
+                    // drop the whitespace the line was broken at
+                    if ((lastWhiteSpace == i) && ((int)lineChars.size() > lineStart))
+                    {
+                        lineChars.pop_back();
+                    }
+
+                    lines.push_back(lineStart);
+                    lines.push_back((int)lineChars.size());
+
+                    lineStart      = (int)lineChars.size();
+                    currentX       = 0.0f;
+                    currentY      += lineHeight;
+                    lastWhiteSpace = -1;
+                    lastCharID     = -1;
+                }
+            }
+        }
+
+        if (sanity-- < 0)
+        {
+            lmLogWarn(gBitmapFontLogGroup, "Failed to lay out text %s after many tries.", text);
+            break;
+        }
+
+        if (a->autoScale && !finished)
+        {
+            fontSize -= 1;
+            lines.clear(true);
+        }
+        else
+        {
+            finished = true;
+        }
+    }
+
+    float bottom = currentY + lineHeight;
+    int yOffset = 0;
+
+    if (a->vAlign == VALIGN_BOTTOM)
+    {
+        yOffset = truncateOffset(containerHeight - bottom);
+    }
+    else if (a->vAlign == VALIGN_CENTER)
+    {
+        yOffset = truncateOffset((containerHeight - bottom) / 2);
+    }
+
+    for (UTsize line = 0; line + 1 < lines.size(); line += 2)
+    {
+        int start = lines[line];
+        int end = lines[line + 1];
+
+        if (end <= start)
+        {
+            continue;
+        }
+
+        const CharLocation& last = lineChars[end - 1];
+        const Glyph& lastGlyph = glyphs[last.glyph];
+        float right = last.x - lastGlyph.xOffset + lastGlyph.xAdvance;
+        int xOffset = 0;
+
+        if (a->hAlign == HALIGN_RIGHT)
+        {
+            xOffset = truncateOffset(containerWidth - right);
+        }
+        else if (a->hAlign == HALIGN_CENTER)
+        {
+            xOffset = truncateOffset((containerWidth - right) / 2);
+        }
+
+        for (int c = start; c < end; c++)
+        {
+            const CharLocation& location = lineChars[c];
+            const Glyph& glyph = glyphs[location.glyph];
+
+            if ((glyph.width <= 0) || (glyph.height <= 0))
+            {
+                continue;
+            }
+
+            CharLocation placed;
+            placed.glyph = location.glyph;
+            placed.x     = scale * (location.x + xOffset);
+            placed.y     = scale * (location.y + yOffset);
+            a->chars.push_back(placed);
+        }
+    }
+
+    a->scale = scale;
+}
+
+int BitmapFontLayout::fillQuadBatch(QuadBatch *quadBatch, float width, float height, const char *text,
+                                    float fontSize, unsigned int color, const char *hAlign, const char *vAlign,
+                                    bool autoScale, bool kerning)
+{
+    LOOM_PROFILE_SCOPE(bitmapFontFillQuadBatch);
+
+    if (!quadBatch)
+    {
+        return 0;
+    }
+
+    Arrangement *a = arrange(width, height, text, fontSize, parseHAlign(hAlign), parseVAlign(vAlign), autoScale, kerning);
+
+    if (!a || (a->chars.size() == 0))
+    {
+        return 0;
+    }
+
+    int numChars = (int)a->chars.size();
+
+    lmAssert(numChars <= MAX_CHARS, "Bitmap Font text is limited to %d characters.", MAX_CHARS);
+
+    GFX::TextureInfo *tinfo = GFX::Texture::getTextureInfo(textureID);
+
+    if (!tinfo || (tinfo->width <= 0) || (tinfo->height <= 0))
+    {
+        return 0;
+    }
+
+    float invWidth  = 1.0f / tinfo->width;
+    float invHeight = 1.0f / tinfo->height;
+    float scale     = a->scale;
+
+    // script color is 0xRRGGBB, vertices are ABGR
+    unsigned int abgr = 0xFF000000 | ((color & 0xFF) << 16) | (color & 0xFF00) | ((color >> 16) & 0xFF);
+
+    quadBatch->nativeTextureID = textureID;
+
+    GFX::VertexPosColorTex *v = quadBatch->addQuads(numChars);
+
+    for (int i = 0; i < numChars; i++)
+    {
+        const CharLocation& location = a->chars[i];
+        const Glyph& glyph = glyphs[location.glyph];
+
+        float x0 = location.x;
+        float y0 = location.y;
+        float x1 = x0 + glyph.width * scale;
+        float y1 = y0 + glyph.height * scale;
+
+        float u0 = glyph.x * invWidth;
+        float v0 = glyph.y * invHeight;
+        float u1 = (glyph.x + glyph.width) * invWidth;
+        float v1 = (glyph.y + glyph.height) * invHeight;
+
+        v[0].x = x0; v[0].y = y0; v[0].z = 0.0f; v[0].abgr = abgr; v[0].u = u0; v[0].v = v0;
+        v[1].x = x1; v[1].y = y0; v[1].z = 0.0f; v[1].abgr = abgr; v[1].u = u1; v[1].v = v0;
+        v[2].x = x0; v[2].y = y1; v[2].z = 0.0f; v[2].abgr = abgr; v[2].u = u0; v[2].v = v1;
+        v[3].x = x1; v[3].y = y1; v[3].z = 0.0f; v[3].abgr = abgr; v[3].u = u1; v[3].v = v1;
+
+        v += 4;
+    }
+
+    return numChars;
+}
+
+int BitmapFontLayout::layout(float width, float height, const char *text, float fontSize,
+                             const char *hAlign, const char *vAlign, bool autoScale, bool kerning)
+{
+    current = arrange(width, height, text, fontSize, parseHAlign(hAlign), parseVAlign(vAlign), autoScale, kerning);
+
+    return current ? (int)current->chars.size() : 0;
+}
+
+int BitmapFontLayout::getLayoutCharID(int index) const
+{
+    lmAssert(current && (index >= 0) && (index < (int)current->chars.size()), "BitmapFontLayout index %d out of range", index);
+    return glyphs[current->chars[index].glyph].id;
+}
+
+float BitmapFontLayout::getLayoutX(int index) const
+{
+    lmAssert(current && (index >= 0) && (index < (int)current->chars.size()), "BitmapFontLayout index %d out of range", index);
+    return current->chars[index].x;
+}
+
+float BitmapFontLayout::getLayoutY(int index) const
+{
+    lmAssert(current && (index >= 0) && (index < (int)current->chars.size()), "BitmapFontLayout index %d out of range", index);
+    return current->chars[index].y;
+}
+
+void BitmapFontLayout::measure(const char *text, float maxWidth, float maxHeight, float fontSize)
+{
+    measuredWidth  = 0.0f;
+    measuredHeight = 0.0f;
+
+    Arrangement *a = arrange(maxWidth, maxHeight, text, fontSize, HALIGN_LEFT, VALIGN_TOP, false, true);
+
+    if (!a || (a->chars.size() == 0))
+    {
+        return;
+    }
+
+    float maxX = 0.0f;
+    float maxY = 0.0f;
+
+    for (UTsize i = 0; i < a->chars.size(); i++)
+    {
+        const CharLocation& location = a->chars[i];
+        const Glyph& glyph = glyphs[location.glyph];
+
+        float right  = location.x + glyph.width * a->scale;
+        float bottom = location.y + glyph.height * a->scale;
+
+        if (right > maxX)
+        {
+            maxX = right;
+        }
+
+        if (bottom > maxY)
+        {
+            maxY = bottom;
+        }
+    }
+
+    measuredWidth  = maxX + 1;
+    measuredHeight = maxY + 1;
+}
+}
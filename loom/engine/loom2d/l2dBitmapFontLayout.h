@@ -0,0 +1,168 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utString.h"
+#include "loom/common/utils/utTypes.h"
+
+namespace Loom2D
+{
+class QuadBatch;
+
+// Native side of the BitmapFont script class: glyph metrics, kerning,
+// text arrangement and quad generation. Arrangements are cached per
+// (text, size, box, alignment, flags) so unchanged labels skip layout.
+class BitmapFontLayout
+{
+public:
+
+    // the most arrangements kept per font before the least recently
+    // used one is evicted
+    static const int MAX_CACHED_LAYOUTS = 128;
+
+    // script BitmapFont rejects longer text, keep the same limit
+    static const int MAX_CHARS = 8192;
+
+    enum HAlign
+    {
+        HALIGN_LEFT,
+        HALIGN_CENTER,
+        HALIGN_RIGHT
+    };
+
+    enum VAlign
+    {
+        VALIGN_TOP,
+        VALIGN_CENTER,
+        VALIGN_BOTTOM
+    };
+
+    struct Glyph
+    {
+        int   id;
+        // region in font texture pixels
+        float x, y, width, height;
+        float xOffset, yOffset, xAdvance;
+    };
+
+    struct CharLocation
+    {
+        int   glyph;
+        float x, y;
+    };
+
+    struct Arrangement
+    {
+        utString text;
+        UThash   hash;
+        float    width, height, fontSize;
+        int      hAlign, vAlign;
+        bool     autoScale, kerning;
+
+        float    scale;
+        utArray<CharLocation> chars;
+
+        unsigned int lastUsed;
+    };
+
+    BitmapFontLayout();
+    ~BitmapFontLayout();
+
+    // font metrics, any change drops the cached arrangements
+    float getSize() const { return size; }
+    void setSize(float value);
+
+    float getLineHeight() const { return lineHeight; }
+    void setLineHeight(float value);
+
+    int getTextureID() const { return textureID; }
+    void setTextureID(int value) { textureID = value; }
+
+    void addGlyph(int id, float x, float y, float width, float height, float xOffset, float yOffset, float xAdvance);
+
+    // kerning applied when 'second' directly follows 'first'
+    void addKerning(int first, int second, float amount);
+
+    float getKerning(int first, int second) const;
+
+    // arranges text and appends one quad per visible char to the batch,
+    // returns the number of quads added
+    int fillQuadBatch(QuadBatch *quadBatch, float width, float height, const char *text,
+                      float fontSize, unsigned int color, const char *hAlign, const char *vAlign,
+                      bool autoScale, bool kerning);
+
+    // arranges text and keeps the result for the accessors below
+    int layout(float width, float height, const char *text, float fontSize,
+               const char *hAlign, const char *vAlign, bool autoScale, bool kerning);
+
+    int getLayoutCharID(int index) const;
+    float getLayoutX(int index) const;
+    float getLayoutY(int index) const;
+    float getLayoutScale() const { return current ? current->scale : 1.0f; }
+
+    // measures text on a left/top aligned canvas without auto scaling
+    void measure(const char *text, float maxWidth, float maxHeight, float fontSize);
+
+    float getMeasuredWidth() const { return measuredWidth; }
+    float getMeasuredHeight() const { return measuredHeight; }
+
+    // drops all cached arrangements
+    void invalidate();
+
+    static int parseHAlign(const char *align);
+    static int parseVAlign(const char *align);
+
+private:
+
+    const Glyph *getGlyph(int id) const;
+
+    // finds or builds the arrangement for the given parameters
+    Arrangement *arrange(float width, float height, const char *text, float fontSize,
+                         int hAlign, int vAlign, bool autoScale, bool kerning);
+
+    void arrangeChars(Arrangement *a);
+
+    float size;
+    float lineHeight;
+    int   textureID;
+
+    utArray<Glyph> glyphs;
+
+    // direct lookup for the 8 bit range, hashed lookup above it
+    int asciiGlyphs[256];
+    utHashTable<utIntHashKey, int> glyphLookup;
+
+    utHashTable<utIntHashKey, float> kernings;
+
+    utHashTable<utIntHashKey, Arrangement *> arrangements;
+    unsigned int useCounter;
+
+    // the arrangement read by the layout accessors
+    Arrangement *current;
+
+    float measuredWidth;
+    float measuredHeight;
+
+    // scratch buffers shared by all fonts, layout only runs on the main thread
+    static utArray<CharLocation> sLineChars;
+    static utArray<int> sLineStarts;
+};
+}
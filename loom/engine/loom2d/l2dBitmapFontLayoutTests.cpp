@@ -0,0 +1,211 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+
+#include "loom/engine/loom2d/l2dBitmapFontLayout.h"
+#include "seatest.h"
+
+using namespace Loom2D;
+
+SEATEST_FIXTURE(bitmapFontLayout)
+{
+    SEATEST_FIXTURE_ENTRY(bitmapFontLayout_wrapAtWhitespace);
+    SEATEST_FIXTURE_ENTRY(bitmapFontLayout_wrapWithinWord);
+    SEATEST_FIXTURE_ENTRY(bitmapFontLayout_wrapUTF8);
+    SEATEST_FIXTURE_ENTRY(bitmapFontLayout_kerning);
+    SEATEST_FIXTURE_ENTRY(bitmapFontLayout_measure);
+    SEATEST_FIXTURE_ENTRY(bitmapFontLayout_cacheEviction);
+}
+
+static const float FIXTURE_SIZE    = 12.0f;
+static const float FIXTURE_ADVANCE = 10.0f;
+static const float FIXTURE_WIDTH   = 8.0f;
+static const float FIXTURE_HEIGHT  = 9.0f;
+
+// Printable ASCII and Latin-1 e acute, every visible glyph is 8x9 pixels
+// and advances 10. Space has no quad and advances 5.
+static void setupFixtureFont(BitmapFontLayout& font)
+{
+    font.setSize(FIXTURE_SIZE);
+    font.setLineHeight(FIXTURE_SIZE);
+
+    font.addGlyph(' ', 0, 0, 0, 0, 0, 0, 5);
+
+    for (int id = '!'; id <= '~'; id++)
+    {
+        font.addGlyph(id, (float)(id - '!') * FIXTURE_WIDTH, 0, FIXTURE_WIDTH, FIXTURE_HEIGHT, 0, 0, FIXTURE_ADVANCE);
+    }
+
+    font.addGlyph(0xE9, 0, FIXTURE_HEIGHT, FIXTURE_WIDTH, FIXTURE_HEIGHT, 0, 0, FIXTURE_ADVANCE);
+}
+
+// Lays out at the font's own size, left/top aligned without auto scaling
+static int layoutAt(BitmapFontLayout& font, const char *text, float width, bool kerning = false)
+{
+    return font.layout(width, 1000.0f, text, FIXTURE_SIZE, "left", "top", false, kerning);
+}
+
+static void assertChar(const BitmapFontLayout& font, int index, int id, float x, float y)
+{
+    assert_int_equal(id, font.getLayoutCharID(index));
+    assert_float_equal(x, font.getLayoutX(index), 0.001f);
+    assert_float_equal(y, font.getLayoutY(index), 0.001f);
+}
+
+SEATEST_TEST(bitmapFontLayout_wrapAtWhitespace)
+{
+    BitmapFontLayout font;
+    setupFixtureFont(font);
+
+    // Fits on one line
+    assert_int_equal(4, layoutAt(font, "ab cd", 1000.0f));
+    assertChar(font, 2, 'c', 25, 0);
+    assertChar(font, 3, 'd', 35, 0);
+
+    // 'd' would end at 43, the whole word moves down and the space is dropped
+    assert_int_equal(4, layoutAt(font, "ab cd", 35.0f));
+    assertChar(font, 0, 'a', 0, 0);
+    assertChar(font, 1, 'b', 10, 0);
+    assertChar(font, 2, 'c', 0, FIXTURE_SIZE);
+    assertChar(font, 3, 'd', 10, FIXTURE_SIZE);
+
+    // Explicit line breaks
+    assert_int_equal(2, layoutAt(font, "a\nb", 1000.0f));
+    assertChar(font, 1, 'b', 0, FIXTURE_SIZE);
+}
+
+SEATEST_TEST(bitmapFontLayout_wrapWithinWord)
+{
+    BitmapFontLayout font;
+    setupFixtureFont(font);
+
+    // No whitespace to break at, only the overflowing char moves down
+    assert_int_equal(4, layoutAt(font, "abcd", 25.0f));
+    assertChar(font, 0, 'a', 0, 0);
+    assertChar(font, 1, 'b', 10, 0);
+    assertChar(font, 2, 'c', 0, FIXTURE_SIZE);
+    assertChar(font, 3, 'd', 10, FIXTURE_SIZE);
+}
+
+SEATEST_TEST(bitmapFontLayout_wrapUTF8)
+{
+    BitmapFontLayout font;
+    setupFixtureFont(font);
+
+    // Rewinding for the overflowing char must restart at its lead byte,
+    // otherwise the continuation byte is read as a char of its own
+    assert_int_equal(4, layoutAt(font, "\xC3\xA9\xC3\xA9\xC3\xA9\xC3\xA9", 25.0f));
+    assertChar(font, 0, 0xE9, 0, 0);
+    assertChar(font, 1, 0xE9, 10, 0);
+    assertChar(font, 2, 0xE9, 0, FIXTURE_SIZE);
+    assertChar(font, 3, 0xE9, 10, FIXTURE_SIZE);
+
+    // Same when breaking at whitespace before a multibyte word
+    assert_int_equal(4, layoutAt(font, "ab \xC3\xA9\xC3\xA9", 35.0f));
+    assertChar(font, 2, 0xE9, 0, FIXTURE_SIZE);
+    assertChar(font, 3, 0xE9, 10, FIXTURE_SIZE);
+}
+
+SEATEST_TEST(bitmapFontLayout_kerning)
+{
+    BitmapFontLayout font;
+    setupFixtureFont(font);
+
+    font.addKerning('a', 'b', -3);
+
+    assert_float_equal(-3, font.getKerning('a', 'b'), 0.001f);
+    assert_float_equal(0, font.getKerning('b', 'a'), 0.001f);
+    assert_float_equal(0, font.getKerning(-1, 'a'), 0.001f);
+
+    assert_int_equal(3, layoutAt(font, "aba", 1000.0f, true));
+    assertChar(font, 1, 'b', 7, 0);
+    assertChar(font, 2, 'a', 17, 0);
+
+    // Same text with kerning off is a different arrangement
+    assert_int_equal(3, layoutAt(font, "aba", 1000.0f, false));
+    assertChar(font, 1, 'b', 10, 0);
+
+    // Pairs don't carry over a line break
+    assert_int_equal(2, layoutAt(font, "a\nb", 1000.0f, true));
+    assertChar(font, 1, 'b', 0, FIXTURE_SIZE);
+
+    // Changing a pair drops cached arrangements
+    font.addKerning('a', 'b', -5);
+    layoutAt(font, "aba", 1000.0f, true);
+    assertChar(font, 1, 'b', 5, 0);
+}
+
+SEATEST_TEST(bitmapFontLayout_measure)
+{
+    BitmapFontLayout font;
+    setupFixtureFont(font);
+
+    font.measure("ab", 1000.0f, 1000.0f, FIXTURE_SIZE);
+    assert_float_equal(FIXTURE_ADVANCE + FIXTURE_WIDTH + 1, font.getMeasuredWidth(), 0.001f);
+    assert_float_equal(FIXTURE_HEIGHT + 1, font.getMeasuredHeight(), 0.001f);
+
+    // Twice the size scales the glyphs
+    font.measure("ab", 1000.0f, 1000.0f, FIXTURE_SIZE * 2);
+    assert_float_equal((FIXTURE_ADVANCE + FIXTURE_WIDTH) * 2 + 1, font.getMeasuredWidth(), 0.001f);
+
+    font.measure("", 1000.0f, 1000.0f, FIXTURE_SIZE);
+    assert_float_equal(0, font.getMeasuredWidth(), 0.001f);
+}
+
+SEATEST_TEST(bitmapFontLayout_cacheEviction)
+{
+    BitmapFontLayout font;
+    setupFixtureFont(font);
+
+    char text[32];
+
+    // The current arrangement is laid out at scale 2, the layout accessors
+    // fall back to scale 1 once it has been evicted. measure() arranges
+    // without changing the current arrangement.
+    font.layout(1000.0f, 1000.0f, "current", FIXTURE_SIZE * 2, "left", "top", false, false);
+    assert_float_equal(2, font.getLayoutScale(), 0.001f);
+
+    // Fill the cache
+    for (int i = 0; i < BitmapFontLayout::MAX_CACHED_LAYOUTS - 1; i++)
+    {
+        sprintf(text, "old%d", i);
+        font.measure(text, 1000.0f, 1000.0f, FIXTURE_SIZE);
+    }
+
+    // Using it again makes it the most recently used
+    font.layout(1000.0f, 1000.0f, "current", FIXTURE_SIZE * 2, "left", "top", false, false);
+
+    // Evicts the older arrangements first
+    for (int i = 0; i < BitmapFontLayout::MAX_CACHED_LAYOUTS - 1; i++)
+    {
+        sprintf(text, "new%d", i);
+        font.measure(text, 1000.0f, 1000.0f, FIXTURE_SIZE);
+        assert_float_equal(2, font.getLayoutScale(), 0.001f);
+    }
+
+    font.measure("last", 1000.0f, 1000.0f, FIXTURE_SIZE);
+    assert_float_equal(1, font.getLayoutScale(), 0.001f);
+
+    // Laying it out again rebuilds the same result
+    assert_int_equal(7, font.layout(1000.0f, 1000.0f, "current", FIXTURE_SIZE * 2, "left", "top", false, false));
+    assert_float_equal(2, font.getLayoutScale(), 0.001f);
+    assertChar(font, 1, 'u', FIXTURE_ADVANCE * 2, 0);
+}
@@ -30,8 +30,23 @@ namespace Loom2D
 {
 Type       *DisplayObject::typeDisplayObject;
 lua_Number DisplayObject::_transformationMatrixOrdinal;
+lua_Number DisplayObject::_ignoreHitTestAlphaOrdinal;
+int        DisplayObject::hitIndexCount = 0;
 bool       DisplayObject::cacheAsBitmapInProgress = false;
 
+void DisplayObject::invalidateHitBounds()
+{
+    // every ancestor caches the bounds of the subtree containing this object,
+    // so the whole chain is marked (a flag already set on an ancestor does not
+    // mean its own ancestors are still dirty, they may have rebuilt since)
+    DisplayObjectContainer *container = parent;
+    while (container)
+    {
+        container->hitIndexDirty = true;
+        container = container->parent;
+    }
+}
+
 bool DisplayObject::renderCached(lua_State *L)
 {
     if (!cacheAsBitmapValid) return false;
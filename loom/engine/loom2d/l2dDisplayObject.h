@@ -24,6 +24,7 @@
 #include "loom/engine/loom2d/l2dMatrix.h"
 #include "loom/engine/loom2d/l2dEventDispatcher.h"
 #include "loom/engine/loom2d/l2dBlendMode.h"
+#include "loom/engine/loom2d/l2dTweenEngine.h"
 #include "loom/script/native/lsNativeDelegate.h"
 #include <math.h>
 
@@ -140,6 +141,9 @@ public:
     // should not set this directly
     DisplayObjectContainer *parent;
 
+    // number of TweenEngine tweens animating this object
+    int tweenCount;
+
     Matrix transformMatrix;
 
     bool isEquivalent(lmscalar a, lmscalar b, lmscalar epsilon = 0.0001f)
@@ -153,6 +157,11 @@ public:
 
     static Type       *typeDisplayObject;
     static lua_Number _transformationMatrixOrdinal;
+    static lua_Number _ignoreHitTestAlphaOrdinal;
+
+    // number of containers with a spatial hit test index, while zero
+    // transform changes skip invalidating the ancestors
+    static int hitIndexCount;
 
     static void initialize(lua_State *L)
     {
@@ -160,6 +169,7 @@ public:
         lmAssert(typeDisplayObject, "unable to get loom2d.display.DisplayObject type");
 
         _transformationMatrixOrdinal = typeDisplayObject->getMemberOrdinal("_transformationMatrix");
+        _ignoreHitTestAlphaOrdinal   = typeDisplayObject->getMemberOrdinal("_ignoreHitTestAlpha");
     }
 
     inline void init()
@@ -185,6 +195,7 @@ public:
         cacheApplyScale  = false;
         cacheUseTexturesPot = false;
         cachedImage        = NULL;
+        tweenCount         = 0;
     }
 
     DisplayObject()
@@ -195,6 +206,11 @@ public:
 
     ~DisplayObject()
     {
+        if (tweenCount)
+        {
+            TweenEngine::releaseTarget(this);
+        }
+
         lualoom_managedpointerreleased(this);
     }
 
@@ -220,7 +236,31 @@ public:
 
     inline void setParent(DisplayObjectContainer *_parent)
     {
+        if (hitIndexCount)
+        {
+            invalidateHitBounds();
+        }
+
         parent = _parent;
+
+        if (hitIndexCount)
+        {
+            invalidateHitBounds();
+        }
+    }
+
+    // marks the spatial hit test index of every ancestor as stale, called
+    // whenever the bounds of this object in its parent's space may change
+    void invalidateHitBounds();
+
+    inline void markTransformDirty()
+    {
+        transformDirty = true;
+
+        if (hitIndexCount)
+        {
+            invalidateHitBounds();
+        }
     }
 
     inline void updateLocalTransform()
@@ -310,6 +350,11 @@ public:
 
         transformDirty = false;
 
+        if (hitIndexCount)
+        {
+            invalidateHitBounds();
+        }
+
         m->copyFrom(newM);
         transformMatrix.copyFrom(newM);
 
@@ -402,7 +447,7 @@ public:
 
     inline void setX(lmscalar _x)
     {
-        transformDirty = true;
+        markTransformDirty();
         x = _x;
     }
 
@@ -413,7 +458,7 @@ public:
 
     inline void setY(lmscalar _y)
     {
-        transformDirty = true;
+        markTransformDirty();
         y = _y;
     }
 
@@ -424,7 +469,7 @@ public:
 
     inline void setPivotX(lmscalar _pivotX)
     {
-        transformDirty = true;
+        markTransformDirty();
         pivotX         = _pivotX;
     }
 
@@ -435,7 +480,7 @@ public:
 
     inline void setPivotY(lmscalar _pivotY)
     {
-        transformDirty = true;
+        markTransformDirty();
         pivotY         = _pivotY;
     }
 
@@ -446,7 +491,7 @@ public:
 
     inline void setScaleX(lmscalar _scaleX)
     {
-        transformDirty = true;
+        markTransformDirty();
         scaleX         = _scaleX;
     }
 
@@ -457,13 +502,13 @@ public:
 
     inline void setScaleY(lmscalar _scaleY)
     {
-        transformDirty = true;
+        markTransformDirty();
         scaleY         = _scaleY;
     }
 
     inline void setScale(lmscalar _scale)
     {
-        transformDirty = true;
+        markTransformDirty();
         scaleX         = scaleY = _scale;
     }
 
@@ -479,7 +524,7 @@ public:
 
     inline void setSkewX(lmscalar _skewX)
     {
-        transformDirty = true;
+        markTransformDirty();
         skewX          = _skewX;
     }
 
@@ -490,7 +535,7 @@ public:
 
     inline void setSkewY(lmscalar _skewY)
     {
-        transformDirty = true;
+        markTransformDirty();
         skewY          = _skewY;
     }
 
@@ -501,7 +546,7 @@ public:
 
     inline void setRotation(lmscalar _rotation)
     {
-        transformDirty = true;
+        markTransformDirty();
         rotation       = _rotation;
     }
 
@@ -603,6 +648,11 @@ public:
     inline void setValid(bool _valid)
     {
         valid = _valid;
+
+        if (!_valid && hitIndexCount)
+        {
+            invalidateHitBounds();
+        }
     }
 
     inline lmscalar getDepth() const
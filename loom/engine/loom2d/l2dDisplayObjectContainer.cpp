@@ -23,9 +23,12 @@
 
 #include "loom/engine/loom2d/l2dDisplayObjectContainer.h"
 #include "loom/engine/loom2d/l2dSprite.h"
+#include "loom/engine/loom2d/l2dQuad.h"
 #include "loom/engine/loom2d/l2dQuadBatch.h"
+#include "loom/engine/loom2d/l2dTilemapLayer.h"
 #include "loom/engine/loom2d/l2dBlendMode.h"
 #include "loom/graphics/gfxGraphics.h"
+#include "loom/common/core/performance.h"
 
 
 namespace Loom2D
@@ -201,4 +204,744 @@ void DisplayObjectContainer::renderChildren(lua_State *L)
         GFX::Graphics::setView(viewRestore);
     }*/
 }
+
+// how a script type answers hitTest and getBounds, resolved once per type
+enum HitTestKind
+{
+    // DisplayObjectContainer.hitTest, children are tested natively
+    HITTEST_CONTAINER,
+    // DisplayObject.hitTest, a bounding box test against getBounds(this)
+    HITTEST_BOUNDS,
+    // overridden in script, called through DisplayObjectContainer._hitTestChild
+    HITTEST_SCRIPT
+};
+
+enum HitBoundsKind
+{
+    HITBOUNDS_QUAD,
+    HITBOUNDS_QUADBATCH,
+    HITBOUNDS_TILEMAP,
+    HITBOUNDS_SCRIPT
+};
+
+struct HitTestInfo
+{
+    int hitTest;
+    int bounds;
+};
+
+static utHashTable<utPointerHashKey, HitTestInfo> sHitTestInfo;
+
+static lua_Number sVertexDataOrdinal = -1;
+static lua_Number sRawDataOrdinal    = -1;
+
+// grid bounds are grown by this much so points on an edge still land in
+// the cells of the entry despite rounding in the inverse transform
+static const lmscalar HIT_BOUNDS_SLOP = 0.01f;
+
+// entries covering more than this share of the grid are tested always
+static const int HIT_INDEX_MAX_SPAN_DIVISOR = 4;
+
+static const int HIT_INDEX_MAX_CELLS_PER_AXIS = 128;
+
+void DisplayObjectContainer::resetHitTestTypes()
+{
+    sHitTestInfo.clear();
+    sVertexDataOrdinal = -1;
+    sRawDataOrdinal    = -1;
+}
+
+static Type *findDeclaringType(Type *type, const char *methodName)
+{
+    MemberTypes types;
+    types.method = true;
+
+    utArray<MemberInfo *> members;
+
+    for (Type *t = type; t; t = t->getBaseType())
+    {
+        t->findMembers(types, members);
+
+        for (UTsize i = 0; i < members.size(); i++)
+        {
+            if (!strcmp(members[i]->getName(), methodName))
+            {
+                return t;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static HitTestInfo getHitTestInfo(Type *type)
+{
+    HitTestInfo *cached = sHitTestInfo.get(utPointerHashKey(type));
+
+    if (cached)
+    {
+        return *cached;
+    }
+
+    HitTestInfo info;
+
+    Type *hitTestType = findDeclaringType(type, "hitTest");
+
+    if (hitTestType == DisplayObjectContainer::typeDisplayObjectContainer)
+    {
+        info.hitTest = HITTEST_CONTAINER;
+    }
+    else if (hitTestType == DisplayObject::typeDisplayObject)
+    {
+        info.hitTest = HITTEST_BOUNDS;
+    }
+    else
+    {
+        info.hitTest = HITTEST_SCRIPT;
+    }
+
+    Type *boundsType = findDeclaringType(type, "getBounds");
+
+    if (boundsType == Quad::typeQuad)
+    {
+        info.bounds = HITBOUNDS_QUAD;
+    }
+    else if (boundsType == QuadBatch::typeQuadBatch)
+    {
+        info.bounds = HITBOUNDS_QUADBATCH;
+    }
+    else if (boundsType == TilemapLayer::typeTilemapLayer)
+    {
+        info.bounds = HITBOUNDS_TILEMAP;
+    }
+    else
+    {
+        info.bounds = HITBOUNDS_SCRIPT;
+    }
+
+    sHitTestInfo.insert(utPointerHashKey(type), info);
+
+    return info;
+}
+
+// mirrors Rectangle.containsPoint
+static inline bool rectContains(const Rectangle& rect, lmscalar px, lmscalar py)
+{
+    return !((px > (rect.x + rect.width)) || (px < rect.x) ||
+             (py > (rect.y + rect.height)) || (py < rect.y));
+}
+
+// mirrors DisplayObject.hasVisibleArea
+static bool hasVisibleArea(lua_State *L, int index, DisplayObject *dobj)
+{
+    if (!dobj->visible || (dobj->scaleX == 0.0) || (dobj->scaleY == 0.0))
+    {
+        return false;
+    }
+
+    if (dobj->alpha > 0.0)
+    {
+        return true;
+    }
+
+    lua_rawgeti(L, index, (int)DisplayObject::_ignoreHitTestAlphaOrdinal);
+    bool ignoreAlpha = lua_toboolean(L, -1) != 0;
+    lua_pop(L, 1);
+
+    return ignoreAlpha;
+}
+
+// bounds of a leaf object in its own space, as getBounds(this) would return;
+// returns false if they can't be retrieved
+static bool getLocalHitBounds(lua_State *L, int index, DisplayObject *dobj, int boundsKind, Rectangle *resultRect)
+{
+    int top = lua_gettop(L);
+    bool result = false;
+
+    switch (boundsKind)
+    {
+    case HITBOUNDS_QUAD:
+    {
+        // Quad.getBounds uses the script vertex data, position of the last vertex
+        if (sVertexDataOrdinal == -1)
+        {
+            Type *vertexDataType = LSLuaState::getLuaState(L)->getType("loom2d.utils.VertexData");
+            lmAssert(vertexDataType, "unable to get loom2d.utils.VertexData type");
+
+            sVertexDataOrdinal = Quad::typeQuad->getMemberOrdinal("mVertexData");
+            sRawDataOrdinal    = vertexDataType->getMemberOrdinal("mRawData");
+        }
+
+        lua_rawgeti(L, index, (int)sVertexDataOrdinal);
+        if (!lua_istable(L, -1))
+        {
+            break;
+        }
+
+        lua_rawgeti(L, -1, (int)sRawDataOrdinal);
+        if (!lua_istable(L, -1))
+        {
+            break;
+        }
+
+        lua_rawgeti(L, -1, LSINDEXVECTOR);
+        lua_rawgeti(L, -1, 3 * 8);
+        lua_rawgeti(L, -2, 3 * 8 + 1);
+
+        if (lua_isnumber(L, -2) && lua_isnumber(L, -1))
+        {
+            resultRect->setTo(0, 0, (lmscalar)lua_tonumber(L, -2), (lmscalar)lua_tonumber(L, -1));
+            result = true;
+        }
+
+        break;
+    }
+
+    case HITBOUNDS_QUADBATCH:
+    {
+        Matrix identity;
+        static_cast<QuadBatch *>(dobj)->getBounds(&identity, resultRect);
+        result = true;
+        break;
+    }
+
+    case HITBOUNDS_TILEMAP:
+        static_cast<TilemapLayer *>(dobj)->getLocalBoundsRect(resultRect);
+        result = true;
+        break;
+
+    default:
+    {
+        lualoom_getmember(L, index, "getBounds");
+        lua_pushvalue(L, index);
+        lua_pushnil(L);
+        lua_call(L, 2, 1);
+
+        Rectangle *bounds = (Rectangle *)lualoom_getnativepointer(L, -1);
+        if (bounds)
+        {
+            *resultRect = *bounds;
+            result = true;
+        }
+
+        break;
+    }
+    }
+
+    lua_settop(L, top);
+
+    return result;
+}
+
+// bounds of the object at the given stack index transformed by mtx, an
+// empty result (negative width) means nothing in it can be hit
+static bool getObjectHitBounds(lua_State *L, int index, DisplayObject *dobj, Matrix *mtx, Rectangle *resultRect)
+{
+    lua_rawgeti(L, index, LSINDEXTYPE);
+    dobj->type = (Type *)lua_topointer(L, -1);
+    lua_pop(L, 1);
+
+    HitTestInfo info = getHitTestInfo(dobj->type);
+
+    if (info.hitTest == HITTEST_CONTAINER)
+    {
+        return static_cast<DisplayObjectContainer *>(dobj)->getHitBounds(L, index, mtx, resultRect);
+    }
+
+    // a custom hitTest may report hits anywhere, and script getBounds
+    // overrides (Shape, ParticleSystem, user classes) change without calling
+    // invalidateHitBounds, so neither can be cached
+    if ((info.hitTest == HITTEST_SCRIPT) || (info.bounds == HITBOUNDS_SCRIPT))
+    {
+        return false;
+    }
+
+    Rectangle local;
+    if (!getLocalHitBounds(L, index, dobj, info.bounds, &local))
+    {
+        return false;
+    }
+
+    if ((local.width < 0) || (local.height < 0))
+    {
+        resultRect->setTo(0, 0, -1, -1);
+        return true;
+    }
+
+    DisplayObject::transformBounds(mtx, &local, resultRect);
+
+    return true;
+}
+
+bool DisplayObjectContainer::getHitBounds(lua_State *L, int index, Matrix *mtx, Rectangle *resultRect)
+{
+    lua_checkstack(L, 8);
+
+    int top = lua_gettop(L);
+
+    index = lua_absindex(L, index);
+
+    lua_rawgeti(L, index, (int)childrenOrdinal);
+    lua_rawgeti(L, -1, LSINDEXVECTOR);
+    int childrenVectorIdx = lua_gettop(L);
+    int numChildren       = lsr_vector_get_length(L, childrenVectorIdx - 1);
+
+    bool     found = false;
+    bool     known = true;
+    lmscalar minX = 0, minY = 0, maxX = 0, maxY = 0;
+
+    for (int i = 0; i < numChildren && known; i++)
+    {
+        lua_rawgeti(L, childrenVectorIdx, i);
+
+        DisplayObject *child = (DisplayObject *)lualoom_getnativepointer(L, -1);
+
+        child->updateLocalTransform();
+
+        Matrix childMatrix;
+        childMatrix.copyFrom(&child->transformMatrix);
+        childMatrix.concat(mtx);
+
+        Rectangle bounds;
+        known = getObjectHitBounds(L, lua_gettop(L), child, &childMatrix, &bounds);
+
+        if (known && (bounds.width >= 0) && (bounds.height >= 0))
+        {
+            if (!found)
+            {
+                minX  = bounds.x;
+                minY  = bounds.y;
+                maxX  = bounds.x + bounds.width;
+                maxY  = bounds.y + bounds.height;
+                found = true;
+            }
+            else
+            {
+                if (bounds.x < minX) minX = bounds.x;
+                if (bounds.y < minY) minY = bounds.y;
+                if (bounds.x + bounds.width > maxX) maxX = bounds.x + bounds.width;
+                if (bounds.y + bounds.height > maxY) maxY = bounds.y + bounds.height;
+            }
+        }
+
+        lua_pop(L, 1);
+    }
+
+    lua_settop(L, top);
+
+    if (!known)
+    {
+        return false;
+    }
+
+    if (found)
+    {
+        resultRect->setTo(minX, minY, maxX - minX, maxY - minY);
+    }
+    else
+    {
+        resultRect->setTo(0, 0, -1, -1);
+    }
+
+    return true;
+}
+
+void DisplayObjectContainer::setSpatialIndex(bool value)
+{
+    if (value == (hitIndex != NULL))
+    {
+        return;
+    }
+
+    if (value)
+    {
+        hitIndex      = lmNew(NULL) HitIndex();
+        hitIndexDirty = true;
+        hitIndexCount++;
+    }
+    else
+    {
+        lmDelete(NULL, hitIndex);
+        hitIndex = NULL;
+        hitIndexCount--;
+    }
+}
+
+void DisplayObjectContainer::rebuildHitIndex(lua_State *L, int childrenVectorIdx, int numChildren)
+{
+    LOOM_PROFILE_SCOPE(hitIndexRebuild);
+
+    // cleared up front, so invalidations raised during the rebuild mark the
+    // index dirty again
+    hitIndexDirty = false;
+
+    HitIndex *hi = hitIndex;
+
+    hi->entries.resize(numChildren);
+    hi->always.clear(true);
+    hi->cellItems.clear(true);
+
+    int numBounded = 0;
+
+    for (int i = 0; i < numChildren; i++)
+    {
+        HitIndex::Entry& entry = hi->entries[i];
+
+        lua_rawgeti(L, childrenVectorIdx, i);
+
+        DisplayObject *child = (DisplayObject *)lualoom_getnativepointer(L, -1);
+
+        child->updateLocalTransform();
+
+        Matrix childMatrix;
+        childMatrix.copyFrom(&child->transformMatrix);
+
+        entry.object = child;
+
+        Rectangle& bounds = entry.bounds;
+
+        if (!getObjectHitBounds(L, lua_gettop(L), child, &childMatrix, &bounds) ||
+            (bounds.width != bounds.width) || (bounds.height != bounds.height))
+        {
+            entry.state = HitIndex::ENTRY_ALWAYS;
+        }
+        else if ((bounds.width < 0) || (bounds.height < 0))
+        {
+            entry.state = HitIndex::ENTRY_EMPTY;
+        }
+        else
+        {
+            entry.state    = HitIndex::ENTRY_BOUNDED;
+            bounds.x      -= HIT_BOUNDS_SLOP;
+            bounds.y      -= HIT_BOUNDS_SLOP;
+            bounds.width  += HIT_BOUNDS_SLOP * 2;
+            bounds.height += HIT_BOUNDS_SLOP * 2;
+
+            if (!numBounded)
+            {
+                hi->minX = bounds.x;
+                hi->minY = bounds.y;
+                hi->maxX = bounds.x + bounds.width;
+                hi->maxY = bounds.y + bounds.height;
+            }
+            else
+            {
+                if (bounds.x < hi->minX) hi->minX = bounds.x;
+                if (bounds.y < hi->minY) hi->minY = bounds.y;
+                if (bounds.x + bounds.width > hi->maxX) hi->maxX = bounds.x + bounds.width;
+                if (bounds.y + bounds.height > hi->maxY) hi->maxY = bounds.y + bounds.height;
+            }
+
+            numBounded++;
+        }
+
+        lua_pop(L, 1);
+    }
+
+    if (!numBounded)
+    {
+        hi->minX = hi->minY = hi->maxX = hi->maxY = 0;
+    }
+
+    // aim for about two entries per cell, shaped after the covered area
+    lmscalar width  = hi->maxX - hi->minX;
+    lmscalar height = hi->maxY - hi->minY;
+
+    if (width <= 0) width = 1;
+    if (height <= 0) height = 1;
+
+    int targetCells = numBounded / 2 > 1 ? numBounded / 2 : 1;
+
+    hi->cellsX = (int)ceil(sqrt(targetCells * width / height));
+    if (hi->cellsX < 1) hi->cellsX = 1;
+    if (hi->cellsX > HIT_INDEX_MAX_CELLS_PER_AXIS) hi->cellsX = HIT_INDEX_MAX_CELLS_PER_AXIS;
+
+    hi->cellsY = (targetCells + hi->cellsX - 1) / hi->cellsX;
+    if (hi->cellsY < 1) hi->cellsY = 1;
+    if (hi->cellsY > HIT_INDEX_MAX_CELLS_PER_AXIS) hi->cellsY = HIT_INDEX_MAX_CELLS_PER_AXIS;
+
+    hi->cellWidth  = width / hi->cellsX;
+    hi->cellHeight = height / hi->cellsY;
+
+    int numCells = hi->cellsX * hi->cellsY;
+    int maxSpan  = numCells / HIT_INDEX_MAX_SPAN_DIVISOR > 1 ? numCells / HIT_INDEX_MAX_SPAN_DIVISOR : 1;
+
+    // count the entries per cell, demoting huge entries to always tested
+    hi->cellStart.resize(numCells + 1);
+    memset(hi->cellStart.ptr(), 0, sizeof(int) * (numCells + 1));
+
+    for (int i = 0; i < numChildren; i++)
+    {
+        HitIndex::Entry& entry = hi->entries[i];
+
+        if (entry.state == HitIndex::ENTRY_BOUNDED)
+        {
+            int x0 = (int)floor((entry.bounds.x - hi->minX) / hi->cellWidth);
+            int y0 = (int)floor((entry.bounds.y - hi->minY) / hi->cellHeight);
+            int x1 = (int)floor((entry.bounds.x + entry.bounds.width - hi->minX) / hi->cellWidth);
+            int y1 = (int)floor((entry.bounds.y + entry.bounds.height - hi->minY) / hi->cellHeight);
+
+            if (x0 < 0) x0 = 0;
+            if (y0 < 0) y0 = 0;
+            if (x1 >= hi->cellsX) x1 = hi->cellsX - 1;
+            if (y1 >= hi->cellsY) y1 = hi->cellsY - 1;
+
+            if ((x1 - x0 + 1) * (y1 - y0 + 1) > maxSpan && numCells > 1)
+            {
+                entry.state = HitIndex::ENTRY_ALWAYS;
+            }
+            else
+            {
+                for (int y = y0; y <= y1; y++)
+                {
+                    for (int x = x0; x <= x1; x++)
+                    {
+                        hi->cellStart[y * hi->cellsX + x + 1]++;
+                    }
+                }
+            }
+        }
+
+        if (entry.state == HitIndex::ENTRY_ALWAYS)
+        {
+            hi->always.push_back(i);
+        }
+    }
+
+    for (int c = 0; c < numCells; c++)
+    {
+        hi->cellStart[c + 1] += hi->cellStart[c];
+    }
+
+    // fill in child order so every cell ends up sorted ascending
+    hi->cellItems.resize(hi->cellStart[numCells]);
+
+    utArray<int> cursor;
+    cursor.resize(numCells);
+    memcpy(cursor.ptr(), hi->cellStart.ptr(), sizeof(int) * numCells);
+
+    for (int i = 0; i < numChildren; i++)
+    {
+        HitIndex::Entry& entry = hi->entries[i];
+
+        if (entry.state != HitIndex::ENTRY_BOUNDED)
+        {
+            continue;
+        }
+
+        int x0 = (int)floor((entry.bounds.x - hi->minX) / hi->cellWidth);
+        int y0 = (int)floor((entry.bounds.y - hi->minY) / hi->cellHeight);
+        int x1 = (int)floor((entry.bounds.x + entry.bounds.width - hi->minX) / hi->cellWidth);
+        int y1 = (int)floor((entry.bounds.y + entry.bounds.height - hi->minY) / hi->cellHeight);
+
+        if (x0 < 0) x0 = 0;
+        if (y0 < 0) y0 = 0;
+        if (x1 >= hi->cellsX) x1 = hi->cellsX - 1;
+        if (y1 >= hi->cellsY) y1 = hi->cellsY - 1;
+
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                hi->cellItems[cursor[y * hi->cellsX + x]++] = i;
+            }
+        }
+    }
+}
+
+// tests a single child with a point in the parent's space
+static bool hitTestChild(lua_State *L, int parentIdx, int childIdx, DisplayObject *child, lmscalar x, lmscalar y, bool forTouch)
+{
+    lua_rawgeti(L, childIdx, LSINDEXTYPE);
+    child->type = (Type *)lua_topointer(L, -1);
+    lua_pop(L, 1);
+
+    if (!hasVisibleArea(L, childIdx, child))
+    {
+        return false;
+    }
+
+    child->updateLocalTransform();
+
+    Matrix toLocal;
+    toLocal.invertOther(&child->transformMatrix);
+
+    lmscalar localX, localY;
+    toLocal.transformCoordInternal(x, y, &localX, &localY);
+
+    HitTestInfo info = getHitTestInfo(child->type);
+
+    if (info.hitTest == HITTEST_CONTAINER)
+    {
+        return static_cast<DisplayObjectContainer *>(child)->hitTestChildren(L, childIdx, localX, localY, forTouch);
+    }
+
+    if (info.hitTest == HITTEST_BOUNDS)
+    {
+        if (forTouch && (!child->visible || !child->touchable))
+        {
+            return false;
+        }
+
+        Rectangle bounds;
+        if (!getLocalHitBounds(L, childIdx, child, info.bounds, &bounds) || !rectContains(bounds, localX, localY))
+        {
+            return false;
+        }
+
+        lua_pushvalue(L, childIdx);
+        return true;
+    }
+
+    lualoom_getmember(L, parentIdx, "_hitTestChild");
+    lua_pushvalue(L, childIdx);
+    lua_pushnumber(L, localX);
+    lua_pushnumber(L, localY);
+    lua_pushboolean(L, forTouch ? 1 : 0);
+    lua_call(L, 4, 1);
+
+    if (lua_isnil(L, -1))
+    {
+        lua_pop(L, 1);
+        return false;
+    }
+
+    return true;
+}
+
+bool DisplayObjectContainer::hitTestChildren(lua_State *L, int index, lmscalar x, lmscalar y, bool forTouch)
+{
+    if (forTouch && (!visible || !touchable))
+    {
+        return false;
+    }
+
+    lua_checkstack(L, 16);
+
+    int top = lua_gettop(L);
+
+    index = lua_absindex(L, index);
+
+    lua_rawgeti(L, index, (int)childrenOrdinal);
+    lua_rawgeti(L, -1, LSINDEXVECTOR);
+    int childrenVectorIdx = lua_gettop(L);
+    int numChildren       = lsr_vector_get_length(L, childrenVectorIdx - 1);
+
+    bool hit       = false;
+    bool bruteForce = (hitIndex == NULL);
+
+    if (!bruteForce)
+    {
+        if (hitIndexDirty || ((int)hitIndex->entries.size() != numChildren))
+        {
+            rebuildHitIndex(L, childrenVectorIdx, numChildren);
+        }
+
+        HitIndex *hi = hitIndex;
+
+        int cellBegin = 0, cellEnd = 0;
+
+        if ((x >= hi->minX) && (x <= hi->maxX) && (y >= hi->minY) && (y <= hi->maxY))
+        {
+            int cx = (int)floor((x - hi->minX) / hi->cellWidth);
+            int cy = (int)floor((y - hi->minY) / hi->cellHeight);
+
+            if (cx >= hi->cellsX) cx = hi->cellsX - 1;
+            if (cy >= hi->cellsY) cy = hi->cellsY - 1;
+
+            cellBegin = hi->cellStart[cy * hi->cellsX + cx];
+            cellEnd   = hi->cellStart[cy * hi->cellsX + cx + 1];
+        }
+
+        // merge the cell and the always tested entries, front to back
+        int a = cellEnd - 1;
+        int b = (int)hi->always.size() - 1;
+
+        while (a >= cellBegin || b >= 0)
+        {
+            int i;
+
+            if ((b < 0) || ((a >= cellBegin) && (hi->cellItems[a] > hi->always[b])))
+            {
+                i = hi->cellItems[a--];
+            }
+            else
+            {
+                i = hi->always[b--];
+            }
+
+            const HitIndex::Entry& entry = hi->entries[i];
+
+            if ((entry.state == HitIndex::ENTRY_BOUNDED) && !rectContains(entry.bounds, x, y))
+            {
+                continue;
+            }
+
+            lua_rawgeti(L, childrenVectorIdx, i);
+
+            DisplayObject *child = (DisplayObject *)lualoom_getnativepointer(L, -1);
+
+            // children were reordered without touching their bounds
+            if (child != entry.object)
+            {
+                lua_pop(L, 1);
+                hitIndexDirty = true;
+                bruteForce    = true;
+                break;
+            }
+
+            if (hitTestChild(L, index, lua_gettop(L), child, x, y, forTouch))
+            {
+                hit = true;
+                break;
+            }
+
+            lua_pop(L, 1);
+        }
+    }
+
+    if (bruteForce)
+    {
+        for (int i = numChildren - 1; i >= 0; --i) // front to back!
+        {
+            lua_rawgeti(L, childrenVectorIdx, i);
+
+            DisplayObject *child = (DisplayObject *)lualoom_getnativepointer(L, -1);
+
+            if (hitTestChild(L, index, lua_gettop(L), child, x, y, forTouch))
+            {
+                hit = true;
+                break;
+            }
+
+            lua_pop(L, 1);
+        }
+    }
+
+    if (hit)
+    {
+        lua_replace(L, top + 1);
+        lua_settop(L, top + 1);
+    }
+    else
+    {
+        lua_settop(L, top);
+    }
+
+    return hit;
+}
+
+int DisplayObjectContainer::_hitTest(lua_State *L)
+{
+    lmscalar x        = (lmscalar)lua_tonumber(L, 2);
+    lmscalar y        = (lmscalar)lua_tonumber(L, 3);
+    bool     forTouch = lua_toboolean(L, 4) != 0;
+
+    if (!hitTestChildren(L, 1, x, y, forTouch))
+    {
+        lua_pushnil(L);
+    }
+
+    return 1;
+}
 }
@@ -31,6 +31,43 @@ struct DisplayObjectSort
     int           index;
 };
 
+// Uniform grid over the bounds of a container's children in the container's
+// local space, used by hit testing to visit only the children near a point.
+struct HitIndex
+{
+    enum EntryState
+    {
+        // bounds are known, the entry is stored in the grid cells it overlaps
+        ENTRY_BOUNDED,
+        // bounds are unknown or too large, always tested
+        ENTRY_ALWAYS,
+        // nothing in the subtree can be hit
+        ENTRY_EMPTY
+    };
+
+    struct Entry
+    {
+        DisplayObject *object;
+        Rectangle     bounds;
+        int           state;
+    };
+
+    // one entry per child, in child order
+    utArray<Entry> entries;
+
+    // ascending child indices of the ENTRY_ALWAYS entries
+    utArray<int> always;
+
+    // cellsX * cellsY + 1 offsets into cellItems, each cell lists
+    // child indices in ascending order
+    utArray<int> cellStart;
+    utArray<int> cellItems;
+
+    int      cellsX, cellsY;
+    lmscalar minX, minY, maxX, maxY;
+    lmscalar cellWidth, cellHeight;
+};
+
 class DisplayObjectContainer : public DisplayObject
 {
     static utArray<DisplayObjectSort> sSortBucket;
@@ -44,6 +81,13 @@ public:
         _view      = 0;
         clipX      = clipY = 0;
         clipWidth  = clipHeight = -1;
+        hitIndex      = NULL;
+        hitIndexDirty = true;
+    }
+
+    ~DisplayObjectContainer()
+    {
+        setSpatialIndex(false);
     }
 
     bool _depthSort;
@@ -82,6 +126,32 @@ public:
         clipHeight = _clipHeight;
     }
 
+    // set when the bounds of any descendant may have changed, see
+    // DisplayObject::invalidateHitBounds
+    bool hitIndexDirty;
+
+    // spatial index of the children for hit testing, NULL unless enabled
+    HitIndex *hitIndex;
+
+    inline bool getSpatialIndex() const
+    {
+        return hitIndex != NULL;
+    }
+
+    void setSpatialIndex(bool value);
+
+    // hitTest(x, y, forTouch) returning the topmost hit descendant or null
+    int _hitTest(lua_State *L);
+
+    // hit tests the children of the container instance at the given stack
+    // index with a point in local space, on a hit the object is pushed and
+    // true returned, otherwise the stack is left unchanged
+    bool hitTestChildren(lua_State *L, int index, lmscalar x, lmscalar y, bool forTouch);
+
+    // bounds of everything hittable in the subtree, transformed by mtx into
+    // the target space; returns false if the bounds can't be determined
+    bool getHitBounds(lua_State *L, int index, Matrix *mtx, Rectangle *resultRect);
+
     static Type       *typeDisplayObjectContainer;
     static lua_Number childrenOrdinal;
 
@@ -112,6 +182,15 @@ public:
         typeDisplayObjectContainer = LSLuaState::getLuaState(L)->getType("loom2d.display.DisplayObjectContainer");
         lmAssert(typeDisplayObjectContainer, "unable to get loom2d.display.DisplayObjectContainer type");
         childrenOrdinal = typeDisplayObjectContainer->getMemberOrdinal("mChildren");
+
+        resetHitTestTypes();
     }
+
+private:
+
+    // forgets the per type hit test resolution, types don't survive a reload
+    static void resetHitTestTypes();
+
+    void rebuildHitIndex(lua_State *L, int childrenVectorIdx, int numChildren);
 };
 }
@@ -0,0 +1,766 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/script/loomscript.h"
+#include "loom/script/runtime/lsRuntime.h"
+
+#include "loom/engine/loom2d/l2dParticleSystem.h"
+#include "loom/engine/loom2d/l2dBlendMode.h"
+#include "loom/graphics/gfxGraphics.h"
+#include "loom/common/core/log.h"
+#include "loom/common/core/performance.h"
+#include "jansson.h"
+
+lmDefineLogGroup(gParticleLogGroup, "loom2d.particles", 1, LoomLogInfo);
+
+namespace Loom2D
+{
+Type *ParticleSystem::typeParticleSystem = NULL;
+
+// number of float attributes stored per particle
+static const int PARTICLE_ATTRIBUTES = 9;
+
+ParticleSystem::ParticleSystem() : random(0x5EED)
+{
+    type   = typeParticleSystem;
+    shader = GFX::ShaderProgram::getDefaultShader();
+
+    emissionRate      = 10.0f;
+    lifespan          = 1.0f;
+    lifespanVariance  = 0.0f;
+    speed             = 100.0f;
+    speedVariance     = 0.0f;
+    emitAngle         = -(float)M_PI / 2.0f;
+    emitAngleVariance = 0.0f;
+    gravityX          = 0.0f;
+    gravityY          = 0.0f;
+    emitterX          = 0.0f;
+    emitterY          = 0.0f;
+    emitterXVariance  = 0.0f;
+    emitterYVariance  = 0.0f;
+    rotationVariance  = 0.0f;
+    spin              = 0.0f;
+    spinVariance      = 0.0f;
+    scaleVariance     = 0.0f;
+
+    posX     = NULL;
+    posY     = NULL;
+    velX     = NULL;
+    velY     = NULL;
+    rotation = NULL;
+    spinRate = NULL;
+    scale    = NULL;
+    life     = NULL;
+    lifeRate = NULL;
+
+    capacity     = 0;
+    numParticles = 0;
+
+    emitting        = false;
+    emitDuration    = -1.0f;
+    emitAccumulator = 0.0f;
+    completePending = false;
+
+    textureID     = -1;
+    u0            = 0.0f;
+    v0            = 0.0f;
+    u1            = 1.0f;
+    v1            = 1.0f;
+    textureWidth  = 0.0f;
+    textureHeight = 0.0f;
+
+    allocate(256);
+    buildScaleTable();
+    buildColorTable();
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    lmSafeFree(NULL, posX);
+}
+
+void ParticleSystem::allocate(int newCapacity)
+{
+    // all attributes share one block, posX always points at its start
+    float *oldBlock = posX;
+    float *block    = NULL;
+
+    if (newCapacity > 0)
+    {
+        block = (float *)lmAlloc(NULL, sizeof(float) * PARTICLE_ATTRIBUTES * newCapacity);
+    }
+
+    int keep = numParticles < newCapacity ? numParticles : newCapacity;
+
+    float **arrays[PARTICLE_ATTRIBUTES] = { &posX, &posY, &velX, &velY, &rotation, &spinRate, &scale, &life, &lifeRate };
+
+    for (int i = 0; i < PARTICLE_ATTRIBUTES; i++)
+    {
+        float *array = block ? block + i * newCapacity : NULL;
+
+        if (keep)
+        {
+            memcpy(array, *arrays[i], sizeof(float) * keep);
+        }
+
+        *arrays[i] = array;
+    }
+
+    lmSafeFree(NULL, oldBlock);
+
+    capacity     = newCapacity;
+    numParticles = keep;
+}
+
+void ParticleSystem::setMaxParticles(int value)
+{
+    lmAssert(value >= 0, "ParticleSystem maxParticles must not be negative");
+
+    if (value != capacity)
+    {
+        allocate(value);
+    }
+}
+
+void ParticleSystem::setSeed(int seed)
+{
+    random.setSeed((UTuint32)seed);
+}
+
+void ParticleSystem::start(lmscalar duration)
+{
+    emitting        = true;
+    emitDuration    = (float)duration;
+    completePending = true;
+}
+
+void ParticleSystem::stop(bool clearParticles)
+{
+    emitting        = false;
+    emitAccumulator = 0.0f;
+
+    if (clearParticles)
+    {
+        clear();
+    }
+}
+
+void ParticleSystem::burst(int count)
+{
+    for (int i = 0; i < count && numParticles < capacity; i++)
+    {
+        emit();
+    }
+
+    completePending = true;
+}
+
+void ParticleSystem::clear()
+{
+    numParticles = 0;
+}
+
+void ParticleSystem::emit()
+{
+    if (numParticles >= capacity)
+    {
+        return;
+    }
+
+    int i = numParticles++;
+
+    float angle    = emitAngle + randomVariance(emitAngleVariance);
+    float velocity = speed + randomVariance(speedVariance);
+    float lifetime = lifespan + randomVariance(lifespanVariance);
+    float size     = 1.0f + randomVariance(scaleVariance);
+
+    if (lifetime < 0.001f)
+    {
+        lifetime = 0.001f;
+    }
+
+    posX[i]     = emitterX + randomVariance(emitterXVariance);
+    posY[i]     = emitterY + randomVariance(emitterYVariance);
+    velX[i]     = cosf(angle) * velocity;
+    velY[i]     = sinf(angle) * velocity;
+    rotation[i] = randomVariance(rotationVariance);
+    spinRate[i] = spin + randomVariance(spinVariance);
+    scale[i]    = size > 0.0f ? size : 0.0f;
+    life[i]     = 0.0f;
+    lifeRate[i] = 1.0f / lifetime;
+}
+
+void ParticleSystem::kill(int index)
+{
+    // move the last particle into the slot to keep the arrays packed
+    int last = --numParticles;
+
+    posX[index]     = posX[last];
+    posY[index]     = posY[last];
+    velX[index]     = velX[last];
+    velY[index]     = velY[last];
+    rotation[index] = rotation[last];
+    spinRate[index] = spinRate[last];
+    scale[index]    = scale[last];
+    life[index]     = life[last];
+    lifeRate[index] = lifeRate[last];
+}
+
+void ParticleSystem::advanceTime(lmscalar time)
+{
+    LOOM_PROFILE_SCOPE(particleAdvance);
+
+    float dt = (float)time;
+
+    if (dt <= 0.0f)
+    {
+        return;
+    }
+
+    // age the particles, a killed slot is refilled by the last particle
+    // which then gets aged in the same iteration
+    for (int i = 0; i < numParticles; )
+    {
+        life[i] += lifeRate[i] * dt;
+
+        if (life[i] >= 1.0f)
+        {
+            kill(i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    // integrate, branch free so it vectorizes
+    float *px  = posX;
+    float *py  = posY;
+    float *vx  = velX;
+    float *vy  = velY;
+    float *rot = rotation;
+    float *spn = spinRate;
+    float gx   = gravityX * dt;
+    float gy   = gravityY * dt;
+    int   n    = numParticles;
+
+    for (int i = 0; i < n; i++)
+    {
+        vx[i]  += gx;
+        vy[i]  += gy;
+        px[i]  += vx[i] * dt;
+        py[i]  += vy[i] * dt;
+        rot[i] += spn[i] * dt;
+    }
+
+    if (emitting)
+    {
+        float emitTime = dt;
+
+        if (emitDuration >= 0.0f)
+        {
+            if (emitTime >= emitDuration)
+            {
+                emitTime = emitDuration;
+                emitting = false;
+            }
+
+            emitDuration -= emitTime;
+        }
+
+        emitAccumulator += emitTime * emissionRate;
+
+        // particles over the limit are dropped rather than queued
+        while (emitAccumulator >= 1.0f)
+        {
+            emit();
+            emitAccumulator -= 1.0f;
+        }
+    }
+
+    if (completePending && !emitting && !numParticles)
+    {
+        completePending = false;
+        _CompleteDelegate.invoke();
+    }
+}
+
+void ParticleSystem::setTexture(int _textureID, float _u0, float _v0, float _u1, float _v1, float width, float height)
+{
+    textureID     = _textureID;
+    u0            = _u0;
+    v0            = _v0;
+    u1            = _u1;
+    v1            = _v1;
+    textureWidth  = width;
+    textureHeight = height;
+}
+
+void ParticleSystem::buildScaleTable()
+{
+    for (int s = 0; s < CURVE_SAMPLES; s++)
+    {
+        float time  = (float)s / (CURVE_SAMPLES - 1);
+        float value = 1.0f;
+
+        UTsize count = scaleKeys.size();
+
+        if (count)
+        {
+            value = scaleKeys[count - 1].scale;
+
+            if (time <= scaleKeys[0].time)
+            {
+                value = scaleKeys[0].scale;
+            }
+            else
+            {
+                for (UTsize k = 1; k < count; k++)
+                {
+                    const ScaleKey& a = scaleKeys[k - 1];
+                    const ScaleKey& b = scaleKeys[k];
+
+                    if (time <= b.time)
+                    {
+                        float t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 1.0f;
+                        value = a.scale + (b.scale - a.scale) * t;
+                        break;
+                    }
+                }
+            }
+        }
+
+        scaleTable[s] = value;
+    }
+}
+
+static inline uint32_t packColor(float r, float g, float b, float a)
+{
+    r = r < 0.0f ? 0.0f : (r > 1.0f ? 1.0f : r);
+    g = g < 0.0f ? 0.0f : (g > 1.0f ? 1.0f : g);
+    b = b < 0.0f ? 0.0f : (b > 1.0f ? 1.0f : b);
+    a = a < 0.0f ? 0.0f : (a > 1.0f ? 1.0f : a);
+
+    return ((uint32_t)(a * 255.0f) << 24) | ((uint32_t)(b * 255.0f) << 16) | ((uint32_t)(g * 255.0f) << 8) | (uint32_t)(r * 255.0f);
+}
+
+void ParticleSystem::buildColorTable()
+{
+    for (int s = 0; s < CURVE_SAMPLES; s++)
+    {
+        float time = (float)s / (CURVE_SAMPLES - 1);
+
+        UTsize count = colorKeys.size();
+
+        if (!count)
+        {
+            colorTable[s] = 0xFFFFFFFF;
+            continue;
+        }
+
+        const ColorKey *a = &colorKeys[0];
+        const ColorKey *b = &colorKeys[0];
+
+        if (time > colorKeys[0].time)
+        {
+            a = b = &colorKeys[count - 1];
+
+            for (UTsize k = 1; k < count; k++)
+            {
+                if (time <= colorKeys[k].time)
+                {
+                    a = &colorKeys[k - 1];
+                    b = &colorKeys[k];
+                    break;
+                }
+            }
+        }
+
+        float t = b->time > a->time ? (time - a->time) / (b->time - a->time) : 1.0f;
+
+        colorTable[s] = packColor(a->r + (b->r - a->r) * t,
+                                  a->g + (b->g - a->g) * t,
+                                  a->b + (b->b - a->b) * t,
+                                  a->a + (b->a - a->a) * t);
+    }
+}
+
+int ParticleSystem::setScaleCurve(lua_State *L)
+{
+    if (!lua_istable(L, 2))
+    {
+        return luaL_error(L, "ParticleSystem.setScaleCurve: keys Vector is null");
+    }
+
+    int length = lsr_vector_get_length(L, 2);
+
+    if (length % 2)
+    {
+        return luaL_error(L, "ParticleSystem.setScaleCurve expects time/scale pairs, got %d values", length);
+    }
+
+    // get the Vector.<Number> off the stack
+    lua_rawgeti(L, 2, LSINDEXVECTOR);
+    int keysTable = lua_gettop(L);
+
+    scaleKeys.clear(true);
+
+    for (int i = 0; i + 1 < length; i += 2)
+    {
+        ScaleKey key;
+
+        lua_rawgeti(L, keysTable, i);
+        key.time = (float)lua_tonumber(L, -1);
+        lua_rawgeti(L, keysTable, i + 1);
+        key.scale = (float)lua_tonumber(L, -1);
+        lua_pop(L, 2);
+
+        scaleKeys.push_back(key);
+    }
+
+    lua_pop(L, 1);
+
+    buildScaleTable();
+
+    return 0;
+}
+
+int ParticleSystem::setColorCurve(lua_State *L)
+{
+    if (!lua_istable(L, 2))
+    {
+        return luaL_error(L, "ParticleSystem.setColorCurve: keys Vector is null");
+    }
+
+    int length = lsr_vector_get_length(L, 2);
+
+    if (length % 5)
+    {
+        return luaL_error(L, "ParticleSystem.setColorCurve expects time/r/g/b/a tuples, got %d values", length);
+    }
+
+    // get the Vector.<Number> off the stack
+    lua_rawgeti(L, 2, LSINDEXVECTOR);
+    int keysTable = lua_gettop(L);
+
+    colorKeys.clear(true);
+
+    for (int i = 0; i + 4 < length; i += 5)
+    {
+        float values[5];
+
+        for (int c = 0; c < 5; c++)
+        {
+            lua_rawgeti(L, keysTable, i + c);
+            values[c] = (float)lua_tonumber(L, -1);
+            lua_pop(L, 1);
+        }
+
+        ColorKey key = { values[0], values[1], values[2], values[3], values[4] };
+        colorKeys.push_back(key);
+    }
+
+    lua_pop(L, 1);
+
+    buildColorTable();
+
+    return 0;
+}
+
+static void readFloat(json_t *definition, const char *name, float& value, float factor = 1.0f)
+{
+    json_t *field = json_object_get(definition, name);
+
+    if (json_is_number(field))
+    {
+        value = (float)json_number_value(field) * factor;
+    }
+}
+
+bool ParticleSystem::parseDefinition(const char *json)
+{
+    json_error_t error;
+    json_t       *definition = json_loads(json ? json : "", 0, &error);
+
+    if (!definition)
+    {
+        lmLogError(gParticleLogGroup, "Unable to parse particle definition, line %d: %s", error.line, error.text);
+        return false;
+    }
+
+    if (!json_is_object(definition))
+    {
+        lmLogError(gParticleLogGroup, "Particle definition must be a JSON object");
+        json_decref(definition);
+        return false;
+    }
+
+    // angles are given in degrees
+    const float degrees = (float)M_PI / 180.0f;
+
+    json_t *maxParticles = json_object_get(definition, "maxParticles");
+    if (json_is_number(maxParticles))
+    {
+        setMaxParticles((int)json_number_value(maxParticles));
+    }
+
+    readFloat(definition, "emissionRate", emissionRate);
+    readFloat(definition, "lifespan", lifespan);
+    readFloat(definition, "lifespanVariance", lifespanVariance);
+    readFloat(definition, "speed", speed);
+    readFloat(definition, "speedVariance", speedVariance);
+    readFloat(definition, "angle", emitAngle, degrees);
+    readFloat(definition, "angleVariance", emitAngleVariance, degrees);
+    readFloat(definition, "gravityX", gravityX);
+    readFloat(definition, "gravityY", gravityY);
+    readFloat(definition, "emitterX", emitterX);
+    readFloat(definition, "emitterY", emitterY);
+    readFloat(definition, "emitterXVariance", emitterXVariance);
+    readFloat(definition, "emitterYVariance", emitterYVariance);
+    readFloat(definition, "rotationVariance", rotationVariance, degrees);
+    readFloat(definition, "spin", spin, degrees);
+    readFloat(definition, "spinVariance", spinVariance, degrees);
+    readFloat(definition, "scaleVariance", scaleVariance);
+
+    // "scale" is either a constant or a list of [time, scale] keys
+    json_t *scaleCurve = json_object_get(definition, "scale");
+
+    if (json_is_number(scaleCurve))
+    {
+        ScaleKey key = { 0.0f, (float)json_number_value(scaleCurve) };
+
+        scaleKeys.clear(true);
+        scaleKeys.push_back(key);
+        buildScaleTable();
+    }
+    else if (json_is_array(scaleCurve))
+    {
+        scaleKeys.clear(true);
+
+        for (size_t i = 0; i < json_array_size(scaleCurve); i++)
+        {
+            json_t *entry = json_array_get(scaleCurve, i);
+
+            if (!json_is_array(entry) || (json_array_size(entry) != 2))
+            {
+                lmLogWarn(gParticleLogGroup, "Ignoring scale key %d, expected [time, scale]", (int)i);
+                continue;
+            }
+
+            ScaleKey key = { (float)json_number_value(json_array_get(entry, 0)), (float)json_number_value(json_array_get(entry, 1)) };
+            scaleKeys.push_back(key);
+        }
+
+        buildScaleTable();
+    }
+
+    // "color" is a list of [time, r, g, b, a] keys with components in 0-1
+    json_t *colorCurve = json_object_get(definition, "color");
+
+    if (json_is_array(colorCurve))
+    {
+        colorKeys.clear(true);
+
+        for (size_t i = 0; i < json_array_size(colorCurve); i++)
+        {
+            json_t *entry = json_array_get(colorCurve, i);
+
+            if (!json_is_array(entry) || (json_array_size(entry) != 5))
+            {
+                lmLogWarn(gParticleLogGroup, "Ignoring color key %d, expected [time, r, g, b, a]", (int)i);
+                continue;
+            }
+
+            ColorKey key;
+            key.time = (float)json_number_value(json_array_get(entry, 0));
+            key.r    = (float)json_number_value(json_array_get(entry, 1));
+            key.g    = (float)json_number_value(json_array_get(entry, 2));
+            key.b    = (float)json_number_value(json_array_get(entry, 3));
+            key.a    = (float)json_number_value(json_array_get(entry, 4));
+            colorKeys.push_back(key);
+        }
+
+        buildColorTable();
+    }
+
+    json_decref(definition);
+
+    return true;
+}
+
+void ParticleSystem::getLocalBoundsRect(Rectangle *resultRect)
+{
+    if (!numParticles)
+    {
+        resultRect->setTo(emitterX, emitterY, 0, 0);
+        return;
+    }
+
+    float minX = posX[0], maxX = posX[0];
+    float minY = posY[0], maxY = posY[0];
+
+    for (int i = 1; i < numParticles; i++)
+    {
+        minX = posX[i] < minX ? posX[i] : minX;
+        maxX = posX[i] > maxX ? posX[i] : maxX;
+        minY = posY[i] < minY ? posY[i] : minY;
+        maxY = posY[i] > maxY ? posY[i] : maxY;
+    }
+
+    // pad by the largest possible rotated particle
+    float maxScale = 0.0f;
+
+    for (int s = 0; s < CURVE_SAMPLES; s++)
+    {
+        maxScale = scaleTable[s] > maxScale ? scaleTable[s] : maxScale;
+    }
+
+    maxScale *= 1.0f + scaleVariance;
+
+    float halfSize = (textureWidth > textureHeight ? textureWidth : textureHeight) * 0.5f;
+    float padding  = halfSize * maxScale * 1.4143f;
+
+    resultRect->setTo(minX - padding, minY - padding, maxX - minX + 2.0f * padding, maxY - minY + 2.0f * padding);
+}
+
+int ParticleSystem::getLocalBounds(lua_State *L)
+{
+    // get the Rectangle to store the bounds into
+    Rectangle *resultRect = (Rectangle *)lualoom_getnativepointer(L, 2);
+
+    getLocalBoundsRect(resultRect);
+
+    return 0;
+}
+
+void ParticleSystem::render(lua_State *L)
+{
+    if (!numParticles || (textureID < 0))
+    {
+        return;
+    }
+
+    // apply the parent alpha
+    renderState.alpha = parent ? parent->renderState.alpha * alpha : alpha;
+    renderState.clampAlpha();
+
+    if (renderState.alpha == 0.0f)
+    {
+        return;
+    }
+
+    LOOM_PROFILE_SCOPE(particleRender);
+
+    renderState.clipRect = parent ? parent->renderState.clipRect : Loom2D::Rectangle(0, 0, -1, -1);
+    if (renderState.isClipping()) GFX::Graphics::setClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height);
+
+    //set blend mode based to be unique or that of our parent
+    renderState.blendMode = (blendMode == BlendMode::AUTO && parent) ? parent->renderState.blendMode : blendMode;
+
+    unsigned int blendSrc, blendDst;
+    BlendMode::BlendFunction(renderState.blendMode, blendSrc, blendDst);
+
+    // update and get our transformation matrix
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    float ma = (float)mtx.a, mb = (float)mtx.b, mc = (float)mtx.c, md = (float)mtx.d;
+    float tx = (float)mtx.tx, ty = (float)mtx.ty;
+
+    // fold the render alpha into a copy of the colour table
+    uint32_t       fadedTable[CURVE_SAMPLES];
+    const uint32_t *colors = colorTable;
+
+    if (renderState.alpha < 1.0f)
+    {
+        for (int s = 0; s < CURVE_SAMPLES; s++)
+        {
+            float va = (float)(colorTable[s] >> 24) * (float)renderState.alpha;
+            fadedTable[s] = ((uint32_t)va << 24) | (colorTable[s] & 0x00FFFFFF);
+        }
+
+        colors = fadedTable;
+    }
+
+    bool  rotates    = (rotationVariance != 0.0f) || (spin != 0.0f) || (spinVariance != 0.0f);
+    float halfWidth  = textureWidth * 0.5f;
+    float halfHeight = textureHeight * 0.5f;
+
+    int first = 0;
+
+    while (first < numParticles)
+    {
+        int count = numParticles - first;
+
+        if (count > MAXBATCHQUADS)
+        {
+            count = MAXBATCHQUADS;
+        }
+
+        GFX::VertexPosColorTex *v = GFX::QuadRenderer::getQuadVertexMemory((uint16_t)(count * 4), textureID, blendEnabled, blendSrc, blendDst, shader);
+
+        if (!v)
+        {
+            return;
+        }
+
+        for (int i = first; i < first + count; i++)
+        {
+            int      sample = (int)(life[i] * (CURVE_SAMPLES - 1));
+            float    s      = scaleTable[sample] * scale[i];
+            uint32_t abgr   = colors[sample];
+
+            // half extents of the particle along its own axes
+            float ax = halfWidth * s, ay = 0.0f;
+            float bx = 0.0f, by = halfHeight * s;
+
+            if (rotates)
+            {
+                float cosR = cosf(rotation[i]);
+                float sinR = sinf(rotation[i]);
+
+                ax = halfWidth * s * cosR;
+                ay = halfWidth * s * sinR;
+                bx = -halfHeight * s * sinR;
+                by = halfHeight * s * cosR;
+            }
+
+            // centre and axes in target space
+            float cx  = ma * posX[i] + mc * posY[i] + tx;
+            float cy  = mb * posX[i] + md * posY[i] + ty;
+            float tax = ma * ax + mc * ay;
+            float tay = mb * ax + md * ay;
+            float tbx = ma * bx + mc * by;
+            float tby = mb * bx + md * by;
+
+            v[0].x = cx - tax - tbx; v[0].y = cy - tay - tby; v[0].z = 0.0f; v[0].abgr = abgr; v[0].u = u0; v[0].v = v0;
+            v[1].x = cx + tax - tbx; v[1].y = cy + tay - tby; v[1].z = 0.0f; v[1].abgr = abgr; v[1].u = u1; v[1].v = v0;
+            v[2].x = cx - tax + tbx; v[2].y = cy - tay + tby; v[2].z = 0.0f; v[2].abgr = abgr; v[2].u = u0; v[2].v = v1;
+            v[3].x = cx + tax + tbx; v[3].y = cy + tay + tby; v[3].z = 0.0f; v[3].abgr = abgr; v[3].u = u1; v[3].v = v1;
+
+            v += 4;
+        }
+
+        first += count;
+    }
+}
+}
@@ -0,0 +1,191 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/engine/loom2d/l2dDisplayObjectContainer.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxShader.h"
+#include "loom/common/utils/utRandom.h"
+
+namespace Loom2D
+{
+// Native side of the ParticleSystem script class
+//
+// Particles live in structure of arrays storage in the local space of the
+// system, dead particles are swapped out so the live range stays packed.
+// Scale and colour over a particle's life come from lookup tables built
+// from curve keys, so the update and render loops are plain float math over
+// contiguous arrays that compilers can vectorize. Every particle uses the
+// same texture and is written straight into QuadRenderer vertex memory.
+class ParticleSystem : public DisplayObject
+{
+public:
+
+    // static type cache
+    static Type *typeParticleSystem;
+
+    // initialize type information
+    static void initialize(lua_State *L)
+    {
+        typeParticleSystem = LSLuaState::getLuaState(L)->getType("loom2d.display.ParticleSystem");
+        lmAssert(typeParticleSystem, "unable to get loom2d.display.ParticleSystem type");
+    }
+
+    // resolution of the scale and colour lookup tables
+    static const int CURVE_SAMPLES = 64;
+
+    struct ScaleKey
+    {
+        float time;
+        float scale;
+    };
+
+    struct ColorKey
+    {
+        float time;
+        float r, g, b, a;
+    };
+
+    ParticleSystem();
+    ~ParticleSystem();
+
+    // emitter parameters, angles are in radians and times in seconds
+    float emissionRate;
+    float lifespan;
+    float lifespanVariance;
+    float speed;
+    float speedVariance;
+    float emitAngle;
+    float emitAngleVariance;
+    float gravityX;
+    float gravityY;
+    float emitterX;
+    float emitterY;
+    float emitterXVariance;
+    float emitterYVariance;
+    float rotationVariance;
+    float spin;
+    float spinVariance;
+    float scaleVariance;
+
+    int getMaxParticles() const { return capacity; }
+    void setMaxParticles(int value);
+
+    int getNumParticles() const { return numParticles; }
+
+    bool isEmitting() const { return emitting; }
+
+    // starts emitting for duration seconds, forever if negative
+    void start(lmscalar duration);
+
+    // stops emitting, live particles finish their life unless cleared
+    void stop(bool clearParticles);
+
+    // emits count particles right away
+    void burst(int count);
+
+    // removes all live particles
+    void clear();
+
+    void advanceTime(lmscalar time);
+
+    // the texture region every particle is drawn with, size in pixels
+    void setTexture(int textureID, float u0, float v0, float u1, float v1, float width, float height);
+
+    // Vector.<Number> of time/scale pairs
+    int setScaleCurve(lua_State *L);
+
+    // Vector.<Number> of time/r/g/b/a tuples, components in the range 0-1
+    int setColorCurve(lua_State *L);
+
+    // applies a particle definition in JSON form, returns false on errors
+    bool parseDefinition(const char *json);
+
+    // reseeds the random generator to make emission reproducible
+    void setSeed(int seed);
+
+    // bounds of the live particles in local space
+    void getLocalBoundsRect(Rectangle *resultRect);
+    int getLocalBounds(lua_State *L);
+
+    GFX::ShaderProgram *shader;
+
+    void setShader(GFX::ShaderProgram* sh)
+    {
+        shader = sh;
+    }
+
+    GFX::ShaderProgram* getShader() const
+    {
+        return shader;
+    }
+
+    void render(lua_State *L);
+
+    // called once all particles died after emission stopped
+    LOOM_DELEGATE(Complete);
+
+private:
+
+    void allocate(int newCapacity);
+    void emit();
+    void kill(int index);
+    void buildScaleTable();
+    void buildColorTable();
+
+    float randomVariance(float variance)
+    {
+        return variance ? variance * random.randRange(-1.0f, 1.0f) : 0.0f;
+    }
+
+    // particle attributes, one array each
+    float *posX;
+    float *posY;
+    float *velX;
+    float *velY;
+    float *rotation;
+    float *spinRate;
+    float *scale;
+    float *life;        // normalized age, 0 at birth and 1 at death
+    float *lifeRate;    // 1 / lifespan of the particle
+
+    int capacity;
+    int numParticles;
+
+    bool  emitting;
+    float emitDuration;
+    float emitAccumulator;
+    bool  completePending;
+
+    utArray<ScaleKey> scaleKeys;
+    utArray<ColorKey> colorKeys;
+
+    float    scaleTable[CURVE_SAMPLES];
+    uint32_t colorTable[CURVE_SAMPLES];
+
+    int   textureID;
+    float u0, v0, u1, v1;
+    float textureWidth, textureHeight;
+
+    utRandomNumberGenerator random;
+};
+}
@@ -65,6 +65,11 @@ public:
     inline void setNativeVertexDataInvalid(bool value)
     {
         nativeVertexDataInvalid = value;
+
+        if (value && hitIndexCount)
+        {
+            invalidateHitBounds();
+        }
     }
 
     void setShader(GFX::ShaderProgram* sh)
@@ -113,27 +113,18 @@ public:
     int reset(lua_State *L)
     {
         numQuads = 0;
-        return 0;
-    }
 
-    // gets the bounding rectangle of the quadbatch
-    int _getBounds(lua_State *L)
-    {
-        DisplayObject *targetSpace = NULL;
-
-        // check if we're given a DisplayObject to use as target space
-        if (!lua_isnil(L, 2))
+        if (hitIndexCount)
         {
-            targetSpace = (DisplayObject *)lualoom_getnativepointer(L, 2);
+            invalidateHitBounds();
         }
 
-        // get the Rectangle to store the bounds into
-        Rectangle *resultRect = (Rectangle *)lualoom_getnativepointer(L, 3);
-
-        // transform to target space
-        Matrix mtx;
-        getTargetTransformationMatrix(targetSpace, &mtx);
+        return 0;
+    }
 
+    // gets the bounding rectangle of the quads transformed by mtx
+    void getBounds(Matrix *mtx, Rectangle *resultRect)
+    {
         lmscalar minx = 1000000;
         lmscalar maxx = -1000000;
 
@@ -148,8 +139,8 @@ public:
 
             for (int j = 0; j < 4; j++)
             {
-                lmscalar x = mtx.a * v->x + mtx.c * v->y + mtx.tx;
-                lmscalar y = mtx.b * v->x + mtx.d * v->y + mtx.ty;
+                lmscalar x = mtx->a * v->x + mtx->c * v->y + mtx->tx;
+                lmscalar y = mtx->b * v->x + mtx->d * v->y + mtx->ty;
 
                 if (x < minx)
                 {
@@ -179,6 +170,27 @@ public:
         resultRect->y      = miny;
         resultRect->width  = maxx - minx;
         resultRect->height = maxy - miny;
+    }
+
+    // gets the bounding rectangle of the quadbatch
+    int _getBounds(lua_State *L)
+    {
+        DisplayObject *targetSpace = NULL;
+
+        // check if we're given a DisplayObject to use as target space
+        if (!lua_isnil(L, 2))
+        {
+            targetSpace = (DisplayObject *)lualoom_getnativepointer(L, 2);
+        }
+
+        // get the Rectangle to store the bounds into
+        Rectangle *resultRect = (Rectangle *)lualoom_getnativepointer(L, 3);
+
+        // transform to target space
+        Matrix mtx;
+        getTargetTransformationMatrix(targetSpace, &mtx);
+
+        getBounds(&mtx, resultRect);
 
         return 0;
     }
@@ -193,19 +205,7 @@ public:
         quad->validate(L, 2);
 
         // check whether we need to allocate more quad storage
-        if (numQuads == maxQuads)
-        {
-            maxQuads = (maxQuads == 0) ? DEFAULT_QUADS : maxQuads * 2;
-            GFX::VertexPosColorTex *newData = (GFX::VertexPosColorTex *)lmAlloc(NULL, sizeof(GFX::VertexPosColorTex) * 4 * maxQuads);
-
-            if (quadData)
-            {
-                memcpy(newData, quadData, numQuads * sizeof(GFX::VertexPosColorTex) * 4);
-                lmFree(NULL, quadData);
-            }
-
-            quadData = newData;
-        }
+        reserveQuads(numQuads + 1);
 
         // ... and add the (transformed) quad data to the batch
         _setQuadData(numQuads, quad, modelViewMatrix);
@@ -214,6 +214,49 @@ public:
         return 0;
     }
 
+    // grows the quad storage to hold at least count quads
+    void reserveQuads(int count)
+    {
+        if (count <= maxQuads)
+        {
+            return;
+        }
+
+        int newMax = (maxQuads == 0) ? DEFAULT_QUADS : maxQuads * 2;
+
+        while (newMax < count)
+        {
+            newMax *= 2;
+        }
+
+        GFX::VertexPosColorTex *newData = (GFX::VertexPosColorTex *)lmAlloc(NULL, sizeof(GFX::VertexPosColorTex) * 4 * newMax);
+
+        if (quadData)
+        {
+            memcpy(newData, quadData, numQuads * sizeof(GFX::VertexPosColorTex) * 4);
+            lmFree(NULL, quadData);
+        }
+
+        quadData = newData;
+        maxQuads = newMax;
+    }
+
+    // appends count quads and returns their vertex memory for the caller to fill in
+    GFX::VertexPosColorTex *addQuads(int count)
+    {
+        reserveQuads(numQuads + count);
+
+        GFX::VertexPosColorTex *v = &quadData[numQuads * 4];
+        numQuads += count;
+
+        if (hitIndexCount)
+        {
+            invalidateHitBounds();
+        }
+
+        return v;
+    }
+
 
     // adds a quad to the QuadBatch
     int _updateQuad(lua_State *L)
@@ -240,6 +283,11 @@ public:
     {
         nativeTextureID = quad->nativeTextureID;
 
+        if (hitIndexCount)
+        {
+            invalidateHitBounds();
+        }
+
         GFX::VertexPosColorTex *dst = &quadData[quadID * 4];
         GFX::VertexPosColorTex *src = quad->quadVertices;
         bool isIdentity = mtx->isIdentity();
@@ -32,6 +32,10 @@
 #include "loom/engine/loom2d/l2dQuad.h"
 #include "loom/engine/loom2d/l2dImage.h"
 #include "loom/engine/loom2d/l2dQuadBatch.h"
+#include "loom/engine/loom2d/l2dBitmapFontLayout.h"
+#include "loom/engine/loom2d/l2dTilemapLayer.h"
+#include "loom/engine/loom2d/l2dParticleSystem.h"
+#include "loom/engine/loom2d/l2dTweenEngine.h"
 
 #include "loom/graphics/gfxShader.h"
 
@@ -58,6 +62,8 @@ public:
         Quad::initialize(L);
         Image::initialize(L);
         QuadBatch::initialize(L);
+        TilemapLayer::initialize(L);
+        ParticleSystem::initialize(L);
 
         sInitialized = true;
     }
@@ -222,8 +228,10 @@ static int registerLoom2D(lua_State *L)
        .deriveClass<DisplayObjectContainer, DisplayObject>("DisplayObjectContainer")
        .addConstructor<void (*)(void)>()
        .addProperty("depthSort", &DisplayObjectContainer::getDepthSort, &DisplayObjectContainer::setDepthSort)
+       .addProperty("spatialIndex", &DisplayObjectContainer::getSpatialIndex, &DisplayObjectContainer::setSpatialIndex)
        //.addProperty("view", &DisplayObjectContainer::getView, &DisplayObjectContainer::setView)
        .addMethod("setClipRect", &DisplayObjectContainer::setClipRect)
+       .addLuaFunction("_hitTest", &DisplayObjectContainer::_hitTest)
        .endClass()
 
     // Stage
@@ -286,6 +294,7 @@ static int registerLoom2D(lua_State *L)
        .addConstructor<void(*)(void)>()
        .addProperty("width", &GFX::VectorSVG::getWidth)
        .addProperty("height", &GFX::VectorSVG::getHeight)
+       .addProperty("rasterize", &GFX::VectorSVG::getRasterize, &GFX::VectorSVG::setRasterize)
        .addMethod("loadFile", &GFX::VectorSVG::loadFile)
        .addMethod("loadString", &GFX::VectorSVG::loadString)
        .endClass()
@@ -352,6 +361,106 @@ static int registerLoom2D(lua_State *L)
        .addLuaFunction("reset", &QuadBatch::reset)
        .endClass()
 
+    // TilemapLayer
+       .deriveClass<TilemapLayer, DisplayObject>("TilemapLayer")
+       .addConstructor<void (*)(void)>()
+       .addVarAccessor("shader", &TilemapLayer::getShader, &TilemapLayer::setShader)
+       .addProperty("mapWidth", &TilemapLayer::getMapWidth)
+       .addProperty("mapHeight", &TilemapLayer::getMapHeight)
+       .addProperty("orientation", &TilemapLayer::getOrientation, &TilemapLayer::setOrientation)
+       .addProperty("visibleChunks", &TilemapLayer::getVisibleChunks)
+       .addMethod("setMapSize", &TilemapLayer::setMapSize)
+       .addMethod("addTileset", &TilemapLayer::addTileset)
+       .addMethod("clearTilesets", &TilemapLayer::clearTilesets)
+       .addMethod("getTile", &TilemapLayer::getTile)
+       .addMethod("setTile", &TilemapLayer::setTile)
+       .addLuaFunction("setTiles", &TilemapLayer::setTiles)
+       .addLuaFunction("_getLocalBounds", &TilemapLayer::getLocalBounds)
+       .endClass()
+
+    // ParticleSystem
+       .deriveClass<ParticleSystem, DisplayObject>("ParticleSystem")
+       .addConstructor<void (*)(void)>()
+       .addVarAccessor("shader", &ParticleSystem::getShader, &ParticleSystem::setShader)
+       .addVar("emissionRate", &ParticleSystem::emissionRate)
+       .addVar("lifespan", &ParticleSystem::lifespan)
+       .addVar("lifespanVariance", &ParticleSystem::lifespanVariance)
+       .addVar("speed", &ParticleSystem::speed)
+       .addVar("speedVariance", &ParticleSystem::speedVariance)
+       .addVar("emitAngle", &ParticleSystem::emitAngle)
+       .addVar("emitAngleVariance", &ParticleSystem::emitAngleVariance)
+       .addVar("gravityX", &ParticleSystem::gravityX)
+       .addVar("gravityY", &ParticleSystem::gravityY)
+       .addVar("emitterX", &ParticleSystem::emitterX)
+       .addVar("emitterY", &ParticleSystem::emitterY)
+       .addVar("emitterXVariance", &ParticleSystem::emitterXVariance)
+       .addVar("emitterYVariance", &ParticleSystem::emitterYVariance)
+       .addVar("rotationVariance", &ParticleSystem::rotationVariance)
+       .addVar("spin", &ParticleSystem::spin)
+       .addVar("spinVariance", &ParticleSystem::spinVariance)
+       .addVar("scaleVariance", &ParticleSystem::scaleVariance)
+       .addProperty("maxParticles", &ParticleSystem::getMaxParticles, &ParticleSystem::setMaxParticles)
+       .addProperty("numParticles", &ParticleSystem::getNumParticles)
+       .addProperty("emitting", &ParticleSystem::isEmitting)
+       .addMethod("start", &ParticleSystem::start)
+       .addMethod("stop", &ParticleSystem::stop)
+       .addMethod("burst", &ParticleSystem::burst)
+       .addMethod("clear", &ParticleSystem::clear)
+       .addMethod("advanceTime", &ParticleSystem::advanceTime)
+       .addMethod("setSeed", &ParticleSystem::setSeed)
+       .addMethod("parseDefinition", &ParticleSystem::parseDefinition)
+       .addMethod("_setTexture", &ParticleSystem::setTexture)
+       .addLuaFunction("setScaleCurve", &ParticleSystem::setScaleCurve)
+       .addLuaFunction("setColorCurve", &ParticleSystem::setColorCurve)
+       .addLuaFunction("_getLocalBounds", &ParticleSystem::getLocalBounds)
+       .addVarAccessor("onComplete", &ParticleSystem::getCompleteDelegate)
+       .endClass()
+
+
+       .endPackage();
+
+    beginPackage(L, "loom2d.text")
+
+    // BitmapFontLayout
+       .beginClass<BitmapFontLayout>("BitmapFontLayout")
+       .addConstructor<void (*)(void)>()
+       .addProperty("size", &BitmapFontLayout::getSize, &BitmapFontLayout::setSize)
+       .addProperty("lineHeight", &BitmapFontLayout::getLineHeight, &BitmapFontLayout::setLineHeight)
+       .addProperty("textureID", &BitmapFontLayout::getTextureID, &BitmapFontLayout::setTextureID)
+       .addProperty("layoutScale", &BitmapFontLayout::getLayoutScale)
+       .addProperty("measuredWidth", &BitmapFontLayout::getMeasuredWidth)
+       .addProperty("measuredHeight", &BitmapFontLayout::getMeasuredHeight)
+       .addMethod("addGlyph", &BitmapFontLayout::addGlyph)
+       .addMethod("addKerning", &BitmapFontLayout::addKerning)
+       .addMethod("getKerning", &BitmapFontLayout::getKerning)
+       .addMethod("fillQuadBatch", &BitmapFontLayout::fillQuadBatch)
+       .addMethod("layout", &BitmapFontLayout::layout)
+       .addMethod("getLayoutCharID", &BitmapFontLayout::getLayoutCharID)
+       .addMethod("getLayoutX", &BitmapFontLayout::getLayoutX)
+       .addMethod("getLayoutY", &BitmapFontLayout::getLayoutY)
+       .addMethod("measure", &BitmapFontLayout::measure)
+       .addMethod("invalidate", &BitmapFontLayout::invalidate)
+       .endClass()
+
+       .endPackage();
+
+    beginPackage(L, "loom2d.animation")
+
+    // TweenEngine
+       .beginClass<TweenEngine>("TweenEngine")
+       .addConstructor<void (*)(void)>()
+       .addProperty("numTweens", &TweenEngine::getNumTweens)
+       .addMethod("add", &TweenEngine::add)
+       .addMethod("remove", &TweenEngine::remove)
+       .addMethod("removeTweens", &TweenEngine::removeTweens)
+       .addMethod("containsTweens", &TweenEngine::containsTweens)
+       .addMethod("contains", &TweenEngine::contains)
+       .addMethod("purge", &TweenEngine::purge)
+       .addMethod("advanceTime", &TweenEngine::advanceTime)
+       .addStaticMethod("ease", &TweenEngine::ease)
+       .addVarAccessor("onRepeat", &TweenEngine::getRepeatDelegate)
+       .addVarAccessor("onComplete", &TweenEngine::getCompleteDelegate)
+       .endClass()
 
        .endPackage();
 
@@ -380,4 +489,8 @@ void installLoom2D()
     LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::Image, Loom2D::registerLoom2D);
     LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::Quad, Loom2D::registerLoom2D);
     LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::QuadBatch, Loom2D::registerLoom2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::TilemapLayer, Loom2D::registerLoom2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::ParticleSystem, Loom2D::registerLoom2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::BitmapFontLayout, Loom2D::registerLoom2D);
+    LOOM_DECLARE_MANAGEDNATIVETYPE(Loom2D::TweenEngine, Loom2D::registerLoom2D);
 }
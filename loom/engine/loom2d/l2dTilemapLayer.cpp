@@ -0,0 +1,628 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/script/loomscript.h"
+#include "loom/script/runtime/lsRuntime.h"
+
+#include "loom/engine/loom2d/l2dTilemapLayer.h"
+#include "loom/engine/loom2d/l2dBlendMode.h"
+#include "loom/graphics/gfxGraphics.h"
+#include "loom/common/core/performance.h"
+
+namespace Loom2D
+{
+Type *TilemapLayer::typeTilemapLayer = NULL;
+
+TilemapLayer::TilemapLayer()
+{
+    type          = typeTilemapLayer;
+    shader        = GFX::ShaderProgram::getDefaultShader();
+    mapWidth      = 0;
+    mapHeight     = 0;
+    tileWidth     = 0.0f;
+    tileHeight    = 0.0f;
+    orientation   = ORTHOGONAL;
+    tiles         = NULL;
+    chunksX       = 0;
+    chunksY       = 0;
+    visibleChunks = 0;
+}
+
+TilemapLayer::~TilemapLayer()
+{
+    freeChunks();
+    lmSafeFree(NULL, tiles);
+}
+
+void TilemapLayer::freeChunks()
+{
+    for (UTsize i = 0; i < chunks.size(); i++)
+    {
+        lmDelete(NULL, chunks[i]);
+    }
+
+    chunks.clear();
+    chunksX = 0;
+    chunksY = 0;
+}
+
+void TilemapLayer::markAllDirty()
+{
+    for (UTsize i = 0; i < chunks.size(); i++)
+    {
+        chunks[i]->dirty = true;
+    }
+
+    // layout changes can move the analytic bounds
+    if (hitIndexCount)
+    {
+        invalidateHitBounds();
+    }
+}
+
+void TilemapLayer::setMapSize(int width, int height, float _tileWidth, float _tileHeight)
+{
+    lmAssert(width >= 0 && height >= 0, "TilemapLayer size must not be negative");
+
+    freeChunks();
+    lmSafeFree(NULL, tiles);
+
+    if (hitIndexCount)
+    {
+        invalidateHitBounds();
+    }
+
+    mapWidth   = width;
+    mapHeight  = height;
+    tileWidth  = _tileWidth;
+    tileHeight = _tileHeight;
+
+    if (!width || !height)
+    {
+        return;
+    }
+
+    tiles = (uint32_t *)lmAlloc(NULL, sizeof(uint32_t) * width * height);
+    memset(tiles, 0, sizeof(uint32_t) * width * height);
+
+    chunksX = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunksY = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    for (int i = 0; i < chunksX * chunksY; i++)
+    {
+        chunks.push_back(lmNew(NULL) Chunk());
+    }
+}
+
+void TilemapLayer::setOrientation(int value)
+{
+    if (orientation == value)
+    {
+        return;
+    }
+
+    orientation = value;
+    markAllDirty();
+}
+
+void TilemapLayer::addTileset(int firstGid, int textureID, int _tileWidth, int _tileHeight, int margin, int spacing)
+{
+    Tileset tileset;
+
+    tileset.firstGid      = (uint32_t)firstGid;
+    tileset.textureID     = textureID;
+    tileset.tileWidth     = _tileWidth;
+    tileset.tileHeight    = _tileHeight;
+    tileset.margin        = margin;
+    tileset.spacing       = spacing;
+    tileset.textureWidth  = 0;
+    tileset.textureHeight = 0;
+
+    tilesets.push_back(tileset);
+    markAllDirty();
+}
+
+void TilemapLayer::clearTilesets()
+{
+    tilesets.clear();
+    markAllDirty();
+}
+
+uint32_t TilemapLayer::getTile(int x, int y) const
+{
+    if ((x < 0) || (y < 0) || (x >= mapWidth) || (y >= mapHeight))
+    {
+        return 0;
+    }
+
+    return tiles[y * mapWidth + x];
+}
+
+void TilemapLayer::setTile(int x, int y, uint32_t gid)
+{
+    if ((x < 0) || (y < 0) || (x >= mapWidth) || (y >= mapHeight))
+    {
+        return;
+    }
+
+    uint32_t *tile = &tiles[y * mapWidth + x];
+
+    if (*tile == gid)
+    {
+        return;
+    }
+
+    *tile = gid;
+    chunks[(y / CHUNK_SIZE) * chunksX + (x / CHUNK_SIZE)]->dirty = true;
+}
+
+int TilemapLayer::setTiles(lua_State *L)
+{
+    if (!lua_istable(L, 2))
+    {
+        return luaL_error(L, "TilemapLayer.setTiles: tiles is null");
+    }
+
+    int length = lsr_vector_get_length(L, 2);
+    int count  = mapWidth * mapHeight;
+
+    if (length > count)
+    {
+        return luaL_error(L, "TilemapLayer.setTiles: given %d tiles for a %dx%d layer", length, mapWidth, mapHeight);
+    }
+
+    // get the Vector.<uint> off the stack
+    lua_rawgeti(L, 2, LSINDEXVECTOR);
+    int tilesTable = lua_gettop(L);
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t gid = 0;
+
+        if (i < length)
+        {
+            lua_rawgeti(L, tilesTable, i);
+            gid = (uint32_t)(long long)lua_tonumber(L, -1);
+            lua_pop(L, 1);
+        }
+
+        tiles[i] = gid;
+    }
+
+    lua_pop(L, 1);
+
+    markAllDirty();
+
+    return 0;
+}
+
+const TilemapLayer::Tileset *TilemapLayer::findTileset(uint32_t gid) const
+{
+    // the tileset with the highest first gid at or below gid
+    const Tileset *result = NULL;
+
+    for (UTsize i = 0; i < tilesets.size(); i++)
+    {
+        const Tileset *tileset = &tilesets[i];
+
+        if ((tileset->firstGid <= gid) && (!result || (tileset->firstGid > result->firstGid)))
+        {
+            result = tileset;
+        }
+    }
+
+    return result;
+}
+
+void TilemapLayer::buildChunk(int chunkX, int chunkY, Chunk *chunk)
+{
+    LOOM_PROFILE_SCOPE(tilemapBuildChunk);
+
+    chunk->dirty    = false;
+    chunk->numQuads = 0;
+    chunk->runs.clear(true);
+
+    chunk->minX = chunk->minY = 0;
+    chunk->maxX = chunk->maxY = 0;
+
+    int x0 = chunkX * CHUNK_SIZE;
+    int y0 = chunkY * CHUNK_SIZE;
+    int x1 = x0 + CHUNK_SIZE > mapWidth ? mapWidth : x0 + CHUNK_SIZE;
+    int y1 = y0 + CHUNK_SIZE > mapHeight ? mapHeight : y0 + CHUNK_SIZE;
+
+    // tiles are added in row order within the chunk, but render draws whole
+    // chunks one after another, so a tile overhanging into the next chunk
+    // can end up below it where one Image per tile would draw it on top
+    for (int y = y0; y < y1; y++)
+    {
+        for (int x = x0; x < x1; x++)
+        {
+            uint32_t raw = tiles[y * mapWidth + x];
+            uint32_t gid = raw & GID_MASK;
+
+            if (!gid)
+            {
+                continue;
+            }
+
+            const Tileset *tileset = findTileset(gid);
+
+            if (!tileset || (tileset->textureWidth <= 0) || (tileset->textureHeight <= 0))
+            {
+                continue;
+            }
+
+            int stepX   = tileset->tileWidth + tileset->spacing;
+            int stepY   = tileset->tileHeight + tileset->spacing;
+            int columns = stepX > 0 ? (tileset->textureWidth - tileset->margin + tileset->spacing) / stepX : 0;
+            int rows    = stepY > 0 ? (tileset->textureHeight - tileset->margin + tileset->spacing) / stepY : 0;
+            int index   = (int)(gid - tileset->firstGid);
+
+            if ((columns <= 0) || (index >= columns * rows))
+            {
+                continue;
+            }
+
+            if (chunk->numQuads == chunk->maxQuads)
+            {
+                int newMax = chunk->maxQuads ? chunk->maxQuads * 2 : 32;
+                GFX::VertexPosColorTex *newData = (GFX::VertexPosColorTex *)lmAlloc(NULL, sizeof(GFX::VertexPosColorTex) * 4 * newMax);
+
+                if (chunk->quadData)
+                {
+                    memcpy(newData, chunk->quadData, sizeof(GFX::VertexPosColorTex) * 4 * chunk->numQuads);
+                    lmFree(NULL, chunk->quadData);
+                }
+
+                chunk->quadData = newData;
+                chunk->maxQuads = newMax;
+            }
+
+            // start a new run whenever the texture changes
+            if (!chunk->runs.size() || (chunk->runs[chunk->runs.size() - 1].textureID != tileset->textureID))
+            {
+                ChunkRun run;
+                run.textureID = tileset->textureID;
+                run.firstQuad = chunk->numQuads;
+                run.numQuads  = 0;
+                chunk->runs.push_back(run);
+            }
+
+            chunk->runs[chunk->runs.size() - 1].numQuads++;
+
+            // tile position in the layer
+            float px, py;
+
+            if (orientation == ISOMETRIC)
+            {
+                px = x * tileWidth / 2 - y * tileWidth / 2;
+                py = x * tileHeight / 2 + y * tileHeight / 2;
+            }
+            else
+            {
+                px = x * tileWidth;
+                py = y * tileHeight;
+            }
+
+            // the source region is inset by half a texel and the quad grown by
+            // half a pixel to hide seams between neighbouring tiles
+            float sx = (float)(tileset->margin + (index % columns) * stepX);
+            float sy = (float)(tileset->margin + (index / columns) * stepY);
+
+            float u0 = (sx + 0.5f) / tileset->textureWidth;
+            float v0 = (sy + 0.5f) / tileset->textureHeight;
+            float u1 = (sx + tileset->tileWidth) / tileset->textureWidth;
+            float v1 = (sy + tileset->tileHeight) / tileset->textureHeight;
+
+            float w = tileset->tileWidth + 0.5f;
+            float h = tileset->tileHeight + 0.5f;
+
+            GFX::VertexPosColorTex *v = &chunk->quadData[chunk->numQuads * 4];
+
+            for (int i = 0; i < 4; i++)
+            {
+                // corners in TL, TR, BL, BR order
+                int cx = i & 1;
+                int cy = i >> 1;
+
+                // the texel shown at a corner: TMX flips apply diagonal first,
+                // then horizontal, then vertical, so undo them in reverse
+                int tx = cx;
+                int ty = cy;
+
+                if (raw & FLIPPED_VERTICALLY_FLAG)
+                {
+                    ty = 1 - ty;
+                }
+
+                if (raw & FLIPPED_HORIZONTALLY_FLAG)
+                {
+                    tx = 1 - tx;
+                }
+
+                if (raw & FLIPPED_DIAGONALLY_FLAG)
+                {
+                    int swap = tx;
+                    tx = ty;
+                    ty = swap;
+                }
+
+                v[i].x    = px + cx * w;
+                v[i].y    = py + cy * h;
+                v[i].z    = 0.0f;
+                v[i].abgr = 0xFFFFFFFF;
+                v[i].u    = tx ? u1 : u0;
+                v[i].v    = ty ? v1 : v0;
+            }
+
+            if (chunk->numQuads == 0)
+            {
+                chunk->minX = px;
+                chunk->minY = py;
+                chunk->maxX = px + w;
+                chunk->maxY = py + h;
+            }
+            else
+            {
+                if (px < chunk->minX) chunk->minX = px;
+                if (py < chunk->minY) chunk->minY = py;
+                if (px + w > chunk->maxX) chunk->maxX = px + w;
+                if (py + h > chunk->maxY) chunk->maxY = py + h;
+            }
+
+            chunk->numQuads++;
+        }
+    }
+}
+
+void TilemapLayer::getMaxTileSize(int& maxTileWidth, int& maxTileHeight) const
+{
+    // tiles are anchored at their grid position, the largest one may hang over the grid
+    maxTileWidth  = 0;
+    maxTileHeight = 0;
+
+    for (UTsize i = 0; i < tilesets.size(); i++)
+    {
+        if (tilesets[i].tileWidth > maxTileWidth)
+        {
+            maxTileWidth = tilesets[i].tileWidth;
+        }
+
+        if (tilesets[i].tileHeight > maxTileHeight)
+        {
+            maxTileHeight = tilesets[i].tileHeight;
+        }
+    }
+}
+
+void TilemapLayer::computeLocalBounds(lmscalar& minX, lmscalar& minY, lmscalar& maxX, lmscalar& maxY) const
+{
+    int maxTileWidth, maxTileHeight;
+    getMaxTileSize(maxTileWidth, maxTileHeight);
+
+    if (orientation == ISOMETRIC)
+    {
+        minX = -(mapHeight - 1) * tileWidth / 2;
+        minY = 0;
+        maxX = (mapWidth - 1) * tileWidth / 2 + maxTileWidth + 0.5f;
+        maxY = (mapWidth + mapHeight - 2) * tileHeight / 2 + maxTileHeight + 0.5f;
+    }
+    else
+    {
+        minX = 0;
+        minY = 0;
+        maxX = (mapWidth - 1) * tileWidth + maxTileWidth + 0.5f;
+        maxY = (mapHeight - 1) * tileHeight + maxTileHeight + 0.5f;
+    }
+}
+
+void TilemapLayer::getLocalBoundsRect(Rectangle *resultRect) const
+{
+    if (!mapWidth || !mapHeight)
+    {
+        resultRect->setTo(0, 0, 0, 0);
+        return;
+    }
+
+    lmscalar minX, minY, maxX, maxY;
+    computeLocalBounds(minX, minY, maxX, maxY);
+
+    resultRect->setTo(minX, minY, maxX - minX, maxY - minY);
+}
+
+int TilemapLayer::getLocalBounds(lua_State *L)
+{
+    // get the Rectangle to store the bounds into
+    Rectangle *resultRect = (Rectangle *)lualoom_getnativepointer(L, 2);
+
+    getLocalBoundsRect(resultRect);
+
+    return 0;
+}
+
+void TilemapLayer::render(lua_State *L)
+{
+    visibleChunks = 0;
+
+    if (!chunks.size() || !tilesets.size())
+    {
+        return;
+    }
+
+    // apply the parent alpha
+    renderState.alpha = parent ? parent->renderState.alpha * alpha : alpha;
+    renderState.clampAlpha();
+
+    if (renderState.alpha == 0.0f)
+    {
+        return;
+    }
+
+    LOOM_PROFILE_SCOPE(tilemapRender);
+
+    renderState.clipRect = parent ? parent->renderState.clipRect : Loom2D::Rectangle(0, 0, -1, -1);
+    if (renderState.isClipping()) GFX::Graphics::setClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height);
+
+    //set blend mode based to be unique or that of our parent
+    renderState.blendMode = (blendMode == BlendMode::AUTO && parent) ? parent->renderState.blendMode : blendMode;
+
+    unsigned int blendSrc, blendDst;
+    BlendMode::BlendFunction(renderState.blendMode, blendSrc, blendDst);
+
+    // rebuild every chunk if a tileset texture was (re)loaded at another size
+    for (UTsize i = 0; i < tilesets.size(); i++)
+    {
+        Tileset *tileset = &tilesets[i];
+        GFX::TextureInfo *tinfo = GFX::Texture::getTextureInfo(tileset->textureID);
+
+        int width  = tinfo ? tinfo->width : 0;
+        int height = tinfo ? tinfo->height : 0;
+
+        if ((width != tileset->textureWidth) || (height != tileset->textureHeight))
+        {
+            tileset->textureWidth  = width;
+            tileset->textureHeight = height;
+            markAllDirty();
+        }
+    }
+
+    // update and get our transformation matrix
+    updateLocalTransform();
+
+    Matrix mtx;
+    getTargetTransformationMatrix(NULL, &mtx);
+
+    if (mtx.determinant() == 0)
+    {
+        return;
+    }
+
+    // the visible area in layer space, from the clip rect or the whole render target
+    Rectangle view = renderState.isClipping() ? renderState.clipRect :
+                     Rectangle(0, 0, (lmscalar)GFX::Graphics::getWidth(), (lmscalar)GFX::Graphics::getHeight());
+
+    Matrix inverse;
+    inverse.copyFrom(&mtx);
+    inverse.invert();
+
+    Rectangle localView;
+    transformBounds(&inverse, &view, &localView);
+
+    lmscalar viewMinX = localView.x;
+    lmscalar viewMinY = localView.y;
+    lmscalar viewMaxX = localView.x + localView.width;
+    lmscalar viewMaxY = localView.y + localView.height;
+
+    int maxTileWidth, maxTileHeight;
+    getMaxTileSize(maxTileWidth, maxTileHeight);
+
+    bool isIdentity = mtx.isIdentity();
+
+    for (int cy = 0; cy < chunksY; cy++)
+    {
+        for (int cx = 0; cx < chunksX; cx++)
+        {
+            Chunk *chunk = chunks[cy * chunksX + cx];
+
+            // grid bounds of the chunk before it is built
+            lmscalar minX, minY, maxX, maxY;
+            int x0 = cx * CHUNK_SIZE;
+            int y0 = cy * CHUNK_SIZE;
+            int x1 = (x0 + CHUNK_SIZE > mapWidth ? mapWidth : x0 + CHUNK_SIZE) - 1;
+            int y1 = (y0 + CHUNK_SIZE > mapHeight ? mapHeight : y0 + CHUNK_SIZE) - 1;
+
+            if (orientation == ISOMETRIC)
+            {
+                minX = x0 * tileWidth / 2 - y1 * tileWidth / 2;
+                maxX = x1 * tileWidth / 2 - y0 * tileWidth / 2 + maxTileWidth + 0.5f;
+                minY = (x0 + y0) * tileHeight / 2;
+                maxY = (x1 + y1) * tileHeight / 2 + maxTileHeight + 0.5f;
+            }
+            else
+            {
+                minX = x0 * tileWidth;
+                maxX = x1 * tileWidth + maxTileWidth + 0.5f;
+                minY = y0 * tileHeight;
+                maxY = y1 * tileHeight + maxTileHeight + 0.5f;
+            }
+
+            if ((maxX < viewMinX) || (minX > viewMaxX) || (maxY < viewMinY) || (minY > viewMaxY))
+            {
+                continue;
+            }
+
+            if (chunk->dirty)
+            {
+                buildChunk(cx, cy, chunk);
+            }
+
+            if (!chunk->numQuads)
+            {
+                continue;
+            }
+
+            // the built bounds are tighter for sparse chunks
+            if ((chunk->maxX < viewMinX) || (chunk->minX > viewMaxX) || (chunk->maxY < viewMinY) || (chunk->minY > viewMaxY))
+            {
+                continue;
+            }
+
+            visibleChunks++;
+
+            for (UTsize r = 0; r < chunk->runs.size(); r++)
+            {
+                const ChunkRun& run = chunk->runs[r];
+                GFX::VertexPosColorTex *src = &chunk->quadData[run.firstQuad * 4];
+
+                // quick path if the transform is identity and there is no alpha modulation
+                if ((renderState.alpha == 1.0f) && isIdentity)
+                {
+                    GFX::QuadRenderer::batch(src, 4 * run.numQuads, run.textureID, blendEnabled, blendSrc, blendDst, shader);
+                    continue;
+                }
+
+                GFX::VertexPosColorTex *v = GFX::QuadRenderer::getQuadVertexMemory(4 * run.numQuads, run.textureID, blendEnabled, blendSrc, blendDst, shader);
+
+                if (!v)
+                {
+                    continue;
+                }
+
+                uint32_t abgr = ((uint32_t)(renderState.alpha * 255.0f) << 24) | 0x00FFFFFF;
+
+                for (int i = 0; i < run.numQuads * 4; i++)
+                {
+                    *v = *src;
+
+                    lmscalar _x = mtx.a * v->x + mtx.c * v->y + mtx.tx;
+                    lmscalar _y = mtx.b * v->x + mtx.d * v->y + mtx.ty;
+
+                    v->x    = (float)_x;
+                    v->y    = (float)_y;
+                    v->abgr = abgr;
+
+                    v++;
+                    src++;
+                }
+            }
+        }
+    }
+}
+}
@@ -0,0 +1,178 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/engine/loom2d/l2dDisplayObjectContainer.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxShader.h"
+
+namespace Loom2D
+{
+// Native side of the TilemapLayer script class
+//
+// Stores the gids of a TMX layer in a packed array and renders them from
+// per-chunk vertex buffers, rebuilt only when tiles or tilesets change.
+// Chunks outside the clip rect (or the render target when not clipping)
+// are skipped. Chunks draw one after another, each in row order, so tiles
+// larger than the grid only overlap in row order within a chunk.
+class TilemapLayer : public DisplayObject
+{
+public:
+
+    // static type cache
+    static Type *typeTilemapLayer;
+
+    // initialize type information
+    static void initialize(lua_State *L)
+    {
+        typeTilemapLayer = LSLuaState::getLuaState(L)->getType("loom2d.display.TilemapLayer");
+        lmAssert(typeTilemapLayer, "unable to get loom2d.display.TilemapLayer type");
+    }
+
+    enum Orientation
+    {
+        ORTHOGONAL = 0,
+        ISOMETRIC  = 1
+    };
+
+    // TMX gid flags, the remaining bits are the tile gid
+    static const uint32_t FLIPPED_HORIZONTALLY_FLAG = 0x80000000;
+    static const uint32_t FLIPPED_VERTICALLY_FLAG   = 0x40000000;
+    static const uint32_t FLIPPED_DIAGONALLY_FLAG   = 0x20000000;
+    static const uint32_t GID_MASK                  = 0x1FFFFFFF;
+
+    // chunks are CHUNK_SIZE x CHUNK_SIZE tiles
+    static const int CHUNK_SIZE = 16;
+
+    struct Tileset
+    {
+        uint32_t firstGid;
+        int      textureID;
+        int      tileWidth, tileHeight;
+        int      margin, spacing;
+
+        // texture size the tile UVs were last built for
+        int      textureWidth, textureHeight;
+    };
+
+    // consecutive quads of a chunk sharing a texture
+    struct ChunkRun
+    {
+        int textureID;
+        int firstQuad;
+        int numQuads;
+    };
+
+    struct Chunk
+    {
+        bool dirty;
+
+        GFX::VertexPosColorTex *quadData;
+        int numQuads;
+        int maxQuads;
+
+        utArray<ChunkRun> runs;
+
+        // local space bounds of the chunk's quads
+        lmscalar minX, minY, maxX, maxY;
+
+        Chunk()
+        {
+            dirty    = true;
+            quadData = NULL;
+            numQuads = 0;
+            maxQuads = 0;
+            minX     = minY = maxX = maxY = 0;
+        }
+
+        ~Chunk()
+        {
+            lmSafeFree(NULL, quadData);
+        }
+    };
+
+    TilemapLayer();
+    ~TilemapLayer();
+
+    // resizes the layer, clearing all tiles
+    void setMapSize(int width, int height, float tileWidth, float tileHeight);
+
+    int getMapWidth() const { return mapWidth; }
+    int getMapHeight() const { return mapHeight; }
+
+    int getOrientation() const { return orientation; }
+    void setOrientation(int value);
+
+    void addTileset(int firstGid, int textureID, int tileWidth, int tileHeight, int margin, int spacing);
+    void clearTilesets();
+
+    // gid including the TMX flip flags
+    uint32_t getTile(int x, int y) const;
+    void setTile(int x, int y, uint32_t gid);
+
+    // copies a Vector.<uint> of width * height gids in row order
+    int setTiles(lua_State *L);
+
+    // bounds of the whole layer in local space
+    void getLocalBoundsRect(Rectangle *resultRect) const;
+    int getLocalBounds(lua_State *L);
+
+    // the number of chunks submitted by the last render
+    int getVisibleChunks() const { return visibleChunks; }
+
+    GFX::ShaderProgram *shader;
+
+    void setShader(GFX::ShaderProgram* sh)
+    {
+        shader = sh;
+    }
+
+    GFX::ShaderProgram* getShader() const
+    {
+        return shader;
+    }
+
+    void render(lua_State *L);
+
+private:
+
+    void freeChunks();
+    void markAllDirty();
+    void buildChunk(int chunkX, int chunkY, Chunk *chunk);
+    void getMaxTileSize(int& maxTileWidth, int& maxTileHeight) const;
+    void computeLocalBounds(lmscalar& minX, lmscalar& minY, lmscalar& maxX, lmscalar& maxY) const;
+    const Tileset *findTileset(uint32_t gid) const;
+
+    int   mapWidth, mapHeight;
+    float tileWidth, tileHeight;
+    int   orientation;
+
+    uint32_t *tiles;
+
+    utArray<Tileset> tilesets;
+
+    int chunksX, chunksY;
+    utArray<Chunk *> chunks;
+
+    int visibleChunks;
+};
+}
@@ -0,0 +1,531 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dTweenEngine.h"
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/common/core/assert.h"
+#include "loom/common/core/performance.h"
+
+namespace Loom2D
+{
+utArray<TweenEngine *> TweenEngine::engines;
+
+static const lmscalar TWEEN_PI = 3.14159265358979323846;
+
+// easing functions ported from loom2d.animation.Transitions
+
+static lmscalar easeIn(lmscalar ratio)
+{
+    return ratio * ratio * ratio;
+}
+
+static lmscalar easeOut(lmscalar ratio)
+{
+    lmscalar invRatio = ratio - 1.0;
+
+    return invRatio * invRatio * invRatio + 1;
+}
+
+static lmscalar easeInBack(lmscalar ratio)
+{
+    lmscalar s = 1.70158;
+
+    return ratio * ratio * ((s + 1.0) * ratio - s);
+}
+
+static lmscalar easeOutBack(lmscalar ratio)
+{
+    lmscalar invRatio = ratio - 1.0;
+    lmscalar s        = 1.70158;
+
+    return invRatio * invRatio * ((s + 1.0) * invRatio + s) + 1.0;
+}
+
+static lmscalar easeInElastic(lmscalar ratio)
+{
+    if ((ratio == 0) || (ratio == 1))
+    {
+        return ratio;
+    }
+
+    lmscalar p        = 0.3;
+    lmscalar s        = p / 4.0;
+    lmscalar invRatio = ratio - 1;
+
+    return -1.0 * pow(2.0, 10.0 * invRatio) * sin((invRatio - s) * (2.0 * TWEEN_PI) / p);
+}
+
+static lmscalar easeOutElastic(lmscalar ratio)
+{
+    if ((ratio == 0) || (ratio == 1))
+    {
+        return ratio;
+    }
+
+    lmscalar p = 0.3;
+    lmscalar s = p / 4.0;
+
+    return pow(2.0, -10.0 * ratio) * sin((ratio - s) * (2.0 * TWEEN_PI) / p) + 1;
+}
+
+static lmscalar easeOutBounce(lmscalar ratio)
+{
+    lmscalar s = 7.5625;
+    lmscalar p = 2.75;
+
+    if (ratio < (1.0 / p))
+    {
+        return s * ratio * ratio;
+    }
+
+    if (ratio < (2.0 / p))
+    {
+        ratio -= 1.5 / p;
+        return s * ratio * ratio + 0.75;
+    }
+
+    if (ratio < (2.5 / p))
+    {
+        ratio -= 2.25 / p;
+        return s * ratio * ratio + 0.9375;
+    }
+
+    ratio -= 2.625 / p;
+    return s * ratio * ratio + 0.984375;
+}
+
+static lmscalar easeInBounce(lmscalar ratio)
+{
+    return 1.0 - easeOutBounce(1.0 - ratio);
+}
+
+typedef lmscalar (*EasingFunction)(lmscalar ratio);
+
+static lmscalar easeCombined(EasingFunction startFunc, EasingFunction endFunc, lmscalar ratio)
+{
+    if (ratio < 0.5)
+    {
+        return 0.5 * startFunc(ratio * 2.0);
+    }
+
+    return 0.5 * endFunc((ratio - 0.5) * 2.0) + 0.5;
+}
+
+lmscalar TweenEngine::ease(int easing, lmscalar ratio)
+{
+    switch (easing)
+    {
+    case EASING_EASE_IN:
+        return easeIn(ratio);
+
+    case EASING_EASE_OUT:
+        return easeOut(ratio);
+
+    case EASING_EASE_IN_OUT:
+        return easeCombined(easeIn, easeOut, ratio);
+
+    case EASING_EASE_OUT_IN:
+        return easeCombined(easeOut, easeIn, ratio);
+
+    case EASING_EASE_IN_BACK:
+        return easeInBack(ratio);
+
+    case EASING_EASE_OUT_BACK:
+        return easeOutBack(ratio);
+
+    case EASING_EASE_IN_OUT_BACK:
+        return easeCombined(easeInBack, easeOutBack, ratio);
+
+    case EASING_EASE_OUT_IN_BACK:
+        return easeCombined(easeOutBack, easeInBack, ratio);
+
+    case EASING_EASE_IN_ELASTIC:
+        return easeInElastic(ratio);
+
+    case EASING_EASE_OUT_ELASTIC:
+        return easeOutElastic(ratio);
+
+    case EASING_EASE_IN_OUT_ELASTIC:
+        return easeCombined(easeInElastic, easeOutElastic, ratio);
+
+    case EASING_EASE_OUT_IN_ELASTIC:
+        return easeCombined(easeOutElastic, easeInElastic, ratio);
+
+    case EASING_EASE_IN_BOUNCE:
+        return easeInBounce(ratio);
+
+    case EASING_EASE_OUT_BOUNCE:
+        return easeOutBounce(ratio);
+
+    case EASING_EASE_IN_OUT_BOUNCE:
+        return easeCombined(easeInBounce, easeOutBounce, ratio);
+
+    case EASING_EASE_OUT_IN_BOUNCE:
+        return easeCombined(easeOutBounce, easeInBounce, ratio);
+
+    default:
+        return ratio;
+    }
+}
+
+static lmscalar getProperty(DisplayObject *target, int property)
+{
+    switch (property)
+    {
+    case TweenEngine::PROPERTY_X:
+        return target->getX();
+
+    case TweenEngine::PROPERTY_Y:
+        return target->getY();
+
+    case TweenEngine::PROPERTY_SCALE_X:
+        return target->getScaleX();
+
+    case TweenEngine::PROPERTY_SCALE_Y:
+        return target->getScaleY();
+
+    case TweenEngine::PROPERTY_ROTATION:
+        return target->getRotation();
+
+    case TweenEngine::PROPERTY_ALPHA:
+        return target->getAlpha();
+
+    case TweenEngine::PROPERTY_PIVOT_X:
+        return target->getPivotX();
+
+    case TweenEngine::PROPERTY_PIVOT_Y:
+        return target->getPivotY();
+
+    case TweenEngine::PROPERTY_SKEW_X:
+        return target->getSkewX();
+
+    case TweenEngine::PROPERTY_SKEW_Y:
+        return target->getSkewY();
+    }
+
+    return 0;
+}
+
+static void setProperty(DisplayObject *target, int property, lmscalar value)
+{
+    switch (property)
+    {
+    case TweenEngine::PROPERTY_X:
+        target->setX(value);
+        break;
+
+    case TweenEngine::PROPERTY_Y:
+        target->setY(value);
+        break;
+
+    case TweenEngine::PROPERTY_SCALE_X:
+        target->setScaleX(value);
+        break;
+
+    case TweenEngine::PROPERTY_SCALE_Y:
+        target->setScaleY(value);
+        break;
+
+    case TweenEngine::PROPERTY_ROTATION:
+        target->setRotation(value);
+        break;
+
+    case TweenEngine::PROPERTY_ALPHA:
+        target->setAlpha(value);
+        break;
+
+    case TweenEngine::PROPERTY_PIVOT_X:
+        target->setPivotX(value);
+        break;
+
+    case TweenEngine::PROPERTY_PIVOT_Y:
+        target->setPivotY(value);
+        break;
+
+    case TweenEngine::PROPERTY_SKEW_X:
+        target->setSkewX(value);
+        break;
+
+    case TweenEngine::PROPERTY_SKEW_Y:
+        target->setSkewY(value);
+        break;
+    }
+}
+
+TweenEngine::TweenEngine()
+{
+    nextID    = 1;
+    numActive = 0;
+
+    engines.push_back(this);
+}
+
+TweenEngine::~TweenEngine()
+{
+    purge();
+
+    engines.erase(this);
+}
+
+int TweenEngine::add(DisplayObject *target, int property, lmscalar endValue, lmscalar time, int easing,
+                     lmscalar delay, int repeatCount, lmscalar repeatDelay, bool reverse)
+{
+    lmAssert(target, "TweenEngine can't tween a null target");
+    lmAssert((property >= 0) && (property < PROPERTY_COUNT), "Invalid TweenEngine property %d", property);
+    lmAssert((easing >= 0) && (easing < EASING_COUNT), "Invalid TweenEngine easing %d", easing);
+
+    Tween tween;
+
+    tween.target       = target;
+    tween.id           = nextID++;
+    tween.property     = property;
+    tween.easing       = easing;
+    tween.reverse      = reverse;
+    tween.started      = false;
+    tween.startValue   = 0;
+    tween.endValue     = endValue;
+    tween.totalTime    = time > 0.0001 ? time : 0.0001;
+    tween.currentTime  = -delay;
+    tween.repeatDelay  = repeatDelay;
+    tween.repeatCount  = repeatCount;
+    tween.currentCycle = -1;
+
+    tweens.push_back(tween);
+
+    target->tweenCount++;
+    numActive++;
+
+    return tween.id;
+}
+
+void TweenEngine::release(Tween& tween)
+{
+    if (!tween.target)
+    {
+        return;
+    }
+
+    tween.target->tweenCount--;
+    tween.target = NULL;
+    numActive--;
+}
+
+void TweenEngine::remove(int id)
+{
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        if ((tweens[i].id == id) && tweens[i].target)
+        {
+            release(tweens[i]);
+            return;
+        }
+    }
+}
+
+void TweenEngine::removeTweens(DisplayObject *target)
+{
+    if (!target || !target->tweenCount)
+    {
+        return;
+    }
+
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        if (tweens[i].target == target)
+        {
+            release(tweens[i]);
+        }
+    }
+}
+
+bool TweenEngine::containsTweens(DisplayObject *target)
+{
+    if (!target || !target->tweenCount)
+    {
+        return false;
+    }
+
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        if (tweens[i].target == target)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TweenEngine::contains(int id)
+{
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        if ((tweens[i].id == id) && tweens[i].target)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TweenEngine::purge()
+{
+    for (UTsize i = 0; i < tweens.size(); i++)
+    {
+        release(tweens[i]);
+    }
+}
+
+void TweenEngine::releaseTarget(DisplayObject *target)
+{
+    for (UTsize i = 0; i < engines.size(); i++)
+    {
+        engines[i]->removeTweens(target);
+    }
+}
+
+bool TweenEngine::advanceTween(Tween& tween, lmscalar time)
+{
+    // mirrors Tween.advanceTime, carried over time is handled by looping
+    // instead of recursing
+    for ( ; ; )
+    {
+        if ((time == 0) || ((tween.repeatCount == 1) && (tween.currentTime == tween.totalTime)))
+        {
+            return true;
+        }
+
+        lmscalar previousTime  = tween.currentTime;
+        lmscalar restTime      = tween.totalTime - tween.currentTime;
+        lmscalar carryOverTime = time > restTime ? time - restTime : 0.0;
+
+        tween.currentTime = tween.currentTime + time < tween.totalTime ? tween.currentTime + time : tween.totalTime;
+
+        if (tween.currentTime <= 0)
+        {
+            // the delay is not over yet
+            return true;
+        }
+
+        if ((tween.currentCycle < 0) && (previousTime <= 0) && (tween.currentTime > 0))
+        {
+            tween.currentCycle++;
+        }
+
+        if (!tween.started)
+        {
+            tween.startValue = getProperty(tween.target, tween.property);
+            tween.started    = true;
+        }
+
+        lmscalar ratio    = tween.currentTime / tween.totalTime;
+        bool     reversed = tween.reverse && (tween.currentCycle % 2 == 1);
+        lmscalar progress = ease(tween.easing, reversed ? 1.0 - ratio : ratio);
+
+        setProperty(tween.target, tween.property, tween.startValue + progress * (tween.endValue - tween.startValue));
+
+        if ((previousTime < tween.totalTime) && (tween.currentTime >= tween.totalTime))
+        {
+            if ((tween.repeatCount == 0) || (tween.repeatCount > 1))
+            {
+                tween.currentTime = -tween.repeatDelay;
+                tween.currentCycle++;
+
+                if (tween.repeatCount > 1)
+                {
+                    tween.repeatCount--;
+                }
+
+                Event e = { EVENT_REPEAT, tween.id };
+                events.push_back(e);
+            }
+            else
+            {
+                Event e = { EVENT_COMPLETE, tween.id };
+                events.push_back(e);
+
+                return false;
+            }
+        }
+
+        if (carryOverTime == 0)
+        {
+            return true;
+        }
+
+        time = carryOverTime;
+    }
+}
+
+void TweenEngine::advanceTime(lmscalar time)
+{
+    LOOM_PROFILE_SCOPE(tweenEngineAdvance);
+
+    // no script runs during the pass, so the array can be compacted in place
+    UTsize count = tweens.size();
+    UTsize alive = 0;
+
+    for (UTsize i = 0; i < count; i++)
+    {
+        Tween& tween = tweens[i];
+
+        if (!tween.target)
+        {
+            continue;
+        }
+
+        if (!advanceTween(tween, time))
+        {
+            release(tween);
+            continue;
+        }
+
+        if (alive != i)
+        {
+            tweens[alive] = tween;
+        }
+
+        alive++;
+    }
+
+    tweens.resize(alive);
+
+    // deliver the events now that the array is consistent again, listeners
+    // may add or remove tweens
+    for (UTsize i = 0; i < events.size(); i++)
+    {
+        Event e = events[i];
+
+        if (e.type == EVENT_REPEAT)
+        {
+            _RepeatDelegate.pushArgument(e.id);
+            _RepeatDelegate.invoke();
+        }
+        else
+        {
+            _CompleteDelegate.pushArgument(e.id);
+            _CompleteDelegate.invoke();
+        }
+    }
+
+    events.clear(true);
+}
+}
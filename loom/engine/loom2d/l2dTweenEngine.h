@@ -0,0 +1,156 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/common/utils/utTypes.h"
+#include "loom/script/native/lsNativeDelegate.h"
+
+namespace Loom2D
+{
+class DisplayObject;
+
+// Animates DisplayObject transform and alpha properties natively. Tweens
+// live in one packed array and are all advanced in a single pass, events
+// are collected during the pass and delivered through delegates after it,
+// so callbacks can freely add and remove tweens.
+class TweenEngine
+{
+public:
+
+    enum Property
+    {
+        PROPERTY_X,
+        PROPERTY_Y,
+        PROPERTY_SCALE_X,
+        PROPERTY_SCALE_Y,
+        PROPERTY_ROTATION,
+        PROPERTY_ALPHA,
+        PROPERTY_PIVOT_X,
+        PROPERTY_PIVOT_Y,
+        PROPERTY_SKEW_X,
+        PROPERTY_SKEW_Y,
+        PROPERTY_COUNT
+    };
+
+    // same set and order as the names in loom2d.animation.Transitions
+    enum Easing
+    {
+        EASING_LINEAR,
+        EASING_EASE_IN,
+        EASING_EASE_OUT,
+        EASING_EASE_IN_OUT,
+        EASING_EASE_OUT_IN,
+        EASING_EASE_IN_BACK,
+        EASING_EASE_OUT_BACK,
+        EASING_EASE_IN_OUT_BACK,
+        EASING_EASE_OUT_IN_BACK,
+        EASING_EASE_IN_ELASTIC,
+        EASING_EASE_OUT_ELASTIC,
+        EASING_EASE_IN_OUT_ELASTIC,
+        EASING_EASE_OUT_IN_ELASTIC,
+        EASING_EASE_IN_BOUNCE,
+        EASING_EASE_OUT_BOUNCE,
+        EASING_EASE_IN_OUT_BOUNCE,
+        EASING_EASE_OUT_IN_BOUNCE,
+        EASING_COUNT
+    };
+
+    struct Tween
+    {
+        // NULL once removed, compacted away on the next advance
+        DisplayObject *target;
+        int           id;
+        int           property;
+        int           easing;
+        bool          reverse;
+        bool          started;
+
+        // start value is read from the target when the tween starts
+        lmscalar startValue;
+        lmscalar endValue;
+
+        lmscalar totalTime;
+        lmscalar currentTime;
+        lmscalar repeatDelay;
+        int      repeatCount;
+        int      currentCycle;
+    };
+
+    TweenEngine();
+    ~TweenEngine();
+
+    // adds a tween and returns its id, a repeatCount of 0 repeats forever
+    int add(DisplayObject *target, int property, lmscalar endValue, lmscalar time, int easing,
+            lmscalar delay, int repeatCount, lmscalar repeatDelay, bool reverse);
+
+    void remove(int id);
+    void removeTweens(DisplayObject *target);
+    bool containsTweens(DisplayObject *target);
+    bool contains(int id);
+    void purge();
+
+    void advanceTime(lmscalar time);
+
+    int getNumTweens() const
+    {
+        return numActive;
+    }
+
+    // evaluates an easing function, ratio in the range 0-1
+    static lmscalar ease(int easing, lmscalar ratio);
+
+    // drops every tween of a DisplayObject that is being destroyed
+    static void releaseTarget(DisplayObject *target);
+
+    // called with the tween id when a repetition finishes (except the last)
+    LOOM_DELEGATE(Repeat);
+
+    // called with the tween id after the last repetition finished
+    LOOM_DELEGATE(Complete);
+
+private:
+
+    enum EventType
+    {
+        EVENT_REPEAT,
+        EVENT_COMPLETE
+    };
+
+    struct Event
+    {
+        int type;
+        int id;
+    };
+
+    // advances one tween, returns false once it completed
+    bool advanceTween(Tween& tween, lmscalar time);
+
+    void release(Tween& tween);
+
+    utArray<Tween> tweens;
+    utArray<Event> events;
+
+    int nextID;
+    int numActive;
+
+    static utArray<TweenEngine *> engines;
+};
+}
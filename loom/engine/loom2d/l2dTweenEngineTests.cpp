@@ -0,0 +1,209 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/engine/loom2d/l2dDisplayObject.h"
+#include "loom/engine/loom2d/l2dTweenEngine.h"
+#include "seatest.h"
+
+using namespace Loom2D;
+
+SEATEST_FIXTURE(tweenEngine)
+{
+    SEATEST_FIXTURE_ENTRY(tweenEngine_ease);
+    SEATEST_FIXTURE_ENTRY(tweenEngine_delay);
+    SEATEST_FIXTURE_ENTRY(tweenEngine_completion);
+    SEATEST_FIXTURE_ENTRY(tweenEngine_repeat);
+    SEATEST_FIXTURE_ENTRY(tweenEngine_reverse);
+    SEATEST_FIXTURE_ENTRY(tweenEngine_remove);
+}
+
+static const float TWEEN_EPSILON = 0.0001f;
+
+SEATEST_TEST(tweenEngine_ease)
+{
+    // Every easing starts at 0 and ends at 1
+    for (int easing = 0; easing < TweenEngine::EASING_COUNT; easing++)
+    {
+        assert_float_equal(0, (float)TweenEngine::ease(easing, 0), TWEEN_EPSILON);
+        assert_float_equal(1, (float)TweenEngine::ease(easing, 1), TWEEN_EPSILON);
+    }
+
+    assert_float_equal(0.5f, (float)TweenEngine::ease(TweenEngine::EASING_LINEAR, 0.5), TWEEN_EPSILON);
+    assert_float_equal(0.125f, (float)TweenEngine::ease(TweenEngine::EASING_EASE_IN, 0.5), TWEEN_EPSILON);
+    assert_float_equal(0.875f, (float)TweenEngine::ease(TweenEngine::EASING_EASE_OUT, 0.5), TWEEN_EPSILON);
+
+    // Combined easings meet halfway
+    assert_float_equal(0.5f, (float)TweenEngine::ease(TweenEngine::EASING_EASE_IN_OUT, 0.5), TWEEN_EPSILON);
+    assert_float_equal(0.0625f, (float)TweenEngine::ease(TweenEngine::EASING_EASE_IN_OUT, 0.25), TWEEN_EPSILON);
+    assert_float_equal(0.5f, (float)TweenEngine::ease(TweenEngine::EASING_EASE_OUT_IN_BOUNCE, 0.5), TWEEN_EPSILON);
+
+    // Back overshoots below the start
+    assert_true(TweenEngine::ease(TweenEngine::EASING_EASE_IN_BACK, 0.25) < 0);
+
+    // Unknown easings fall back to linear
+    assert_float_equal(0.3f, (float)TweenEngine::ease(TweenEngine::EASING_COUNT, 0.3), TWEEN_EPSILON);
+}
+
+SEATEST_TEST(tweenEngine_delay)
+{
+    TweenEngine   engine;
+    DisplayObject target;
+
+    int id = engine.add(&target, TweenEngine::PROPERTY_X, 100, 1, TweenEngine::EASING_LINEAR, 0.5, 1, 0, false);
+    assert_int_equal(1, engine.getNumTweens());
+
+    engine.advanceTime(0.25);
+    assert_float_equal(0, (float)target.getX(), TWEEN_EPSILON);
+
+    // The start value is read once the delay is over
+    target.setX(20);
+
+    engine.advanceTime(0.5);
+    assert_float_equal(40, (float)target.getX(), TWEEN_EPSILON);
+    assert_true(engine.contains(id));
+
+    engine.advanceTime(0.75);
+    assert_float_equal(100, (float)target.getX(), TWEEN_EPSILON);
+    assert_false(engine.contains(id));
+    assert_int_equal(0, engine.getNumTweens());
+}
+
+SEATEST_TEST(tweenEngine_completion)
+{
+    TweenEngine   engine;
+    DisplayObject target;
+
+    int alphaID = engine.add(&target, TweenEngine::PROPERTY_ALPHA, 0, 1, TweenEngine::EASING_EASE_IN, 0, 1, 0, false);
+    int scaleID = engine.add(&target, TweenEngine::PROPERTY_SCALE_X, 3, 2, TweenEngine::EASING_EASE_OUT_ELASTIC, 0, 1, 0, false);
+
+    engine.advanceTime(0.5);
+    assert_float_equal(0.875f, (float)target.getAlpha(), TWEEN_EPSILON);
+
+    // Completes exactly at its time, the other keeps running
+    engine.advanceTime(0.5);
+    assert_float_equal(0, (float)target.getAlpha(), TWEEN_EPSILON);
+    assert_false(engine.contains(alphaID));
+    assert_true(engine.contains(scaleID));
+    assert_true(engine.containsTweens(&target));
+
+    // Overshooting the end lands on the end value
+    engine.advanceTime(5);
+    assert_float_equal(3, (float)target.getScaleX(), TWEEN_EPSILON);
+    assert_false(engine.containsTweens(&target));
+
+    // Nothing changes after completion
+    target.setScaleX(1);
+    engine.advanceTime(1);
+    assert_float_equal(1, (float)target.getScaleX(), TWEEN_EPSILON);
+}
+
+SEATEST_TEST(tweenEngine_repeat)
+{
+    TweenEngine   engine;
+    DisplayObject target;
+
+    int id = engine.add(&target, TweenEngine::PROPERTY_Y, 10, 1, TweenEngine::EASING_LINEAR, 0, 3, 0.5, false);
+
+    engine.advanceTime(1);
+    assert_float_equal(10, (float)target.getY(), TWEEN_EPSILON);
+    assert_true(engine.contains(id));
+
+    // Waits out the repeat delay at the end value, then starts over
+    engine.advanceTime(0.25);
+    assert_float_equal(10, (float)target.getY(), TWEEN_EPSILON);
+    engine.advanceTime(0.75);
+    assert_float_equal(5, (float)target.getY(), TWEEN_EPSILON);
+
+    engine.advanceTime(0.5);
+    assert_float_equal(10, (float)target.getY(), TWEEN_EPSILON);
+    assert_true(engine.contains(id));
+
+    // Third and last repetition, including its delay
+    engine.advanceTime(1.5);
+    assert_float_equal(10, (float)target.getY(), TWEEN_EPSILON);
+    assert_false(engine.contains(id));
+
+    // A repeat count of 0 runs forever, time carries over into the next
+    // repetitions within one step
+    int forever = engine.add(&target, TweenEngine::PROPERTY_Y, 20, 1, TweenEngine::EASING_LINEAR, 0, 0, 0, false);
+    engine.advanceTime(10.25);
+    assert_true(engine.contains(forever));
+    assert_float_equal(12.5f, (float)target.getY(), TWEEN_EPSILON);
+}
+
+SEATEST_TEST(tweenEngine_reverse)
+{
+    TweenEngine   engine;
+    DisplayObject target;
+
+    int id = engine.add(&target, TweenEngine::PROPERTY_ROTATION, 1, 1, TweenEngine::EASING_EASE_IN, 0, 2, 0, true);
+
+    engine.advanceTime(1);
+    assert_float_equal(1, (float)target.getRotation(), TWEEN_EPSILON);
+
+    // Every second repetition runs the easing backwards
+    engine.advanceTime(0.5);
+    assert_float_equal(0.125f, (float)target.getRotation(), TWEEN_EPSILON);
+
+    engine.advanceTime(0.5);
+    assert_float_equal(0, (float)target.getRotation(), TWEEN_EPSILON);
+    assert_false(engine.contains(id));
+}
+
+SEATEST_TEST(tweenEngine_remove)
+{
+    TweenEngine   engine;
+    DisplayObject target;
+    DisplayObject other;
+
+    int id = engine.add(&target, TweenEngine::PROPERTY_X, 100, 1, TweenEngine::EASING_LINEAR, 0, 1, 0, false);
+    engine.add(&target, TweenEngine::PROPERTY_Y, 100, 1, TweenEngine::EASING_LINEAR, 0, 1, 0, false);
+    engine.add(&other, TweenEngine::PROPERTY_X, 100, 1, TweenEngine::EASING_LINEAR, 0, 1, 0, false);
+
+    // Removing leaves the property where it is
+    engine.advanceTime(0.5);
+    engine.remove(id);
+    engine.advanceTime(0.25);
+    assert_float_equal(50, (float)target.getX(), TWEEN_EPSILON);
+    assert_float_equal(75, (float)target.getY(), TWEEN_EPSILON);
+    assert_int_equal(2, engine.getNumTweens());
+
+    engine.removeTweens(&target);
+    assert_false(engine.containsTweens(&target));
+    assert_true(engine.containsTweens(&other));
+    assert_int_equal(1, engine.getNumTweens());
+
+    // A destroyed target drops its tweens from every engine
+    TweenEngine second;
+    {
+        DisplayObject temporary;
+        engine.add(&temporary, TweenEngine::PROPERTY_ALPHA, 0, 1, TweenEngine::EASING_LINEAR, 0, 1, 0, false);
+        second.add(&temporary, TweenEngine::PROPERTY_ALPHA, 0, 1, TweenEngine::EASING_LINEAR, 0, 0, 0, false);
+        assert_int_equal(2, engine.getNumTweens());
+    }
+    assert_int_equal(1, engine.getNumTweens());
+    assert_int_equal(0, second.getNumTweens());
+    engine.advanceTime(0.25);
+    second.advanceTime(0.25);
+
+    engine.purge();
+    assert_int_equal(0, engine.getNumTweens());
+    assert_false(engine.containsTweens(&other));
+}
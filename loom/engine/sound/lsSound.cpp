@@ -23,6 +23,7 @@
 #include "loom/common/assets/assetsSound.h"
 #include "loom/common/config/applicationConfig.h"
 #include "loom/common/utils/utString.h"
+#include "loom/common/utils/utFlatStringMap.h"
 #include "loom/script/loomscript.h"
 #include "loom/vendor/openal-soft/include/AL/al.h"
 #include "loom/vendor/openal-soft/include/AL/alc.h"
@@ -122,7 +123,7 @@ class OALBufferManager
 
 public:
     
-    static utHashTable<utHashedString, OALBufferNote *> buffers;
+    static utFlatStringMap<OALBufferNote *> buffers;
 
     static ALuint getBufferForAsset(const char *assetPath)
     {
@@ -210,7 +211,7 @@ public:
     static void soundUpdater(void *payload, const char *name);
 };
 
-utHashTable<utHashedString, OALBufferNote *> OALBufferManager::buffers;
+utFlatStringMap<OALBufferNote *> OALBufferManager::buffers;
 
 class Sound
 {
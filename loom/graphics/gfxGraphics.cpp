@@ -30,6 +30,7 @@
 #include "loom/graphics/gfxTexture.h"
 #include "loom/graphics/gfxQuadRenderer.h"
 #include "loom/graphics/gfxVectorRenderer.h"
+#include "loom/graphics/gfxVectorSVGCache.h"
 #include "loom/graphics/gfxBitmapData.h"
 #include "loom/graphics/gfxStateManager.h"
 
@@ -153,6 +154,7 @@ void Graphics::resume()
 
 void Graphics::shutdown()
 {
+    VectorSVGCache::shutdown();
     Texture::shutdown();
     QuadRenderer::destroyGraphicsResources();
     VectorRenderer::destroyGraphicsResources();
@@ -339,6 +341,7 @@ void Graphics::handleContextLoss()
     // make sure the QuadRenderer resources are freed before we shutdown
     QuadRenderer::destroyGraphicsResources();
     VectorRenderer::destroyGraphicsResources();
+    VectorSVGCache::reset();
 
     lmLogDebug(gGFXLogGroup, "Handle context loss: Init");
 
@@ -25,6 +25,7 @@
 
 #include "loom/common/core/assert.h"
 #include "loom/common/core/allocator.h"
+#include "loom/common/core/allocatorFrame.h"
 #include "loom/common/core/log.h"
 #include "loom/common/utils/utTypes.h"
 
@@ -45,7 +46,7 @@ namespace GFX
 {
 
 TextureInfo Texture::sTextureInfos[MAXTEXTURES];
-utHashTable<utFastStringHash, TextureID> Texture::sTexturePathLookup;
+utFlatStringMap<TextureID> Texture::sTexturePathLookup;
 bool Texture::sTextureAssetNofificationsEnabled = true;
 bool Texture::supportsFullNPOT;
 TextureID Texture::currentRenderTexture = -1;
@@ -484,8 +485,8 @@ void Texture::upload(TextureInfo &tinfo, uint8_t *data, uint16_t width, uint16_t
                 int mipHalfHeight = mipHeight >> 1; mipHalfHeight = mipHalfHeight < 1 ? 1 : mipHalfHeight;
                 int mipQuarterSize = mipHalfWidth*mipHalfHeight;
                 // Allocate enough for the biggest/current mipmap and a quarter of the size of
-                // additional space used for downsizing
-                mipData = static_cast<uint32_t*>(lmAlloc(NULL, (mipSize + mipQuarterSize)*sizeof(uint32_t)));
+                // additional space used for downsizing, the buffer only lives for this upload
+                mipData = static_cast<uint32_t*>(lmAlloc(loom_frameAllocator_getGlobal(), (mipSize + mipQuarterSize)*sizeof(uint32_t)));
                 // The current mipmap bytes are the entire buffer minus the additional space
                 // at first, with the parent bytes being the full image size
                 mipCurrent = mipData;
@@ -513,7 +514,7 @@ void Texture::upload(TextureInfo &tinfo, uint8_t *data, uint16_t width, uint16_t
             mipLevel++;
         }
         lmLogDebug(gGFXTextureLogGroup, "Generated mipmaps in %d ms", platform_getMilliseconds() - time);
-        if (mipData) lmSafeFree(NULL, mipData);
+        if (mipData) lmSafeFree(loom_frameAllocator_getGlobal(), mipData);
         LOOM_PROFILE_END(textureLoadMipmap);
     }
     else
@@ -903,13 +904,13 @@ void Texture::updateImageAsset(loom_asset_image_t *lat, TextureInfo *tinfo)
 
     if (downsampling) {
         lmLogWarn(gGFXTextureLogGroup, "Texture too big at %dx%d, downsampling to %dx%d", lat->width, lat->height, localWidth, localHeight);
-        localBits = static_cast<uint32_t*>(lmAlloc(NULL, localWidth * localWidth * 4));
+        localBits = static_cast<uint32_t*>(lmAlloc(loom_frameAllocator_getGlobal(), localWidth * localWidth * 4));
         downsampleAverage((uint32_t*)lat->bits, localBits, lat->width, lat->height);
     }
 
     upload(*tinfo, (uint8_t*) localBits, localWidth, localHeight, 0, 0);
 
-    if (downsampling) lmFree(NULL, localBits);
+    if (downsampling) lmFree(loom_frameAllocator_getGlobal(), localBits);
 }
 
 TextureInfo *Texture::initFromBytesAsync(utByteArray *bytes, const char *name, bool highPriority)
@@ -25,6 +25,7 @@
 #include "loom/common/assets/assetsImage.h"
 #include "loom/common/utils/utString.h"
 #include "loom/common/utils/utByteArray.h"
+#include "loom/common/utils/utFlatStringMap.h"
 #include "loom/script/native/lsNativeDelegate.h"
 #include "loom/common/platform/platformThread.h"
 
@@ -169,7 +170,7 @@ class Texture
 
 private:
 
-    static utHashTable<utFastStringHash, TextureID> sTexturePathLookup;
+    static utFlatStringMap<TextureID> sTexturePathLookup;
     static bool sTextureAssetNofificationsEnabled;
     static bool supportsFullNPOT;
     static TextureID currentRenderTexture;
@@ -225,8 +226,8 @@ private:
                                                 bool checkHandle = true,
                                                 bool clearDispose = true)
     {
-        TextureID   *texID = sTexturePathLookup.get(path);
         loom_mutex_lock(Texture::sTexInfoLock);
+        TextureID   *texID = sTexturePathLookup.get(path);
         TextureInfo *tinfo = Texture::getTextureInfo(texID);
         if(checkHandle && (tinfo && (tinfo->handle == -1)))
         {
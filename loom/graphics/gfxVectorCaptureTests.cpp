@@ -0,0 +1,295 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "loom/common/utils/utTypes.h"
+#include "nanovg.h"
+#include "seatest.h"
+
+SEATEST_FIXTURE(vectorCapture)
+{
+    SEATEST_FIXTURE_ENTRY(vectorCapture_replayMatchesTessellation);
+    SEATEST_FIXTURE_ENTRY(vectorCapture_replayIdentity);
+}
+
+// Headless nanovg backend that records the geometry handed to it
+struct CaptureRecording
+{
+    // fill or stroke, the paint alpha and the vertex count of each call
+    utArray<int>       types;
+    utArray<float>     alphas;
+    utArray<int>       counts;
+    utArray<NVGvertex> verts;
+
+    void clear()
+    {
+        types.clear();
+        alphas.clear();
+        counts.clear();
+        verts.clear();
+    }
+
+    void record(int type, const NVGpaint *paint, const NVGpath *paths, int npaths)
+    {
+        int count = 0;
+
+        for (int i = 0; i < npaths; i++)
+        {
+            for (int j = 0; j < paths[i].nfill; j++)
+            {
+                verts.push_back(paths[i].fill[j]);
+            }
+
+            for (int j = 0; j < paths[i].nstroke; j++)
+            {
+                verts.push_back(paths[i].stroke[j]);
+            }
+
+            count += paths[i].nfill + paths[i].nstroke;
+        }
+
+        types.push_back(type);
+        alphas.push_back(paint->innerColor.a);
+        counts.push_back(count);
+    }
+};
+
+static int recordCreate(void *uptr)
+{
+    return 1;
+}
+
+static int recordCreateTexture(void *uptr, int type, int w, int h, int imageFlags, const unsigned char *data)
+{
+    return 1;
+}
+
+static int recordDeleteTexture(void *uptr, int image)
+{
+    return 1;
+}
+
+static int recordUpdateTexture(void *uptr, int image, int x, int y, int w, int h, const unsigned char *data)
+{
+    return 1;
+}
+
+static int recordGetTextureSize(void *uptr, int image, int *w, int *h)
+{
+    *w = *h = 512;
+    return 1;
+}
+
+static void recordViewport(void *uptr, int width, int height)
+{
+}
+
+static void recordCancel(void *uptr)
+{
+}
+
+static void recordFlush(void *uptr)
+{
+}
+
+static void recordFill(void *uptr, NVGpaint *paint, NVGscissor *scissor, float fringe, const float *bounds, const NVGpath *paths, int npaths)
+{
+    ((CaptureRecording *)uptr)->record(0, paint, paths, npaths);
+}
+
+static void recordStroke(void *uptr, NVGpaint *paint, NVGscissor *scissor, float fringe, float strokeWidth, const NVGpath *paths, int npaths)
+{
+    ((CaptureRecording *)uptr)->record(1, paint, paths, npaths);
+}
+
+static void recordTriangles(void *uptr, NVGpaint *paint, NVGscissor *scissor, const NVGvertex *verts, int nverts)
+{
+}
+
+static void recordDelete(void *uptr)
+{
+}
+
+static NVGcontext *createRecordingContext(CaptureRecording *recording)
+{
+    NVGparams params;
+
+    memset(&params, 0, sizeof(params));
+    params.userPtr              = recording;
+    params.edgeAntiAlias        = 1;
+    params.renderCreate         = recordCreate;
+    params.renderCreateTexture  = recordCreateTexture;
+    params.renderDeleteTexture  = recordDeleteTexture;
+    params.renderUpdateTexture  = recordUpdateTexture;
+    params.renderGetTextureSize = recordGetTextureSize;
+    params.renderViewport       = recordViewport;
+    params.renderCancel         = recordCancel;
+    params.renderFlush          = recordFlush;
+    params.renderFill           = recordFill;
+    params.renderStroke         = recordStroke;
+    params.renderTriangles      = recordTriangles;
+    params.renderDelete         = recordDelete;
+
+    return nvgCreateInternal(&params);
+}
+
+// A filled circle and a stroked rounded rect in local space
+static void drawShapes(NVGcontext *ctx, float alpha)
+{
+    nvgBeginPath(ctx);
+    nvgCircle(ctx, 20, 30, 15);
+    nvgFillColor(ctx, nvgRGBAf(1, 0, 0, alpha));
+    nvgFill(ctx);
+
+    nvgBeginPath(ctx);
+    nvgRoundedRect(ctx, -10, 5, 60, 25, 6);
+    nvgStrokeColor(ctx, nvgRGBAf(0, 0, 1, alpha));
+    nvgStrokeWidth(ctx, 3);
+    nvgStroke(ctx);
+}
+
+static void setTransform(NVGcontext *ctx, float x, float y, float rotation)
+{
+    nvgResetTransform(ctx);
+    nvgTranslate(ctx, x, y);
+    nvgRotate(ctx, rotation);
+}
+
+// Compares two recordings call by call and vertex by vertex
+static void assertSameGeometry(const CaptureRecording& expected, const CaptureRecording& actual, float alphaScale)
+{
+    assert_int_equal((int)expected.types.size(), (int)actual.types.size());
+    assert_int_equal((int)expected.verts.size(), (int)actual.verts.size());
+
+    if ((expected.types.size() != actual.types.size()) || (expected.verts.size() != actual.verts.size()))
+    {
+        return;
+    }
+
+    for (UTsize i = 0; i < expected.types.size(); i++)
+    {
+        assert_int_equal(expected.types[i], actual.types[i]);
+        assert_int_equal(expected.counts[i], actual.counts[i]);
+        assert_float_equal(expected.alphas[i] * alphaScale, actual.alphas[i], 0.0001f);
+    }
+
+    float maxError = 0;
+
+    for (UTsize i = 0; i < expected.verts.size(); i++)
+    {
+        float dx = fabsf(expected.verts[i].x - actual.verts[i].x);
+        float dy = fabsf(expected.verts[i].y - actual.verts[i].y);
+
+        if (dx > maxError)
+        {
+            maxError = dx;
+        }
+
+        if (dy > maxError)
+        {
+            maxError = dy;
+        }
+
+        // fringe coordinates don't depend on the transform
+        assert_float_equal(expected.verts[i].u, actual.verts[i].u, 0.0001f);
+        assert_float_equal(expected.verts[i].v, actual.verts[i].v, 0.0001f);
+    }
+
+    assert_true(maxError < 0.001f);
+}
+
+SEATEST_TEST(vectorCapture_replayMatchesTessellation)
+{
+    CaptureRecording recording;
+    NVGcontext       *ctx     = createRecordingContext(&recording);
+    NVGcapture       *capture = nvgCreateCapture();
+
+    // Capture once under one transform
+    nvgBeginFrame(ctx, 800, 600, 1);
+    setTransform(ctx, 100, 50, 0.3f);
+    nvgBeginCapture(ctx, capture);
+    drawShapes(ctx, 1);
+    assert_int_equal(1, nvgEndCapture(ctx));
+    nvgEndFrame(ctx);
+
+    // Tessellate again under a moved and rotated transform with lower alpha
+    CaptureRecording fresh;
+    recording.clear();
+    nvgBeginFrame(ctx, 800, 600, 1);
+    setTransform(ctx, 320, 240, 1.2f);
+    drawShapes(ctx, 1);
+    nvgEndFrame(ctx);
+    fresh = recording;
+    assert_int_equal(2, (int)fresh.types.size());
+    assert_true(fresh.verts.size() > 0);
+
+    // Replaying the capture under that transform must hand the backend the
+    // same geometry, with the alpha scaled
+    recording.clear();
+    nvgBeginFrame(ctx, 800, 600, 1);
+    setTransform(ctx, 320, 240, 1.2f);
+    nvgReplayCapture(ctx, capture, 0.5f);
+    nvgEndFrame(ctx);
+
+    assertSameGeometry(fresh, recording, 0.5f);
+
+    nvgDeleteCapture(capture);
+    nvgDeleteInternal(ctx);
+}
+
+SEATEST_TEST(vectorCapture_replayIdentity)
+{
+    CaptureRecording recording;
+    NVGcontext       *ctx     = createRecordingContext(&recording);
+    NVGcapture       *capture = nvgCreateCapture();
+
+    nvgBeginFrame(ctx, 800, 600, 1);
+    setTransform(ctx, 10, 20, 0);
+    nvgBeginCapture(ctx, capture);
+    drawShapes(ctx, 0.8f);
+    assert_int_equal(1, nvgEndCapture(ctx));
+    nvgEndFrame(ctx);
+
+    CaptureRecording captured;
+    captured = recording;
+
+    // Same transform replays the captured geometry unchanged
+    recording.clear();
+    nvgBeginFrame(ctx, 800, 600, 1);
+    setTransform(ctx, 10, 20, 0);
+    nvgReplayCapture(ctx, capture, 1);
+    nvgEndFrame(ctx);
+
+    assertSameGeometry(captured, recording, 1);
+
+    // Capturing again drops the previous content
+    nvgBeginFrame(ctx, 800, 600, 1);
+    nvgBeginCapture(ctx, capture);
+    assert_int_equal(1, nvgEndCapture(ctx));
+    recording.clear();
+    nvgReplayCapture(ctx, capture, 1);
+    nvgEndFrame(ctx);
+    assert_int_equal(0, (int)recording.types.size());
+
+    nvgDeleteCapture(capture);
+    nvgDeleteInternal(ctx);
+}
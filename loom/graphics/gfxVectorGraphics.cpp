@@ -22,6 +22,7 @@
 #include "loom/graphics/gfxQuadRenderer.h"
 #include "loom/graphics/gfxVectorGraphics.h"
 #include "loom/engine/loom2d/l2dShape.h"
+#include "loom/engine/loom2d/l2dBlendMode.h"
 
 #include "loom/script/runtime/lsProfiler.h"
 
@@ -90,6 +91,10 @@ void VectorGraphics::clear() {
         lmDelete(NULL, d);
     }
     queue.clear();
+    svgs.clear();
+    touch();
+    cacheable = true;
+    cacheHasSVG = false;
     /*
     bounds.x = INFINITY;
     bounds.y = INFINITY;
@@ -190,26 +195,33 @@ void VectorGraphics::lineStyle(float thickness, unsigned int color, float alpha,
 
     lastLineStyle = lmNew(NULL) VectorLineStyle(thickness, color, alpha, scaleModeEnum, capsEnum, jointsEnum, miterLimit);
     queue.push_back(lastLineStyle);
+    touch();
     restartPath();
 }
 
 void VectorGraphics::textFormat(VectorTextFormat format) {
     queue.push_back(lmNew(NULL) VectorTextFormatData(lmNew(NULL) VectorTextFormat(format)));
+    touch();
     currentTextFormat.merge(&format);
 }
 
 void VectorGraphics::beginFill(unsigned int color, float alpha) {
     queue.push_back(lmNew(NULL) VectorFill(color, alpha));
+    touch();
     restartPath();
 }
 
 void VectorGraphics::beginTextureFill(TextureID id, Loom2D::Matrix *matrix, bool repeat, bool smooth) {
     queue.push_back(lmNew(NULL) VectorFill(id, matrix, repeat, smooth));
+    touch();
+    // Texture paints reference nanovg images that only live for one render.
+    cacheable = false;
     restartPath();
 }
 
 void VectorGraphics::endFill() {
     queue.push_back(lmNew(NULL) VectorFill());
+    touch();
     restartPath();
 }
 
@@ -286,11 +298,15 @@ void VectorGraphics::drawArc(float x, float y, float radius, float angleFrom, fl
 
 void VectorGraphics::drawTextLine(float x, float y, utString text) {
     queue.push_back(lmNew(NULL) VectorText(x, y, -1, lmNew(NULL) utString(text)));
+    touch();
+    cacheable = false;
     inflateBounds(VectorRenderer::textLineBounds(&currentTextFormat, x, y, &text));
 }
 
 void VectorGraphics::drawTextBox(float x, float y, float width, utString text) {
     queue.push_back(lmNew(NULL) VectorText(x, y, width < 0 ? 0 : width, lmNew(NULL) utString(text)));
+    touch();
+    cacheable = false;
     inflateBounds(VectorRenderer::textBoxBounds(&currentTextFormat, x, y, width, &text));
 }
 
@@ -307,7 +323,11 @@ Loom2D::Rectangle* VectorGraphics::textBoxBounds(VectorTextFormat format, float
 }
 
 void VectorGraphics::drawSVG(VectorSVG* svg, float x, float y, float scale, float lineThickness) {
-    queue.push_back(lmNew(NULL) VectorSVGData(svg, x, y, scale, lineThickness));
+    VectorSVGData* data = lmNew(NULL) VectorSVGData(svg, x, y, scale, lineThickness);
+    queue.push_back(data);
+    svgs.push_back(data);
+    touch();
+    cacheHasSVG = true;
     restartPath();
     inflateBounds(Loom2D::Rectangle(x, y, svg->getWidth() * scale, svg->getHeight() * scale));
 }
@@ -332,6 +352,7 @@ void VectorGraphics::render(Loom2D::RenderState* renderStatePointer, Loom2D::Mat
 
     alpha = renderState.alpha;
     scale = sqrt(transform->a*transform->a + transform->b*transform->b + transform->c*transform->c + transform->d*transform->d);
+    pixelScale = lmMax(sqrt(transform->a*transform->a + transform->b*transform->b), sqrt(transform->c*transform->c + transform->d*transform->d));
 
     if (clipWidth != -1 && clipHeight != -1)
     {
@@ -359,14 +380,40 @@ void VectorGraphics::render(Loom2D::RenderState* renderStatePointer, Loom2D::Mat
 
     flushPath();
 
-    LOOM_PROFILE_START(vectorRenderData);
-    utArray<VectorData*>::Iterator it = queue.iterator();
-    while (it.hasMoreElements()) {
-        VectorData* d = it.getNext();
-        d->render(this);
+    // Tessellation depends on the on-screen size, so geometry is only reused
+    // within a quarter octave of the scale it was captured at.
+    int scaleBucket = scale > 0 ? (int)floor(log(scale) / log(2.0) * 4) : 0;
+
+    if (isCacheCurrent(scaleBucket))
+    {
+        VectorRenderer::replayCapture(cache, cachedAlpha > 0 ? (float)(alpha / cachedAlpha) : 1.0f);
+    }
+    else
+    {
+        bool capture = cacheable;
+        if (capture)
+        {
+            if (cache == NULL) cache = VectorRenderer::createCapture();
+            capture = cache != NULL;
+        }
+        if (capture) VectorRenderer::beginCapture(cache);
+
+        LOOM_PROFILE_START(vectorRenderData);
+        utArray<VectorData*>::Iterator it = queue.iterator();
+        while (it.hasMoreElements()) {
+            VectorData* d = it.getNext();
+            d->render(this);
+        }
+        flushPath();
+        LOOM_PROFILE_END(vectorRenderData);
+
+        cacheValid = capture && VectorRenderer::endCapture();
+        cachedVersion = contentVersion;
+        cachedScaleBucket = scaleBucket;
+        cachedQuality = (VectorRenderer::tessellationQuality << 8) | VectorRenderer::quality;
+        cachedSVGChangeCount = VectorSVG::getChangeCount();
+        cachedAlpha = alpha;
     }
-    flushPath();
-    LOOM_PROFILE_END(vectorRenderData);
 
     if (renderState.isClipping()) {
         VectorRenderer::resetClipRect();
@@ -374,6 +421,36 @@ void VectorGraphics::render(Loom2D::RenderState* renderStatePointer, Loom2D::Mat
 
     VectorRenderer::postDraw();
     VectorRenderer::endFrame();
+
+    if (cacheHasSVG) renderRasterSVGs(renderState, transform);
+}
+
+void VectorGraphics::renderRasterSVGs(Loom2D::RenderState& renderState, Loom2D::Matrix* transform) {
+    // Rasterised SVGs are batched as quads after the vector content
+    unsigned int blendSrc, blendDst;
+    Loom2D::BlendMode::BlendFunction(renderState.blendMode, blendSrc, blendDst);
+
+    bool clipped = false;
+    for (UTsize i = 0; i < svgs.size(); i++) {
+        VectorSVGData* d = svgs[i];
+        if (d->raster == NULL) continue;
+        if (!clipped && renderState.isClipping()) {
+            GFX::Graphics::setClipRect((int)renderState.clipRect.x, (int)renderState.clipRect.y, (int)renderState.clipRect.width, (int)renderState.clipRect.height);
+            clipped = true;
+        }
+        VectorSVGCache::draw(d->raster, d->x, d->y, d->scale, *transform, (float)renderState.alpha, true, blendSrc, blendDst);
+    }
+}
+
+bool VectorGraphics::isCacheCurrent(int scaleBucket) {
+    if (!cacheValid) return false;
+    if (cachedVersion != contentVersion) return false;
+    if (cachedScaleBucket != scaleBucket) return false;
+    if (cachedQuality != ((VectorRenderer::tessellationQuality << 8) | VectorRenderer::quality)) return false;
+    if (cacheHasSVG && cachedSVGChangeCount != VectorSVG::getChangeCount()) return false;
+    // Alpha is scaled on replay, which only works if the capture wasn't transparent
+    if (cachedAlpha <= 0 && alpha != cachedAlpha) return false;
+    return true;
 }
 
 void VectorPath::render(VectorGraphics* g) {
@@ -476,7 +553,14 @@ VectorTextFormatData::~VectorTextFormatData() {
 
 void VectorSVGData::render(VectorGraphics* g) {
     g->flushPath();
-    VectorRenderer::svg(image, x, y, scale, lineThickness, (float)g->alpha);
+    raster = NULL;
+    // Rasters are made with the SVG's own stroke widths, so only plain line thickness qualifies
+    if (image->getRasterize() && lineThickness == 1.0f) {
+        raster = VectorSVGCache::request(image, (float)(g->pixelScale*scale));
+    }
+    if (raster == NULL) {
+        VectorRenderer::svg(image, x, y, scale, lineThickness, (float)g->alpha);
+    }
 }
 
 
@@ -516,6 +600,7 @@ void VectorLineStyle::copyTo(VectorLineStyle* s) {
 
 
 VectorPath* VectorGraphics::getPath() {
+    touch();
     VectorPath* path = lastPath;
     if (path == NULL) {
         path = queue.empty() ? NULL : dynamic_cast<VectorPath*>(queue.back());
@@ -530,6 +615,7 @@ VectorPath* VectorGraphics::getPath() {
 
 void VectorGraphics::addShape(VectorShape *shape) {
     queue.push_back(shape);
+    touch();
     restartPath();
 }
 
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "loom/graphics/gfxVectorRenderer.h"
+#include "loom/graphics/gfxVectorSVGCache.h"
 #include "loom/engine/loom2d/l2dDisplayObject.h"
 #include "loom/engine/loom2d/l2dDisplayObjectContainer.h"
 #include "loom/engine/loom2d/l2dMatrix.h"
@@ -188,7 +189,9 @@ public:
     float scale;
     float lineThickness;
     GFX::VectorSVG* image;
-    VectorSVGData(GFX::VectorSVG* image, float x, float y, float scale = 1.0f, float lineThickness = 1.0f) : x(x), y(y), scale(scale), lineThickness(lineThickness), image(image) {};
+    // Set when the last render used a cached bitmap instead of drawing the vectors.
+    GFX::VectorSVGRaster* raster;
+    VectorSVGData(GFX::VectorSVG* image, float x, float y, float scale = 1.0f, float lineThickness = 1.0f) : x(x), y(y), scale(scale), lineThickness(lineThickness), image(image), raster(NULL) {};
     virtual void render(VectorGraphics* g);
 };
 
@@ -212,6 +215,25 @@ protected:
     
     const Loom2D::Shape* parent;
 
+    // Tessellated fill and stroke geometry from the last render, replayed
+    // while the content, scale bucket and renderer quality stay the same.
+    NVGcapture* cache;
+    bool cacheValid;
+    bool cacheable;
+    bool cacheHasSVG;
+    int contentVersion;
+    int cachedVersion;
+    int cachedScaleBucket;
+    int cachedQuality;
+    int cachedSVGChangeCount;
+    lmscalar cachedAlpha;
+
+    void touch() { contentVersion++; }
+    bool isCacheCurrent(int scaleBucket);
+
+    utArray<VectorSVGData*> svgs;
+    void renderRasterSVGs(Loom2D::RenderState& renderState, Loom2D::Matrix* transform);
+
 public:
     utArray<VectorData*> queue;
     VectorPath *lastPath;
@@ -227,10 +249,15 @@ public:
     lmscalar boundB;
     lmscalar alpha;
     lmscalar scale;
+    // Largest axis scale of the current transform, in pixels per unit.
+    lmscalar pixelScale;
     int clipX, clipY, clipWidth, clipHeight;
 
     VectorGraphics(const Loom2D::Shape* shape)
     : parent(shape)
+    , cache(NULL)
+    , cacheValid(false)
+    , contentVersion(0)
     , clipX(0)
     , clipY(0)
     , clipWidth(-1)
@@ -239,12 +266,14 @@ public:
     }
 
     VectorGraphics()
+    : cache(NULL)
     {
         assert(false); // Shouldn't use the default constructor
     }
 
     ~VectorGraphics() {
         clear();
+        VectorRenderer::deleteCapture(cache);
         lualoom_managedpointerreleased(this);
     }
 
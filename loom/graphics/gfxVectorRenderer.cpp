@@ -32,6 +32,7 @@
 #include "loom/graphics/gfxMath.h"
 #include "loom/graphics/gfxGraphics.h"
 #include "loom/graphics/gfxVectorRenderer.h"
+#include "loom/graphics/gfxVectorSVGCache.h"
 
 #include "loom/script/runtime/lsProfiler.h"
 
@@ -481,6 +482,27 @@ void VectorRenderer::svg(VectorSVG* image, float x, float y, float scale, float
     image->render(x, y, scale, lineThickness, alpha);
 }
 
+NVGcapture* VectorRenderer::createCapture() {
+    return nvgCreateCapture();
+}
+
+void VectorRenderer::deleteCapture(NVGcapture* capture) {
+    nvgDeleteCapture(capture);
+}
+
+void VectorRenderer::beginCapture(NVGcapture* capture) {
+    nvgBeginCapture(nvg, capture);
+}
+
+bool VectorRenderer::endCapture() {
+    return nvgEndCapture(nvg) != 0;
+}
+
+void VectorRenderer::replayCapture(NVGcapture* capture, float alphaScale) {
+    LOOM_PROFILE_SCOPE(vectorReplay);
+    nvgReplayCapture(nvg, capture, alphaScale);
+}
+
 void VectorRenderer::deleteImages()
 {
     if (nvg != NULL)
@@ -586,8 +608,11 @@ void VectorTextFormat::merge(VectorTextFormat* source) {
     if (!isnan(source->lineHeight)) lineHeight = source->lineHeight;
 }
 
+int VectorSVG::changeCount = 0;
+
 VectorSVG::VectorSVG() {
     image = NULL;
+    rasterize = false;
 }
 
 VectorSVG::~VectorSVG() {
@@ -608,11 +633,20 @@ void VectorSVG::resetInfo() {
 
 void VectorSVG::resetImage() {
     if (image != NULL) {
+        // Waits for the raster thread in case it's reading the image
+        VectorSVGCache::release(this);
         nsvgDelete(image);
         image = NULL;
     }
 }
 
+void VectorSVG::setRasterize(bool value) {
+    if (rasterize == value) return;
+    rasterize = value;
+    if (!rasterize) VectorSVGCache::release(this);
+    markChanged();
+}
+
 void VectorSVG::loadFile(utString path, utString units, float dpi) {
     lmLogDebug(gGFXVectorRendererLogGroup, "Loading '%s'", path.c_str());
     reset();
@@ -650,6 +684,7 @@ void VectorSVG::parse(const char* svg, const char* units, float dpi) {
     memcpy(svgTemp, svg, strlen(svg) + 1);
     image = nsvgParse((char*) svgTemp, units, dpi);
     lmFree(NULL, svgTemp);
+    markChanged();
     if (image->shapes == NULL) 
     {
         lmLogError(gGFXVectorRendererLogGroup, "Failure loading %s - no shapes.", path.c_str());
@@ -26,6 +26,7 @@
 #include "loom/engine/loom2d/l2dMatrix.h"
 #include "loom/common/utils/utTypes.h"
 struct NSVGimage;
+struct NVGcapture;
 
 namespace GFX
 {
@@ -145,7 +146,11 @@ public:
 
 };
 
+struct VectorSVGRaster;
+
 class VectorSVG {
+    friend class VectorSVGCache;
+
 protected:
     utString path;
     utString units;
@@ -153,6 +158,11 @@ protected:
 
     NSVGimage* image;
 
+    bool rasterize;
+    utArray<VectorSVGRaster*> rasters;
+
+    static int changeCount;
+
     void reset();
     void resetInfo();
     void resetImage();
@@ -164,6 +174,12 @@ public:
     VectorSVG();
     ~VectorSVG();
     static void onReload(void *payload, const char *name);
+    // Bumped whenever an SVG is parsed or its rasters change, lets cached geometry notice.
+    static int getChangeCount() { return changeCount; }
+    static void markChanged() { changeCount++; }
+
+    bool getRasterize() const { return rasterize; }
+    void setRasterize(bool value);
     void reload();
     void loadFile(utString path, utString units = utString("px"), float dpi = 96.0f);
     void loadString(utString svg, utString units = utString("px"), float dpi = 96.0f);
@@ -251,6 +267,12 @@ public:
 
     static void svg(VectorSVG* image, float x, float y, float scale, float lineThickness, float alpha);
 
+    static NVGcapture* createCapture();
+    static void deleteCapture(NVGcapture* capture);
+    static void beginCapture(NVGcapture* capture);
+    static bool endCapture();
+    static void replayCapture(NVGcapture* capture, float alphaScale);
+
     static float* getBounds();
 
 };
@@ -0,0 +1,458 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "loom/common/core/log.h"
+#include "loom/common/core/allocator.h"
+#include "loom/common/core/assert.h"
+#include "loom/common/platform/platformThread.h"
+#include "loom/graphics/gfxMath.h"
+#include "loom/graphics/gfxGraphics.h"
+#include "loom/graphics/gfxQuadRenderer.h"
+#include "loom/graphics/gfxShader.h"
+#include "loom/graphics/gfxVectorRenderer.h"
+#include "loom/graphics/gfxVectorSVGCache.h"
+#include "loom/script/runtime/lsProfiler.h"
+
+#include "nanosvg.h"
+#define NANOSVGRAST_IMPLEMENTATION
+#include "nanosvgrast.h"
+
+namespace GFX
+{
+lmDefineLogGroup(gGFXVectorSVGCacheLogGroup, "gfx.svgcache", 1, LoomLogInfo);
+
+struct VectorSVGAtlasPage
+{
+    TextureID texture;
+    int shelfX;
+    int shelfY;
+    int shelfHeight;
+    uint32_t lastUsedFrame;
+    utArray<VectorSVGRaster*> rasters;
+};
+
+static utArray<VectorSVGAtlasPage*> sPages;
+
+// Rasters waiting for the raster thread and rasters it finished,
+// both guarded by sQueueMutex.
+static utArray<VectorSVGRaster*> sJobs;
+static utArray<VectorSVGRaster*> sDone;
+
+static MutexHandle sQueueMutex = NULL;
+// Held by the raster thread while it reads an image, see release().
+static MutexHandle sRasterMutex = NULL;
+static SemaphoreHandle sJobSemaphore;
+static ThreadHandle sThread = NULL;
+static bool sThreadStop = false;
+
+int __stdcall VectorSVGCache::rasterThreadMain(void *param)
+{
+    loom_thread_setDebugName("VectorSVGCache");
+
+    NSVGrasterizer* rasterizer = nsvgCreateRasterizer();
+
+    for (;;)
+    {
+        loom_semaphore_wait(sJobSemaphore);
+
+        loom_mutex_lock(sRasterMutex);
+        loom_mutex_lock(sQueueMutex);
+
+        if (sThreadStop)
+        {
+            loom_mutex_unlock(sQueueMutex);
+            loom_mutex_unlock(sRasterMutex);
+            break;
+        }
+
+        if (sJobs.size() == 0)
+        {
+            // The job was released before we got to it.
+            loom_mutex_unlock(sQueueMutex);
+            loom_mutex_unlock(sRasterMutex);
+            continue;
+        }
+
+        VectorSVGRaster* raster = sJobs[0];
+        sJobs.erase((UTsize)0, true);
+
+        loom_mutex_unlock(sQueueMutex);
+
+        int stride = (raster->width + 2*VectorSVGCache::PADDING)*4;
+        int size = stride*(raster->height + 2*VectorSVGCache::PADDING);
+        uint8_t* pixels = static_cast<uint8_t*>(lmAlloc(NULL, size));
+        memset(pixels, 0, size);
+
+        // The padding stays transparent so bilinear filtering doesn't bleed neighbours in.
+        uint8_t* origin = pixels + VectorSVGCache::PADDING*stride + VectorSVGCache::PADDING*4;
+        nsvgRasterize(rasterizer, raster->svg->image, 0, 0, raster->scale, origin, raster->width, raster->height, stride);
+
+        loom_mutex_lock(sQueueMutex);
+        raster->pixels = pixels;
+        sDone.push_back(raster);
+        loom_mutex_unlock(sQueueMutex);
+
+        loom_mutex_unlock(sRasterMutex);
+    }
+
+    nsvgDeleteRasterizer(rasterizer);
+
+    return 0;
+}
+
+static void ensureThread()
+{
+    if (sThread != NULL) return;
+
+    sQueueMutex = loom_mutex_create();
+    sRasterMutex = loom_mutex_create();
+    sJobSemaphore = loom_semaphore_create();
+    sThreadStop = false;
+    sThread = loom_thread_start(VectorSVGCache::rasterThreadMain, NULL);
+}
+
+static void unloadRaster(VectorSVGRaster* raster)
+{
+    raster->page = -1;
+    raster->pending = false;
+}
+
+static VectorSVGAtlasPage* createPage()
+{
+    TextureInfo* tinfo = Texture::initEmptyTexture(VectorSVGCache::PAGE_SIZE, VectorSVGCache::PAGE_SIZE);
+    if (tinfo == NULL) return NULL;
+    tinfo->smoothing = TEXTUREINFO_SMOOTHING_BILINEAR;
+
+    VectorSVGAtlasPage* page = lmNew(NULL) VectorSVGAtlasPage();
+    page->texture = tinfo->id;
+    page->shelfX = 0;
+    page->shelfY = 0;
+    page->shelfHeight = 0;
+    page->lastUsedFrame = Graphics::getCurrentFrame();
+    return page;
+}
+
+static void clearPage(VectorSVGAtlasPage* page)
+{
+    for (UTsize i = 0; i < page->rasters.size(); i++)
+    {
+        unloadRaster(page->rasters[i]);
+    }
+    page->rasters.clear();
+    page->shelfX = 0;
+    page->shelfY = 0;
+    page->shelfHeight = 0;
+}
+
+static bool allocateInPage(VectorSVGAtlasPage* page, int width, int height, int* x, int* y)
+{
+    if (page->shelfX + width > VectorSVGCache::PAGE_SIZE)
+    {
+        page->shelfY += page->shelfHeight;
+        page->shelfX = 0;
+        page->shelfHeight = 0;
+    }
+    if (page->shelfY + height > VectorSVGCache::PAGE_SIZE) return false;
+
+    *x = page->shelfX;
+    *y = page->shelfY;
+    page->shelfX += width;
+    if (height > page->shelfHeight) page->shelfHeight = height;
+    return true;
+}
+
+static int allocate(int width, int height, int* x, int* y)
+{
+    for (UTsize i = 0; i < sPages.size(); i++)
+    {
+        if (allocateInPage(sPages[i], width, height, x, y)) return (int)i;
+    }
+
+    if (sPages.size() < VectorSVGCache::MAX_PAGES)
+    {
+        VectorSVGAtlasPage* page = createPage();
+        if (page != NULL)
+        {
+            sPages.push_back(page);
+            return allocateInPage(page, width, height, x, y) ? (int)sPages.size() - 1 : -1;
+        }
+    }
+
+    // Out of pages, recycle the one that was drawn from least recently.
+    if (sPages.size() == 0) return -1;
+    int oldest = 0;
+    for (UTsize i = 1; i < sPages.size(); i++)
+    {
+        if (sPages[i]->lastUsedFrame < sPages[oldest]->lastUsedFrame) oldest = (int)i;
+    }
+    lmLogDebug(gGFXVectorSVGCacheLogGroup, "Recycling atlas page %d", oldest);
+    clearPage(sPages[oldest]);
+    return allocateInPage(sPages[oldest], width, height, x, y) ? oldest : -1;
+}
+
+static int getBucket(float screenScale)
+{
+    return (int)ceil(log(screenScale) / log(2.0) * 2);
+}
+
+static float getBucketScale(int bucket)
+{
+    return (float)pow(2.0, bucket * 0.5);
+}
+
+VectorSVGRaster* VectorSVGCache::request(VectorSVG* svg, float screenScale)
+{
+    if (svg->image == NULL || !(screenScale > 0)) return NULL;
+
+    float svgWidth = svg->getWidth();
+    float svgHeight = svg->getHeight();
+    if (!(svgWidth > 0) || !(svgHeight > 0)) return NULL;
+
+    // Step down to the largest bucket that still fits on a page
+    int maxSize = PAGE_SIZE - 2*PADDING;
+    int bucket = getBucket(screenScale);
+    while (ceil(svgWidth*getBucketScale(bucket)) > maxSize || ceil(svgHeight*getBucketScale(bucket)) > maxSize)
+    {
+        bucket--;
+    }
+
+    VectorSVGRaster* match = NULL;
+    VectorSVGRaster* closest = NULL;
+    for (UTsize i = 0; i < svg->rasters.size(); i++)
+    {
+        VectorSVGRaster* raster = svg->rasters[i];
+        if (raster->bucket == bucket)
+        {
+            match = raster;
+        }
+        else if (raster->page != -1 && (closest == NULL || abs(raster->bucket - bucket) < abs(closest->bucket - bucket)))
+        {
+            closest = raster;
+        }
+    }
+
+    if (match == NULL)
+    {
+        match = lmNew(NULL) VectorSVGRaster();
+        match->svg = svg;
+        match->bucket = bucket;
+        match->scale = getBucketScale(bucket);
+        match->contentWidth = svgWidth*match->scale;
+        match->contentHeight = svgHeight*match->scale;
+        match->width = (int)ceil(match->contentWidth);
+        match->height = (int)ceil(match->contentHeight);
+        if (match->width < 1) match->width = 1;
+        if (match->height < 1) match->height = 1;
+        match->page = -1;
+        match->x = 0;
+        match->y = 0;
+        match->pending = false;
+        match->pixels = NULL;
+        svg->rasters.push_back(match);
+    }
+
+    if (match->page != -1) return match;
+
+    if (!match->pending)
+    {
+        ensureThread();
+        match->pending = true;
+        loom_mutex_lock(sQueueMutex);
+        sJobs.push_back(match);
+        loom_mutex_unlock(sQueueMutex);
+        loom_semaphore_post(sJobSemaphore);
+    }
+
+    return closest;
+}
+
+void VectorSVGCache::draw(VectorSVGRaster* raster, float x, float y, float scale, const Loom2D::Matrix& transform, float alpha, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend)
+{
+    if (raster->page == -1) return;
+
+    VectorSVGAtlasPage* page = sPages[raster->page];
+    page->lastUsedFrame = Graphics::getCurrentFrame();
+
+    VertexPosColorTex* v = QuadRenderer::getQuadVertexMemory(4, page->texture, blendEnabled, srcBlend, dstBlend, ShaderProgram::getDefaultShader());
+    if (v == NULL) return;
+
+    float x1 = x + raster->contentWidth/raster->scale*scale;
+    float y1 = y + raster->contentHeight/raster->scale*scale;
+    float u0 = (float)raster->x/PAGE_SIZE;
+    float v0 = (float)raster->y/PAGE_SIZE;
+    float u1 = (raster->x + raster->contentWidth)/PAGE_SIZE;
+    float v1 = (raster->y + raster->contentHeight)/PAGE_SIZE;
+    uint32_t abgr = ((uint32_t)(lmClamp(alpha, 0.0f, 1.0f)*255.0f) << 24) | 0x00FFFFFF;
+
+    const float corners[4][4] = {
+        { x,  y,  u0, v0 },
+        { x1, y,  u1, v0 },
+        { x,  y1, u0, v1 },
+        { x1, y1, u1, v1 },
+    };
+
+    for (int i = 0; i < 4; i++)
+    {
+        v[i].x = (float)(transform.a*corners[i][0] + transform.c*corners[i][1] + transform.tx);
+        v[i].y = (float)(transform.b*corners[i][0] + transform.d*corners[i][1] + transform.ty);
+        v[i].z = 0;
+        v[i].abgr = abgr;
+        v[i].u = corners[i][2];
+        v[i].v = corners[i][3];
+    }
+}
+
+void VectorSVGCache::release(VectorSVG* svg)
+{
+    if (svg->rasters.size() == 0) return;
+
+    // Without a raster thread there is nothing in flight to wait for.
+    bool threaded = sThread != NULL;
+    if (threaded)
+    {
+        loom_mutex_lock(sRasterMutex);
+        loom_mutex_lock(sQueueMutex);
+    }
+
+    for (UTsize i = 0; i < svg->rasters.size(); i++)
+    {
+        VectorSVGRaster* raster = svg->rasters[i];
+
+        UTsize index = sJobs.find(raster);
+        if (index != UT_NPOS) sJobs.erase(index, true);
+        index = sDone.find(raster);
+        if (index != UT_NPOS) sDone.erase(index, true);
+
+        if (raster->page != -1)
+        {
+            sPages[raster->page]->rasters.erase(raster);
+        }
+
+        lmSafeFree(NULL, raster->pixels);
+        lmDelete(NULL, raster);
+    }
+    svg->rasters.clear();
+
+    if (threaded)
+    {
+        loom_mutex_unlock(sQueueMutex);
+        loom_mutex_unlock(sRasterMutex);
+    }
+
+    VectorSVG::markChanged();
+}
+
+void VectorSVGCache::tick()
+{
+    if (sThread == NULL) return;
+
+    LOOM_PROFILE_SCOPE(vectorSVGCacheTick);
+
+    utArray<VectorSVGRaster*> done;
+    loom_mutex_lock(sQueueMutex);
+    for (UTsize i = 0; i < sDone.size(); i++)
+    {
+        done.push_back(sDone[i]);
+    }
+    sDone.clear();
+    loom_mutex_unlock(sQueueMutex);
+
+    if (done.size() == 0) return;
+
+    for (UTsize i = 0; i < done.size(); i++)
+    {
+        VectorSVGRaster* raster = done[i];
+        int paddedWidth = raster->width + 2*PADDING;
+        int paddedHeight = raster->height + 2*PADDING;
+        int px, py;
+        int pageIndex = allocate(paddedWidth, paddedHeight, &px, &py);
+        if (pageIndex != -1)
+        {
+            VectorSVGAtlasPage* page = sPages[pageIndex];
+            TextureInfo* tinfo = Texture::getTextureInfo(page->texture);
+            if (tinfo != NULL)
+            {
+                Texture::upload(*tinfo, raster->pixels, (uint16_t)paddedWidth, (uint16_t)paddedHeight, px, py);
+                raster->page = pageIndex;
+                raster->x = px + PADDING;
+                raster->y = py + PADDING;
+                page->rasters.push_back(raster);
+            }
+        }
+        else
+        {
+            lmLogWarn(gGFXVectorSVGCacheLogGroup, "Unable to fit %dx%d SVG raster into the atlas", raster->width, raster->height);
+        }
+        raster->pending = false;
+        lmSafeFree(NULL, raster->pixels);
+    }
+
+    // Graphics that drew vector fallbacks need to pick up the new rasters.
+    VectorSVG::markChanged();
+}
+
+void VectorSVGCache::reset()
+{
+    for (UTsize i = 0; i < sPages.size(); i++)
+    {
+        VectorSVGAtlasPage* page = sPages[i];
+        clearPage(page);
+        Texture::dispose(page->texture);
+        lmDelete(NULL, page);
+    }
+    sPages.clear();
+
+    VectorSVG::markChanged();
+}
+
+void VectorSVGCache::shutdown()
+{
+    if (sThread != NULL)
+    {
+        loom_mutex_lock(sQueueMutex);
+        sThreadStop = true;
+        loom_mutex_unlock(sQueueMutex);
+        loom_semaphore_post(sJobSemaphore);
+        loom_thread_join(sThread);
+        sThread = NULL;
+
+        // Rasters still queued or done are owned by their SVGs, just forget them.
+        for (UTsize i = 0; i < sJobs.size(); i++) sJobs[i]->pending = false;
+        for (UTsize i = 0; i < sDone.size(); i++)
+        {
+            lmSafeFree(NULL, sDone[i]->pixels);
+            sDone[i]->pending = false;
+        }
+        sJobs.clear();
+        sDone.clear();
+
+        loom_semaphore_destroy(sJobSemaphore);
+        loom_mutex_destroy(sRasterMutex);
+        loom_mutex_destroy(sQueueMutex);
+        sRasterMutex = NULL;
+        sQueueMutex = NULL;
+    }
+
+    reset();
+}
+
+}
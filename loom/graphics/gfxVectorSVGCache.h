@@ -0,0 +1,103 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#pragma once
+
+#include "loom/graphics/gfxTexture.h"
+#include "loom/engine/loom2d/l2dMatrix.h"
+#include "loom/common/utils/utTypes.h"
+
+namespace GFX
+{
+
+class VectorSVG;
+
+/*
+ * One SVG rasterised at one scale bucket. Rasters are owned by
+ * VectorSVGCache and listed on the VectorSVG they were made from.
+ */
+struct VectorSVGRaster
+{
+    VectorSVG* svg;
+    int bucket;
+
+    // Scale the image is rasterised at, the size of the image at that scale
+    // and the whole pixels it occupies (without atlas padding).
+    float scale;
+    float contentWidth;
+    float contentHeight;
+    int width;
+    int height;
+
+    // Atlas page index and position, page is -1 until the pixels are uploaded.
+    int page;
+    int x;
+    int y;
+
+    // Set while queued for or being processed by the raster thread.
+    bool pending;
+
+    // Pixels handed back by the raster thread, waiting to be uploaded.
+    uint8_t* pixels;
+};
+
+/*
+ * Rasterises SVG images on a background thread and keeps the results in
+ * shared atlas textures so they can be drawn as textured quads through the
+ * QuadRenderer instead of being tessellated by nanovg every frame.
+ *
+ * Rasters are keyed by (image, scale bucket), with two buckets per octave
+ * of on-screen scale. Full atlas pages are recycled least recently used first.
+ */
+class VectorSVGCache
+{
+public:
+    static const int PAGE_SIZE = 1024;
+    static const int MAX_PAGES = 4;
+    static const int PADDING = 1;
+
+    /*
+     * Returns a raster of the SVG suitable for the provided on-screen scale.
+     * If the matching bucket isn't ready yet it gets queued for rasterisation
+     * and the closest ready bucket is returned instead, or NULL if there is none.
+     */
+    static VectorSVGRaster* request(VectorSVG* svg, float screenScale);
+
+    /*
+     * Batches a quad showing the raster at (x, y) with the size of the SVG
+     * times scale, transformed by the provided matrix.
+     */
+    static void draw(VectorSVGRaster* raster, float x, float y, float scale, const Loom2D::Matrix& transform, float alpha, bool blendEnabled, uint32_t srcBlend, uint32_t dstBlend);
+
+    // Drops all rasters of the SVG, waiting for the raster thread if it's busy with one.
+    static void release(VectorSVG* svg);
+
+    // Uploads rasters finished by the raster thread, call once per frame on the main thread.
+    static void tick();
+
+    // Drops all atlas pages, e.g. after the graphics context was lost.
+    static void reset();
+
+    static void shutdown();
+
+    static int __stdcall rasterThreadMain(void *param);
+};
+
+}
@@ -655,10 +655,14 @@ Statement *JitTypeCompiler::visit(DoStatement *statement)
 
     enterBlock(fs, &bl, 1);
 
+    /* the trace compiler only records loops which start with a LOOP instruction */
+    BCPos loop = bcemit_AD(fs, BC_LOOP, fs->nactvar, 0);
+
     /* statements*/
     statement->statement->visitStatement(this);
 
-    lua_assert(bl.breaklist == NO_JMP);
+    /* continue evaluates the condition */
+    BC::jmpToHere(fs, bl.continuelist);
 
     int condexit = encodeCondition(statement->expression);
 
@@ -667,6 +671,7 @@ Statement *JitTypeCompiler::visit(DoStatement *statement)
     leaveBlock(fs);
 
     BC::jmpToHere(fs, condexit); /* false conditions finish the loop */
+    BC::jmpPatchIns(fs, loop, fs->pc);
 
     return statement;
 }
@@ -744,13 +749,16 @@ Statement *JitTypeCompiler::visit(ForStatement *statement)
 
     enterBlock(fs, &bl, 1);
 
+    BCPos loop = bcemit_AD(fs, BC_LOOP, fs->nactvar, 0);
+
     /* statements*/
     statement->statement->visitStatement(this);
 
+    /* continue runs the increment, if any, then tests the condition */
+    BC::jmpToHere(fs, bl.continuelist);
+
     if (es)
     {
-        BC::jmpToHere(fs, bl.continuelist);
-
         es->visitStatement(this);
 
         es->expression = NULL;
@@ -759,12 +767,11 @@ Statement *JitTypeCompiler::visit(ForStatement *statement)
         es = NULL;
     }
 
-    lua_assert(bl.breaklist == NO_JUMP);
-
     BC::jmpPatch(fs, BC::emitJmp(fs), whileinit);
     leaveBlock(fs);
 
     BC::jmpToHere(fs, condexit); /* false conditions finish the loop */
+    BC::jmpPatchIns(fs, loop, fs->pc);
 
     return statement;
 }
@@ -1643,8 +1650,52 @@ Expression *JitTypeCompiler::visit(ConditionalExpression *conditional)
     return conditional;
 }
 
+void JitTypeCompiler::generateMethodLookup(ExpDesc *object, int key)
+{
+    FuncState *fs = cs->fs;
+
+    // this mirrors LuaJIT's bcemit_method with a numeric key and a second index
+    BCReg obj = BC::expToAnyReg(fs, object);
+    BC::expFree(fs, object);
+
+    BCReg func = fs->freereg;
+    BCReg keyReg = func + 2 + twoSlotFrameInfo;
+
+    // copy object to first argument
+    BC::emitINS(fs, BCINS_AD(BC_MOV, func + 1 + twoSlotFrameInfo, obj));
+
+    BC::regReserve(fs, 3 + twoSlotFrameInfo);
+
+    // func = object[LSINDEXCLASS]
+    ExpDesc eindex;
+    BC::initExpDesc(&eindex, VKNUM, 0);
+    setnumV(&eindex.u.nval, LSINDEXCLASS);
+    BC::expToReg(fs, &eindex, keyReg);
+    BC::emitINS(fs, BCINS_ABC(BC_TGETV, func, obj, keyReg));
+
+    // func = func[key]
+    if ((key >= 0) && (key <= BCMAX_C))
+    {
+        BC::emitINS(fs, BCINS_ABC(BC_TGETB, func, func, key));
+    }
+    else
+    {
+        BC::initExpDesc(&eindex, VKNUM, 0);
+        setnumV(&eindex.u.nval, key);
+        BC::expToReg(fs, &eindex, keyReg);
+        BC::emitINS(fs, BCINS_ABC(BC_TGETV, func, func, keyReg));
+    }
+
+    // release the key register
+    fs->freereg--;
+
+    object->u.s.info = func;
+    object->k        = VNONRELOC;
+}
+
+
 void JitTypeCompiler::generateCall(ExpDesc *call, utArray<Expression *> *arguments,
-                                MethodBase *methodBase)
+                                MethodBase *methodBase, bool methodCall)
 {
     FuncState *fs = cs->fs;
 
@@ -1657,8 +1708,12 @@ void JitTypeCompiler::generateCall(ExpDesc *call, utArray<Expression *> *argumen
         vararg = methodBase->getVarArgParameter();
     }
 
-    BC::expToNextReg(fs, call);
-    if (twoSlotFrameInfo) BC::regReserve(fs, 1);
+    // method calls already have the function, frame slot and receiver in place
+    if (!methodCall)
+    {
+        BC::expToNextReg(fs, call);
+        if (twoSlotFrameInfo) BC::regReserve(fs, 1);
+    }
 
     ExpDesc args;
     args.k = VVOID;
@@ -60,7 +60,9 @@ class JitTypeCompiler : public TypeCompilerBase {
     int parList(FunctionLiteral *literal, bool method);
 
     void generateCall(ExpDesc *call, utArray<Expression *> *arguments,
-                      MethodBase *methodBase = NULL);
+                      MethodBase *methodBase = NULL, bool methodCall = false);
+
+    void generateMethodLookup(ExpDesc *object, int key);
 
     virtual void generateConstructor(FunctionLiteral *function,
                                      ConstructorInfo *method);
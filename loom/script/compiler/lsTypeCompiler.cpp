@@ -616,6 +616,9 @@ Statement *TypeCompiler::visit(DoStatement *statement)
 
     lua_assert(bl.breaklist == NO_JUMP);
 
+    /* continue evaluates the condition */
+    BC::patchToHere(fs, bl.continuelist);
+
     statement->expression->visitExpression(this);
     ExpDesc c        = statement->expression->e;
     int     condexit = BC::cond(cs, &c);
@@ -703,10 +706,11 @@ Statement *TypeCompiler::visit(ForStatement *statement)
     /* statements*/
     statement->statement->visitStatement(this);
 
+    /* continue runs the increment, if any, then tests the condition */
+    BC::patchToHere(fs, bl.continuelist);
+
     if (es)
     {
-        BC::patchToHere(fs, bl.continuelist);
-
         es->visitStatement(this);
 
         es->expression = NULL;
@@ -1490,8 +1494,33 @@ Expression *TypeCompiler::visit(ConditionalExpression *conditional)
     return conditional;
 }
 
+void TypeCompiler::generateMethodLookup(ExpDesc *object, int key)
+{
+    FuncState *fs = cs->fs;
+
+    ExpDesc eclass;
+
+    BC::initExpDesc(&eclass, VKNUM, 0);
+    eclass.u.nval = LSINDEXCLASS;
+
+    // func = object[LSINDEXCLASS], func + 1 = object
+    BC::self(fs, object, &eclass);
+
+    int func = object->u.s.info;
+
+    ExpDesc ekey;
+
+    BC::initExpDesc(&ekey, VKNUM, 0);
+    ekey.u.nval = key;
+
+    // func = func[key]
+    BC::codeABC(fs, OP_GETTABLE, func, func, BC::expToRK(fs, &ekey));
+    BC::freeExp(fs, &ekey);
+}
+
+
 void TypeCompiler::generateCall(ExpDesc *call, utArray<Expression *> *arguments,
-                                MethodBase *methodBase)
+                                MethodBase *methodBase, bool methodCall)
 {
     FuncState *fs = cs->fs;
 
@@ -1504,7 +1533,11 @@ void TypeCompiler::generateCall(ExpDesc *call, utArray<Expression *> *arguments,
         vararg = methodBase->getVarArgParameter();
     }
 
-    BC::expToNextReg(fs, call);
+    // method calls already have the function and receiver in place
+    if (!methodCall)
+    {
+        BC::expToNextReg(fs, call);
+    }
 
     ExpDesc args;
     args.k = VVOID;
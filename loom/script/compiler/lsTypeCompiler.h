@@ -55,7 +55,9 @@ class TypeCompiler : public TypeCompilerBase  {
                       int startIdx);
 
     void generateCall(ExpDesc *call, utArray<Expression *> *arguments,
-                      MethodBase *methodBase = NULL);
+                      MethodBase *methodBase = NULL, bool methodCall = false);
+
+    void generateMethodLookup(ExpDesc *object, int key);
     void generatePropertySet(ExpDesc *call, Expression *value,
                              bool visit = true);
 
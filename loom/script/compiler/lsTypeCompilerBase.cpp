@@ -25,6 +25,7 @@
 #include "loom/script/reflection/lsPropertyInfo.h"
 
 #include "loom/script/runtime/lsProfiler.h"
+#include "loom/script/runtime/lsRuntime.h"
 
 #if LOOM_ENABLE_JIT
 
@@ -339,10 +340,88 @@ Expression *TypeCompilerBase::visit(LogicalOrExpression *expression)
     return visit((BinaryOperatorExpression *)expression);
 }
 
+bool TypeCompilerBase::generateSharedMethodCall(CallExpression *call)
+{
+    MethodBase *methodBase = call->methodBase;
+
+    if (!methodBase || !methodBase->isMethod() || methodBase->isStatic() || methodBase->isNative() || methodBase->isFastCall())
+    {
+        return false;
+    }
+
+    Type *declaringType = methodBase->getDeclaringType();
+
+    // interface calls are resolved by name and primitives are transformed to static calls
+    if (declaringType->isInterface() || declaringType->isPrimitive() || declaringType->isDelegate())
+    {
+        return false;
+    }
+
+    // default and variable arguments are filled in by the bound lsr_method closure
+    int nargs = call->arguments ? (int)call->arguments->size() : 0;
+    if (methodBase->getVarArgParameter() || (nargs < methodBase->getNumParameters()))
+    {
+        return false;
+    }
+
+    ExpDesc object;
+
+    if (call->function->astType == AST_PROPERTYEXPRESSION)
+    {
+        PropertyExpression *p = (PropertyExpression *)call->function;
+
+        if (p->arrayAccess || p->staticAccess || (p->rightExpression->memberInfo != methodBase))
+        {
+            return false;
+        }
+
+        // the receiver must be a script instance table, an Object may be any Lua value
+        Type *receiverType = p->leftExpression->type;
+        if (!receiverType || receiverType->isInterface() || receiverType->isPrimitive() ||
+            (receiverType->getFullName() == "system.Object"))
+        {
+            return false;
+        }
+
+        p->leftExpression->visitExpression(this);
+        object = p->leftExpression->e;
+    }
+    else if (call->function->astType == AST_IDENTIFIER)
+    {
+        Identifier *identifier = (Identifier *)call->function;
+
+        if (identifier->superAccess || identifier->typeExpression || (identifier->memberInfo != methodBase))
+        {
+            return false;
+        }
+
+        BC::singleVar(cs, &object, "this");
+    }
+    else
+    {
+        return false;
+    }
+
+    generateMethodLookup(&object, lualoom_sharedmethodkey(methodBase->getOrdinal()));
+    generateCall(&object, call->arguments, methodBase, true);
+
+    call->function->e = object;
+    call->e           = object;
+
+    return true;
+}
+
+
 Expression *TypeCompilerBase::visit(CallExpression *call)
 {
     MethodBase *methodBase = call->methodBase;
 
+    // direct calls to script methods dispatch through the class table
+    if (generateSharedMethodCall(call))
+    {
+        return call;
+    }
+
     call->function->visitExpression(this);
 
     // check whether we're calling a methodbase
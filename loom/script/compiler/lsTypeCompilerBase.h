@@ -95,7 +95,18 @@ protected:
     virtual void initCodeState(CodeState *codeState, FuncState *funcState, const utString& source) = 0;
     virtual void closeCodeState(CodeState *codeState) = 0;
 
-    virtual void generateCall(ExpDesc *call, utArray<Expression *> *arguments, MethodBase *methodBase = NULL) = 0;
+    // when methodCall is set, the call has been set up by generateMethodLookup and
+    // the receiver is already in place as the first argument
+    virtual void generateCall(ExpDesc *call, utArray<Expression *> *arguments, MethodBase *methodBase = NULL, bool methodCall = false) = 0;
+
+    // Loads object[LSINDEXCLASS][key] into a call base register and copies
+    // object after it as the first argument, the class table method is shared
+    // by all instances so this doesn't bind (and cache) a closure per instance
+    virtual void generateMethodLookup(ExpDesc *object, int key) = 0;
+
+    // Emits a direct call to an instance script method through the receiver's class table,
+    // returns false if the call needs the bound method path (natives, default args, interfaces, etc)
+    bool generateSharedMethodCall(CallExpression *call);
 
 
     virtual void generateConstructor(FunctionLiteral *function,
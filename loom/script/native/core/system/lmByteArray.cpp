@@ -19,8 +19,135 @@
  */
 
 #include "loom/script/loomscript.h"
+#include "loom/script/runtime/lsRuntime.h"
 #include "loom/common/utils/utByteArray.h"
 
+// Values are staged through a fixed stack buffer so the bulk calls never
+// allocate, and each chunk is a single bounds check and copy.
+static const int BULK_CHUNK = 256;
+
+template<typename T>
+static int readVectorChunked(utByteArray *bytes, lua_State *L, const char *method)
+{
+    // args: target:Vector, count:int
+    if (!lua_istable(L, 2))
+    {
+        return luaL_error(L, "ByteArray.%s: target Vector is null", method);
+    }
+
+    int count = (int)lua_tonumber(L, 3);
+
+    if (count < 0)
+    {
+        return luaL_error(L, "ByteArray.%s: count must not be negative, got %d", method, count);
+    }
+
+    if ((unsigned int)count > bytes->bytesAvailable() / sizeof(T))
+    {
+        return luaL_error(L, "ByteArray.%s: %d values don't fit in the %d bytes available", method, count, (int)bytes->bytesAvailable());
+    }
+
+    lua_rawgeti(L, 2, LSINDEXVECTOR);
+    int vectorTable = lua_gettop(L);
+
+    T   buffer[BULK_CHUNK];
+    int index = 0;
+    while (index < count)
+    {
+        int n = count - index;
+        if (n > BULK_CHUNK)
+        {
+            n = BULK_CHUNK;
+        }
+
+        bytes->readArray<T>(buffer, (UTsize)n);
+
+        for (int i = 0; i < n; i++)
+        {
+            lua_pushnumber(L, (lua_Number)buffer[i]);
+            lua_rawseti(L, vectorTable, index + i);
+        }
+
+        index += n;
+    }
+
+    lua_pop(L, 1);
+
+    lsr_vector_set_length(L, 2, count);
+
+    lua_pushvalue(L, 2);
+    return 1;
+}
+
+template<typename T>
+static int writeVectorChunked(utByteArray *bytes, lua_State *L, const char *method)
+{
+    // args: source:Vector, start:int, count:int (-1 for the rest)
+    if (!lua_istable(L, 2))
+    {
+        return luaL_error(L, "ByteArray.%s: source Vector is null", method);
+    }
+
+    int length = lsr_vector_get_length(L, 2);
+    int start  = (int)lua_tonumber(L, 3);
+    int count  = (int)lua_tonumber(L, 4);
+
+    start = utClamp<int>(start, 0, length);
+    if ((count < 0) || (count > length - start))
+    {
+        count = length - start;
+    }
+
+    lua_rawgeti(L, 2, LSINDEXVECTOR);
+    int vectorTable = lua_gettop(L);
+
+    T   buffer[BULK_CHUNK];
+    int index = 0;
+    while (index < count)
+    {
+        int n = count - index;
+        if (n > BULK_CHUNK)
+        {
+            n = BULK_CHUNK;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            lua_rawgeti(L, vectorTable, start + index + i);
+            buffer[i] = (T)lua_tonumber(L, -1);
+            lua_pop(L, 1);
+        }
+
+        bytes->writeArray<T>(buffer, (UTsize)n);
+
+        index += n;
+    }
+
+    lua_pop(L, 1);
+
+    return 0;
+}
+
+int utByteArray::readFloatsLua(lua_State *L)
+{
+    return readVectorChunked<float>(this, L, "readFloats");
+}
+
+int utByteArray::writeFloatsLua(lua_State *L)
+{
+    return writeVectorChunked<float>(this, L, "writeFloats");
+}
+
+int utByteArray::readIntsLua(lua_State *L)
+{
+    return readVectorChunked<int>(this, L, "readInts");
+}
+
+int utByteArray::writeIntsLua(lua_State *L)
+{
+    return writeVectorChunked<int>(this, L, "writeInts");
+}
+
 static int registerSystemByteArray(lua_State *L)
 {
     beginPackage(L, "system")
@@ -59,6 +186,10 @@ static int registerSystemByteArray(lua_State *L)
        .addMethod("writeUnsignedByte", &utByteArray::writeUnsignedByte)
        .addMethod("readBytes", &utByteArray::readBytes)
        .addMethod("writeBytes", &utByteArray::writeBytes)
+       .addLuaFunction("readFloats", &utByteArray::readFloatsLua)
+       .addLuaFunction("writeFloats", &utByteArray::writeFloatsLua)
+       .addLuaFunction("readInts", &utByteArray::readIntsLua)
+       .addLuaFunction("writeInts", &utByteArray::writeIntsLua)
        .addMethod("reserve", &utByteArray::reserve)
        .addMethod("compress", &utByteArray::compress)
        .addMethod("uncompress", &utByteArray::uncompress)
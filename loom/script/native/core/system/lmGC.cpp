@@ -29,6 +29,19 @@ namespace LS {
 
 static loom_logGroup_t  gGCGroup = { "GC", 1 };
 
+// Telemetry tick values, registered once so updates are plain array writes
+static TickMetricID gcCyclePreviousGarbageID = Telemetry::registerTickValue("gc.cycle.previous.garbage");
+static TickMetricID gcCycleRunsLimitID       = Telemetry::registerTickValue("gc.cycle.runs.limit");
+static TickMetricID gcCycleUpdateCountID     = Telemetry::registerTickValue("gc.cycle.update.count");
+static TickMetricID gcCycleUpdateTimeSumID   = Telemetry::registerTickValue("gc.cycle.update.time.sum");
+static TickMetricID gcCycleUpdateTimeMaxID   = Telemetry::registerTickValue("gc.cycle.update.time.max");
+static TickMetricID gcCycleRunsSumID         = Telemetry::registerTickValue("gc.cycle.runs.sum");
+static TickMetricID gcCycleCollectedID       = Telemetry::registerTickValue("gc.cycle.collected");
+static TickMetricID gcCyclePreviousKBID      = Telemetry::registerTickValue("gc.cycle.previous.collectedKB");
+static TickMetricID gcCycleLastValidBPRID    = Telemetry::registerTickValue("gc.cycle.lastValidBPR");
+static TickMetricID gcCycleHibernatingID     = Telemetry::registerTickValue("gc.cycle.hibernating");
+static TickMetricID gcMemoryID               = Telemetry::registerTickValue("gc.memory");
+
 
 class GC 
 {
@@ -60,7 +73,14 @@ public:
 
     static int collect(lua_State *L)
     {
-        lua_gc(L, (int)lua_tonumber(L, 1), (int)lua_tonumber(L, 2));
+        int what = (int)lua_tonumber(L, 1);
+
+        lua_gc(L, what, (int)lua_tonumber(L, 2));
+
+        if (what == LUA_GCCOLLECT)
+        {
+            LSLuaState::getLuaState(L)->trimAllocator();
+        }
 
         return 0;
     }
@@ -232,17 +252,25 @@ public:
 
         }
 
-        Telemetry::setTickValue("gc.cycle.previous.garbage", cyclePrevGarbage);
-        Telemetry::setTickValue("gc.cycle.runs.limit", updateRunLimit);
-        Telemetry::setTickValue("gc.cycle.update.count", cycleUpdates);
-        Telemetry::setTickValue("gc.cycle.update.time.sum", cycleUpdateTime);
-        Telemetry::setTickValue("gc.cycle.update.time.max", cycleMaxTime);
-        Telemetry::setTickValue("gc.cycle.runs.sum", cycleRuns);
-        Telemetry::setTickValue("gc.cycle.collected", cycleCollectedBytes);
-        Telemetry::setTickValue("gc.cycle.previous.collectedKB", cycleKB);
-        Telemetry::setTickValue("gc.cycle.lastValidBPR", lastValidBPR);
-        Telemetry::setTickValue("gc.cycle.hibernating", hibernating ? 1 : 0);
-        Telemetry::setTickValue("gc.memory", (double) memoryAfterKB * 1024 + memoryAfterB);
+        Telemetry::setTickValue(gcCyclePreviousGarbageID, cyclePrevGarbage);
+        Telemetry::setTickValue(gcCycleRunsLimitID, updateRunLimit);
+        Telemetry::setTickValue(gcCycleUpdateCountID, cycleUpdates);
+        Telemetry::setTickValue(gcCycleUpdateTimeSumID, cycleUpdateTime);
+        Telemetry::setTickValue(gcCycleUpdateTimeMaxID, cycleMaxTime);
+        Telemetry::setTickValue(gcCycleRunsSumID, cycleRuns);
+        Telemetry::setTickValue(gcCycleCollectedID, cycleCollectedBytes);
+        Telemetry::setTickValue(gcCyclePreviousKBID, cycleKB);
+        Telemetry::setTickValue(gcCycleLastValidBPRID, lastValidBPR);
+        Telemetry::setTickValue(gcCycleHibernatingID, hibernating ? 1 : 0);
+        Telemetry::setTickValue(gcMemoryID, (double) memoryAfterKB * 1024 + memoryAfterB);
+
+        // Slabs emptied by a finished cycle go back to the OS
+        LSLuaState *vm = LSLuaState::getLuaState(L);
+        if (cyclesFinished > 0)
+        {
+            vm->trimAllocator();
+        }
+        vm->reportAllocatorTelemetry();
 
 
         return 0;
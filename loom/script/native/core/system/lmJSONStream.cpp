@@ -0,0 +1,431 @@
+/*
+ * ===========================================================================
+ * Loom SDK
+ * Copyright 2011, 2012, 2013
+ * The Game Engine Company, LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * ===========================================================================
+ */
+
+#include "loom/common/utils/jsonStream.h"
+#include "loom/script/loomscript.h"
+#include "loom/script/runtime/lsRuntime.h"
+#include "loom/script/reflection/lsType.h"
+#include "loom/script/reflection/lsPropertyInfo.h"
+
+using namespace LS;
+
+// Types the decoder handles specially, looked up once per decode
+struct JSONDecodeTypes
+{
+    Type *objectType;
+    Type *stringType;
+    Type *numberType;
+    Type *booleanType;
+    Type *vectorType;
+    Type *dictionaryType;
+};
+
+static bool decodeValue(lua_State *L, JSONReader *reader, const JSONDecodeTypes& types, Type *type, TemplateInfo *templateInfo, int existing);
+
+static bool decodeVector(lua_State *L, JSONReader *reader, const JSONDecodeTypes& types, TemplateInfo *templateInfo)
+{
+    Type         *elementType = NULL;
+    TemplateInfo *elementInfo = NULL;
+
+    if (templateInfo && templateInfo->isVector() && templateInfo->hasIndexedType())
+    {
+        elementType = templateInfo->getIndexedType();
+        elementInfo = templateInfo->getIndexedTemplateInfo();
+    }
+
+    lsr_createinstance(L, types.vectorType);
+    int vectorIdx = lua_gettop(L);
+
+    lua_rawgeti(L, vectorIdx, LSINDEXVECTOR);
+    int tableIdx = lua_gettop(L);
+
+    // elements of the wrong type are left out
+    int count = 0;
+    for ( ; ; )
+    {
+        int token = reader->next();
+
+        if (token == JSON_TOKEN_ARRAY_END)
+        {
+            break;
+        }
+
+        if (token == JSON_TOKEN_ERROR)
+        {
+            lua_settop(L, vectorIdx - 1);
+            return false;
+        }
+
+        if (decodeValue(L, reader, types, elementType, elementInfo, 0))
+        {
+            lua_rawseti(L, tableIdx, count++);
+        }
+    }
+
+    lua_pop(L, 1);
+    lsr_vector_set_length(L, vectorIdx, count);
+
+    return true;
+}
+
+static bool decodeDictionary(lua_State *L, JSONReader *reader, const JSONDecodeTypes& types, TemplateInfo *templateInfo)
+{
+    Type         *valueType = NULL;
+    TemplateInfo *valueInfo = NULL;
+
+    if (templateInfo && !templateInfo->isVector() && templateInfo->hasIndexedType())
+    {
+        valueType = templateInfo->getIndexedType();
+        valueInfo = templateInfo->getIndexedTemplateInfo();
+    }
+
+    lsr_createinstance(L, types.dictionaryType);
+    int dictionaryIdx = lua_gettop(L);
+
+    lua_rawgeti(L, dictionaryIdx, LSINDEXDICTPAIRS);
+    int pairsIdx = lua_gettop(L);
+
+    for ( ; ; )
+    {
+        int token = reader->next();
+
+        if (token == JSON_TOKEN_OBJECT_END)
+        {
+            break;
+        }
+
+        if (token != JSON_TOKEN_KEY)
+        {
+            lua_settop(L, dictionaryIdx - 1);
+            return false;
+        }
+
+        // push the key now, scanning the value reuses the reader's string buffer
+        lua_pushlstring(L, reader->getString(), reader->getStringLength());
+
+        if (reader->next() == JSON_TOKEN_ERROR)
+        {
+            lua_settop(L, dictionaryIdx - 1);
+            return false;
+        }
+
+        if (decodeValue(L, reader, types, valueType, valueInfo, 0))
+        {
+            lua_rawset(L, pairsIdx);
+        }
+        else
+        {
+            lua_pop(L, 1);
+        }
+    }
+
+    lua_pop(L, 1);
+
+    return true;
+}
+
+static bool decodeInstance(lua_State *L, JSONReader *reader, const JSONDecodeTypes& types, Type *type, int existing)
+{
+    // decode into the object that's already there, if it is one
+    if (existing && lua_istable(L, existing) && (lsr_gettype(L, existing) == type))
+    {
+        lua_pushvalue(L, existing);
+    }
+    else
+    {
+        lsr_createinstance(L, type);
+    }
+
+    int instanceIdx = lua_gettop(L);
+
+    for ( ; ; )
+    {
+        int token = reader->next();
+
+        if (token == JSON_TOKEN_OBJECT_END)
+        {
+            break;
+        }
+
+        if (token != JSON_TOKEN_KEY)
+        {
+            lua_settop(L, instanceIdx - 1);
+            return false;
+        }
+
+        // Only public instance fields and properties with a setter are
+        // decoded, anything else in the JSON is skipped
+        MemberInfo *member = type->findMember(reader->getString());
+
+        MethodInfo *setter = NULL;
+        if (member && member->isProperty())
+        {
+            setter = ((PropertyInfo *)member)->setter;
+        }
+
+        bool decodable = member && member->isPublic() && !member->isStatic() &&
+                         ((member->isField() && !member->isNative()) || setter);
+
+        if (!decodable)
+        {
+            if (!reader->skip())
+            {
+                lua_settop(L, instanceIdx - 1);
+                return false;
+            }
+            continue;
+        }
+
+        if (reader->next() == JSON_TOKEN_ERROR)
+        {
+            lua_settop(L, instanceIdx - 1);
+            return false;
+        }
+
+        if (setter)
+        {
+            if (decodeValue(L, reader, types, member->getType(), member->getTemplateInfo(), 0))
+            {
+                // the accessor comes back with the instance already bound
+                lua_pushnumber(L, setter->getOrdinal());
+                lua_gettable(L, instanceIdx);
+                lua_pushvalue(L, -2);
+                lua_call(L, 1, 0);
+                lua_pop(L, 1);
+            }
+        }
+        else
+        {
+            lua_pushnumber(L, member->getOrdinal());
+            lua_gettable(L, instanceIdx);
+            int existingIdx = lua_gettop(L);
+
+            if (decodeValue(L, reader, types, member->getType(), member->getTemplateInfo(), existingIdx))
+            {
+                lua_pushnumber(L, member->getOrdinal());
+                lua_insert(L, -2);
+                lua_settable(L, instanceIdx);
+            }
+
+            lua_settop(L, instanceIdx);
+        }
+
+        if (reader->getToken() == JSON_TOKEN_ERROR)
+        {
+            lua_settop(L, instanceIdx - 1);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Decode the value at the reader's current token as type, pushing it and
+ * returning true, or consuming it and returning false when it doesn't fit
+ * the type (or is malformed).
+ */
+static bool decodeValue(lua_State *L, JSONReader *reader, const JSONDecodeTypes& types, Type *type, TemplateInfo *templateInfo, int existing)
+{
+    if (!lua_checkstack(L, 8))
+    {
+        return false;
+    }
+
+    bool untyped = !type || (type == types.objectType);
+
+    switch (reader->getToken())
+    {
+    case JSON_TOKEN_STRING:
+        if (untyped || (type == types.stringType))
+        {
+            lua_pushlstring(L, reader->getString(), reader->getStringLength());
+            return true;
+        }
+        return false;
+
+    case JSON_TOKEN_NUMBER:
+        if (untyped || (type == types.numberType) || type->isEnum())
+        {
+            lua_pushnumber(L, reader->getNumber());
+            return true;
+        }
+        if (type == types.stringType)
+        {
+            // keeps large ids exact
+            lua_pushlstring(L, reader->getString(), reader->getStringLength());
+            return true;
+        }
+        return false;
+
+    case JSON_TOKEN_TRUE:
+    case JSON_TOKEN_FALSE:
+        if (untyped || (type == types.booleanType))
+        {
+            lua_pushboolean(L, reader->getBoolean() ? 1 : 0);
+            return true;
+        }
+        return false;
+
+    case JSON_TOKEN_NULL:
+        // Number and Boolean keep their value, they can't be null
+        if ((type == types.numberType) || (type == types.booleanType))
+        {
+            return false;
+        }
+        lua_pushnil(L);
+        return true;
+
+    case JSON_TOKEN_ARRAY_START:
+        if (untyped || (type == types.vectorType))
+        {
+            return decodeVector(L, reader, types, templateInfo);
+        }
+        reader->skip();
+        return false;
+
+    case JSON_TOKEN_OBJECT_START:
+        if (untyped || (type == types.dictionaryType))
+        {
+            return decodeDictionary(L, reader, types, templateInfo);
+        }
+        if (!type->isPrimitive() && (type != types.vectorType) &&
+            !type->isInterface() && !type->isEnum() && !type->isDelegate())
+        {
+            return decodeInstance(L, reader, types, type, existing);
+        }
+        reader->skip();
+        return false;
+    }
+
+    return false;
+}
+
+int JSONReader::decode(lua_State *L)
+{
+    // args: type:Type, target:Object
+    Type *type = NULL;
+    if ((lua_gettop(L) >= 2) && !lua_isnil(L, 2))
+    {
+        type = (Type *)lualoom_getnativepointer(L, 2, false, "system.reflection.Type");
+    }
+
+    int target = ((lua_gettop(L) >= 3) && !lua_isnil(L, 3)) ? 3 : 0;
+
+    if (!type && target && lua_istable(L, target))
+    {
+        type = lsr_gettype(L, target);
+    }
+
+    // Start at the current token if it begins a value, otherwise at the next
+    int token = getToken();
+    if ((token == JSON_TOKEN_NONE) || (token == JSON_TOKEN_KEY) ||
+        (token == JSON_TOKEN_OBJECT_END) || (token == JSON_TOKEN_ARRAY_END))
+    {
+        token = next();
+    }
+
+    if ((token == JSON_TOKEN_END) || (token == JSON_TOKEN_ERROR))
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    LSLuaState *ls = LSLuaState::getLuaState(L);
+
+    JSONDecodeTypes types;
+    types.objectType     = ls->getType("system.Object");
+    types.stringType     = ls->getType("system.String");
+    types.numberType     = ls->getType("system.Number");
+    types.booleanType    = ls->getType("system.Boolean");
+    types.vectorType     = ls->getType("system.Vector");
+    types.dictionaryType = ls->getType("system.Dictionary");
+
+    int top = lua_gettop(L);
+
+    if (!decodeValue(L, this, types, type, NULL, target) || (getToken() == JSON_TOKEN_ERROR))
+    {
+        lua_settop(L, top);
+        lua_pushnil(L);
+    }
+
+    return 1;
+}
+
+static int registerSystemJSONReader(lua_State *L)
+{
+    beginPackage(L, "system")
+
+       .beginClass<JSONReader> ("JSONReader")
+       .addConstructor<void (*)(void)>()
+       .addMethod("loadString_", &JSONReader::loadString)
+       .addMethod("loadBytes_", &JSONReader::loadBytes)
+       .addMethod("next", &JSONReader::next)
+       .addMethod("getToken", &JSONReader::getToken)
+       .addMethod("getString", &JSONReader::getString)
+       .addMethod("getNumber", &JSONReader::getNumber)
+       .addMethod("getBoolean", &JSONReader::getBoolean)
+       .addMethod("getDepth", &JSONReader::getDepth)
+       .addMethod("skip", &JSONReader::skip)
+       .addMethod("getError", &JSONReader::getError)
+       .addLuaFunction("decode", &JSONReader::decode)
+       .endClass()
+
+       .endPackage();
+
+    return 0;
+}
+
+static int registerSystemJSONWriter(lua_State *L)
+{
+    beginPackage(L, "system")
+
+       .beginClass<JSONWriter> ("JSONWriter")
+       .addConstructor<void (*)(void)>()
+       .addMethod("clear", &JSONWriter::clear)
+       .addProperty("indent", &JSONWriter::getIndent, &JSONWriter::setIndent)
+       .addMethod("beginObject", &JSONWriter::beginObject)
+       .addMethod("endObject", &JSONWriter::endObject)
+       .addMethod("beginArray", &JSONWriter::beginArray)
+       .addMethod("endArray", &JSONWriter::endArray)
+       .addMethod("writeKey", &JSONWriter::writeKey)
+       .addMethod("writeString", &JSONWriter::writeString)
+       .addMethod("writeNumber", &JSONWriter::writeNumber)
+       .addMethod("writeBoolean", &JSONWriter::writeBoolean)
+       .addMethod("writeNull", &JSONWriter::writeNull)
+       .addMethod("isComplete", &JSONWriter::isComplete)
+       .addMethod("openFile", &JSONWriter::openFile)
+       .addMethod("closeFile", &JSONWriter::closeFile)
+       .addMethod("serialize", &JSONWriter::serialize)
+       .addMethod("serializeToBuffer", &JSONWriter::serializeToBuffer)
+       .addMethod("getError", &JSONWriter::getError)
+       .endClass()
+
+       .endPackage();
+
+    return 0;
+}
+
+
+void installSystemJSONStream()
+{
+    NativeInterface::registerManagedNativeType<JSONReader>(registerSystemJSONReader);
+    NativeInterface::registerManagedNativeType<JSONWriter>(registerSystemJSONWriter);
+}
@@ -56,6 +56,7 @@ void installSystemReflectionType();
 // system.xml
 void installSystemXML();
 void installSystemJSON();
+void installSystemJSONStream();
 
 // system.metrics
 void installSystemMetrics();
@@ -109,6 +110,7 @@ void installPackageSystem()
 
     // system.JSON
     installSystemJSON();
+    installSystemJSONStream();
 
     // system.metrics
     installSystemMetrics();
@@ -35,6 +35,12 @@ int registerSystemProfiler(lua_State *L)
        .addStaticMethod("reset", &LSProfiler::reset)
        .addStaticMethod("isEnabled", &LSProfiler::isEnabled)
        .addStaticMethod("dump", &LSProfiler::dump)
+       .addStaticMethod("beginTrace", &LSProfiler::beginTrace)
+       .addStaticMethod("endTrace", &LSProfiler::endTrace)
+       .addStaticLuaFunction("startSampling", &LSProfiler::startSampling)
+       .addStaticMethod("stopSampling", &LSProfiler::stopSampling)
+       .addStaticMethod("isSampling", &LSProfiler::isSampling)
+       .addStaticMethod("writeSamples", &LSProfiler::writeSamples)
 
        .endClass()
 
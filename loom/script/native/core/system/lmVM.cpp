@@ -40,6 +40,8 @@ static int registerSystemVM(lua_State *L)
        .addMethod("getStackSize", &LSLuaState::getStackSize)
 
        .addStaticMethod("isJIT", &LSLuaState::isJIT)
+       .addMethod("setJITCompiler", &LSLuaState::setJITCompiler)
+       .addMethod("getJITCompiler", &LSLuaState::getJITCompiler)
 
        .addStaticMethod("getExecutingVM", &LSLuaState::getExecutingVM)
 
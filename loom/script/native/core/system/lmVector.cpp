@@ -18,8 +18,11 @@
  * ===========================================================================
  */
 
+#include <stdint.h>
+
 #include "loom/script/loomscript.h"
 #include "loom/script/runtime/lsRuntime.h"
+#include "loom/script/reflection/lsPropertyInfo.h"
 
 using namespace LS;
 
@@ -121,6 +124,225 @@ static void lsr_create_internal_vector(lua_State *L)
     lua_setmetatable(L, -2);
 }
 
+/*
+ * Vector sorting extracts a native key per element up front, sorts the keys
+ * without touching the Lua stack (except for script compare functions), then
+ * permutes the vector once. All state is passed explicitly so sorts may nest,
+ * for instance when a compare function sorts another Vector.
+ */
+
+// numeric key, the bits of the number remapped so unsigned order matches numeric order
+struct VectorSortNumericKey
+{
+    uint64_t bits;
+    int      index;
+};
+
+// string key, textOffset >= 0 if the string was formatted from a number
+struct VectorSortStringKey
+{
+    const char *string;
+    int        textOffset;
+    int        index;
+};
+
+// cached member lookup for Vector.sortOn
+struct VectorSortFieldCache
+{
+    Type       *type;
+    MemberInfo *member;
+
+    VectorSortFieldCache() : type(NULL), member(NULL) {}
+};
+
+static inline uint64_t lsr_vector_numeric_sortbits(lua_Number number, bool descending)
+{
+    // fold negative zero onto zero so they sort as equal
+    if (number == 0)
+    {
+        number = 0;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+
+    // negative numbers have all bits flipped, positive only the sign
+    bits = (bits & 0x8000000000000000ULL) ? ~bits : (bits | 0x8000000000000000ULL);
+
+    return descending ? ~bits : bits;
+}
+
+/*
+ * Stable LSD radix sort of numeric keys, 8 bits per pass. Passes where every
+ * key shares the same byte (common for integers) are skipped.
+ */
+static void lsr_vector_radixsort(VectorSortNumericKey *keys, VectorSortNumericKey *scratch, int count)
+{
+    VectorSortNumericKey *src = keys;
+    VectorSortNumericKey *dst = scratch;
+
+    int histogram[256];
+
+    for (int shift = 0; shift < 64 && count > 1; shift += 8)
+    {
+        memset(histogram, 0, sizeof(histogram));
+
+        for (int i = 0; i < count; i++)
+        {
+            histogram[(src[i].bits >> shift) & 0xFF]++;
+        }
+
+        if (histogram[(src[0].bits >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        int offset = 0;
+        for (int i = 0; i < 256; i++)
+        {
+            int bucketCount = histogram[i];
+            histogram[i] = offset;
+            offset      += bucketCount;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            dst[histogram[(src[i].bits >> shift) & 0xFF]++] = src[i];
+        }
+
+        VectorSortNumericKey *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != keys)
+    {
+        memcpy(keys, src, count * sizeof(VectorSortNumericKey));
+    }
+}
+
+/*
+ * Stable bottom up merge sort, short runs are insertion sorted first.
+ * Compare returns < 0, 0, > 0 like strcmp.
+ */
+template<typename T, typename Compare>
+static void lsr_vector_mergesort(T *items, T *scratch, int count, Compare& compare)
+{
+    static const int runLength = 16;
+
+    for (int start = 0; start < count; start += runLength)
+    {
+        int end = utMin(start + runLength, count);
+
+        for (int i = start + 1; i < end; i++)
+        {
+            T   item = items[i];
+            int j    = i - 1;
+
+            while (j >= start && compare(item, items[j]) < 0)
+            {
+                items[j + 1] = items[j];
+                j--;
+            }
+
+            items[j + 1] = item;
+        }
+    }
+
+    T *src = items;
+    T *dst = scratch;
+
+    for (int width = runLength; width < count; width *= 2)
+    {
+        for (int left = 0; left < count; left += 2 * width)
+        {
+            int mid   = utMin(left + width, count);
+            int right = utMin(left + 2 * width, count);
+
+            int i = left, j = mid, k = left;
+
+            // only take from the right run when strictly less, this keeps us stable
+            while (i < mid && j < right)
+            {
+                dst[k++] = compare(src[j], src[i]) < 0 ? src[j++] : src[i++];
+            }
+
+            while (i < mid)
+            {
+                dst[k++] = src[i++];
+            }
+
+            while (j < right)
+            {
+                dst[k++] = src[j++];
+            }
+        }
+
+        T *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != items)
+    {
+        memcpy(items, src, count * sizeof(T));
+    }
+}
+
+class VectorSortStringCompare
+{
+    bool caseInsensitive;
+    bool descending;
+
+public:
+
+    VectorSortStringCompare(bool _caseInsensitive, bool _descending)
+        : caseInsensitive(_caseInsensitive), descending(_descending)
+    {
+    }
+
+    inline int operator()(const VectorSortStringKey& a, const VectorSortStringKey& b) const
+    {
+        int val = caseInsensitive ? strcasecmp(a.string, b.string) : strcmp(a.string, b.string);
+
+        return descending ? -val : val;
+    }
+};
+
+// calls a script compare function with the elements at the given indices
+class VectorSortFunctionCompare
+{
+    lua_State *L;
+    int       vectorIdx;
+    int       functionIdx;
+
+public:
+
+    VectorSortFunctionCompare(lua_State *_L, int _vectorIdx, int _functionIdx)
+        : L(_L), vectorIdx(_vectorIdx), functionIdx(_functionIdx)
+    {
+    }
+
+    int operator()(int idx1, int idx2)
+    {
+        lua_pushvalue(L, functionIdx);
+        lua_rawgeti(L, vectorIdx, idx1);
+        lua_rawgeti(L, vectorIdx, idx2);
+        lua_call(L, 2, 1);
+
+        if (!lua_isnumber(L, -1))
+        {
+            lua_pushstring(L, "Vector.sort compare function did not return a number");
+            lua_error(L);
+        }
+
+        lua_Number rval = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+
+        return rval < 0 ? -1 : (rval > 0 ? 1 : 0);
+    }
+};
+
 class LSVector {
     /*
      * Sort Flags, these must match the const definitions in Vector.ls
@@ -714,191 +936,272 @@ public:
         return 1;
     }
 
-    // static state variables for access in qsort
-
-    // the lua_State we're sorting in
-    static lua_State *_sortState;
-    // the vector table we're sorting
-    static int _sortVectorIdx;
-    // the length of the vector table
-    static int _sortVectorLength;
-    // current sort flags (for default sort only)
-    static int _sortFlags;
-    // whether we're aborting sort on UNIQUESORT flag
-    static bool _sortUniqueAbort;
-    // if we're using a sort Function instead of numeric/string sort
-    static bool _sortFunction;
-
-    // internal (qsort) function
-    static int internalsort(const void *pidx1, const void *pidx2)
+    static int sort(lua_State *L)
     {
-        static char sbuffer1[1024];
-        static char sbuffer2[1024];
+        int  flags       = 0;
+        bool useFunction = false;
 
-        int idx1 = *((int *)pidx1);
-        int idx2 = *((int *)pidx2);
+        if (lua_isnumber(L, 2))
+        {
+            flags = (int)lua_tonumber(L, 2);
+        }
+        else if (lua_isfunction(L, 2) || lua_iscfunction(L, 2))
+        {
+            useFunction = true;
+        }
+        else
+        {
+            lmAssert(0, "INTERNAL ERROR: unknown parameter type to Vector.sort");
+        }
 
-        lua_State *L = _sortState;
+        return sortInternal(L, flags, useFunction ? 2 : 0, NULL);
+    }
 
-        if (_sortFunction)
+    static int sortOn(lua_State *L)
+    {
+        if (!lua_isstring(L, 2))
         {
-            // we're using a sort function, so we need to
-            // setup args and call the sort function
-
-            lua_pushvalue(L, 2);
-            lua_rawgeti(L, _sortVectorIdx, idx1);
-            lua_rawgeti(L, _sortVectorIdx, idx2);
-            lua_call(L, 2, 1);
+            lua_pushstring(L, "Vector.sortOn requires a field name");
+            lua_error(L);
+        }
 
-            if (!lua_isnumber(L, -1))
-            {
-                lua_pushstring(L, "Vector.sort compare function did not return a number");
-                lua_error(L);
-            }
+        const char *fieldName = lua_tostring(L, 2);
 
-            int rval = (int)lua_tonumber(L, -1);
-            lua_pop(L, 1);
-            return rval;
+        int flags = 0;
+        if (lua_isnumber(L, 3))
+        {
+            flags = (int)lua_tonumber(L, 3);
         }
 
-        // convert to string/number generic objects are undefined and should use a script sorting function
-
-        const char *s1 = "";
-        const char *s2 = "";
+        return sortInternal(L, flags, 0, fieldName);
+    }
 
-        double d1 = 0;
-        double d2 = 0;
+private:
 
-        lua_rawgeti(L, _sortVectorIdx, idx1);
+    /*
+     * Pushes the sort key of element idx, which is either the element itself or
+     * the value of fieldName on the element when sorting an object Vector
+     */
+    static void pushSortKey(lua_State *L, int vectorIdx, int idx, const char *fieldName, VectorSortFieldCache& cache)
+    {
+        lua_rawgeti(L, vectorIdx, idx);
 
-        // please note, we MUST check string first as lua automatically converts numbers to strings :/
-        if (lua_isnumber(L, -1))
+        if (!fieldName)
         {
-            d1 = lua_tonumber(L, -1);
-            if (!(_sortFlags & NUMERIC))
-            {
-                snprintf(sbuffer1, 1024, "%f", d1);
-                s1 = sbuffer1;
-            }
+            return;
         }
-        else if (lua_isstring(L, -1))
+
+        if (!lua_istable(L, -1))
         {
-            s1 = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            lua_pushnil(L);
+            return;
         }
 
+        int instanceIdx = lua_gettop(L);
+
+        lua_rawgeti(L, instanceIdx, LSINDEXTYPE);
+        Type *type = (Type *)lua_topointer(L, -1);
         lua_pop(L, 1);
 
-        lua_rawgeti(L, _sortVectorIdx, idx2);
+        if (!type)
+        {
+            lua_pop(L, 1);
+            lua_pushnil(L);
+            return;
+        }
 
-        if (lua_isnumber(L, -1))
+        // vectors are usually homogeneous, so only resolve the member on type change
+        if (type != cache.type)
         {
-            d2 = lua_tonumber(L, -1);
-            if (!(_sortFlags & NUMERIC))
+            cache.type   = type;
+            cache.member = type->findMember(fieldName, true);
+
+            if (cache.member && cache.member->isProperty())
             {
-                snprintf(sbuffer2, 1024, "%f", d2);
-                s2 = sbuffer2;
+                cache.member = ((PropertyInfo *)cache.member)->getGetMethod();
+            }
+
+            if (!cache.member || !(cache.member->isField() || cache.member->isMethod()))
+            {
+                lua_pushfstring(L, "Vector.sortOn unable to find field or property '%s' on type %s", fieldName, type->getFullName().c_str());
+                lua_error(L);
             }
         }
-        else if (lua_isstring(L, -1))
+
+        lua_pushnumber(L, cache.member->getOrdinal());
+        lua_gettable(L, instanceIdx);
+
+        if (cache.member->isMethod())
         {
-            s2 = lua_tostring(L, -1);
+            // property getter, bound to the instance
+            lua_call(L, 0, 1);
         }
 
-        lua_pop(L, 1);
+        lua_replace(L, instanceIdx);
+    }
+
+    static int sortInternal(lua_State *L, int flags, int functionIdx, const char *fieldName)
+    {
+        int length = lsr_vector_get_length(L, 1);
 
-        bool descending = _sortFlags & DESCENDING ? true : false;
+        lua_rawgeti(L, 1, LSINDEXVECTOR);
+        int vectorIdx = lua_absindex(L, -1);
 
-        if (_sortFlags & NUMERIC)
+        // anchors sort keys which are not owned by the vector table (field values) against GC
+        int anchorIdx = 0;
+        if (fieldName && !(flags & NUMERIC))
         {
-            if (d1 < d2)
-            {
-                return descending ? 1 : -1;
-            }
+            lua_createtable(L, length, 0);
+            anchorIdx = lua_gettop(L);
+        }
+
+        utArray<int> order;
+        order.resize(length);
+
+        bool uniqueAbort = false;
+
+        if (functionIdx)
+        {
+            utArray<int> scratch;
+            scratch.resize(length);
 
-            if (d1 > d2)
+            for (int i = 0; i < length; i++)
             {
-                return descending ? -1 : 1;
+                order[i] = i;
             }
 
+            VectorSortFunctionCompare compare(L, vectorIdx, functionIdx);
+            lsr_vector_mergesort(order.ptr(), scratch.ptr(), length, compare);
+        }
+        else if (flags & NUMERIC)
+        {
+            utArray<VectorSortNumericKey> keys;
+            utArray<VectorSortNumericKey> scratch;
+            keys.resize(length);
+            scratch.resize(length);
+
+            VectorSortFieldCache cache;
 
-            if (_sortFlags & UNIQUESORT)
+            for (int i = 0; i < length; i++)
             {
-                _sortUniqueAbort = true;
+                pushSortKey(L, vectorIdx, i, fieldName, cache);
+
+                lua_Number number = lua_isnumber(L, -1) ? lua_tonumber(L, -1) : 0;
+                lua_pop(L, 1);
+
+                keys[i].bits  = lsr_vector_numeric_sortbits(number, (flags & DESCENDING) != 0);
+                keys[i].index = i;
             }
 
-            return 0;
-        }
+            lsr_vector_radixsort(keys.ptr(), scratch.ptr(), length);
 
-        int val = 0;
+            for (int i = 0; i < length; i++)
+            {
+                if ((flags & UNIQUESORT) && i && (keys[i].bits == keys[i - 1].bits))
+                {
+                    uniqueAbort = true;
+                }
 
-        if (_sortFlags & CASEINSENSITIVE)
-        {
-            val = descending ? -strcasecmp(s1, s2) : strcasecmp(s1, s2);
+                order[i] = keys[i].index;
+            }
         }
         else
         {
-            val = descending ? -strcmp(s1, s2) : strcmp(s1, s2);
-        }
+            utArray<VectorSortStringKey> keys;
+            utArray<VectorSortStringKey> scratch;
+            keys.resize(length);
+            scratch.resize(length);
 
-        if (!val && (_sortFlags & UNIQUESORT))
-        {
-            _sortUniqueAbort = true;
-        }
+            // numbers are compared by their formatted text which is stored here
+            utArray<char> text;
+            char          buffer[1024];
 
-        return val;
-    }
+            VectorSortFieldCache cache;
 
-    static int sort(lua_State *L)
-    {
-        _sortState = L;
+            for (int i = 0; i < length; i++)
+            {
+                pushSortKey(L, vectorIdx, i, fieldName, cache);
 
-        _sortVectorLength = lsr_vector_get_length(L, 1);
+                VectorSortStringKey& key = keys[i];
+                key.string     = "";
+                key.textOffset = -1;
+                key.index      = i;
 
-        lua_rawgeti(L, 1, LSINDEXVECTOR);
-        _sortVectorIdx = lua_absindex(L, -1);
+                // please note, we MUST check number first as lua automatically converts numbers to strings :/
+                if (lua_isnumber(L, -1))
+                {
+                    int written = snprintf(buffer, sizeof(buffer), "%f", lua_tonumber(L, -1));
+                    written = written < (int)sizeof(buffer) ? written + 1 : (int)sizeof(buffer);
+                    buffer[written - 1] = 0;
+
+                    if (text.size() + written > text.capacity())
+                    {
+                        text.reserve(utMax<UTsize>(text.capacity() * 2, text.size() + written));
+                    }
+
+                    key.textOffset = (int)text.size();
+                    text.resize(text.size() + written);
+                    memcpy(text.ptr() + key.textOffset, buffer, written);
+                }
+                else if (lua_isstring(L, -1))
+                {
+                    // the string is interned and owned by the vector (or anchor) table
+                    key.string = lua_tostring(L, -1);
+                }
 
-        _sortFlags    = 0;
-        _sortFunction = false;
-        if (lua_isnumber(L, 2))
-        {
-            _sortFlags = (int)lua_tonumber(L, 2);
-        }
-        else if (lua_isfunction(L, 2) || lua_iscfunction(L, 2))
-        {
-            _sortFunction = true;
-        }
-        else
-        {
-            lmAssert(0, "INTERNAL ERROR: unknown parameter type to Vector.sort");
-        }
+                if (anchorIdx)
+                {
+                    lua_rawseti(L, anchorIdx, i);
+                }
+                else
+                {
+                    lua_pop(L, 1);
+                }
+            }
 
-        _sortUniqueAbort = false;
+            for (int i = 0; i < length; i++)
+            {
+                if (keys[i].textOffset >= 0)
+                {
+                    keys[i].string = text.ptr() + keys[i].textOffset;
+                }
+            }
 
-        int *indices = new int[_sortVectorLength];
+            VectorSortStringCompare compare((flags & CASEINSENSITIVE) != 0, (flags & DESCENDING) != 0);
+            lsr_vector_mergesort(keys.ptr(), scratch.ptr(), length, compare);
 
-        for (int i = 0; i < _sortVectorLength; i++)
-        {
-            indices[i] = i;
+            for (int i = 0; i < length; i++)
+            {
+                if ((flags & UNIQUESORT) && i && !compare(keys[i - 1], keys[i]))
+                {
+                    uniqueAbort = true;
+                }
+
+                order[i] = keys[i].index;
+            }
         }
 
-        qsort(indices, _sortVectorLength, sizeof(int), internalsort);
+        if (anchorIdx)
+        {
+            lua_remove(L, anchorIdx);
+        }
 
-        if (_sortUniqueAbort)
+        if (uniqueAbort)
         {
             lua_pushnumber(L, 0);
-            delete [] indices;
             return 1;
         }
 
         // create new table to hold the result
         lsr_create_internal_vector(L);
 
-        if (_sortFlags & RETURNINDEXEDARRAY)
+        if (flags & RETURNINDEXEDARRAY)
         {
             // populate index vector
-            for (int i = 0; i < _sortVectorLength; i++)
+            for (int i = 0; i < length; i++)
             {
-                lua_pushnumber(L, indices[i]);
+                lua_pushnumber(L, order[i]);
                 lua_rawseti(L, -2, i);
             }
 
@@ -908,37 +1211,28 @@ public:
             lua_pushvalue(L, -2); // return the new vector table
             lua_rawseti(L, -2, LSINDEXVECTOR);
 
-            lsr_vector_set_length(L, -1, _sortVectorLength);
+            lsr_vector_set_length(L, -1, length);
 
-            delete [] indices;
             return 1;
         }
 
-        // populate replacement vector
-        for (int i = 0; i < _sortVectorLength; i++)
+        // populate replacement vector, this is the only pass which moves elements
+        for (int i = 0; i < length; i++)
         {
-            lua_rawgeti(L, _sortVectorIdx, indices[i]);
+            lua_rawgeti(L, vectorIdx, order[i]);
             lua_rawseti(L, -2, i);
         }
 
         // replace vector table
         lua_rawseti(L, 1, LSINDEXVECTOR);
-        lsr_vector_set_length(L, 1, _sortVectorLength);
+        lsr_vector_set_length(L, 1, length);
 
         lua_pushvalue(L, 1); // return the existing vector table
-        delete [] indices;
 
         return 1;
     }
 };
 
-lua_State *LSVector::_sortState       = NULL;
-int       LSVector::_sortVectorIdx    = -1;
-int       LSVector::_sortVectorLength = -2;
-int       LSVector::_sortFlags        = 0;
-bool      LSVector::_sortUniqueAbort  = false;
-bool      LSVector::_sortFunction     = false;
-
 namespace LS {
 
 int lsr_vector_get_length(lua_State *L, int index)
@@ -1016,6 +1310,7 @@ static int registerSystemVector(lua_State *L)
        .addStaticLuaFunction("slice", &LSVector::slice)
        .addStaticLuaFunction("indexOf", &LSVector::indexOf)
        .addStaticLuaFunction("sort", &LSVector::sort)
+       .addStaticLuaFunction("sortOn", &LSVector::sortOn)
 
        .endClass()
 
@@ -20,6 +20,7 @@
 
 #include "loom/common/platform/platformThread.h"
 #include "loom/common/core/log.h"
+#include "loom/common/core/allocatorFrame.h"
 #include "loom/script/native/lsLuaBridge.h"
 #include "loom/script/runtime/lsRuntime.h"
 #include "loom/script/runtime/lsProfiler.h"
@@ -202,11 +203,11 @@ struct NativeDelegateCallNote
         return v;
     }
 
-    // Don't forget to lmFree()
-    char *readString()
+    // Don't forget to lmFree() with the same allocator
+    char *readString(loom_allocator_t *allocator)
     {
         unsigned int strLen = readInt();
-        char *str = (char*)lmAlloc(NULL, strLen + 1);
+        char *str = (char*)lmAlloc(allocator, strLen + 1);
         readBytes(str, strLen);
         str[strLen] = 0;
         return str;
@@ -328,9 +329,10 @@ void NativeDelegate::executeDeferredCalls(lua_State *L)
                 break;
 
                 case MSG_PushString:
-                    str = ndcn->readString();
+                    // Copied onto the Lua stack, so frame scratch is enough.
+                    str = ndcn->readString(loom_frameAllocator_getGlobal());
                     theDelegate->pushArgument(str);
-                    lmFree(NULL, str);
+                    lmFree(loom_frameAllocator_getGlobal(), str);
                     break;
 
                 case MSG_PushByteArray:
@@ -369,6 +371,10 @@ void NativeDelegate::executeDeferredCalls(lua_State *L)
     }
 
     // Purge queue.
+    for(unsigned int i=0; i<gNDCallNoteQueue.size(); i++)
+    {
+        lmDelete(NULL, gNDCallNoteQueue[i]);
+    }
     gNDCallNoteQueue.clear();
 
     loom_mutex_unlock(gCallNoteMutex);
@@ -180,11 +180,9 @@ void ByteCode::serialize(utByteArray *bytes)
     bytes->writeUnsignedByte(LOOM_CLASSIC_BYTECODE_MAGIC);
     bytes->writeUnsignedByte(LOOM_CLASSIC_BYTECODE_VERSION);
 
-    utArray<unsigned char> data = base64.getData();
+    const utArray<unsigned char>& data = base64.getData();
     bytes->writeUnsignedInt(data.size());
-    utByteArray wrapper;
-    wrapper.attach(data.ptr(), data.size());
-    if (data.size() > 0) bytes->writeBytes(&wrapper);
+    bytes->writeRaw(data.ptr(), data.size());
 }
 
 void ByteCode::deserialize(utByteArray *bytes)
@@ -194,13 +194,11 @@ void lualoom_newscriptinstance_internal(lua_State *L, Type *type)
 {
     lmAssert(type, "Internal Error: lsr_newscriptinstance_internal got a NULL type");
 
-    // Allocate a hash big enough for properties,
-    // any method access grows this, so memory usage is taken
-    // lazily instead of aggresively. This shouldn't be needed
-    // down the line as we shouldn't need to allocate method per instance.
-    //
-    // i.e. Member table allocation, properties included!
-    //          * methods sold separately
+    // Allocate a hash big enough for properties, direct calls of script
+    // methods dispatch through the class table so don't grow this.
+    // Property accessors, native methods and methods referenced as
+    // values (delegates, callbacks) are still bound and cached to the
+    // instance on first access.
     lua_createtable(L, 0, type->getPropertyInfoCount());
 
     int instanceIdx = lua_gettop(L);
@@ -475,6 +473,24 @@ static int lsr_classindex(lua_State *L)
     {
         int ordinal = (int)lua_tonumber(L, 2);
 
+        // direct calls of script methods, wrap the method once per class, see lsr_sharedmethod
+        if (lualoom_issharedmethodkey(ordinal))
+        {
+            MemberInfo *mi = type->getMemberInfoByOrdinal(-ordinal);
+
+            lmAssert(mi && mi->isMethod(), "Out of range shared method ordinal %i on type %s", -ordinal, type->getFullName().c_str());
+
+            lua_pushlightuserdata(L, mi);
+            lua_pushnumber(L, -ordinal);
+            lua_gettable(L, 1);
+            assert(lua_isfunction(L, -1));
+            lua_pushcclosure(L, lsr_sharedmethod, 2);
+
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, 1, ordinal);
+            return 1;
+        }
+
         // a loom indexer should be in the table (not missing so it his the index metamethod)
         lmAssert(!lualoom_isindexer(ordinal), "Internal Error: class table being indexed by a LSINDEX value.");
 
@@ -857,6 +873,14 @@ static void lsr_classinitializemethod(lua_State *L, MethodBase *methodBase, int
     {
         int functionIdx = lua_gettop(L);
 
+#ifdef LUAJIT_MODE_MASK
+        // keep excluded methods and their closures off the trace compiler
+        if (LSLuaState::isJITExcluded(methodBase))
+        {
+            luaJIT_setmode(L, functionIdx, LUAJIT_MODE_ALLFUNC | LUAJIT_MODE_OFF);
+        }
+#endif
+
         // create the function environment
         lua_newtable(L);
 
@@ -50,9 +50,28 @@ static int lsr_method_fastcall_get(lua_State *L)
 }
 
 
+/*
+ * Reports an error returned by the pcall of a method
+ */
+static void lsr_methoderror(lua_State *L, MethodBase *method, int error)
+{
+    const char *errorName;
+
+    switch (error) {
+        case LUA_ERRRUN: errorName = "Runtime"; break;
+        case LUA_ERRMEM: errorName = "Memory allocation"; break;
+        case LUA_ERRERR: errorName = "Error handler"; break;
+        default:         errorName = "Unknown";
+    }
+
+    LSLuaState::getLuaState(L)->triggerRuntimeError("%s error calling %s:%s", errorName, method->getDeclaringType()->getFullName().c_str(), method->getName());
+}
+
+
 /*
  * Static methods use the lsr_method closure which is generated at class initialization time
  * Instance methods are bound to a generated lsr_method closure the first time the method is referenced (at runtime)
+ * (direct calls of script methods use lsr_sharedmethod instead)
  * lsr_method is a thin wrapper which handles catching native calls for profiling, default arguments, etc
  */
 int lsr_method(lua_State *L)
@@ -123,8 +142,6 @@ int lsr_method(lua_State *L)
         }
     }
 
-    LSLuaState *ls = LSLuaState::getLuaState(L);
-
     // error handling
     lua_getglobal(L, "__ls_traceback");
     lua_insert(L, 1);
@@ -133,14 +150,7 @@ int lsr_method(lua_State *L)
 
     if (error)
     {
-        const char *errorName;
-        switch (error) {
-            case LUA_ERRRUN: errorName = "Runtime"; break;
-            case LUA_ERRMEM: errorName = "Memory allocation"; break;
-            case LUA_ERRERR: errorName = "Error handler"; break;
-            default:         errorName = "Unknown";
-        }
-        ls->triggerRuntimeError("%s error calling %s:%s", errorName, method->getDeclaringType()->getFullName().c_str(), method->getName());
+        lsr_methoderror(L, method, error);
     }
 
     // get rid of the traceback
@@ -160,6 +170,39 @@ int lsr_method(lua_State *L)
 }
 
 
+/*
+ * Direct calls to instance script methods with all arguments supplied are compiled to
+ * instance[LSINDEXCLASS][lualoom_sharedmethodkey(ordinal)](instance, ...)
+ * The class table caches one of these closures per method, instead of every instance binding
+ * its own lsr_method closure, "this" is passed as the first argument
+ */
+int lsr_sharedmethod(lua_State *L)
+{
+    int nargs = lua_gettop(L);
+
+    MethodBase *method = (MethodBase *)lua_topointer(L, lua_upvalueindex(1));
+
+    // error handling
+    lua_getglobal(L, "__ls_traceback");
+    lua_insert(L, 1);
+
+    lua_pushvalue(L, lua_upvalueindex(2));
+    lua_insert(L, 2); // method
+
+    int error = lua_pcall(L, nargs, LUA_MULTRET, 1);
+
+    if (error)
+    {
+        lsr_methoderror(L, method, error);
+    }
+
+    // get rid of the traceback
+    lua_remove(L, 1);
+
+    return lua_gettop(L);
+}
+
+
 void *lsr_getmethodcfunctionaddress()
 {
     return (void *)lsr_method;
@@ -21,8 +21,10 @@
 #include "zlib.h"
 
 #include "loom/common/core/allocator.h"
+#include "loom/common/core/allocatorSlab.h"
 #include "loom/common/core/assert.h"
 #include "loom/common/core/log.h"
+#include "loom/common/core/telemetry.h"
 #include "loom/common/utils/utByteArray.h"
 #include "loom/common/utils/utString.h"
 #include "loom/common/platform/platformIO.h"
@@ -56,6 +58,8 @@ lua_State         *LSLuaState::lastState     = NULL;
 LSLuaState        *LSLuaState::lastLSState   = NULL;
 double            LSLuaState::constructorKey = 0;
 utArray<utString> LSLuaState::buildCache;
+bool              LSLuaState::jitCompilerDefault = false;
+utArray<utString> LSLuaState::jitExclusions;
 
 lmDefineLogGroup(gLuaStateLogGroup, "luastate", true, LoomLogInfo);
 
@@ -74,23 +78,26 @@ size_t LSLuaState::allocatedBytes = 0;
 
 static void *lsLuaAlloc(void *ud, void *ptr, size_t osize, size_t nsize)
 {
-    (void)ud;  /* not used */
+    loom_slabAllocator_t *allocator = (loom_slabAllocator_t *)ud;
+
+    // Lua passes the old block size, which the slab allocator relies on
+    // and which is meaningless when ptr is NULL
+    if (ptr == NULL)
+    {
+        osize = 0;
+    }
 
     LSLuaState::allocatedBytes += nsize - osize;
 
     void *ret;
     if (nsize == 0)
     {
-        lmFree(NULL, ptr);
+        loom_slabAllocator_free(allocator, ptr, osize);
         return NULL;
     }
-    else if (ptr == NULL)
-    {
-        ret = lmAlloc(NULL, nsize);
-    }
     else
     {
-        ret = lmRealloc(NULL, ptr, nsize);
+        ret = loom_slabAllocator_realloc(allocator, ptr, osize, nsize);
     }
 
     // Garbage collection here would be nice,
@@ -104,18 +111,25 @@ void LSLuaState::open()
 {
     assert(!L);
 
-    #if LOOM_PLATFORM_64BIT
+    // 64 bit LuaJIT needs its own allocator to keep GC objects in low memory
+    #if defined(LOOM_ENABLE_JIT) && LOOM_PLATFORM_64BIT
     L = luaL_newstate();
     #else
-    L = lua_newstate(lsLuaAlloc, this);
+    allocator = loom_slabAllocator_create(NULL);
+    L = lua_newstate(lsLuaAlloc, allocator);
     #endif
 
     toLuaState.insert(L, this);
 
 #ifdef LUAJIT_MODE_MASK
-    // TODO: turn this back on when it doesn't fail on the testWhile unit test
-    // update luajit and test again
+    // The trace compiler is opt in, see setJITCompilerDefault
+    jitCompiler = false;
     luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+
+    if (jitCompilerDefault)
+    {
+        setJITCompiler(true);
+    }
 #endif
 
     // Stop the GC initially
@@ -178,6 +192,81 @@ void LSLuaState::open()
 }
 
 
+bool LSLuaState::setJITCompiler(bool enabled)
+{
+#ifdef LUAJIT_MODE_MASK
+    lmAssert(L, "LSLuaState::setJITCompiler called on a closed state");
+
+    if (enabled)
+    {
+        // fails on platforms without a usable JIT backend
+        if (!luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_ON))
+        {
+            lmLogWarn(gLuaStateLogGroup, "JIT compiler unavailable on this platform, running interpreted");
+            jitCompiler = false;
+            return false;
+        }
+    }
+    else
+    {
+        // drop existing traces so no compiled code keeps running
+        luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_FLUSH);
+        luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+    }
+
+    jitCompiler = enabled;
+    return true;
+#else
+    return !enabled;
+#endif
+}
+
+
+void LSLuaState::addJITExclusion(const utString& name)
+{
+    jitExclusions.push_back(name);
+}
+
+
+bool LSLuaState::isJITExcluded(MethodBase *method)
+{
+    Type *type = method->getDeclaringType();
+
+    if (method->getMetaInfo("NoJIT") || (type && type->getMetaInfo("NoJIT")))
+    {
+        return true;
+    }
+
+    if (!type || !jitExclusions.size())
+    {
+        return false;
+    }
+
+    const utString& typeName = type->getFullName();
+    utString methodName = typeName + "." + method->getName();
+
+    for (UTsize i = 0; i < jitExclusions.size(); i++)
+    {
+        const utString& exclusion = jitExclusions[i];
+
+        if ((exclusion == typeName) || (exclusion == methodName))
+        {
+            return true;
+        }
+
+        // package prefix
+        if ((typeName.length() > exclusion.length()) &&
+            !strncmp(typeName.c_str(), exclusion.c_str(), exclusion.length()) &&
+            (typeName.c_str()[exclusion.length()] == '.'))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
 void LSLuaState::close()
 {
     assert(L);
@@ -203,6 +292,65 @@ void LSLuaState::close()
     toLuaState.remove(L);
 
     L = NULL;
+
+    if (allocator)
+    {
+        loom_slabAllocator_destroy(allocator);
+        allocator = NULL;
+    }
+}
+
+
+void LSLuaState::trimAllocator()
+{
+    if (allocator)
+    {
+        loom_slabAllocator_trim(allocator);
+    }
+}
+
+
+void LSLuaState::reportAllocatorTelemetry()
+{
+    static TickMetricID slabBytesID     = Telemetry::registerTickValue("vm.alloc.slab.bytes");
+    static TickMetricID liveBytesID     = Telemetry::registerTickValue("vm.alloc.live.bytes");
+    static TickMetricID largeBytesID    = Telemetry::registerTickValue("vm.alloc.large.bytes");
+    static TickMetricID releasedSlabsID = Telemetry::registerTickValue("vm.alloc.slabs.released");
+    static TickMetricID classLiveIDs[LOOM_SLAB_CLASS_COUNT];
+    static TickMetricID classSlabsIDs[LOOM_SLAB_CLASS_COUNT];
+    static bool         classIDsRegistered = false;
+
+    if (!allocator || !Telemetry::isEnabled())
+    {
+        return;
+    }
+
+    loom_slabAllocatorStats_t stats;
+    loom_slabAllocator_getStats(allocator, &stats);
+
+    if (!classIDsRegistered)
+    {
+        char name[64];
+        for (int i = 0; i < LOOM_SLAB_CLASS_COUNT; i++)
+        {
+            sprintf(name, "vm.alloc.class.%d.live", (int)stats.classes[i].itemSize);
+            classLiveIDs[i] = Telemetry::registerTickValue(name);
+            sprintf(name, "vm.alloc.class.%d.slabs", (int)stats.classes[i].itemSize);
+            classSlabsIDs[i] = Telemetry::registerTickValue(name);
+        }
+        classIDsRegistered = true;
+    }
+
+    Telemetry::setTickValue(slabBytesID, (double)stats.slabBytes);
+    Telemetry::setTickValue(liveBytesID, (double)stats.liveBytes);
+    Telemetry::setTickValue(largeBytesID, (double)stats.largeBytes);
+    Telemetry::setTickValue(releasedSlabsID, (double)stats.releasedSlabs);
+
+    for (int i = 0; i < LOOM_SLAB_CLASS_COUNT; i++)
+    {
+        Telemetry::setTickValue(classLiveIDs[i], (double)stats.classes[i].liveCount);
+        Telemetry::setTickValue(classSlabsIDs[i], (double)stats.classes[i].slabCount);
+    }
 }
 
 
@@ -607,7 +755,8 @@ utByteArray *LSLuaState::openExecutableAssemblyBinary(const char *buffer, long b
 
     utByteArray headerBytes;
 
-    headerBytes.allocateAndCopy((void *)buffer, sizeof(unsigned int) * 4);
+    // read the header in place, there is no need to copy it
+    headerBytes.attach(buffer, sizeof(unsigned int) * 4);
 
     // we need to decompress
     lmCheck(headerBytes.readUnsignedInt() == LOOM_BINARY_ID, "binary id mismatch");
@@ -22,6 +22,7 @@
 #define _lsluastate_h
 
 #include "loom/common/core/assert.h"
+#include "loom/common/core/allocatorSlab.h"
 #include "loom/script/reflection/lsAssembly.h"
 #include "loom/script/native/lsNativeDelegate.h"
 #include "loom/script/runtime/lsRuntime.h"
@@ -52,8 +53,20 @@ class LSLuaState {
 
     bool hasMissingTypes;
 
+    // whether the LuaJIT trace compiler is running for this state
+    bool jitCompiler;
+
+    // whether newly opened states start with the trace compiler on
+    static bool jitCompilerDefault;
+
+    // packages, types and Type.method names kept off the trace compiler
+    static utArray<utString> jitExclusions;
+
     lua_State *L;
 
+    // small object allocator backing L, NULL when Lua uses its own
+    loom_slabAllocator_t *allocator;
+
     // loaded assemblies
     utHashTable<utHashedString, Assembly *> assemblies;
     utHashTable<utHashedString, Type *>     typeCache;
@@ -106,7 +119,7 @@ public:
     static size_t allocatedBytes;
 
     LSLuaState() :
-        compiling(false), loadingAssembly(0), L(NULL)
+        compiling(false), loadingAssembly(0), jitCompiler(false), L(NULL), allocator(NULL)
     {
 
 #ifdef LOOM_DEBUG
@@ -158,6 +171,12 @@ public:
     void open();
     void close();
 
+    // Returns slabs emptied by garbage collection to the OS
+    void trimAllocator();
+
+    // Publishes per size class allocator stats as telemetry tick values
+    void reportAllocatorTelemetry();
+
     void setCompiling(bool value)
     {
         compiling = value;
@@ -320,6 +339,33 @@ public:
 #endif
     }
 
+    /*
+     * LuaJIT builds run interpreted unless the trace compiler is enabled,
+     * either for every state opened afterwards or per state at runtime.
+     * setJITCompiler returns whether the requested mode is now active.
+     */
+    static void setJITCompilerDefault(bool enabled)
+    {
+        jitCompilerDefault = enabled;
+    }
+
+    bool setJITCompiler(bool enabled);
+
+    bool getJITCompiler()
+    {
+        return jitCompiler;
+    }
+
+    /*
+     * Excludes a package ("loom2d.display"), type ("loom2d.display.Sprite")
+     * or method ("loom2d.display.Sprite.render") from trace compilation.
+     * Applies to methods initialized afterwards, as does [NoJIT] metadata
+     * on a class or method.
+     */
+    static void addJITExclusion(const utString& name);
+
+    static bool isJITExcluded(MethodBase *method);
+
     LOOM_DELEGATE(OnReload);
 };
 }
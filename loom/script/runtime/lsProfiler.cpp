@@ -23,6 +23,7 @@
 #include "loom/common/core/log.h"
 #include "loom/script/loomscript.h"
 #include "loom/script/runtime/lsProfiler.h"
+#include <stdio.h>
 #include <string.h>
 #include "SDL.h"
 
@@ -35,6 +36,16 @@ utStack<MethodBase *> LSProfiler::methodStack;
 utHashTable<utPointerHashKey, LSProfilerTypeAllocation *> LSProfiler::allocations;
 utHashTable<utPointerHashKey, MethodAllocation> *LSProfiler::sortMethods = NULL;
 
+lua_State *LSProfiler::samplingState = NULL;
+loom_precision_timer_t LSProfiler::sampleTimer = NULL;
+long long LSProfiler::sampleIntervalNs = 0;
+long long LSProfiler::sampleLastNs = 0;
+LSProfilerSample *LSProfiler::samples = NULL;
+int LSProfiler::numSamples = 0;
+MethodBase **LSProfiler::sampleFrames = NULL;
+int LSProfiler::numSampleFrames = 0;
+int LSProfiler::droppedSamples = 0;
+
 lmDefineLogGroup(gProfilerLogGroup, "profiler", 1, LoomLogInfo);
 
 static const char* primingPath = ".......";
@@ -223,6 +234,9 @@ void LSProfiler::enable(lua_State *L)
         return;
     }
 
+    // Both modes own the debug hook.
+    disableSampling(L);
+
     enabled = true;
 
     updateState(L);
@@ -380,6 +394,216 @@ void LSProfiler::reset(lua_State *L)
     clearAllocations();
 }
 
+void LSProfiler::enableSampling(lua_State *L, int intervalMicroseconds)
+{
+#ifdef LOOM_ENABLE_JIT
+    lua_State *mainL = mainthread(G(L));
+#else
+    lua_State *mainL = L->l_G->mainthread;
+#endif
+
+    if (lua_gethook(mainL) != NULL && lua_gethook(mainL) != sampleHook && lua_gethook(mainL) != profileHook)
+    {
+        lmLogError(gProfilerLogGroup, "Unable to start sampling, another debug hook is installed");
+        return;
+    }
+
+    disable(L);
+
+    if (!samples)
+    {
+        samples      = (LSProfilerSample *)lmAlloc(NULL, sizeof(LSProfilerSample) * MaxSamples);
+        sampleFrames = (MethodBase **)lmAlloc(NULL, sizeof(MethodBase *) * MaxSampleFrames);
+        sampleTimer  = loom_startTimer();
+    }
+
+    numSamples       = 0;
+    numSampleFrames  = 0;
+    droppedSamples   = 0;
+    sampleIntervalNs = (long long)(intervalMicroseconds > 0 ? intervalMicroseconds : 1000) * 1000;
+    sampleLastNs     = loom_readTimerNano(sampleTimer);
+    samplingState    = mainL;
+
+    lua_sethook(mainL, sampleHook, LUA_MASKCOUNT, SampleInstructionCount);
+}
+
+
+void LSProfiler::disableSampling(lua_State *L)
+{
+    if (!samplingState)
+    {
+        return;
+    }
+
+    lua_sethook(samplingState, sampleHook, 0, 0);
+    samplingState = NULL;
+
+    if (droppedSamples > 0)
+    {
+        lmLogWarn(gProfilerLogGroup, "Sample buffer was full, dropped %d samples", droppedSamples);
+    }
+}
+
+
+void LSProfiler::sampleHook(lua_State *L, lua_Debug *ar)
+{
+    // Only sample the main thread, like profileHook.
+    if (ar->event != LUA_HOOKCOUNT || L != samplingState)
+    {
+        return;
+    }
+
+    long long now     = loom_readTimerNano(sampleTimer);
+    long long elapsed = now - sampleLastNs;
+
+    if (elapsed < sampleIntervalNs)
+    {
+        return;
+    }
+
+    sampleLastNs = now;
+
+    if (numSamples == MaxSamples || numSampleFrames + MaxSampleDepth > MaxSampleFrames)
+    {
+        droppedSamples++;
+        return;
+    }
+
+    LSProfilerSample *sample = &samples[numSamples];
+    sample->firstFrame = numSampleFrames;
+
+    // A long native call or a stall shows up as one late sample, weight it
+    // by the intervals it covers so counts stay proportional to time.
+    sample->weight = (int)(elapsed / sampleIntervalNs);
+
+    int top = lua_gettop(L);
+    lua_rawgeti(L, LUA_GLOBALSINDEX, LSINDEXMETHODLOOKUP);
+    int lookup = lua_gettop(L);
+
+    lua_Debug  frame;
+    MethodBase *lastMethod = NULL;
+    for (int level = 0; level < MaxSampleDepth && lua_getstack(L, level, &frame); level++)
+    {
+        if (!lua_getinfo(L, "f", &frame))
+        {
+            break;
+        }
+
+        bool cfunc = lua_iscfunction(L, -1) != 0;
+
+        lua_rawget(L, lookup);
+        MethodBase *methodBase = lua_isnil(L, -1) ? NULL : (MethodBase *)lua_topointer(L, -1);
+        lua_pop(L, 1);
+
+        // Skip unmapped builtins and the native wrapper around the
+        // method we just recorded.
+        if (cfunc && (!methodBase || methodBase == lastMethod))
+        {
+            continue;
+        }
+
+        lastMethod = methodBase;
+        sampleFrames[numSampleFrames++] = methodBase;
+    }
+
+    lua_settop(L, top);
+
+    sample->depth = numSampleFrames - sample->firstFrame;
+
+    if (sample->depth > 0)
+    {
+        numSamples++;
+    }
+}
+
+
+bool LSProfiler::writeSamples(const char *path)
+{
+    utHashTable<utHashedString, int> folded;
+    utString stack;
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        const LSProfilerSample& sample = samples[i];
+
+        stack = "";
+        for (int j = sample.depth - 1; j >= 0; j--)
+        {
+            MethodBase *methodBase = sampleFrames[sample.firstFrame + j];
+
+            if (j != sample.depth - 1)
+            {
+                stack += ";";
+            }
+            stack += methodBase ? methodBase->getFullMemberName() : "(anonymous)";
+        }
+
+        utHashedString key(stack);
+        int *count = folded.get(key);
+        if (count)
+        {
+            *count += sample.weight;
+        }
+        else
+        {
+            folded.insert(key, sample.weight);
+        }
+    }
+
+    FILE *file = fopen(path, "wb");
+
+    if (!file)
+    {
+        lmLogError(gProfilerLogGroup, "Unable to write samples to %s", path);
+        return false;
+    }
+
+    for (UTsize i = 0; i < folded.size(); i++)
+    {
+        fprintf(file, "%s %d\n", folded.keyAt(i).str().c_str(), folded.at(i));
+    }
+
+    bool written = ferror(file) == 0;
+    fclose(file);
+
+    lmLogInfo(gProfilerLogGroup, "Wrote %d samples (%d unique stacks) to %s", numSamples, (int)folded.size(), path);
+
+    return written;
+}
+
+
+int LSProfiler::startSampling(lua_State *L)
+{
+    enableSampling(L, (int)lua_tonumber(L, 1));
+    return 0;
+}
+
+
+void LSProfiler::stopSampling(lua_State *L)
+{
+    disableSampling(L);
+}
+
+
+void LSProfiler::beginTrace(int maxEvents)
+{
+    if (gLoomProfiler)
+    {
+        gLoomProfiler->beginTrace(maxEvents);
+    }
+}
+
+
+bool LSProfiler::endTrace(const char *path)
+{
+    if (!gLoomProfiler)
+    {
+        return false;
+    }
+
+    return gLoomProfiler->endTrace(path);
+}
+
 void LSProfiler::dumpAllocations(lua_State *L)
 {
     lua_gc(L, LUA_GCCOLLECT, 0);
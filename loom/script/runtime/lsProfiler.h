@@ -54,6 +54,15 @@ typedef struct MethodAllocation {
     utArray<LSProfilerTypeAllocation*> allocations;
 } MethodAllocation;
 
+// One captured script stack; its frames are stored innermost first in
+// LSProfiler::sampleFrames starting at firstFrame.
+struct LSProfilerSample
+{
+    int firstFrame;
+    int depth;
+    int weight;
+};
+
 class LSProfiler
 {
 private:
@@ -62,6 +71,27 @@ private:
 
     static void profileHook(lua_State *L, lua_Debug *ar);
 
+    // Sampling mode, see enableSampling.
+    enum
+    {
+        SampleInstructionCount = 1000,
+        MaxSamples             = 65536,
+        MaxSampleFrames        = 262144,
+        MaxSampleDepth         = 256,
+    };
+
+    static void sampleHook(lua_State *L, lua_Debug *ar);
+
+    static lua_State *samplingState;
+    static loom_precision_timer_t sampleTimer;
+    static long long sampleIntervalNs;
+    static long long sampleLastNs;
+    static LSProfilerSample *samples;
+    static int numSamples;
+    static MethodBase **sampleFrames;
+    static int numSampleFrames;
+    static int droppedSamples;
+
     static bool enabled;
     static utStack<MethodBase *> methodStack;
     // Type -> allocations
@@ -219,6 +249,36 @@ public:
     static void dump(lua_State *L);
 
     static void reset(lua_State *L);
+
+    /*
+     * Sampling profiler. Rather than hooking every call and return, a count
+     * hook checks the clock every thousand VM instructions and captures
+     * the script call stack once per interval into a fixed buffer. Method
+     * names are only resolved when the samples are written out. Under JIT,
+     * compiled traces do not run hooks so only interpreted code is sampled.
+     */
+    static void enableSampling(lua_State *L, int intervalMicroseconds);
+    static void disableSampling(lua_State *L);
+
+    inline static bool isSampling()
+    {
+        return samplingState != NULL;
+    }
+
+    /*
+     * Writes the captured samples as folded stacks, one
+     * "outer;inner;leaf count" line per unique stack, for flamegraph.pl
+     * and compatible viewers. Returns false if the file can't be written.
+     */
+    static bool writeSamples(const char *path);
+
+    // Script bindings for system.Profiler.
+    static int startSampling(lua_State *L);
+    static void stopSampling(lua_State *L);
+
+    static void beginTrace(int maxEvents);
+
+    static bool endTrace(const char *path);
 };
 }
 #endif
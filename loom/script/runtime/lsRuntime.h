@@ -45,6 +45,10 @@ namespace LS {
 
 #define lualoom_isindexer(v)    (v >= LSINDEXNATIVE && v <= LSINDEXMAX)
 
+// Class tables hold the shared method wrapper (see lsr_sharedmethod) for a method ordinal at this key
+#define lualoom_sharedmethodkey(ordinal)    (-(ordinal))
+#define lualoom_issharedmethodkey(v)        (v < 0 && v > LSINDEXNATIVE)
+
 // A native class instance will have a valid native userdata at this index.
 // the native userdata is used to interface with the raw C++ properties, methods, etc
 #define LSINDEXNATIVE                 -1000000
@@ -136,6 +140,7 @@ Type *lsr_gettype(lua_State *L, int index);
 const char *lsr_objecttostring(lua_State *L, int index);
 
 int lsr_method(lua_State *L);
+int lsr_sharedmethod(lua_State *L);
 void *lsr_getmethodcfunctionaddress();
 
 inline void lsr_getclasstable(lua_State *L, Type *type)
@@ -30,7 +30,7 @@ const char            *BinReader::stringBuffer = NULL;
 LSLuaState            *BinReader::vm           = NULL;
 
 utHashTable<utHashedString, BinReader::Reference *> BinReader::references;
-utHashTable<utHashedString, BinReader::TypeIndex *> BinReader::types;
+utFlatStringMap<BinReader::TypeIndex *> BinReader::types;
 
 void BinReader::readStringPool()
 {
@@ -54,11 +54,8 @@ void BinReader::readStringPool()
 
         const char *pstring = p;
 
-        while (length--)
-        {
-            *p = sBytes->readByte();
-            p++;
-        }
+        sBytes->readRaw(p, (UTsize)length);
+        p += length;
 
         *p = 0;
         p++;
@@ -622,7 +619,7 @@ Type *BinReader::readType()
     fullname += ".";
     fullname += name;
 
-    TypeIndex *tindex = *(types.get(utHashedString(fullname)));
+    TypeIndex *tindex = *(types.get(fullname.c_str()));
 
     Type *type = tindex->type;
 
@@ -837,7 +834,7 @@ void BinReader::loadExecutableHeader(LSLuaState *_vm, utByteArray *byteArray)
         // within the ref
         tindex->position = sBytes->readInt();
         tindex->length = sBytes->readInt();
-        types.insert(utHashedString(tindex->fullName), tindex);
+        types.insert(tindex->fullName, tindex);
     }
 
     // load up reference assemblies
@@ -877,7 +874,7 @@ void BinReader::loadExecutableHeader(LSLuaState *_vm, utByteArray *byteArray)
             TypeIndex *tindex = types.at(j);
             if (a != NULL && tindex->refIdx == (int)i)
             {
-                types.remove(utHashedString(tindex->fullName));
+                types.remove(tindex->fullName);
             }
             else
             {
@@ -24,6 +24,7 @@
 #include "jansson.h"
 
 #include "loom/common/utils/utByteArray.h"
+#include "loom/common/utils/utFlatStringMap.h"
 #include "loom/script/runtime/lsLuaState.h"
 #include "loom/script/reflection/lsAssembly.h"
 #include "loom/script/serialize/lsBinWriter.h"
@@ -71,7 +72,7 @@ class BinReader {
     };
 
     // Full qualified typename -> TypeIndex
-    static utHashTable<utHashedString, TypeIndex *> types;
+    static utFlatStringMap<TypeIndex *> types;
     // Reference name -> Reference
     static utHashTable<utHashedString, Reference *> references;
     // The VM we are loading the assemblty into
@@ -107,13 +108,12 @@ class BinReader {
     {
         if (fullname && strlen(fullname))
         {
-            if (types.find(fullname) == UT_NPOS)
+            TypeIndex **tindex = types.get(fullname);
+            if (tindex == NULL)
             {
                 return vm->getType(fullname);
             }
 
-            TypeIndex **tindex = types.get(fullname);
-            assert(tindex);
             return (*tindex)->type;
         }
 
@@ -125,7 +125,7 @@ class BinReader {
      */
     static void seekType(const char *fullname)
     {
-        TypeIndex *tindex = *(types.get(utHashedString(fullname)));
+        TypeIndex *tindex = *(types.get(fullname));
 
         sBytes->setPosition(tindex->position);
     }
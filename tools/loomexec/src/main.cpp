@@ -26,6 +26,7 @@
 #include "loom/common/platform/platformTime.h"
 #include "loom/common/platform/platformNetwork.h"
 #include "loom/script/runtime/lsLuaState.h"
+#include "loom/script/runtime/lsProfiler.h"
 #include "loom/script/native/lsNativeDelegate.h"
 #include "loom/script/common/lsLog.h"
 #include "loom/script/common/lsFile.h"
@@ -38,6 +39,8 @@ static utString   assemblyPath  = "bin/Main.loom";
 static LSLuaState *execState    = NULL;
 static Assembly   *execAssembly = NULL;
 static utArray<utString> argSwitches;
+static utString   sampleProfilePath;
+static int        sampleInterval = 1000;
 
 lmDefineLogGroup(applicationLogGroup, "app", 1, LoomLogInfo);
 lmDefineLogGroup(scriptLogGroup, "script", 1, LoomLogInfo);
@@ -117,6 +120,16 @@ static void initialize(int argc, const char **argv)
 
     if (argSwitches.find("--verbose") != UT_NPOS) LSLogSetLevel(LSLogDebug);
     if (argSwitches.find("--ignore-missing-types") != UT_NPOS) Type::ignoreMissingTypes = true;
+    if (argSwitches.find("--jit") != UT_NPOS) LSLuaState::setJITCompilerDefault(true);
+
+    // --sample-profile=<file> writes folded script stacks for a flamegraph,
+    // --sample-interval=<microseconds> sets how often the stack is sampled.
+    for (UTsize i = 0; i < argSwitches.size(); i++)
+    {
+        const char *sw = argSwitches[i].c_str();
+        if (strncmp(sw, "--sample-profile=", 17) == 0) sampleProfilePath = sw + 17;
+        if (strncmp(sw, "--sample-interval=", 18) == 0) sampleInterval = atoi(sw + 18);
+    }
 
     // look for passing a .loom file
     for (int i = argStart; i < argc; i++ )
@@ -178,6 +191,19 @@ int main(int argc, const char **argv)
     initialize(argc, argv);
 
     initExecState();
+
+    if (sampleProfilePath.size() > 0)
+    {
+        LSProfiler::enableSampling(execState->VM(), sampleInterval);
+    }
+
     executeAssembly();
+
+    if (sampleProfilePath.size() > 0)
+    {
+        LSProfiler::disableSampling(execState->VM());
+        LSProfiler::writeSamples(sampleProfilePath.c_str());
+    }
+
     shutdownExecState();
 }